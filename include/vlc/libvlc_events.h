@@ -86,6 +86,7 @@ enum libvlc_event_e {
     libvlc_MediaPlayerAudioVolume,
     libvlc_MediaPlayerAudioDevice,
     libvlc_MediaPlayerChapterChanged,
+    libvlc_MediaPlayerStartupStage,
 
     libvlc_MediaListItemAdded=0x200,
     libvlc_MediaListWillAddItem,
@@ -275,6 +276,12 @@ typedef struct libvlc_event_t
             const char *device;
         } media_player_audio_device;
 
+        struct
+        {
+            int     stage; /**< \see libvlc_startup_stage_t */
+            int64_t delay; /**< microseconds since the playback request */
+        } media_player_startup_stage;
+
         struct
         {
             libvlc_renderer_item_t *item;
@@ -693,6 +693,10 @@ LIBVLC_API libvlc_time_t
  *
  * \note Parsing can be aborted with libvlc_media_parse_stop().
  *
+ * \note Requests with libvlc_media_do_interact are processed before the
+ * other pending ones. Calling this function again with this flag while the
+ * request is still pending moves it ahead (and returns -1).
+ *
  * \see libvlc_MediaParsedChanged
  * \see libvlc_media_get_meta
  * \see libvlc_media_tracks_get
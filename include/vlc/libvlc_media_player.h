@@ -160,6 +160,27 @@ typedef enum libvlc_teletext_key_t {
     libvlc_teletext_key_index = 'i' << 16,
 } libvlc_teletext_key_t;
 
+/**
+ * Startup stages of the media player, reported by the
+ * libvlc_MediaPlayerStartupStage event.
+ *
+ * Each stage is reported once, the first time it is reached. Some stages
+ * are skipped depending on the media, e.g. there is no access nor stream
+ * filter stage for capture devices, and no picture stage for audio files.
+ *
+ * \version LibVLC 3.0.22 or later
+ */
+typedef enum libvlc_startup_stage_t {
+    libvlc_startup_access, /**< Access opened */
+    libvlc_startup_stream_filter, /**< Stream filters set up */
+    libvlc_startup_demux, /**< Demux probed and opened */
+    libvlc_startup_first_block, /**< First block out of the demux */
+    libvlc_startup_decoder, /**< First decoder loaded */
+    libvlc_startup_first_frame, /**< First audio or video frame decoded */
+    libvlc_startup_first_picture, /**< First picture displayed */
+    libvlc_startup_first_audio, /**< First audio samples played */
+} libvlc_startup_stage_t;
+
 /**
  * Opaque equalizer handle.
  *
@@ -26,6 +26,7 @@
 #define VLC_FILTER_H 1
 
 #include <vlc_es.h>
+#include <vlc_block.h>
 
 /**
  * \defgroup filter Filters
@@ -52,6 +53,10 @@ typedef struct filter_owner_t
         {
             subpicture_t * (*buffer_new)( filter_t * );
         } sub;
+        struct
+        {
+            block_t * (*buffer_new)( filter_t *, size_t );
+        } audio;
     };
 } filter_owner_t;
 
@@ -186,6 +191,51 @@ static inline void filter_ChangeViewpoint( filter_t *p_filter,
         p_filter->pf_change_viewpoint( p_filter, vp );
 }
 
+/**
+ * This function will return a new block usable by p_filter as an audio output
+ * buffer, recycled by the owner if it supports it. The block may have more
+ * room than requested after its payload, for the next filters to grow the
+ * samples in place.
+ *
+ * \param p_filter filter_t object
+ * \param i_size payload size in bytes
+ * \return new block on success or NULL on failure
+ */
+static inline block_t *filter_NewAudioBuffer( filter_t *p_filter,
+                                              size_t i_size )
+{
+    if( p_filter->owner.audio.buffer_new != NULL )
+        return p_filter->owner.audio.buffer_new( p_filter, i_size );
+    return block_Alloc( i_size );
+}
+
+/**
+ * This function will return an audio output buffer of i_size bytes for
+ * p_in. If p_in has enough room after its payload, it is resized and
+ * returned, so that the samples can be processed in place (backward if they
+ * grow). Otherwise, a new buffer with the properties of p_in is returned and
+ * p_in is left untouched: the caller releases it when done.
+ *
+ * \param p_filter filter_t object
+ * \param p_in input block
+ * \param i_size output payload size in bytes
+ * \return p_in, a new block, or NULL on failure
+ */
+static inline block_t *filter_GetAudioOutput( filter_t *p_filter,
+                                              block_t *p_in, size_t i_size )
+{
+    if( (size_t)(p_in->p_start + p_in->i_size - p_in->p_buffer) >= i_size )
+    {
+        p_in->i_buffer = i_size;
+        return p_in;
+    }
+
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_size );
+    if( p_out != NULL )
+        block_CopyProperties( p_out, p_in );
+    return p_out;
+}
+
 /**
  * This function will drain, then flush an audio filter.
  */
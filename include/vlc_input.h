@@ -385,6 +385,9 @@ typedef enum input_event_type_e
     /* A vout_thread_t object has been created/deleted by *the input* */
     INPUT_EVENT_VOUT,
 
+    /* A startup stage has been reached (see INPUT_GET_STARTUP) */
+    INPUT_EVENT_STARTUP,
+
 } input_event_type_e;
 
 /**
@@ -487,6 +490,9 @@ enum input_query_e
     /* External clock managments */
     INPUT_GET_PCR_SYSTEM,   /* arg1=vlc_tick_t *, arg2=vlc_tick_t *       res=can fail */
     INPUT_MODIFY_PCR_SYSTEM,/* arg1=int absolute, arg2=vlc_tick_t   res=can fail */
+
+    /* Startup tracing */
+    INPUT_GET_STARTUP,      /* arg1=int64_t[INPUT_STARTUP_COUNT]   res=cannot fail */
 };
 
 /** @}*/
@@ -542,6 +548,18 @@ input_thread_t *input_CreateAndStart( vlc_object_t *parent,
  */
 VLC_API input_item_t* input_GetItem( input_thread_t * ) VLC_USED;
 
+/**
+ * Get all the inputs of the instance, except the preparsing ones
+ *
+ * Each returned input is held, and must be released with
+ * vlc_object_release(). The table must be freed with free().
+ *
+ * \param count pointer to the number of returned inputs
+ * \return a table of inputs, or NULL if there are none
+ */
+VLC_API input_thread_t ** input_GetAll( vlc_object_t *, size_t *count ) VLC_USED;
+#define input_GetAll(a,b) input_GetAll(VLC_OBJECT(a),b)
+
 /**
  * It will return the current state of the input.
  * Provided for convenience.
@@ -365,7 +365,9 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    META_REQUEST_OPTION_PRIORITY_LOW  = 0x08, /* bulk request */
+    META_REQUEST_OPTION_PRIORITY_HIGH = 0x10, /* someone is waiting for it */
 } input_item_meta_request_option_t;
 
 /* status of the vlc_InputItemPreparseEnded event */
@@ -382,11 +384,42 @@ VLC_API int libvlc_MetadataRequest( libvlc_int_t *, input_item_t *,
                                     int, void * );
 VLC_API int libvlc_ArtRequest(libvlc_int_t *, input_item_t *,
                               input_item_meta_request_option_t );
+VLC_API void libvlc_MetadataPrioritize( libvlc_int_t *, void *,
+                                       input_item_meta_request_option_t );
 VLC_API void libvlc_MetadataCancel( libvlc_int_t *, void * );
 
 /******************
  * Input stats
  ******************/
+/**
+ * Input startup stages
+ *
+ * Each stage is timed once, the first time it is reached. Some stages are
+ * skipped depending on the input: there is no access nor stream filter with
+ * an access demux, and no audio or video output with some media.
+ */
+enum input_startup_stage_e
+{
+    INPUT_STARTUP_ACCESS, /**< Access opened */
+    INPUT_STARTUP_STREAM_FILTER, /**< Stream filter chain built */
+    INPUT_STARTUP_DEMUX, /**< Demux probed and opened */
+    INPUT_STARTUP_FIRST_BLOCK, /**< First block out of the demux */
+    INPUT_STARTUP_DECODER, /**< First decoder module loaded */
+    INPUT_STARTUP_FIRST_FRAME, /**< First audio or video frame decoded */
+    INPUT_STARTUP_FIRST_PICTURE, /**< First picture displayed */
+    INPUT_STARTUP_FIRST_AUDIO, /**< First audio samples played */
+};
+#define INPUT_STARTUP_COUNT (INPUT_STARTUP_FIRST_AUDIO + 1)
+
+/**
+ * Number of buckets of the clock jitter histogram.
+ *
+ * The bucket i counts the clock references received less than 2^i
+ * milliseconds away from their expected date (and not counted in a lower
+ * bucket). The last bucket counts all the other ones.
+ */
+#define INPUT_CLOCK_JITTER_BUCKETS 10
+
 struct input_stats_t
 {
     vlc_mutex_t         lock;
@@ -408,6 +441,7 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    int64_t i_decoder_buffered; /* bytes waiting in the decoder queues */
 
     /* Vout */
     int64_t i_displayed_pictures;
@@ -421,6 +455,16 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+    int64_t i_audio_drift; /* last measured drift, in microseconds */
+
+    /* Clock of the selected program */
+    int64_t i_clock_drift; /* drift estimation, in microseconds */
+    int64_t i_clock_resets; /* reference points set */
+    int64_t i_clock_jitter[INPUT_CLOCK_JITTER_BUCKETS];
+    int64_t i_clock_jitter_sum; /* in microseconds */
+
+    /* Startup, in microseconds since the input start, or -1 if not reached */
+    int64_t i_startup[INPUT_STARTUP_COUNT];
 };
 
 /**
@@ -48,6 +48,7 @@ enum vlc_module_properties
     VLC_MODULE_DESCRIPTION,
     VLC_MODULE_HELP,
     VLC_MODULE_TEXTDOMAIN,
+    VLC_MODULE_SIGNATURE,
     /* Insert new VLC_MODULE_* here */
 
     /* DO NOT EVER REMOVE, INSERT OR REPLACE ANY ITEM! It would break the ABI!
@@ -285,6 +286,17 @@ VLC_METADATA_EXPORTS
         goto error; \
 }
 
+/**
+ * Declares the magic bytes found at the given offset of the data that the
+ * module handles. If a module declares signatures, data matching none of
+ * them is assumed to be rejected by the module unless it is forced.
+ * The magic cannot contain null bytes.
+ */
+#define add_signature( offset, magic ) \
+    if (vlc_module_set (VLC_MODULE_SIGNATURE, (unsigned)(offset), \
+                        (const char *)(magic))) \
+        goto error;
+
 #define set_shortname( shortname ) \
     if (vlc_module_set (VLC_MODULE_SHORTNAME, (const char *)(shortname))) \
         goto error;
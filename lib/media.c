@@ -769,7 +769,10 @@ libvlc_media_get_duration( libvlc_media_t * p_md )
 static int media_parse(libvlc_media_t *media, bool b_async,
                        libvlc_media_parse_flag_t parse_flag, int timeout)
 {
+    libvlc_int_t *libvlc = media->p_libvlc_instance->p_libvlc_int;
     bool needed;
+    /* Someone is waiting for the result: do not queue it behind the others */
+    const bool urgent = !b_async || (parse_flag & libvlc_media_do_interact);
 
     vlc_mutex_lock(&media->parsed_lock);
     needed = !media->has_asked_preparse;
@@ -780,7 +783,6 @@ static int media_parse(libvlc_media_t *media, bool b_async,
 
     if (needed)
     {
-        libvlc_int_t *libvlc = media->p_libvlc_instance->p_libvlc_int;
         input_item_t *item = media->p_input_item;
         input_item_meta_request_option_t parse_scope = META_REQUEST_OPTION_SCOPE_LOCAL;
         int ret;
@@ -799,12 +801,20 @@ static int media_parse(libvlc_media_t *media, bool b_async,
             parse_scope |= META_REQUEST_OPTION_SCOPE_NETWORK;
         if (parse_flag & libvlc_media_do_interact)
             parse_scope |= META_REQUEST_OPTION_DO_INTERACT;
+        if (urgent)
+            parse_scope |= META_REQUEST_OPTION_PRIORITY_HIGH;
         ret = libvlc_MetadataRequest(libvlc, item, parse_scope, timeout, media);
         if (ret != VLC_SUCCESS)
             return ret;
     }
     else
+    {
+        /* Move a pending request ahead of the others */
+        if (urgent)
+            libvlc_MetadataPrioritize(libvlc, media,
+                                      META_REQUEST_OPTION_PRIORITY_HIGH);
         return VLC_EGENERIC;
+    }
 
     if (!b_async)
     {
@@ -289,6 +289,17 @@ input_scrambled_changed( vlc_object_t * p_this, char const * psz_cmd,
     return VLC_SUCCESS;
 }
 
+static_assert(
+    INPUT_STARTUP_ACCESS        == (int) libvlc_startup_access &&
+    INPUT_STARTUP_STREAM_FILTER == (int) libvlc_startup_stream_filter &&
+    INPUT_STARTUP_DEMUX         == (int) libvlc_startup_demux &&
+    INPUT_STARTUP_FIRST_BLOCK   == (int) libvlc_startup_first_block &&
+    INPUT_STARTUP_DECODER       == (int) libvlc_startup_decoder &&
+    INPUT_STARTUP_FIRST_FRAME   == (int) libvlc_startup_first_frame &&
+    INPUT_STARTUP_FIRST_PICTURE == (int) libvlc_startup_first_picture &&
+    INPUT_STARTUP_FIRST_AUDIO   == (int) libvlc_startup_first_audio,
+    "Mismatch between libvlc_startup_stage_t and input_startup_stage_e" );
+
 static int
 input_event_changed( vlc_object_t * p_this, char const * psz_cmd,
                      vlc_value_t oldval, vlc_value_t newval,
@@ -397,6 +408,32 @@ input_event_changed( vlc_object_t * p_this, char const * psz_cmd,
         event.u.media_player_vout.new_count = i_vout;
         libvlc_event_send( &p_mi->event_manager, &event );
     }
+    else if( newval.i_int == INPUT_EVENT_STARTUP )
+    {
+        int64_t delay[INPUT_STARTUP_COUNT];
+        unsigned reported;
+
+        input_Control( p_input, INPUT_GET_STARTUP, delay );
+
+        /* Several stages may have been reached since the last event */
+        lock( p_mi );
+        reported = p_mi->startup_stages;
+        for( unsigned i = 0; i < INPUT_STARTUP_COUNT; i++ )
+            if( delay[i] >= 0 )
+                p_mi->startup_stages |= 1u << i;
+        unlock( p_mi );
+
+        event.type = libvlc_MediaPlayerStartupStage;
+        for( unsigned i = 0; i < INPUT_STARTUP_COUNT; i++ )
+        {
+            if( delay[i] < 0 || (reported & (1u << i)) )
+                continue;
+
+            event.u.media_player_startup_stage.stage = i;
+            event.u.media_player_startup_stage.delay = delay[i];
+            libvlc_event_send( &p_mi->event_manager, &event );
+        }
+    }
     else if ( newval.i_int == INPUT_EVENT_TITLE )
     {
         event.type = libvlc_MediaPlayerTitleChanged;
@@ -980,6 +1017,7 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
 
     for( size_t i = 0; i < ARRAY_SIZE( p_mi->selected_es ); ++i )
         p_mi->selected_es[i] = ES_INIT;
+    p_mi->startup_stages = 0;
 
     media_attach_preparsed_event( p_mi->p_md );
 
@@ -57,6 +57,7 @@ struct libvlc_media_player_t
     libvlc_state_t state;
     vlc_viewpoint_t viewpoint;
     int selected_es[3];
+    unsigned startup_stages; /* startup stages already reported */
 };
 
 /* Media player - audio, video */
@@ -0,0 +1,1137 @@
+/*****************************************************************************
+ * llhls.c: low-latency HTTP Live Streaming (CMAF) output
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef HAVE_POLL
+# include <poll.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_arrays.h>
+#include <vlc_memstream.h>
+#include <vlc_network.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define SOUT_CFG_PREFIX "sout-llhls-"
+#define SEGLEN_TEXT N_("Segment length")
+#define SEGLEN_LONGTEXT N_("Minimum length of the segments, in seconds. " \
+                           "Segments start on keyframes.")
+#define NUMSEGS_TEXT N_("Number of segments")
+#define NUMSEGS_LONGTEXT N_("Number of complete segments to keep " \
+                            "in the playlist")
+#define PARTSEGS_TEXT N_("Segments with parts")
+#define PARTSEGS_LONGTEXT N_("Number of recent segments whose partial " \
+                             "segments are listed in the playlist")
+
+vlc_module_begin ()
+    set_description( N_("Low-latency HTTP Live Streaming output") )
+    set_shortname( N_("LL-HLS" ))
+    add_shortcut( "llhls" )
+    set_capability( "sout access", 0 )
+    set_category( CAT_SOUT )
+    set_subcategory( SUBCAT_SOUT_ACO )
+    add_integer( SOUT_CFG_PREFIX "seglen", 4, SEGLEN_TEXT, SEGLEN_LONGTEXT, false )
+        change_integer_range( 1, 60 )
+    add_integer( SOUT_CFG_PREFIX "numsegs", 6, NUMSEGS_TEXT, NUMSEGS_LONGTEXT, false )
+        change_integer_range( 2, 1000 )
+    add_integer( SOUT_CFG_PREFIX "partsegs", 2, PARTSEGS_TEXT, PARTSEGS_LONGTEXT, true )
+        change_integer_range( 1, 1000 )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Exported prototypes
+ *****************************************************************************/
+static const char *const ppsz_sout_options[] = {
+    "seglen",
+    "numsegs",
+    "partsegs",
+    NULL
+};
+
+static ssize_t Write( sout_access_out_t *, block_t * );
+static int Control( sout_access_out_t *, int, va_list );
+
+/* The muxer output (mp4frag) is split on its top-level boxes: ftyp and moov
+ * make the initialization section, each moof and the following mdat make a
+ * partial segment. Segments are runs of partial segments starting with an
+ * independent one (no leading non-sync sample).
+ *
+ * Everything is served from memory, on fixed URLs, with the sequence and
+ * part numbers in the query string:
+ *   <path>/index.m3u8[?_HLS_msn=N[&_HLS_part=M]]
+ *   <path>/init.mp4
+ *   <path>/media.mp4?msn=N[&part=M]
+ *
+ * Blocking playlist reloads and requests for the preload hinted part are
+ * held until the media is published. The httpd host thread serves all its
+ * clients and cannot defer a response, so this output runs its own minimal
+ * HTTP/1.1 server instead, with one thread per connection.
+ *
+ * The target durations cannot change during the stream. The part target
+ * is the fragment duration announced by mp4frag, or else the longest part
+ * of the first segment, since the playlist is only served once that
+ * segment is complete. The target duration is the segment length, plus
+ * the half part by which a segment may overrun it. */
+
+#define MAX_CLIENTS  128
+#define MAX_REQUEST  8192   /* bytes of request line and headers */
+#define IDLE_TIMEOUT 30000  /* ms without request on a connection */
+
+typedef struct
+{
+    uint8_t     *p_data;
+    size_t      i_data;
+    vlc_tick_t  i_duration;
+    bool        b_independent;
+} llhls_part_t;
+
+typedef struct
+{
+    unsigned int    i_msn;
+    vlc_tick_t      i_duration;
+    bool            b_complete;
+    int             i_parts;
+    llhls_part_t    **pp_parts;
+} llhls_segment_t;
+
+typedef struct
+{
+    sout_access_out_t   *p_access;
+    vlc_thread_t        thread;
+    int                 fd;
+    bool                b_done; /* the thread can be joined, under lock */
+} llhls_client_t;
+
+struct sout_access_out_sys_t
+{
+    /* HTTP server, the clients are only handled by the listen thread */
+    int                 *pi_listen_fd;
+    vlc_thread_t        listen_thread;
+    char                *psz_path;
+    int                 i_clients;
+    llhls_client_t      **pp_clients;
+
+    vlc_tick_t          i_seglen;
+    int                 i_numsegs;
+    int                 i_partsegs;
+
+    /* Box parser state, only used by the stream output thread */
+    vlc_fourcc_t        i_box;
+    uint64_t            i_box_remaining;
+    struct vlc_memstream init;
+    bool                b_init_open;
+    struct vlc_memstream part;
+    bool                b_part_open;
+    bool                b_part_independent;
+    vlc_tick_t          i_part_start;
+    vlc_tick_t          i_part_end;
+    bool                b_part_warned;
+
+    /* Published media, protected by lock */
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait; /* signaled on each new part */
+    bool                b_closing;
+    vlc_tick_t          i_part_target; /* 0 until known */
+    vlc_tick_t          i_target_duration;
+    uint8_t             *p_init;
+    size_t              i_init;
+    int                 i_segments;
+    llhls_segment_t     **pp_segments;
+    unsigned int        i_next_msn;
+};
+
+/*****************************************************************************
+ * Media publication
+ *****************************************************************************/
+static void SegmentDelete( llhls_segment_t *p_seg )
+{
+    for( int i = 0; i < p_seg->i_parts; i++ )
+    {
+        free( p_seg->pp_parts[i]->p_data );
+        free( p_seg->pp_parts[i] );
+    }
+    TAB_CLEAN( p_seg->i_parts, p_seg->pp_parts );
+    free( p_seg );
+}
+
+static llhls_segment_t *CurrentSegment( sout_access_out_sys_t *p_sys )
+{
+    if( p_sys->i_segments == 0 )
+        return NULL;
+    llhls_segment_t *p_seg = p_sys->pp_segments[p_sys->i_segments - 1];
+    return p_seg->b_complete ? NULL : p_seg;
+}
+
+static llhls_segment_t *FindSegment( const sout_access_out_sys_t *p_sys,
+                                     unsigned int i_msn )
+{
+    if( p_sys->i_segments == 0 )
+        return NULL;
+    const unsigned int i_first = p_sys->pp_segments[0]->i_msn;
+    if( i_msn < i_first || i_msn - i_first >= (unsigned)p_sys->i_segments )
+        return NULL;
+    return p_sys->pp_segments[i_msn - i_first];
+}
+
+static void SetPartTarget( sout_access_out_sys_t *p_sys,
+                           vlc_tick_t i_part_target )
+{
+    p_sys->i_part_target = i_part_target;
+    /* A segment is closed before the first independent part which would
+     * take it more than half a part past the segment length */
+    p_sys->i_target_duration = ( p_sys->i_seglen + i_part_target / 2 +
+                                 CLOCK_FREQ / 2 ) / CLOCK_FREQ * CLOCK_FREQ;
+}
+
+/* Completes the current segment, and drops those out of the window */
+static void CloseSegment( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    llhls_segment_t *p_seg = CurrentSegment( p_sys );
+
+    if( p_seg == NULL )
+        return;
+    p_seg->b_complete = true;
+
+    if( p_sys->i_part_target == 0 )
+    {
+        /* No fragment duration from the muxer, the first segment tells */
+        vlc_tick_t i_max = 0;
+        for( int i = 0; i < p_seg->i_parts; i++ )
+            i_max = __MAX( i_max, p_seg->pp_parts[i]->i_duration );
+        SetPartTarget( p_sys, ( i_max + CLOCK_FREQ / 1000 - 1 ) /
+                              ( CLOCK_FREQ / 1000 ) * ( CLOCK_FREQ / 1000 ) );
+        msg_Dbg( p_access, "part target %"PRId64" ms",
+                 p_sys->i_part_target / 1000 );
+    }
+
+    /* The durations are rounded to the nearest second against it */
+    if( p_seg->i_duration >= p_sys->i_target_duration + CLOCK_FREQ / 2 )
+        msg_Warn( p_access, "segment %u lasts %"PRId64" ms, more than the "
+                  "target duration (sparse keyframes?)", p_seg->i_msn,
+                  p_seg->i_duration / 1000 );
+
+    while( p_sys->i_segments > p_sys->i_numsegs )
+    {
+        llhls_segment_t *p_old = p_sys->pp_segments[0];
+        TAB_ERASE( p_sys->i_segments, p_sys->pp_segments, 0 );
+        SegmentDelete( p_old );
+    }
+
+    msg_Dbg( p_access, "segment %u complete, %d parts, %"PRId64" ms",
+             p_seg->i_msn, p_seg->i_parts, p_seg->i_duration / 1000 );
+}
+
+static void PublishPart( sout_access_out_t *p_access, llhls_part_t *p_part )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+
+    llhls_segment_t *p_seg = CurrentSegment( p_sys );
+    if( p_seg != NULL && p_part->b_independent &&
+        p_seg->i_duration + p_part->i_duration / 2 >= p_sys->i_seglen )
+    {
+        CloseSegment( p_access );
+        p_seg = NULL;
+    }
+
+    if( p_seg == NULL )
+    {
+        if( !p_part->b_independent && p_sys->i_segments == 0 )
+        {
+            /* Players cannot start on it */
+            vlc_mutex_unlock( &p_sys->lock );
+            free( p_part->p_data );
+            free( p_part );
+            return;
+        }
+
+        p_seg = calloc( 1, sizeof( *p_seg ) );
+        if( unlikely(p_seg == NULL) )
+        {
+            vlc_mutex_unlock( &p_sys->lock );
+            free( p_part->p_data );
+            free( p_part );
+            return;
+        }
+        p_seg->i_msn = p_sys->i_next_msn++;
+        TAB_APPEND( p_sys->i_segments, p_sys->pp_segments, p_seg );
+    }
+
+    TAB_APPEND( p_seg->i_parts, p_seg->pp_parts, p_part );
+    p_seg->i_duration += p_part->i_duration;
+
+    /* Held requests may be answered */
+    vlc_cond_broadcast( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+/*****************************************************************************
+ * Muxer output parsing
+ *****************************************************************************/
+
+/* A fragment is independent unless one of its track runs starts with a
+ * non-sync sample. mp4frag flags those with the first sample flags. */
+static bool MoofIsIndependent( const uint8_t *p_moof, size_t i_moof )
+{
+    for( size_t i = 8; i + 8 <= i_moof; )
+    {
+        const uint32_t i_size = GetDWBE( &p_moof[i] );
+        if( i_size < 8 || i_size > i_moof - i )
+            break;
+
+        if( !memcmp( &p_moof[i + 4], "traf", 4 ) )
+        {
+            for( size_t j = i + 8; j + 8 <= i + i_size; )
+            {
+                const uint32_t i_child = GetDWBE( &p_moof[j] );
+                if( i_child < 8 || i_child > i + i_size - j )
+                    break;
+
+                if( !memcmp( &p_moof[j + 4], "trun", 4 ) && i_child >= 16 )
+                {
+                    const uint32_t i_flags = GetDWBE( &p_moof[j + 8] ) & 0xffffff;
+                    const size_t i_offset = j + 16 + ( ( i_flags & 0x1 ) ? 4 : 0 );
+                    if( ( i_flags & 0x4 ) && i_offset + 4 <= j + i_child &&
+                        ( GetDWBE( &p_moof[i_offset] ) & 0x10000 ) )
+                        return false;
+                }
+                j += i_child;
+            }
+        }
+        i += i_size;
+    }
+
+    return true;
+}
+
+static void EndPart( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->b_part_open = false;
+    if( vlc_memstream_close( &p_sys->part ) )
+        return;
+
+    llhls_part_t *p_part = malloc( sizeof( *p_part ) );
+    if( unlikely(p_part == NULL) )
+    {
+        free( p_sys->part.ptr );
+        return;
+    }
+    p_part->p_data = (uint8_t *)p_sys->part.ptr;
+    p_part->i_data = p_sys->part.length;
+    p_part->b_independent = p_sys->b_part_independent;
+    /* Without timestamps, the fragment is assumed to be as long as
+     * requested from the muxer, by default 1.5s with mp4frag. The part
+     * target is only set from the stream output thread. */
+    p_part->i_duration = p_sys->i_part_end > p_sys->i_part_start ?
+                         p_sys->i_part_end - p_sys->i_part_start :
+                         p_sys->i_part_target > 0 ? p_sys->i_part_target :
+                                                    CLOCK_FREQ * 3 / 2;
+
+    if( p_sys->i_part_target > 0 &&
+        p_part->i_duration > p_sys->i_part_target && !p_sys->b_part_warned )
+    {
+        msg_Warn( p_access, "part lasts %"PRId64" ms, more than the part "
+                  "target (the mp4 fragment duration)",
+                  p_part->i_duration / 1000 );
+        p_sys->b_part_warned = true;
+    }
+
+    PublishPart( p_access, p_part );
+}
+
+static void EndInit( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->b_init_open = false;
+    if( vlc_memstream_close( &p_sys->init ) )
+        return;
+
+    vlc_mutex_lock( &p_sys->lock );
+    free( p_sys->p_init );
+    p_sys->p_init = (uint8_t *)p_sys->init.ptr;
+    p_sys->i_init = p_sys->init.length;
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+/* Starts a top-level box. Returns the header size, or 0 on error. */
+static size_t BeginBox( sout_access_out_t *p_access,
+                        const uint8_t *p_data, size_t i_data )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( i_data < 8 )
+        return 0;
+
+    size_t i_header = 8;
+    uint64_t i_size = GetDWBE( p_data );
+    if( i_size == 1 && i_data >= 16 )
+    {
+        i_size = GetQWBE( &p_data[8] );
+        i_header = 16;
+    }
+    if( i_size < i_header )
+        return 0;
+
+    p_sys->i_box = VLC_FOURCC( p_data[4], p_data[5], p_data[6], p_data[7] );
+    p_sys->i_box_remaining = i_size;
+
+    switch( p_sys->i_box )
+    {
+        case VLC_FOURCC('f','t','y','p'):
+            if( p_sys->b_init_open )
+                free( vlc_memstream_close( &p_sys->init ) ? NULL : p_sys->init.ptr );
+            p_sys->b_init_open = !vlc_memstream_open( &p_sys->init );
+            break;
+
+        case VLC_FOURCC('m','o','o','f'):
+            if( p_sys->b_part_open )
+            {
+                msg_Warn( p_access, "fragment without media data" );
+                free( vlc_memstream_close( &p_sys->part ) ? NULL : p_sys->part.ptr );
+            }
+            p_sys->b_part_open = !vlc_memstream_open( &p_sys->part );
+            p_sys->b_part_independent = i_size <= i_data &&
+                                        MoofIsIndependent( p_data, i_size );
+            p_sys->i_part_start = INT64_MAX;
+            p_sys->i_part_end = INT64_MIN;
+            break;
+    }
+
+    return i_header;
+}
+
+static void WriteBox( sout_access_out_t *p_access,
+                      const uint8_t *p_data, size_t i_data )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    switch( p_sys->i_box )
+    {
+        case VLC_FOURCC('f','t','y','p'):
+        case VLC_FOURCC('m','o','o','v'):
+            if( p_sys->b_init_open )
+                vlc_memstream_write( &p_sys->init, p_data, i_data );
+            break;
+
+        case VLC_FOURCC('m','o','o','f'):
+        case VLC_FOURCC('m','d','a','t'):
+            if( p_sys->b_part_open )
+                vlc_memstream_write( &p_sys->part, p_data, i_data );
+            break;
+
+        default: /* mfra and others have no use in a live stream */
+            break;
+    }
+
+    p_sys->i_box_remaining -= i_data;
+    if( p_sys->i_box_remaining > 0 )
+        return;
+
+    if( p_sys->i_box == VLC_FOURCC('m','o','o','v') && p_sys->b_init_open )
+        EndInit( p_access );
+    else if( p_sys->i_box == VLC_FOURCC('m','d','a','t') && p_sys->b_part_open )
+        EndPart( p_access );
+}
+
+/*****************************************************************************
+ * HTTP requests, answered with the lock held
+ *****************************************************************************/
+static bool GetQueryValue( const char *psz_query, const char *psz_name,
+                           unsigned int *pi_value )
+{
+    const size_t i_name = strlen( psz_name );
+
+    while( psz_query != NULL )
+    {
+        if( !strncmp( psz_query, psz_name, i_name ) && psz_query[i_name] == '=' )
+        {
+            const char *psz_value = &psz_query[i_name + 1];
+            char *psz_end;
+            unsigned long i_value = strtoul( psz_value, &psz_end, 10 );
+            if( psz_end == psz_value || i_value > UINT_MAX )
+                return false;
+            *pi_value = i_value;
+            return true;
+        }
+        psz_query = strchr( psz_query, '&' );
+        if( psz_query != NULL )
+            psz_query++;
+    }
+    return false;
+}
+
+/* Players give up on requests held for more than three target durations */
+static vlc_tick_t HoldDeadline( const sout_access_out_sys_t *p_sys )
+{
+    return mdate() + 3 * ( p_sys->i_target_duration > 0 ?
+                           p_sys->i_target_duration : p_sys->i_seglen );
+}
+
+static void PrintPart( struct vlc_memstream *p_stream,
+                       const llhls_segment_t *p_seg, int i )
+{
+    const llhls_part_t *p_part = p_seg->pp_parts[i];
+
+    vlc_memstream_printf( p_stream, "#EXT-X-PART:DURATION=%.3f,"
+                          "URI=\"media.mp4?msn=%u&part=%d\"%s\n",
+                          (double)p_part->i_duration / CLOCK_FREQ,
+                          p_seg->i_msn, i,
+                          p_part->b_independent ? ",INDEPENDENT=YES" : "" );
+}
+
+static bool PlaylistReady( const sout_access_out_sys_t *p_sys,
+                           bool b_msn, unsigned int i_msn,
+                           bool b_part, unsigned int i_part )
+{
+    /* Nothing is listed until the first segment is complete, players
+     * cannot start without one */
+    if( p_sys->i_segments == 0 ||
+        ( p_sys->i_segments == 1 && !p_sys->pp_segments[0]->b_complete ) )
+        return false;
+    if( !b_msn )
+        return true;
+
+    /* Segments are listed once complete, parts as soon as published */
+    const llhls_segment_t *p_last = p_sys->pp_segments[p_sys->i_segments - 1];
+    if( p_last->i_msn != i_msn )
+        return p_last->i_msn > i_msn;
+    return b_part ? (unsigned)p_last->i_parts > i_part : p_last->b_complete;
+}
+
+static int PlaylistRequest( sout_access_out_sys_t *p_sys,
+                            const char *psz_query,
+                            struct vlc_memstream *p_stream )
+{
+    unsigned int i_msn = 0, i_part = 0;
+    const bool b_msn = GetQueryValue( psz_query, "_HLS_msn", &i_msn );
+    const bool b_part = GetQueryValue( psz_query, "_HLS_part", &i_part );
+
+    /* Blocking reloads may only ask for the next two segments */
+    if( ( b_part && !b_msn ) || ( b_msn && i_msn > p_sys->i_next_msn + 1 ) )
+        return 400;
+
+    const vlc_tick_t i_deadline = HoldDeadline( p_sys );
+    while( !PlaylistReady( p_sys, b_msn, i_msn, b_part, i_part ) )
+        if( !b_msn || p_sys->b_closing ||
+            vlc_cond_timedwait( &p_sys->wait, &p_sys->lock, i_deadline ) )
+            return 503;
+
+    vlc_memstream_printf( p_stream, "#EXTM3U\n"
+                          "#EXT-X-VERSION:6\n"
+                          "#EXT-X-TARGETDURATION:%"PRId64"\n"
+                          "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,"
+                          "PART-HOLD-BACK=%.3f\n"
+                          "#EXT-X-PART-INF:PART-TARGET=%.3f\n"
+                          "#EXT-X-MEDIA-SEQUENCE:%u\n"
+                          "#EXT-X-MAP:URI=\"init.mp4\"\n",
+                          p_sys->i_target_duration / CLOCK_FREQ,
+                          3. * p_sys->i_part_target / CLOCK_FREQ,
+                          (double)p_sys->i_part_target / CLOCK_FREQ,
+                          p_sys->pp_segments[0]->i_msn );
+
+    for( int i = 0; i < p_sys->i_segments; i++ )
+    {
+        const llhls_segment_t *p_seg = p_sys->pp_segments[i];
+
+        /* Parts are listed for the last complete segments */
+        if( i >= p_sys->i_segments - p_sys->i_partsegs - 1 )
+            for( int j = 0; j < p_seg->i_parts; j++ )
+                PrintPart( p_stream, p_seg, j );
+
+        if( p_seg->b_complete )
+            vlc_memstream_printf( p_stream, "#EXTINF:%.3f,\n"
+                                  "media.mp4?msn=%u\n",
+                                  (double)p_seg->i_duration / CLOCK_FREQ,
+                                  p_seg->i_msn );
+    }
+
+    /* The next part, which MediaRequest() holds until it is published */
+    const llhls_segment_t *p_last = p_sys->pp_segments[p_sys->i_segments - 1];
+    vlc_memstream_printf( p_stream, "#EXT-X-PRELOAD-HINT:TYPE=PART,"
+                          "URI=\"media.mp4?msn=%u&part=%d\"\n",
+                          p_last->b_complete ? p_sys->i_next_msn : p_last->i_msn,
+                          p_last->b_complete ? 0 : p_last->i_parts );
+    return 200;
+}
+
+static int InitRequest( sout_access_out_sys_t *p_sys,
+                        struct vlc_memstream *p_stream )
+{
+    if( p_sys->p_init == NULL )
+        return 404;
+    vlc_memstream_write( p_stream, p_sys->p_init, p_sys->i_init );
+    return 200;
+}
+
+/* Parts of the current segment, or the first of the next one, are to come */
+static bool PartPending( const sout_access_out_sys_t *p_sys,
+                         unsigned int i_msn, unsigned int i_part )
+{
+    const llhls_segment_t *p_seg = FindSegment( p_sys, i_msn );
+    if( p_seg == NULL )
+        return i_msn == p_sys->i_next_msn && i_part == 0;
+    return !p_seg->b_complete && i_part >= (unsigned)p_seg->i_parts;
+}
+
+static int MediaRequest( sout_access_out_sys_t *p_sys,
+                         const char *psz_query,
+                         struct vlc_memstream *p_stream )
+{
+    unsigned int i_msn, i_part = UINT_MAX;
+
+    if( !GetQueryValue( psz_query, "msn", &i_msn ) )
+        return 400;
+    GetQueryValue( psz_query, "part", &i_part );
+
+    if( i_part != UINT_MAX )
+    {
+        const vlc_tick_t i_deadline = HoldDeadline( p_sys );
+        while( PartPending( p_sys, i_msn, i_part ) )
+            if( p_sys->b_closing ||
+                vlc_cond_timedwait( &p_sys->wait, &p_sys->lock, i_deadline ) )
+                return 503;
+    }
+
+    const llhls_segment_t *p_seg = FindSegment( p_sys, i_msn );
+
+    if( p_seg == NULL || ( i_part == UINT_MAX && !p_seg->b_complete ) ||
+        ( i_part != UINT_MAX && i_part >= (unsigned)p_seg->i_parts ) )
+        return 404;
+
+    if( i_part != UINT_MAX )
+        vlc_memstream_write( p_stream, p_seg->pp_parts[i_part]->p_data,
+                             p_seg->pp_parts[i_part]->i_data );
+    else
+        for( int i = 0; i < p_seg->i_parts; i++ )
+            vlc_memstream_write( p_stream, p_seg->pp_parts[i]->p_data,
+                                 p_seg->pp_parts[i]->i_data );
+    return 200;
+}
+
+/* Returns the HTTP status, and the body in p_stream if it is 200 */
+static int Answer( sout_access_out_sys_t *p_sys, const char *psz_path,
+                   const char *psz_query, struct vlc_memstream *p_stream,
+                   const char **ppsz_mime )
+{
+    const size_t i_prefix = strlen( p_sys->psz_path );
+
+    if( strncmp( psz_path, p_sys->psz_path, i_prefix ) )
+        return 404;
+    psz_path += i_prefix;
+
+    if( !strcmp( psz_path, "/index.m3u8" ) )
+    {
+        *ppsz_mime = "application/vnd.apple.mpegurl";
+        return PlaylistRequest( p_sys, psz_query, p_stream );
+    }
+
+    *ppsz_mime = "video/mp4";
+    if( !strcmp( psz_path, "/init.mp4" ) )
+        return InitRequest( p_sys, p_stream );
+    if( !strcmp( psz_path, "/media.mp4" ) )
+        return MediaRequest( p_sys, psz_query, p_stream );
+    return 404;
+}
+
+/*****************************************************************************
+ * HTTP server
+ *****************************************************************************/
+
+/* Splits the request head in place. Returns false if it is malformed. */
+static bool ParseRequest( char *psz_head, const char **ppsz_method,
+                          const char **ppsz_path, const char **ppsz_query,
+                          bool *pb_close )
+{
+    /* Each line ends with CRLF, including the last header */
+    char *psz_next = strstr( psz_head, "\r\n" );
+    *psz_next = '\0';
+
+    char *psz_target = strchr( psz_head, ' ' );
+    if( psz_target == NULL )
+        return false;
+    *psz_target++ = '\0';
+    char *psz_version = strchr( psz_target, ' ' );
+    if( psz_version == NULL )
+        return false;
+    *psz_version++ = '\0';
+    if( strncmp( psz_version, "HTTP/1.", 7 ) )
+        return false;
+
+    char *psz_query = strchr( psz_target, '?' );
+    if( psz_query != NULL )
+        *psz_query++ = '\0';
+
+    *ppsz_method = psz_head;
+    *ppsz_path = psz_target;
+    *ppsz_query = psz_query;
+    *pb_close = strcmp( psz_version, "HTTP/1.1" ) != 0;
+
+    /* Only the persistence of the connection matters in the headers */
+    for( char *psz_line = psz_next + 2; *psz_line; psz_line = psz_next + 2 )
+    {
+        psz_next = strstr( psz_line, "\r\n" );
+        *psz_next = '\0';
+
+        if( !strncasecmp( psz_line, "Connection:", 11 ) )
+        {
+            if( strcasestr( psz_line + 11, "close" ) != NULL )
+                *pb_close = true;
+            else if( strcasestr( psz_line + 11, "keep-alive" ) != NULL )
+                *pb_close = false;
+        }
+    }
+    return true;
+}
+
+static const char *StatusText( int i_status )
+{
+    switch( i_status )
+    {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 503: return "Service Unavailable";
+        default:  return "Error";
+    }
+}
+
+static int Respond( struct vlc_memstream *p_stream, int i_status,
+                    const char *psz_mime, const void *p_body, size_t i_body,
+                    bool b_head, bool b_close )
+{
+    vlc_memstream_open( p_stream );
+    vlc_memstream_printf( p_stream, "HTTP/1.1 %d %s\r\n",
+                          i_status, StatusText( i_status ) );
+    if( psz_mime != NULL )
+        vlc_memstream_printf( p_stream, "Content-Type: %s\r\n", psz_mime );
+    vlc_memstream_printf( p_stream, "Content-Length: %zu\r\n"
+                          "Cache-Control: no-cache\r\n%s\r\n", i_body,
+                          b_close ? "Connection: close\r\n" : "" );
+    if( !b_head )
+        vlc_memstream_write( p_stream, p_body, i_body );
+
+    return vlc_memstream_close( p_stream );
+}
+
+/* Writes and frees the response, this is a cancellation point */
+static bool Send( sout_access_out_t *p_access, int fd, char *p_data,
+                  size_t i_data )
+{
+    ssize_t i_sent;
+
+    vlc_cleanup_push( free, p_data );
+    i_sent = net_Write( p_access, fd, p_data, i_data );
+    vlc_cleanup_pop();
+    free( p_data );
+    return i_sent == (ssize_t)i_data;
+}
+
+static void *ClientThread( void *data )
+{
+    llhls_client_t *p_client = data;
+    sout_access_out_t *p_access = p_client->p_access;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    char buf[MAX_REQUEST + 1];
+    size_t i_buf = 0;
+    bool b_close = false;
+
+    while( !b_close )
+    {
+        char *psz_end;
+
+        buf[i_buf] = '\0';
+        while( ( psz_end = strstr( buf, "\r\n\r\n" ) ) == NULL )
+        {
+            struct pollfd ufd = { .fd = p_client->fd, .events = POLLIN };
+
+            if( i_buf >= MAX_REQUEST ||
+                poll( &ufd, 1, IDLE_TIMEOUT ) <= 0 )
+                goto out;
+
+            ssize_t val = recv( p_client->fd, buf + i_buf,
+                                MAX_REQUEST - i_buf, 0 );
+            if( val <= 0 )
+                goto out;
+            i_buf += val;
+            buf[i_buf] = '\0';
+        }
+        psz_end[2] = '\0';
+        const size_t i_request = psz_end + 4 - buf;
+
+        const char *psz_method, *psz_path, *psz_query, *psz_mime = NULL;
+        struct vlc_memstream body, response;
+        bool b_head = false;
+        int i_status;
+
+        /* Only the socket I/O can be cancelled */
+        int canc = vlc_savecancel();
+
+        vlc_memstream_open( &body );
+        if( !ParseRequest( buf, &psz_method, &psz_path, &psz_query,
+                           &b_close ) )
+        {
+            i_status = 400;
+            b_close = true;
+        }
+        else if( strcmp( psz_method, "GET" ) && strcmp( psz_method, "HEAD" ) )
+        {
+            i_status = 405;
+            b_close = true; /* the request body is not read */
+        }
+        else
+        {
+            b_head = !strcmp( psz_method, "HEAD" );
+            vlc_mutex_lock( &p_sys->lock );
+            i_status = Answer( p_sys, psz_path, psz_query, &body, &psz_mime );
+            vlc_mutex_unlock( &p_sys->lock );
+        }
+
+        int i_ret = vlc_memstream_close( &body );
+        if( i_ret == 0 )
+        {
+            if( i_status == 200 )
+                i_ret = Respond( &response, i_status, psz_mime, body.ptr,
+                                 body.length, b_head, b_close );
+            else
+                i_ret = Respond( &response, i_status, NULL, NULL, 0,
+                                 b_head, b_close );
+            free( body.ptr );
+        }
+
+        vlc_restorecancel( canc );
+        if( i_ret )
+            break;
+
+        if( !Send( p_access, p_client->fd, response.ptr, response.length ) )
+            break;
+
+        /* Keep what the client already sent of its next request */
+        i_buf -= i_request;
+        memmove( buf, buf + i_request, i_buf );
+    }
+
+out:
+    vlc_mutex_lock( &p_sys->lock );
+    p_client->b_done = true;
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
+}
+
+/* Joins the threads of the closed connections */
+static void ReapClients( sout_access_out_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_clients; )
+    {
+        llhls_client_t *p_client = p_sys->pp_clients[i];
+
+        vlc_mutex_lock( &p_sys->lock );
+        const bool b_done = p_client->b_done;
+        vlc_mutex_unlock( &p_sys->lock );
+        if( !b_done )
+        {
+            i++;
+            continue;
+        }
+
+        vlc_join( p_client->thread, NULL );
+        net_Close( p_client->fd );
+        free( p_client );
+        TAB_ERASE( p_sys->i_clients, p_sys->pp_clients, i );
+    }
+}
+
+static void *ListenThread( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    for( ;; )
+    {
+        int fd = net_Accept( p_access, p_sys->pi_listen_fd );
+        if( fd == -1 )
+            continue;
+
+        int canc = vlc_savecancel();
+        ReapClients( p_sys );
+
+        llhls_client_t *p_client = NULL;
+        if( p_sys->i_clients < MAX_CLIENTS )
+            p_client = malloc( sizeof( *p_client ) );
+        else
+            msg_Warn( p_access, "too many connections" );
+
+        if( p_client != NULL )
+        {
+            p_client->p_access = p_access;
+            p_client->fd = fd;
+            p_client->b_done = false;
+            if( vlc_clone( &p_client->thread, ClientThread, p_client,
+                           VLC_THREAD_PRIORITY_LOW ) )
+            {
+                free( p_client );
+                p_client = NULL;
+            }
+            else
+                TAB_APPEND( p_sys->i_clients, p_sys->pp_clients, p_client );
+        }
+        if( p_client == NULL )
+            net_Close( fd );
+        vlc_restorecancel( canc );
+    }
+
+    vlc_assert_unreachable();
+}
+
+/*****************************************************************************
+ * Open: open the server
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t   *p_sys;
+
+    if( !( p_sys = p_access->p_sys = calloc( 1, sizeof( *p_sys ) ) ) )
+        return VLC_ENOMEM;
+
+    config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
+
+    p_sys->i_seglen = CLOCK_FREQ * var_GetInteger( p_access, SOUT_CFG_PREFIX "seglen" );
+    p_sys->i_numsegs = var_GetInteger( p_access, SOUT_CFG_PREFIX "numsegs" );
+    p_sys->i_partsegs = var_GetInteger( p_access, SOUT_CFG_PREFIX "partsegs" );
+
+    /* Same destination syntax as the http output: [host][:port][/path] */
+    const char *path = p_access->psz_path;
+    char *psz_host = NULL;
+    int i_port = var_InheritInteger( p_access, "http-port" );
+
+    path += strcspn( path, "/" );
+    if( path > p_access->psz_path )
+    {
+        const char *port = strrchr( p_access->psz_path, ':' );
+        if( port != NULL && strchr( port, ']' ) != NULL )
+            port = NULL; /* IPv6 numeral */
+        if( port != p_access->psz_path )
+            psz_host = strndup( p_access->psz_path,
+                                (port ? port : path) - p_access->psz_path );
+        if( port != NULL && atoi( port + 1 ) > 0 )
+            i_port = atoi( port + 1 );
+    }
+
+    /* URLs are made relative to the path, without its trailing slashes */
+    int i_path = strlen( path );
+    while( i_path > 0 && path[i_path - 1] == '/' )
+        i_path--;
+    p_sys->psz_path = strndup( path, i_path );
+
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait );
+
+    p_sys->pi_listen_fd = net_ListenTCP( p_access, psz_host, i_port );
+    free( psz_host );
+    if( p_sys->pi_listen_fd == NULL )
+    {
+        msg_Err( p_access, "cannot listen on port %d", i_port );
+        goto error;
+    }
+
+    if( p_sys->psz_path == NULL ||
+        vlc_clone( &p_sys->listen_thread, ListenThread, p_access,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        net_ListenClose( p_sys->pi_listen_fd );
+        goto error;
+    }
+
+    msg_Dbg( p_access, "serving playlist %s/index.m3u8 on port %d",
+             p_sys->psz_path, i_port );
+
+    p_access->pf_write       = Write;
+    p_access->pf_control     = Control;
+
+    return VLC_SUCCESS;
+
+error:
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys->psz_path );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close: close the server
+ *****************************************************************************/
+static void Close( vlc_object_t * p_this )
+{
+    sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t   *p_sys = p_access->p_sys;
+
+    vlc_cancel( p_sys->listen_thread );
+    vlc_join( p_sys->listen_thread, NULL );
+    net_ListenClose( p_sys->pi_listen_fd );
+
+    /* Held requests are released, then the connections dropped */
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_closing = true;
+    vlc_cond_broadcast( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    for( int i = 0; i < p_sys->i_clients; i++ )
+    {
+        llhls_client_t *p_client = p_sys->pp_clients[i];
+
+        vlc_cancel( p_client->thread );
+        vlc_join( p_client->thread, NULL );
+        net_Close( p_client->fd );
+        free( p_client );
+    }
+    TAB_CLEAN( p_sys->i_clients, p_sys->pp_clients );
+
+    if( p_sys->b_init_open && !vlc_memstream_close( &p_sys->init ) )
+        free( p_sys->init.ptr );
+    if( p_sys->b_part_open && !vlc_memstream_close( &p_sys->part ) )
+        free( p_sys->part.ptr );
+
+    for( int i = 0; i < p_sys->i_segments; i++ )
+        SegmentDelete( p_sys->pp_segments[i] );
+    TAB_CLEAN( p_sys->i_segments, p_sys->pp_segments );
+    free( p_sys->p_init );
+
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys->psz_path );
+
+    msg_Dbg( p_access, "Close" );
+
+    free( p_sys );
+}
+
+static int Control( sout_access_out_t *p_access, int i_query, va_list args )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    switch( i_query )
+    {
+        case ACCESS_OUT_CONTROLS_PACE:
+            *va_arg( args, bool * ) = false;
+            break;
+
+        case ACCESS_OUT_SET_FRAGMENT_DURATION:
+        {
+            vlc_tick_t i_duration = va_arg( args, vlc_tick_t );
+
+            /* The playlists cannot change it once published */
+            vlc_mutex_lock( &p_sys->lock );
+            bool b_set = i_duration > 0 && p_sys->i_segments == 0;
+            if( b_set )
+                SetPartTarget( p_sys, i_duration );
+            vlc_mutex_unlock( &p_sys->lock );
+
+            if( !b_set )
+                return VLC_EGENERIC;
+            msg_Dbg( p_access, "part target %"PRId64" ms", i_duration / 1000 );
+            break;
+        }
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Write: split the muxer output into the init section and the parts
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_len = 0;
+
+    while( p_buffer )
+    {
+        block_t *p_next = p_buffer->p_next;
+        const uint8_t *p_data = p_buffer->p_buffer;
+        size_t i_data = p_buffer->i_buffer;
+
+        i_len += i_data;
+
+        /* Sample timestamps give the duration of the part */
+        if( p_sys->b_part_open && p_sys->i_box == VLC_FOURCC('m','d','a','t') &&
+            p_sys->i_box_remaining > 0 && p_buffer->i_dts > VLC_TICK_INVALID )
+        {
+            p_sys->i_part_start = __MIN( p_sys->i_part_start, p_buffer->i_dts );
+            p_sys->i_part_end = __MAX( p_sys->i_part_end,
+                                       p_buffer->i_dts + p_buffer->i_length );
+        }
+
+        while( i_data > 0 )
+        {
+            if( p_sys->i_box_remaining == 0 )
+            {
+                size_t i_header = BeginBox( p_access, p_data, i_data );
+                if( i_header == 0 )
+                {
+                    msg_Err( p_access, "invalid box, dropping %zu bytes",
+                             i_data );
+                    break;
+                }
+                WriteBox( p_access, p_data, i_header );
+                p_data += i_header;
+                i_data -= i_header;
+                continue;
+            }
+
+            size_t i_copy = __MIN( (uint64_t)i_data, p_sys->i_box_remaining );
+            WriteBox( p_access, p_data, i_copy );
+            p_data += i_copy;
+            i_data -= i_copy;
+        }
+
+        block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    return i_len;
+}
@@ -0,0 +1,634 @@
+/*****************************************************************************
+ * biquad.c: second order IIR filters on interleaved channels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef BIQUAD_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "biquad.h"
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define BIQUAD_X86 1
+# include <xmmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define BIQUAD_NEON 1
+# include <arm_neon.h>
+#endif
+
+#define L BIQUAD_LANES
+
+/* The states decay through denormal numbers at the end of the signal, which
+ * are very slow to compute on most CPUs. The SSE kernels flush them to zero
+ * in hardware, the other ones flush the states after each block. */
+static void FlushState(float *state, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        if (fabsf(state[i]) < 1e-30f)
+            state[i] = 0.f;
+}
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static void CascadeC(float *out, const float *in, unsigned frames,
+                     unsigned channels, const biquad_coeffs_t *coeffs,
+                     unsigned count, float *state)
+{
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * count * 4 * L;
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+
+            for (unsigned l = 0; l < lanes; l++)
+            {
+                float x = in[pos + l];
+                float *s = st + l;
+
+                for (unsigned k = 0; k < count; k++, s += 4 * L)
+                {
+                    const biquad_coeffs_t *c = &coeffs[k];
+                    float y = x * c->b0 + s[0] * c->b1 + s[L] * c->b2
+                            - s[2 * L] * c->a1 - s[3 * L] * c->a2;
+
+                    s[L] = s[0];
+                    s[0] = x;
+                    s[3 * L] = s[2 * L];
+                    s[2 * L] = y;
+                    x = y;
+                }
+                out[pos + l] = x;
+            }
+        }
+    }
+}
+
+static void BankC(float *out, const float *in, unsigned frames,
+                  unsigned channels, const biquad_band_t *bands,
+                  unsigned count, float in_gain, float out_gain,
+                  float *state)
+{
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * (2 + 2 * count) * L;
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+
+            for (unsigned l = 0; l < lanes; l++)
+            {
+                const float x = in[pos + l];
+                float *s = st + l;
+                float o = 0.f;
+
+                for (unsigned k = 0; k < count; k++)
+                {
+                    const biquad_band_t *b = &bands[k];
+                    float *sy = s + (2 + 2 * k) * L;
+                    float y = b->alpha * (x - s[L]) + b->gamma * sy[0]
+                            - b->beta * sy[L];
+
+                    sy[L] = sy[0];
+                    sy[0] = y;
+                    o += y * b->amp;
+                }
+                s[L] = s[0];
+                s[0] = x;
+                out[pos + l] = out_gain * (in_gain * x + o);
+            }
+        }
+    }
+}
+
+#ifdef BIQUAD_X86
+/*****************************************************************************
+ * SSE
+ *****************************************************************************/
+#define MXCSR_FTZ 0x8000
+
+VLC_SSE
+static inline __m128 LoadSSE(const float *p, unsigned lanes)
+{
+    if (likely(lanes == L))
+        return _mm_loadu_ps(p);
+
+    float v[L] = { 0.f };
+    for (unsigned l = 0; l < lanes; l++)
+        v[l] = p[l];
+    return _mm_loadu_ps(v);
+}
+
+VLC_SSE
+static inline void StoreSSE(float *p, __m128 x, unsigned lanes)
+{
+    if (likely(lanes == L))
+    {
+        _mm_storeu_ps(p, x);
+        return;
+    }
+
+    float v[L];
+    _mm_storeu_ps(v, x);
+    for (unsigned l = 0; l < lanes; l++)
+        p[l] = v[l];
+}
+
+VLC_SSE
+static void CascadeSSE(float *out, const float *in, unsigned frames,
+                       unsigned channels, const biquad_coeffs_t *coeffs,
+                       unsigned count, float *state)
+{
+    const unsigned csr = _mm_getcsr();
+    _mm_setcsr(csr | MXCSR_FTZ);
+
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * count * 4 * L;
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+            __m128 x = LoadSSE(in + pos, lanes);
+            float *s = st;
+
+            for (unsigned k = 0; k < count; k++, s += 4 * L)
+            {
+                const biquad_coeffs_t *c = &coeffs[k];
+                const __m128 x1 = _mm_loadu_ps(s);
+                const __m128 x2 = _mm_loadu_ps(s + L);
+                const __m128 y1 = _mm_loadu_ps(s + 2 * L);
+                const __m128 y2 = _mm_loadu_ps(s + 3 * L);
+                __m128 y = _mm_mul_ps(x, _mm_set1_ps(c->b0));
+
+                y = _mm_add_ps(y, _mm_mul_ps(x1, _mm_set1_ps(c->b1)));
+                y = _mm_add_ps(y, _mm_mul_ps(x2, _mm_set1_ps(c->b2)));
+                y = _mm_sub_ps(y, _mm_mul_ps(y1, _mm_set1_ps(c->a1)));
+                y = _mm_sub_ps(y, _mm_mul_ps(y2, _mm_set1_ps(c->a2)));
+
+                _mm_storeu_ps(s + L, x1);
+                _mm_storeu_ps(s, x);
+                _mm_storeu_ps(s + 3 * L, y1);
+                _mm_storeu_ps(s + 2 * L, y);
+                x = y;
+            }
+            StoreSSE(out + pos, x, lanes);
+        }
+    }
+
+    _mm_setcsr(csr);
+}
+
+VLC_SSE
+static void BankSSE(float *out, const float *in, unsigned frames,
+                    unsigned channels, const biquad_band_t *bands,
+                    unsigned count, float in_gain, float out_gain,
+                    float *state)
+{
+    const unsigned csr = _mm_getcsr();
+    _mm_setcsr(csr | MXCSR_FTZ);
+
+    const __m128 vin_gain = _mm_set1_ps(in_gain);
+    const __m128 vout_gain = _mm_set1_ps(out_gain);
+
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * (2 + 2 * count) * L;
+        __m128 x1 = _mm_loadu_ps(st);
+        __m128 x2 = _mm_loadu_ps(st + L);
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+            const __m128 x = LoadSSE(in + pos, lanes);
+            const __m128 dx = _mm_sub_ps(x, x2);
+            __m128 o = _mm_setzero_ps();
+            float *sy = st + 2 * L;
+
+            for (unsigned k = 0; k < count; k++, sy += 2 * L)
+            {
+                const biquad_band_t *b = &bands[k];
+                const __m128 y1 = _mm_loadu_ps(sy);
+                const __m128 y2 = _mm_loadu_ps(sy + L);
+                __m128 y = _mm_mul_ps(_mm_set1_ps(b->alpha), dx);
+
+                y = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(b->gamma), y1));
+                y = _mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(b->beta), y2));
+
+                _mm_storeu_ps(sy + L, y1);
+                _mm_storeu_ps(sy, y);
+                o = _mm_add_ps(o, _mm_mul_ps(y, _mm_set1_ps(b->amp)));
+            }
+            x2 = x1;
+            x1 = x;
+
+            StoreSSE(out + pos, _mm_mul_ps(vout_gain,
+                              _mm_add_ps(_mm_mul_ps(vin_gain, x), o)), lanes);
+        }
+        _mm_storeu_ps(st, x1);
+        _mm_storeu_ps(st + L, x2);
+    }
+
+    _mm_setcsr(csr);
+}
+#endif
+
+#ifdef BIQUAD_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static inline float32x4_t LoadNEON(const float *p, unsigned lanes)
+{
+    if (likely(lanes == L))
+        return vld1q_f32(p);
+
+    float v[L] = { 0.f };
+    for (unsigned l = 0; l < lanes; l++)
+        v[l] = p[l];
+    return vld1q_f32(v);
+}
+
+static inline void StoreNEON(float *p, float32x4_t x, unsigned lanes)
+{
+    if (likely(lanes == L))
+    {
+        vst1q_f32(p, x);
+        return;
+    }
+
+    float v[L];
+    vst1q_f32(v, x);
+    for (unsigned l = 0; l < lanes; l++)
+        p[l] = v[l];
+}
+
+static void CascadeNEON(float *out, const float *in, unsigned frames,
+                        unsigned channels, const biquad_coeffs_t *coeffs,
+                        unsigned count, float *state)
+{
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * count * 4 * L;
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+            float32x4_t x = LoadNEON(in + pos, lanes);
+            float *s = st;
+
+            for (unsigned k = 0; k < count; k++, s += 4 * L)
+            {
+                const biquad_coeffs_t *c = &coeffs[k];
+                const float32x4_t x1 = vld1q_f32(s);
+                const float32x4_t x2 = vld1q_f32(s + L);
+                const float32x4_t y1 = vld1q_f32(s + 2 * L);
+                const float32x4_t y2 = vld1q_f32(s + 3 * L);
+                float32x4_t y = vmulq_n_f32(x, c->b0);
+
+                y = vaddq_f32(y, vmulq_n_f32(x1, c->b1));
+                y = vaddq_f32(y, vmulq_n_f32(x2, c->b2));
+                y = vsubq_f32(y, vmulq_n_f32(y1, c->a1));
+                y = vsubq_f32(y, vmulq_n_f32(y2, c->a2));
+
+                vst1q_f32(s + L, x1);
+                vst1q_f32(s, x);
+                vst1q_f32(s + 3 * L, y1);
+                vst1q_f32(s + 2 * L, y);
+                x = y;
+            }
+            StoreNEON(out + pos, x, lanes);
+        }
+    }
+}
+
+static void BankNEON(float *out, const float *in, unsigned frames,
+                     unsigned channels, const biquad_band_t *bands,
+                     unsigned count, float in_gain, float out_gain,
+                     float *state)
+{
+    for (unsigned g = 0; g < BIQUAD_GROUPS(channels); g++)
+    {
+        const unsigned lanes = __MIN(channels - g * L, L);
+        float *st = state + g * (2 + 2 * count) * L;
+        float32x4_t x1 = vld1q_f32(st);
+        float32x4_t x2 = vld1q_f32(st + L);
+
+        for (unsigned i = 0; i < frames; i++)
+        {
+            const size_t pos = (size_t)i * channels + g * L;
+            const float32x4_t x = LoadNEON(in + pos, lanes);
+            const float32x4_t dx = vsubq_f32(x, x2);
+            float32x4_t o = vdupq_n_f32(0.f);
+            float *sy = st + 2 * L;
+
+            for (unsigned k = 0; k < count; k++, sy += 2 * L)
+            {
+                const biquad_band_t *b = &bands[k];
+                const float32x4_t y1 = vld1q_f32(sy);
+                const float32x4_t y2 = vld1q_f32(sy + L);
+                float32x4_t y = vmulq_n_f32(dx, b->alpha);
+
+                y = vaddq_f32(y, vmulq_n_f32(y1, b->gamma));
+                y = vsubq_f32(y, vmulq_n_f32(y2, b->beta));
+
+                vst1q_f32(sy + L, y1);
+                vst1q_f32(sy, y);
+                o = vaddq_f32(o, vmulq_n_f32(y, b->amp));
+            }
+            x2 = x1;
+            x1 = x;
+
+            StoreNEON(out + pos, vmulq_n_f32(vaddq_f32(vmulq_n_f32(x, in_gain),
+                                                       o), out_gain), lanes);
+        }
+        vst1q_f32(st, x1);
+        vst1q_f32(st + L, x2);
+    }
+}
+
+static bool NEON_Available(void)
+{
+# if defined(__aarch64__)
+    return vlc_CPU_ARM64_NEON();
+# else
+    return vlc_CPU_ARM_NEON();
+# endif
+}
+#endif
+
+/* With less channels than lanes, the vectors would be mostly empty and the
+ * C version is faster. */
+void biquad_Cascade(float *out, const float *in, unsigned frames,
+                    unsigned channels, const biquad_coeffs_t *coeffs,
+                    unsigned count, float *state)
+{
+#ifdef BIQUAD_X86
+    if (vlc_CPU_SSE() && channels >= L)
+    {
+        CascadeSSE(out, in, frames, channels, coeffs, count, state);
+        return;
+    }
+#endif
+#ifdef BIQUAD_NEON
+    if (NEON_Available() && channels >= L)
+        CascadeNEON(out, in, frames, channels, coeffs, count, state);
+    else
+#endif
+        CascadeC(out, in, frames, channels, coeffs, count, state);
+    FlushState(state, BIQUAD_CASCADE_STATE(channels, count));
+}
+
+void biquad_Bank(float *out, const float *in, unsigned frames,
+                 unsigned channels, const biquad_band_t *bands,
+                 unsigned count, float in_gain, float out_gain,
+                 float *state)
+{
+#ifdef BIQUAD_X86
+    if (vlc_CPU_SSE() && channels >= L)
+    {
+        BankSSE(out, in, frames, channels, bands, count, in_gain, out_gain,
+                state);
+        return;
+    }
+#endif
+#ifdef BIQUAD_NEON
+    if (NEON_Available() && channels >= L)
+        BankNEON(out, in, frames, channels, bands, count, in_gain, out_gain,
+                 state);
+    else
+#endif
+        BankC(out, in, frames, channels, bands, count, in_gain, out_gain,
+              state);
+    FlushState(state, BIQUAD_BANK_STATE(channels, count));
+}
+
+#ifdef BIQUAD_TEST
+/*****************************************************************************
+ * Test and benchmark
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RATE 48000
+#define FRAMES 1024
+#define BLOCKS 200
+#define MAX_CHANNELS 9
+#define MAX_BANDS 10
+
+static const float frequencies[MAX_BANDS] = {
+    60, 170, 310, 600, 1000, 3000, 6000, 12000, 14000, 16000,
+};
+
+/* Same as the equalizer, with one octave bands and +6 dB gains */
+static void SetupBank(biquad_band_t *bands)
+{
+    for (unsigned i = 0; i < MAX_BANDS; i++)
+    {
+        float theta_1 = 2.f * (float)M_PI * frequencies[i] / RATE;
+        float theta_2 = theta_1 / sqrtf(2.f);
+        float s = sinf(theta_2);
+        float prd = sinf(theta_2 * .5f * (sqrtf(2.f) + 1.f))
+                  * sinf(theta_2 * .5f * (sqrtf(2.f) - 1.f));
+        float den = s * .5f + prd;
+
+        bands[i].alpha = prd / den;
+        bands[i].beta = (s * .5f - prd) / den;
+        bands[i].gamma = s * cosf(theta_1) / den;
+        bands[i].amp = .25f * (i & 1 ? 1.f : -.5f);
+    }
+}
+
+/* Same as the parametric equalizer peaking filters */
+static void SetupCascade(biquad_coeffs_t *coeffs)
+{
+    for (unsigned i = 0; i < MAX_BANDS; i++)
+    {
+        float A = powf(10.f, (i & 1 ? 6.f : -6.f) / 40.f);
+        float w0 = 2.f * (float)M_PI * frequencies[i] / RATE;
+        float alpha = sinf(w0) / (2.f * 3.f);
+        float a0 = 1.f + alpha / A;
+
+        coeffs[i].b0 = (1.f + alpha * A) / a0;
+        coeffs[i].b1 = -2.f * cosf(w0) / a0;
+        coeffs[i].b2 = (1.f - alpha * A) / a0;
+        coeffs[i].a1 = -2.f * cosf(w0) / a0;
+        coeffs[i].a2 = (1.f - alpha / A) / a0;
+    }
+}
+
+typedef void (*cascade_t)(float *, const float *, unsigned, unsigned,
+                          const biquad_coeffs_t *, unsigned, float *);
+typedef void (*bank_t)(float *, const float *, unsigned, unsigned,
+                       const biquad_band_t *, unsigned, float, float,
+                       float *);
+
+struct kernels
+{
+    const char *name;
+    cascade_t cascade;
+    bank_t bank;
+};
+
+static const struct kernels kernels[] = {
+    { "C", CascadeC, BankC },
+#ifdef BIQUAD_X86
+    { "SSE", CascadeSSE, BankSSE },
+#endif
+#ifdef BIQUAD_NEON
+    { "NEON", CascadeNEON, BankNEON },
+#endif
+};
+
+static float in[FRAMES * MAX_CHANNELS];
+static float ref[FRAMES * MAX_CHANNELS];
+static float out[FRAMES * MAX_CHANNELS];
+static float ref_state[BIQUAD_CASCADE_STATE(MAX_CHANNELS, MAX_BANDS)];
+static float state[BIQUAD_CASCADE_STATE(MAX_CHANNELS, MAX_BANDS)];
+
+/* The filters of low frequencies amplify the rounding errors, which differ
+ * as the compiler may reorder the operations of the C version: compare the
+ * level of the difference with the level of the output. */
+static void Compare(const char *name, const char *what, unsigned channels,
+                    unsigned count)
+{
+    double signal = 0., noise = 0.;
+
+    for (unsigned i = 0; i < FRAMES * channels; i++)
+    {
+        signal += ref[i] * ref[i];
+        noise += (out[i] - ref[i]) * (out[i] - ref[i]);
+    }
+    if (noise > signal * 1e-6)
+    {
+        fprintf(stderr, "%s %s: %u channels, %u bands: %.1f dB error\n",
+                name, what, channels, count, 10. * log10(noise / signal));
+        abort();
+    }
+}
+
+static void Check(const struct kernels *k, const biquad_coeffs_t *coeffs,
+                  const biquad_band_t *bands)
+{
+    for (unsigned channels = 1; channels <= MAX_CHANNELS; channels++)
+        for (unsigned count = 1; count <= MAX_BANDS; count++)
+        {
+            memset(ref_state, 0, sizeof (ref_state));
+            memset(state, 0, sizeof (state));
+            for (unsigned b = 0; b < 4; b++)
+            {
+                for (unsigned i = 0; i < FRAMES * channels; i++)
+                    in[i] = (rand() / (float)RAND_MAX - .5f);
+
+                CascadeC(ref, in, FRAMES, channels, coeffs, count, ref_state);
+                k->cascade(out, in, FRAMES, channels, coeffs, count, state);
+                Compare(k->name, "cascade", channels, count);
+            }
+
+            memset(ref_state, 0, sizeof (ref_state));
+            memset(state, 0, sizeof (state));
+            for (unsigned b = 0; b < 4; b++)
+            {
+                for (unsigned i = 0; i < FRAMES * channels; i++)
+                    in[i] = (rand() / (float)RAND_MAX - .5f);
+
+                BankC(ref, in, FRAMES, channels, bands, count, .25f, 1.5f,
+                      ref_state);
+                k->bank(out, in, FRAMES, channels, bands, count, .25f, 1.5f,
+                        state);
+                Compare(k->name, "bank", channels, count);
+            }
+        }
+}
+
+/* Prints the time per band and per sample of one channel */
+static void Bench(const struct kernels *k, const biquad_coeffs_t *coeffs,
+                  const biquad_band_t *bands, unsigned channels,
+                  unsigned count, bool silence)
+{
+    for (unsigned i = 0; i < FRAMES * channels; i++)
+        in[i] = silence ? 0.f : (rand() / (float)RAND_MAX - .5f);
+
+    /* Silence after a loud signal leaves the states decaying */
+    for (unsigned i = 0; i < BIQUAD_CASCADE_STATE(channels, count); i++)
+        state[i] = silence ? 1e-25f : 0.f;
+    vlc_tick_t start = mdate();
+    for (unsigned b = 0; b < BLOCKS; b++)
+        k->cascade(out, in, FRAMES, channels, coeffs, count, state);
+    vlc_tick_t cascade = mdate() - start;
+
+    for (unsigned i = 0; i < BIQUAD_BANK_STATE(channels, count); i++)
+        state[i] = silence ? 1e-25f : 0.f;
+    start = mdate();
+    for (unsigned b = 0; b < BLOCKS; b++)
+        k->bank(out, in, FRAMES, channels, bands, count, .25f, 1.f, state);
+    vlc_tick_t bank = mdate() - start;
+
+    const double samples = (double)BLOCKS * FRAMES * channels * count;
+    printf("%-4s %u channels %2u bands%s: cascade %5.2f ns, bank %5.2f ns\n",
+           k->name, channels, count, silence ? " (decay)" : "",
+           cascade * 1000. / samples, bank * 1000. / samples);
+}
+
+int main(void)
+{
+    biquad_coeffs_t coeffs[MAX_BANDS];
+    biquad_band_t bands[MAX_BANDS];
+
+    alarm(60);
+    SetupCascade(coeffs);
+    SetupBank(bands);
+
+    for (size_t i = 1; i < ARRAY_SIZE(kernels); i++)
+        Check(&kernels[i], coeffs, bands);
+
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        static const unsigned channels[] = { 1, 2, 6, 8 };
+
+        for (size_t j = 0; j < ARRAY_SIZE(channels); j++)
+        {
+            Bench(&kernels[i], coeffs, bands, channels[j], 5, false);
+            Bench(&kernels[i], coeffs, bands, channels[j], 10, false);
+        }
+        Bench(&kernels[i], coeffs, bands, 8, 10, true);
+    }
+    return 0;
+}
+#endif
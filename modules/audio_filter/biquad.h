@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * biquad.h: second order IIR filters on interleaved channels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BIQUAD_H
+#define VLC_BIQUAD_H 1
+
+/**
+ * Channels are filtered in groups of BIQUAD_LANES, one channel per vector
+ * lane. The filter states are stored per group, with the same layout.
+ */
+#define BIQUAD_LANES 4
+
+#define BIQUAD_GROUPS(channels) \
+    (((channels) + BIQUAD_LANES - 1) / BIQUAD_LANES)
+
+/** Number of floats of the state of biquad_Cascade() */
+#define BIQUAD_CASCADE_STATE(channels, count) \
+    (BIQUAD_GROUPS(channels) * (count) * 4 * BIQUAD_LANES)
+
+/** Number of floats of the state of biquad_Bank() */
+#define BIQUAD_BANK_STATE(channels, count) \
+    (BIQUAD_GROUPS(channels) * (2 + 2 * (count)) * BIQUAD_LANES)
+
+/** Direct form 1 coefficients, normalized by a0 */
+typedef struct
+{
+    float b0, b1, b2;
+    float a1, a2;
+} biquad_coeffs_t;
+
+/**
+ * Band-pass filter of a bank:
+ * y[n] = alpha * (x[n] - x[n-2]) + gamma * y[n-1] - beta * y[n-2]
+ */
+typedef struct
+{
+    float alpha, beta, gamma;
+    float amp; /**< Gain of the band in the output */
+} biquad_band_t;
+
+/**
+ * Filters interleaved samples through biquads in series.
+ *
+ * \param out output samples, may be the same as in
+ * \param state BIQUAD_CASCADE_STATE(channels, count) floats, zero initially
+ */
+void biquad_Cascade(float *out, const float *in, unsigned frames,
+                    unsigned channels, const biquad_coeffs_t *coeffs,
+                    unsigned count, float *state);
+
+/**
+ * Filters interleaved samples through band-pass filters in parallel:
+ * out = out_gain * (in_gain * x + sum of amp * y for every band).
+ *
+ * \param out output samples, may be the same as in
+ * \param state BIQUAD_BANK_STATE(channels, count) floats, zero initially
+ */
+void biquad_Bank(float *out, const float *in, unsigned frames,
+                 unsigned channels, const biquad_band_t *bands,
+                 unsigned count, float in_gain, float out_gain,
+                 float *state);
+
+#endif
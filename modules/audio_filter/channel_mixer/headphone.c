@@ -39,12 +39,15 @@
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
+#include "../convolution.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 static block_t *Convert( filter_t *, block_t * );
+static void Flush( filter_t * );
 
 /*****************************************************************************
  * Module descriptor
@@ -72,6 +75,17 @@ static block_t *Convert( filter_t *, block_t * );
      "Dolby Surround encoded streams won't be decoded before being " \
      "processed by this filter. Enabling this setting is not recommended.")
 
+#define HEADPHONE_ROOM_TEXT N_("Room reverberation")
+#define HEADPHONE_ROOM_LONGTEXT N_( \
+     "Reverberation time of the virtual room in milliseconds, 0 to " \
+     "disable. The speakers are then rendered by convolution with " \
+     "synthetic room responses.")
+
+#define HEADPHONE_PARTITION_TEXT N_("Room rendering latency")
+#define HEADPHONE_PARTITION_LONGTEXT N_( \
+     "Latency of the room rendering in samples, rounded down to a power " \
+     "of two. Lower values use more CPU.")
+
 vlc_module_begin ()
     set_description( N_("Headphone virtual spatialization effect") )
     set_shortname( N_("Headphone effect") )
@@ -85,6 +99,12 @@ vlc_module_begin ()
               HEADPHONE_COMPENSATE_LONGTEXT, true )
     add_bool( "headphone-dolby", false, HEADPHONE_DOLBY_TEXT,
               HEADPHONE_DOLBY_LONGTEXT, true )
+    add_integer_with_range( "headphone-room", 0, 0, 2000,
+                            HEADPHONE_ROOM_TEXT, HEADPHONE_ROOM_LONGTEXT,
+                            true )
+    add_integer_with_range( "headphone-partition", 256, 16, 8192,
+                            HEADPHONE_PARTITION_TEXT,
+                            HEADPHONE_PARTITION_LONGTEXT, true )
 
     set_capability( "audio filter", 0 )
     set_callbacks( OpenFilter, CloseFilter )
@@ -109,6 +129,7 @@ struct filter_sys_t
     float * p_overflow_buffer;
     unsigned int i_nb_atomic_operations;
     struct atomic_operation_t * p_atomic_operations;
+    convolution_t * p_convolution;
 };
 
 /*****************************************************************************
@@ -327,6 +348,76 @@ static int Init( vlc_object_t *p_this, struct filter_sys_t * p_data
     return 0;
 }
 
+/*****************************************************************************
+ * InitRoom: renders the atomic operations by convolution, each of them
+ * followed by the reverberation of the room
+ *****************************************************************************/
+#define ROOM_LEVEL 0.5 /* level of the reverberation, relative to the sound */
+
+static int InitRoom( vlc_object_t *p_this, struct filter_sys_t * p_data
+        , unsigned int i_nb_channels, unsigned int i_rate )
+{
+    unsigned int i_room = var_InheritInteger( p_this, "headphone-room" )
+                          * i_rate / 1000;
+    unsigned int i_max_partition
+        = var_InheritInteger( p_this, "headphone-partition" );
+    unsigned int i_partition = 16;
+    unsigned int i_length = 0;
+    unsigned int i;
+
+    while( i_partition * 2 <= i_max_partition && i_partition < 8192 )
+        i_partition *= 2;
+
+    for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+        i_length = __MAX( i_length,
+                          p_data->p_atomic_operations[i].i_delay + i_room );
+
+    float *p_response = vlc_alloc( i_length, sizeof (float) );
+    if( p_response == NULL )
+        return -1;
+
+    p_data->p_convolution = convolution_New( i_partition, i_nb_channels, 2,
+                                             i_length );
+    if( p_data->p_convolution == NULL )
+    {
+        free( p_response );
+        return -1;
+    }
+
+    /* Exponentially decaying noise, down by 60 dB after the reverberation
+     * time. The seed is different for every operation, so that the tails
+     * are not correlated between the ears. */
+    for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+    {
+        const struct atomic_operation_t *p_op =
+            &p_data->p_atomic_operations[i];
+        float *p_tail = p_response + p_op->i_delay;
+        uint32_t i_seed = 0x9e3779b9 * (i + 1);
+        double d_energy = 0.;
+        unsigned int j;
+
+        memset( p_response, 0, i_length * sizeof (float) );
+        for( j = 1 ; j < i_room ; j++ )
+        {
+            i_seed = i_seed * 1664525 + 1013904223;
+            p_tail[j] = (int32_t)i_seed / 2147483648.0
+                      * exp( -6.9 * j / i_room );
+            d_energy += p_tail[j] * p_tail[j];
+        }
+        for( j = 1 ; j < i_room ; j++ )
+            p_tail[j] *= p_op->d_amplitude_factor * ROOM_LEVEL
+                       / sqrt( d_energy );
+        p_tail[0] = p_op->d_amplitude_factor;
+
+        convolution_AddResponse( p_data->p_convolution
+                , p_op->i_source_channel_offset, p_op->i_dest_channel_offset
+                , p_response, i_length );
+    }
+
+    free( p_response );
+    return 0;
+}
+
 /*****************************************************************************
  * DoWork: convert a buffer
  *****************************************************************************/
@@ -354,6 +445,13 @@ static void DoWork( filter_t * p_filter,
     double d_amplitude_factor;
 
     p_out = (float *)p_out_buf->p_buffer;
+    if( p_sys->p_convolution != NULL )
+    {
+        convolution_Process( p_sys->p_convolution, p_out, p_in,
+                             p_out_buf->i_nb_samples );
+        return;
+    }
+
     i_out_size = p_out_buf->i_buffer;
 
     /* Slide the overflow buffer */
@@ -458,6 +556,7 @@ static int OpenFilter( vlc_object_t *p_this )
     p_sys->p_overflow_buffer = NULL;
     p_sys->i_nb_atomic_operations = 0;
     p_sys->p_atomic_operations = NULL;
+    p_sys->p_convolution = NULL;
 
     if( Init( VLC_OBJECT(p_filter), p_sys
                 , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
@@ -481,10 +580,22 @@ static int OpenFilter( vlc_object_t *p_this )
         p_filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_5_0;
     }
     p_filter->pf_audio_filter = Convert;
+    p_filter->pf_flush = Flush;
 
     aout_FormatPrepare(&p_filter->fmt_in.audio);
     aout_FormatPrepare(&p_filter->fmt_out.audio);
 
+    if( var_InheritInteger( p_filter, "headphone-room" ) > 0
+     && InitRoom( VLC_OBJECT(p_filter), p_sys
+                , aout_FormatNbChannels( &p_filter->fmt_in.audio )
+                , p_filter->fmt_in.audio.i_rate ) < 0 )
+    {
+        free( p_sys->p_overflow_buffer );
+        free( p_sys->p_atomic_operations );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -495,11 +606,22 @@ static void CloseFilter( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
 
+    if( p_filter->p_sys->p_convolution != NULL )
+        convolution_Delete( p_filter->p_sys->p_convolution );
     free( p_filter->p_sys->p_overflow_buffer );
     free( p_filter->p_sys->p_atomic_operations );
     free( p_filter->p_sys );
 }
 
+static void Flush( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    memset( p_sys->p_overflow_buffer, 0, p_sys->i_overflow_buffer_size );
+    if( p_sys->p_convolution != NULL )
+        convolution_Flush( p_sys->p_convolution );
+}
+
 static block_t *Convert( filter_t *p_filter, block_t *p_block )
 {
     if( !p_block || !p_block->i_nb_samples )
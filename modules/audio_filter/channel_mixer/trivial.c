@@ -52,42 +52,66 @@ struct filter_sys_t
 };
 
 /**
- * Trivially upmixes
+ * Reads one input frame as float samples
+ */
+static void LoadFrame( float *p_dest, const void *p_src, unsigned i_nb,
+                       vlc_fourcc_t i_format )
+{
+    switch( i_format )
+    {
+        case VLC_CODEC_S16N:
+            for( unsigned j = 0; j < i_nb; j++ )
+                p_dest[j] = ((const int16_t *)p_src)[j] * (1.f / 32768.f);
+            break;
+        case VLC_CODEC_S32N:
+            for( unsigned j = 0; j < i_nb; j++ )
+                p_dest[j] = ((const int32_t *)p_src)[j] * (1.f / 2147483648.f);
+            break;
+        default:
+            memcpy( p_dest, p_src, i_nb * sizeof(float) );
+            break;
+    }
+}
+
+/**
+ * Trivially upmixes, converting the samples to float if needed
  */
 static block_t *Upmix( filter_t *p_filter, block_t *p_in_buf )
 {
     unsigned i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
     unsigned i_output_nb = aout_FormatNbChannels( &p_filter->fmt_out.audio );
+    const vlc_fourcc_t i_format = p_filter->fmt_in.audio.i_format;
+    const size_t i_in_frame = p_filter->fmt_in.audio.i_bytes_per_frame;
+    const size_t i_nb_samples = p_in_buf->i_nb_samples;
 
-    assert( i_input_nb < i_output_nb );
+    assert( i_input_nb <= i_output_nb );
+    assert( i_in_frame <= i_output_nb * sizeof(float) );
 
-    block_t *p_out_buf = block_Alloc(
-                              p_in_buf->i_buffer * i_output_nb / i_input_nb );
+    block_t *p_out_buf = filter_GetAudioOutput( p_filter, p_in_buf,
+                                 i_nb_samples * i_output_nb * sizeof(float) );
     if( unlikely(p_out_buf == NULL) )
     {
         block_Release( p_in_buf );
         return NULL;
     }
 
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_dts        = p_in_buf->i_dts;
-    p_out_buf->i_pts        = p_in_buf->i_pts;
-    p_out_buf->i_length     = p_in_buf->i_length;
-
     float *p_dest = (float *)p_out_buf->p_buffer;
-    const float *p_src = (float *)p_in_buf->p_buffer;
+    const uint8_t *p_src = p_in_buf->p_buffer;
     const int *channel_map = p_filter->p_sys->channel_map;
+    /* Backward, as the output frames are larger and may overlap the input
+     * ones. Use extra buffers for the frame being processed. */
+    float in[AOUT_CHAN_MAX], out[AOUT_CHAN_MAX];
 
-    for( size_t i = 0; i < p_in_buf->i_nb_samples; i++ )
+    for( size_t i = i_nb_samples; i-- > 0; )
     {
+        LoadFrame( in, p_src + i * i_in_frame, i_input_nb, i_format );
         for( unsigned j = 0; j < i_output_nb; j++ )
-            p_dest[j] = channel_map[j] == -1 ? 0.f : p_src[channel_map[j]];
-
-        p_src += i_input_nb;
-        p_dest += i_output_nb;
+            out[j] = channel_map[j] == -1 ? 0.f : in[channel_map[j]];
+        memcpy( p_dest + i * i_output_nb, out, i_output_nb * sizeof(float) );
     }
 
-    block_Release( p_in_buf );
+    if( p_out_buf != p_in_buf )
+        block_Release( p_in_buf );
     return p_out_buf;
 }
 
@@ -134,17 +158,13 @@ static block_t *Extract( filter_t *p_filter, block_t *p_in_buf )
                       * p_filter->fmt_out.audio.i_bitspersample
                       * i_out_channels / 8;
 
-    block_t *p_out_buf = block_Alloc( i_out_size );
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter, i_out_size );
     if( unlikely(p_out_buf == NULL) )
     {
         block_Release( p_in_buf );
         return NULL;
     }
-
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_dts        = p_in_buf->i_dts;
-    p_out_buf->i_pts        = p_in_buf->i_pts;
-    p_out_buf->i_length     = p_in_buf->i_length;
+    block_CopyProperties( p_out_buf, p_in_buf );
 
     static const int pi_selections[] = {
         0, 1, 2, 3, 4, 5, 6, 7, 8,
@@ -173,7 +193,8 @@ static int Create( vlc_object_t *p_this )
     if( infmt->i_physical_channels == 0 )
     {
         assert( infmt->i_channels > 0 );
-        if( outfmt->i_physical_channels == 0 )
+        if( outfmt->i_physical_channels == 0
+         || infmt->i_format != outfmt->i_format )
             return VLC_EGENERIC;
         if( aout_FormatNbChannels( outfmt ) == infmt->i_channels )
         {
@@ -190,9 +211,18 @@ static int Create( vlc_object_t *p_this )
         }
     }
 
-    if( infmt->i_format != outfmt->i_format
-     || infmt->i_rate != outfmt->i_rate
-     || infmt->i_format != VLC_CODEC_FL32 )
+    if( infmt->i_rate != outfmt->i_rate
+     || outfmt->i_format != VLC_CODEC_FL32 )
+        return VLC_EGENERIC;
+
+    /* Integer input is converted while upmixing or reordering, so that the
+     * pipeline does not need a separate converter. Downmixing is left to the
+     * simple channel mixer. */
+    const bool b_convert = infmt->i_format != VLC_CODEC_FL32;
+    if( b_convert
+     && ( ( infmt->i_format != VLC_CODEC_S16N
+         && infmt->i_format != VLC_CODEC_S32N )
+       || aout_FormatNbChannels( outfmt ) < aout_FormatNbChannels( infmt ) ) )
         return VLC_EGENERIC;
 
     /* trivial is the lowest priority converter: if chan_mode are different
@@ -207,6 +237,8 @@ static int Create( vlc_object_t *p_this )
     if ( aout_FormatNbChannels( outfmt ) == 1
       && aout_FormatNbChannels( infmt ) == 1 )
     {
+        if( b_convert )
+            return VLC_EGENERIC;
         p_filter->pf_audio_filter = Equals;
         return VLC_SUCCESS;
     }
@@ -287,7 +319,7 @@ static int Create( vlc_object_t *p_this )
                 b_equals = false;
                 break;
             }
-        if( b_equals )
+        if( b_equals && !b_convert )
         {
             p_filter->pf_audio_filter = Equals;
             return VLC_SUCCESS;
@@ -299,7 +331,8 @@ static int Create( vlc_object_t *p_this )
         return VLC_ENOMEM;
     memcpy( p_filter->p_sys->channel_map, channel_map, sizeof(channel_map) );
 
-    if( aout_FormatNbChannels( outfmt ) > aout_FormatNbChannels( infmt ) )
+    if( aout_FormatNbChannels( outfmt ) > aout_FormatNbChannels( infmt )
+     || b_convert )
         p_filter->pf_audio_filter = Upmix;
     else
         p_filter->pf_audio_filter = Downmix;
@@ -40,19 +40,34 @@
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
+#include "pcm.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+#define DITHER_TEXT N_("Dither")
+#define DITHER_LONGTEXT N_( \
+    "Add a triangular noise of one least significant bit when converting " \
+    "floating point samples to 16-bits, to decorrelate the rounding " \
+    "errors from the signal.")
 
 vlc_module_begin()
     set_description(N_("Audio filter for PCM format conversion"))
     set_category(CAT_AUDIO)
     set_subcategory(SUBCAT_AUDIO_MISC)
     set_capability("audio converter", 1)
-    set_callbacks(Open, NULL)
+    set_callbacks(Open, Close)
+    add_bool("audio-format-dither", false, DITHER_TEXT, DITHER_LONGTEXT, true)
 vlc_module_end()
 
+struct filter_sys_t
+{
+    pcm_dither_t dither;
+};
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -76,79 +91,100 @@ static int Open(vlc_object_t *object)
     if (filter->pf_audio_filter == NULL)
         return VLC_EGENERIC;
 
+    filter->p_sys = NULL;
+    if (src->i_codec == VLC_CODEC_FL32 && dst->i_codec == VLC_CODEC_S16N
+     && var_InheritBool(filter, "audio-format-dither"))
+    {
+        filter->p_sys = malloc(sizeof (*filter->p_sys));
+        if (unlikely(filter->p_sys == NULL))
+            return VLC_ENOMEM;
+        pcm_InitDither(&filter->p_sys->dither);
+    }
+
     msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
             (char *)&src->i_codec, (char *)&dst->i_codec,
             src->audio.i_bitspersample, dst->audio.i_bitspersample);
     return VLC_SUCCESS;
 }
 
+static void Close(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    free(filter->p_sys);
+}
+
 
 /*** from U8 ***/
 static block_t *U8toS16(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    const size_t count = bsrc->i_buffer;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    int16_t *dst = (int16_t *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((*src++) << 8) - 0x8000;
+    /* Backward, as the samples may grow in place */
+    const uint8_t *src = (const uint8_t *)bsrc->p_buffer + count;
+    int16_t *dst = (int16_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((*--src) << 8) - 0x8000;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
 static block_t *U8toFl32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    const size_t count = bsrc->i_buffer;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((float)((*src++) - 128)) / 128.f;
+    /* Backward, as the samples may grow in place */
+    const uint8_t *src = (const uint8_t *)bsrc->p_buffer + count;
+    float *dst = (float *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((float)((*--src) - 128)) / 128.f;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
 static block_t *U8toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    const size_t count = bsrc->i_buffer;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    int32_t *dst = (int32_t *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((*src++) << 24) - 0x80000000;
+    /* Backward, as the samples may grow in place */
+    const uint8_t *src = (const uint8_t *)bsrc->p_buffer + count;
+    int32_t *dst = (int32_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((*--src) << 24) - 0x80000000;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
 static block_t *U8toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 8);
+    const size_t count = bsrc->i_buffer;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    double  *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((double)((*src++) - 128)) / 128.;
+    /* Backward, as the samples may grow in place */
+    const uint8_t *src = (const uint8_t *)bsrc->p_buffer + count;
+    double *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((double)((*--src) - 128)) / 128.;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
@@ -168,63 +204,52 @@ static block_t *S16toU8(filter_t *filter, block_t *b)
 
 static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    const size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
+    pcm_S16ToFl32((float *)bdst->p_buffer, (const int16_t *)bsrc->p_buffer,
+                  count);
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
 static block_t *S16toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    const size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    int32_t *dst = (int32_t *)bdst->p_buffer;
-    for (int i = bsrc->i_buffer / 2; i--;)
-        *dst++ = *src++ << 16;
+    /* Backward, as the samples may grow in place */
+    const int16_t *src = (const int16_t *)bsrc->p_buffer + count;
+    int32_t *dst = (int32_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = *--src << 16;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
 static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    const size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-        *dst++ = (double)*src++ / 32768.;
+    /* Backward, as the samples may grow in place */
+    const int16_t *src = (const int16_t *)bsrc->p_buffer + count;
+    double *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = (double)*--src / 32768.;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
@@ -252,65 +277,37 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
 
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
-    VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
+    filter_sys_t *sys = filter->p_sys;
+
+    pcm_Fl32ToS16((int16_t *)b->p_buffer, (const float *)b->p_buffer,
+                  b->i_buffer / 4, sys != NULL ? &sys->dither : NULL);
     b->i_buffer /= 2;
     return b;
 }
 
 static block_t *Fl32toS32(filter_t *filter, block_t *b)
 {
-    float   *src = (float *)b->p_buffer;
-    int32_t *dst = (int32_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
+    pcm_Fl32ToS32((int32_t *)b->p_buffer, (const float *)b->p_buffer,
+                  b->i_buffer / 4);
     VLC_UNUSED(filter);
     return b;
 }
 
 static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    const size_t count = bsrc->i_buffer / 4;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    float  *src = (float *)bsrc->p_buffer;
-    double *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *(dst++) = *(src++);
+    /* Backward, as the samples may grow in place */
+    const float *src = (const float *)bsrc->p_buffer + count;
+    double *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = *--src;
 out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
@@ -343,27 +340,26 @@ static block_t *S32toS16(filter_t *filter, block_t *b)
 static block_t *S32toFl32(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / 2147483648.f;
+    pcm_S32ToFl32((float *)b->p_buffer, (const int32_t *)b->p_buffer,
+                  b->i_buffer / 4);
     return b;
 }
 
 static block_t *S32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    const size_t count = bsrc->i_buffer / 4;
+    block_t *bdst = filter_GetAudioOutput(filter, bsrc, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int32_t *src = (int32_t*)bsrc->p_buffer;
-    double  *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *dst++ = (double)(*src++) / 2147483648.;
+    /* Backward, as the samples may grow in place */
+    const int32_t *src = (const int32_t *)bsrc->p_buffer + count;
+    double *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = (double)(*--src) / 2147483648.;
 out:
-    VLC_UNUSED(filter);
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
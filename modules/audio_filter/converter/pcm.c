@@ -0,0 +1,763 @@
+/*****************************************************************************
+ * pcm.c: PCM sample conversion and scaling
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef PCM_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "pcm.h"
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define PCM_X86 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define PCM_NEON 1
+# include <arm_neon.h>
+#endif
+
+void pcm_InitDither(pcm_dither_t *dither)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(dither->state); i++)
+        dither->state[i] = 0x9e3779b9 * (i + 1);
+}
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+/* The difference of the two halves of a xorshift output is a triangular
+ * noise within ]-1, 1[ */
+static inline float DitherC(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return ((int32_t)(x >> 16) - (int32_t)(x & 0xffff)) * (1.f / 65536.f);
+}
+
+static void S16ToFl32C(float *dst, const int16_t *src, size_t count)
+{
+    /* Backward, as the samples may grow in place */
+    src += count;
+    dst += count;
+    for (size_t i = count; i--;)
+    {   /* This is Walken's trick based on IEEE float format. On my PIII
+         * this takes 16 seconds to perform one billion conversions, instead
+         * of 19 seconds for the division by 32768. */
+        union { float f; int32_t i; } u;
+        u.i = *--src + 0x43c00000;
+        *--dst = u.f - 384.f;
+    }
+}
+
+static void S32ToFl32C(float *dst, const int32_t *src, size_t count)
+{
+    for (size_t i = count; i--;)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+static void Fl32ToS16C(int16_t *dst, const float *src, size_t count,
+                       pcm_dither_t *dither)
+{
+    for (size_t i = count; i--;)
+    {   /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        float s = *src++;
+        if (dither != NULL)
+            s += DitherC(&dither->state[0]) * (1.f / 32768.f);
+        u.f = s + 384.f;
+        if (u.i > 0x43c07fff)
+            *dst++ = 32767;
+        else if (u.i < 0x43bf8000)
+            *dst++ = -32768;
+        else
+            *dst++ = u.i - 0x43c00000;
+    }
+}
+
+static void Fl32ToS32C(int32_t *dst, const float *src, size_t count)
+{
+    for (size_t i = count; i--;)
+    {
+        float s = *(src++) * 2147483648.f;
+        if (s >= 2147483647.f)
+            *(dst++) = 2147483647;
+        else
+        if (s <= -2147483648.f)
+            *(dst++) = -2147483648;
+        else
+            *(dst++) = lroundf(s);
+    }
+}
+
+static void AmplifyFl32C(float *p, size_t count, float factor)
+{
+    for (size_t i = count; i > 0; i--)
+        *(p++) *= factor;
+}
+
+static void AmplifyS16C(int16_t *p, size_t count, int factor)
+{
+    for (size_t n = count; n > 0; n--)
+    {
+        int_fast32_t s = (*p * (int_fast32_t)factor) >> 8;
+        if (s > INT16_MAX)
+            s = INT16_MAX;
+        else
+        if (s < INT16_MIN)
+            s = INT16_MIN;
+        *(p++) = s;
+    }
+}
+
+#ifdef PCM_X86
+/*****************************************************************************
+ * AVX / AVX2
+ *****************************************************************************/
+# define VLC_AVX __attribute__ ((__target__ ("avx")))
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+VLC_AVX2
+static void S16ToFl32AVX2(float *dst, const int16_t *src, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+    size_t i = count;
+
+    /* Backward, as the samples may grow in place */
+    while (i >= 16)
+    {
+        i -= 16;
+
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1));
+
+        _mm256_storeu_ps(dst + i + 8,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+        _mm256_storeu_ps(dst + i,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+    }
+    S16ToFl32C(dst, src, i);
+}
+
+VLC_AVX2
+static void S32ToFl32AVX2(float *dst, const int32_t *src, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+    S32ToFl32C(dst + i, src + i, count - i);
+}
+
+VLC_AVX2
+static inline __m256 DitherAVX2(__m256i *state)
+{
+    __m256i x = *state;
+
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    *state = x;
+
+    __m256i d = _mm256_sub_epi32(_mm256_srli_epi32(x, 16),
+                                 _mm256_and_si256(x, _mm256_set1_epi32(0xffff)));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(d), _mm256_set1_ps(1.f / 65536.f));
+}
+
+VLC_AVX2
+static void Fl32ToS16AVX2(int16_t *dst, const float *src, size_t count,
+                          pcm_dither_t *dither)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    __m256i state = _mm256_setzero_si256();
+    size_t i = 0;
+
+    if (dither != NULL)
+        state = _mm256_loadu_si256((const __m256i *)dither->state);
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+
+        if (dither != NULL)
+        {
+            a = _mm256_add_ps(a, DitherAVX2(&state));
+            b = _mm256_add_ps(b, DitherAVX2(&state));
+        }
+        /* Clip first: out of range conversions return INT32_MIN */
+        a = _mm256_min_ps(_mm256_max_ps(a, min), max);
+        b = _mm256_min_ps(_mm256_max_ps(b, min), max);
+
+        __m256i s = _mm256_packs_epi32(_mm256_cvtps_epi32(a),
+                                       _mm256_cvtps_epi32(b));
+        /* Packing works within 128-bits lanes */
+        s = _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(dst + i), s);
+    }
+
+    if (dither != NULL)
+        _mm256_storeu_si256((__m256i *)dither->state, state);
+    Fl32ToS16C(dst + i, src + i, count - i, dither);
+}
+
+VLC_AVX2
+static void Fl32ToS32AVX2(int32_t *dst, const float *src, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256i v = _mm256_cvtps_epi32(s);
+
+        /* Positive overflows give INT32_MIN: flip them to INT32_MAX */
+        v = _mm256_xor_si256(v, _mm256_castps_si256(
+                                    _mm256_cmp_ps(s, scale, _CMP_GE_OQ)));
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    Fl32ToS32C(dst + i, src + i, count - i);
+}
+
+VLC_AVX
+static void AmplifyFl32AVX(float *p, size_t count, float factor)
+{
+    const __m256 f = _mm256_set1_ps(factor);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), f));
+        _mm256_storeu_ps(p + i + 8,
+                         _mm256_mul_ps(_mm256_loadu_ps(p + i + 8), f));
+    }
+    AmplifyFl32C(p + i, count - i, factor);
+}
+
+VLC_AVX2
+static void AmplifyS16AVX2(int16_t *p, size_t count, int factor)
+{
+    const __m256i f = _mm256_set1_epi16(factor);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lo = _mm256_mullo_epi16(s, f);
+        __m256i hi = _mm256_mulhi_epi16(s, f);
+
+        /* The 32-bits products, shifted, then packed with saturation */
+        __m256i a = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 8);
+        __m256i b = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 8);
+        _mm256_storeu_si256((__m256i *)(p + i), _mm256_packs_epi32(a, b));
+    }
+    AmplifyS16C(p + i, count - i, factor);
+}
+#endif
+
+#ifdef PCM_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static void S16ToFl32NEON(float *dst, const int16_t *src, size_t count)
+{
+    size_t i = count;
+
+    /* Backward, as the samples may grow in place */
+    while (i >= 8)
+    {
+        i -= 8;
+
+        int16x8_t s = vld1q_s16(src + i);
+        int32x4_t lo = vmovl_s16(vget_low_s16(s));
+        int32x4_t hi = vmovl_s16(vget_high_s16(s));
+
+        vst1q_f32(dst + i + 4, vcvtq_n_f32_s32(hi, 15));
+        vst1q_f32(dst + i, vcvtq_n_f32_s32(lo, 15));
+    }
+    S16ToFl32C(dst, src, i);
+}
+
+static void S32ToFl32NEON(float *dst, const int32_t *src, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, vcvtq_n_f32_s32(vld1q_s32(src + i), 31));
+    S32ToFl32C(dst + i, src + i, count - i);
+}
+
+/* Rounds to the nearest integer with saturation */
+static inline int32x4_t RoundNEON(float32x4_t v)
+{
+# ifdef __aarch64__
+    return vcvtnq_s32_f32(v);
+# else
+    /* Half away from zero, since ARMv7 conversions truncate */
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v),
+                                vdupq_n_u32(0x80000000));
+    float32x4_t half = vreinterpretq_f32_u32(
+        vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(.5f))));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+# endif
+}
+
+static inline float32x4_t DitherNEON(uint32x4_t *state)
+{
+    uint32x4_t x = *state;
+
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    *state = x;
+
+    int32x4_t d = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(x, 16)),
+                            vreinterpretq_s32_u32(vandq_u32(x,
+                                                  vdupq_n_u32(0xffff))));
+    return vmulq_n_f32(vcvtq_f32_s32(d), 1.f / 65536.f);
+}
+
+static void Fl32ToS16NEON(int16_t *dst, const float *src, size_t count,
+                          pcm_dither_t *dither)
+{
+    uint32x4_t state = vdupq_n_u32(0);
+    size_t i = 0;
+
+    if (dither != NULL)
+        state = vld1q_u32(dither->state);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(src + i), 32768.f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(src + i + 4), 32768.f);
+
+        if (dither != NULL)
+        {
+            a = vaddq_f32(a, DitherNEON(&state));
+            b = vaddq_f32(b, DitherNEON(&state));
+        }
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(RoundNEON(a)),
+                                        vqmovn_s32(RoundNEON(b))));
+    }
+
+    if (dither != NULL)
+        vst1q_u32(dither->state, state);
+    Fl32ToS16C(dst + i, src + i, count - i, dither);
+}
+
+static void Fl32ToS32NEON(int32_t *dst, const float *src, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32(dst + i,
+                  RoundNEON(vmulq_n_f32(vld1q_f32(src + i), 2147483648.f)));
+    Fl32ToS32C(dst + i, src + i, count - i);
+}
+
+static void AmplifyFl32NEON(float *p, size_t count, float factor)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        vst1q_f32(p + i, vmulq_n_f32(vld1q_f32(p + i), factor));
+        vst1q_f32(p + i + 4, vmulq_n_f32(vld1q_f32(p + i + 4), factor));
+    }
+    AmplifyFl32C(p + i, count - i, factor);
+}
+
+static void AmplifyS16NEON(int16_t *p, size_t count, int factor)
+{
+    const int16x4_t f = vdup_n_s16(factor);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        int16x8_t s = vld1q_s16(p + i);
+        int32x4_t a = vmull_s16(vget_low_s16(s), f);
+        int32x4_t b = vmull_s16(vget_high_s16(s), f);
+
+        vst1q_s16(p + i, vcombine_s16(vqshrn_n_s32(a, 8),
+                                      vqshrn_n_s32(b, 8)));
+    }
+    AmplifyS16C(p + i, count - i, factor);
+}
+
+static bool NEON_Available(void)
+{
+# if defined(__aarch64__)
+    return vlc_CPU_ARM64_NEON();
+# else
+    return vlc_CPU_ARM_NEON();
+# endif
+}
+#endif
+
+void pcm_S16ToFl32(float *dst, const int16_t *src, size_t count)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX2())
+    {
+        S16ToFl32AVX2(dst, src, count);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available())
+    {
+        S16ToFl32NEON(dst, src, count);
+        return;
+    }
+#endif
+    S16ToFl32C(dst, src, count);
+}
+
+void pcm_S32ToFl32(float *dst, const int32_t *src, size_t count)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX2())
+    {
+        S32ToFl32AVX2(dst, src, count);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available())
+    {
+        S32ToFl32NEON(dst, src, count);
+        return;
+    }
+#endif
+    S32ToFl32C(dst, src, count);
+}
+
+void pcm_Fl32ToS16(int16_t *dst, const float *src, size_t count,
+                   pcm_dither_t *dither)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX2())
+    {
+        Fl32ToS16AVX2(dst, src, count, dither);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available())
+    {
+        Fl32ToS16NEON(dst, src, count, dither);
+        return;
+    }
+#endif
+    Fl32ToS16C(dst, src, count, dither);
+}
+
+void pcm_Fl32ToS32(int32_t *dst, const float *src, size_t count)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX2())
+    {
+        Fl32ToS32AVX2(dst, src, count);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available())
+    {
+        Fl32ToS32NEON(dst, src, count);
+        return;
+    }
+#endif
+    Fl32ToS32C(dst, src, count);
+}
+
+void pcm_AmplifyFl32(float *p, size_t count, float factor)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX())
+    {
+        AmplifyFl32AVX(p, count, factor);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available())
+    {
+        AmplifyFl32NEON(p, count, factor);
+        return;
+    }
+#endif
+    AmplifyFl32C(p, count, factor);
+}
+
+/* The SIMD versions take the factor as a 16-bits integer */
+void pcm_AmplifyS16(int16_t *p, size_t count, int factor)
+{
+#ifdef PCM_X86
+    if (vlc_CPU_AVX2() && factor <= INT16_MAX)
+    {
+        AmplifyS16AVX2(p, count, factor);
+        return;
+    }
+#endif
+#ifdef PCM_NEON
+    if (NEON_Available() && factor <= INT16_MAX)
+    {
+        AmplifyS16NEON(p, count, factor);
+        return;
+    }
+#endif
+    AmplifyS16C(p, count, factor);
+}
+
+#ifdef PCM_TEST
+/*****************************************************************************
+ * Test and benchmark
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SAMPLES (1024 * 8 + 13)
+#define RUNS 2000
+
+typedef void (*s16_to_fl32_t)(float *, const int16_t *, size_t);
+typedef void (*s32_to_fl32_t)(float *, const int32_t *, size_t);
+typedef void (*fl32_to_s16_t)(int16_t *, const float *, size_t,
+                              pcm_dither_t *);
+typedef void (*fl32_to_s32_t)(int32_t *, const float *, size_t);
+typedef void (*amplify_fl32_t)(float *, size_t, float);
+typedef void (*amplify_s16_t)(int16_t *, size_t, int);
+
+struct kernels
+{
+    const char *name;
+    bool (*available)(void);
+    s16_to_fl32_t s16_to_fl32;
+    s32_to_fl32_t s32_to_fl32;
+    fl32_to_s16_t fl32_to_s16;
+    fl32_to_s32_t fl32_to_s32;
+    amplify_fl32_t amplify_fl32;
+    amplify_s16_t amplify_s16;
+};
+
+#ifdef PCM_X86
+static bool AVX2_Available(void)
+{
+    return vlc_CPU_AVX() && vlc_CPU_AVX2();
+}
+#endif
+
+static const struct kernels kernels[] = {
+#ifdef PCM_X86
+    { "AVX2", AVX2_Available, S16ToFl32AVX2, S32ToFl32AVX2, Fl32ToS16AVX2,
+      Fl32ToS32AVX2, AmplifyFl32AVX, AmplifyS16AVX2 },
+#endif
+#ifdef PCM_NEON
+    { "NEON", NEON_Available, S16ToFl32NEON, S32ToFl32NEON, Fl32ToS16NEON,
+      Fl32ToS32NEON, AmplifyFl32NEON, AmplifyS16NEON },
+#endif
+};
+
+/* Large enough for the samples to grow in place */
+static union { float f[SAMPLES]; int32_t s32[SAMPLES]; int16_t s16[SAMPLES]; }
+    ref, out;
+static float fl32[SAMPLES];
+static int16_t s16[SAMPLES];
+static int32_t s32[SAMPLES];
+
+static void Fail(const char *name, const char *what, size_t i)
+{
+    fprintf(stderr, "%s %s: mismatch at sample %zu\n", name, what, i);
+    abort();
+}
+
+static void Check(const struct kernels *k)
+{
+    for (size_t i = 0; i < SAMPLES; i++)
+    {   /* Include out of range and extreme values */
+        fl32[i] = (rand() / (float)RAND_MAX - .5f) * 2.2f;
+        s16[i] = rand();
+        s32[i] = rand() * 2u + (rand() & 1);
+    }
+    fl32[0] = 1.f; fl32[1] = -1.f; fl32[2] = 1e9f; fl32[3] = -1e9f;
+    s16[0] = INT16_MIN; s16[1] = INT16_MAX;
+    s32[0] = INT32_MIN; s32[1] = INT32_MAX;
+
+    for (size_t count = 0; count < SAMPLES; count += 1 + count / 4)
+    {
+        /* In place, as in the converters */
+        memcpy(ref.s16, s16, count * sizeof (*s16));
+        memcpy(out.s16, s16, count * sizeof (*s16));
+        S16ToFl32C(ref.f, ref.s16, count);
+        k->s16_to_fl32(out.f, out.s16, count);
+        for (size_t i = 0; i < count; i++)
+            if (out.f[i] != ref.f[i])
+                Fail(k->name, "S16 to FL32", i);
+
+        memcpy(ref.s32, s32, count * sizeof (*s32));
+        memcpy(out.s32, s32, count * sizeof (*s32));
+        S32ToFl32C(ref.f, ref.s32, count);
+        k->s32_to_fl32(out.f, out.s32, count);
+        for (size_t i = 0; i < count; i++)
+            if (out.f[i] != ref.f[i])
+                Fail(k->name, "S32 to FL32", i);
+
+        /* Rounding of the halves may differ */
+        memcpy(ref.f, fl32, count * sizeof (*fl32));
+        memcpy(out.f, fl32, count * sizeof (*fl32));
+        Fl32ToS16C(ref.s16, ref.f, count, NULL);
+        k->fl32_to_s16(out.s16, out.f, count, NULL);
+        for (size_t i = 0; i < count; i++)
+            if (abs(out.s16[i] - ref.s16[i]) > 1)
+                Fail(k->name, "FL32 to S16", i);
+
+        memcpy(ref.f, fl32, count * sizeof (*fl32));
+        memcpy(out.f, fl32, count * sizeof (*fl32));
+        Fl32ToS32C(ref.s32, ref.f, count);
+        k->fl32_to_s32(out.s32, out.f, count);
+        for (size_t i = 0; i < count; i++)
+            if (llabs((int64_t)out.s32[i] - ref.s32[i]) > 1)
+                Fail(k->name, "FL32 to S32", i);
+
+        memcpy(ref.f, fl32, count * sizeof (*fl32));
+        memcpy(out.f, fl32, count * sizeof (*fl32));
+        AmplifyFl32C(ref.f, count, .7f);
+        k->amplify_fl32(out.f, count, .7f);
+        for (size_t i = 0; i < count; i++)
+            if (out.f[i] != ref.f[i])
+                Fail(k->name, "FL32 volume", i);
+
+        memcpy(ref.s16, s16, count * sizeof (*s16));
+        memcpy(out.s16, s16, count * sizeof (*s16));
+        AmplifyS16C(ref.s16, count, 300);
+        k->amplify_s16(out.s16, count, 300);
+        for (size_t i = 0; i < count; i++)
+            if (out.s16[i] != ref.s16[i])
+                Fail(k->name, "S16 volume", i);
+    }
+
+    /* The dither noise is within one LSB, and centered */
+    for (size_t i = 0; i < SAMPLES; i++)
+        fl32[i] = (rand() / (float)RAND_MAX - .5f) * 1.9f;
+
+    pcm_dither_t dither;
+    double sum = 0.;
+
+    pcm_InitDither(&dither);
+    memcpy(out.f, fl32, sizeof (fl32));
+    k->fl32_to_s16(out.s16, out.f, SAMPLES, &dither);
+    for (size_t i = 0; i < SAMPLES; i++)
+    {
+        double error = out.s16[i] - fl32[i] * 32768.;
+
+        if (fabs(error) > 1.5)
+            Fail(k->name, "dithered FL32 to S16", i);
+        sum += error;
+    }
+    if (fabs(sum / SAMPLES) > .05)
+        Fail(k->name, "dithered FL32 to S16 bias", SAMPLES);
+}
+
+static void Bench(const char *name, s16_to_fl32_t s16_to_fl32,
+                  s32_to_fl32_t s32_to_fl32, fl32_to_s16_t fl32_to_s16,
+                  fl32_to_s32_t fl32_to_s32, amplify_fl32_t amplify_fl32,
+                  amplify_s16_t amplify_s16)
+{
+    pcm_dither_t dither;
+    vlc_tick_t t[7];
+
+    pcm_InitDither(&dither);
+
+    t[0] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        s16_to_fl32(out.f, s16, SAMPLES);
+    t[1] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        s32_to_fl32(out.f, s32, SAMPLES);
+    t[2] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        fl32_to_s16(out.s16, fl32, SAMPLES, NULL);
+    t[3] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        fl32_to_s16(out.s16, fl32, SAMPLES, &dither);
+    t[4] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        fl32_to_s32(out.s32, fl32, SAMPLES);
+    t[5] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        amplify_fl32(fl32, SAMPLES, 1.f);
+    t[6] = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        amplify_s16(s16, SAMPLES, 256);
+
+    const double ns = 1000. / ((double)RUNS * SAMPLES);
+    printf("%-4s S16>FL32 %.2f S32>FL32 %.2f FL32>S16 %.2f (dither %.2f) "
+           "FL32>S32 %.2f FL32 vol %.2f S16 vol %.2f ns/sample\n", name,
+           (t[1] - t[0]) * ns, (t[2] - t[1]) * ns, (t[3] - t[2]) * ns,
+           (t[4] - t[3]) * ns, (t[5] - t[4]) * ns, (t[6] - t[5]) * ns,
+           (mdate() - t[6]) * ns);
+}
+
+int main(void)
+{
+    alarm(60);
+
+    Bench("C", S16ToFl32C, S32ToFl32C, Fl32ToS16C, Fl32ToS32C, AmplifyFl32C,
+          AmplifyS16C);
+
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        const struct kernels *k = &kernels[i];
+
+        if (!k->available())
+        {
+            printf("%s not available\n", k->name);
+            continue;
+        }
+        Check(k);
+        Bench(k->name, k->s16_to_fl32, k->s32_to_fl32, k->fl32_to_s16,
+              k->fl32_to_s32, k->amplify_fl32, k->amplify_s16);
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * pcm.h: PCM sample conversion and scaling
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_PCM_H
+#define VLC_PCM_H 1
+
+/**
+ * Conversions work on samples regardless of the channels. The destination
+ * may start at the same address as the source, so that samples are
+ * converted in place.
+ */
+
+/** State of the triangular dither noise */
+typedef struct
+{
+    uint32_t state[8];
+} pcm_dither_t;
+
+void pcm_InitDither(pcm_dither_t *);
+
+void pcm_S16ToFl32(float *dst, const int16_t *src, size_t count);
+void pcm_S32ToFl32(float *dst, const int32_t *src, size_t count);
+
+/**
+ * Converts to signed 16-bits with saturation.
+ *
+ * \param dither triangular dither of one LSB added before rounding,
+ *               or NULL for none
+ */
+void pcm_Fl32ToS16(int16_t *dst, const float *src, size_t count,
+                   pcm_dither_t *dither);
+void pcm_Fl32ToS32(int32_t *dst, const float *src, size_t count);
+
+void pcm_AmplifyFl32(float *samples, size_t count, float factor);
+
+/**
+ * Multiplies samples with saturation.
+ *
+ * \param factor 8.8 fixed point factor
+ */
+void pcm_AmplifyS16(int16_t *samples, size_t count, int factor);
+
+#endif
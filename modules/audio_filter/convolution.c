@@ -0,0 +1,560 @@
+/*****************************************************************************
+ * convolution.c: uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Every partition of B frames of the responses is transformed with a complex
+ * FFT of N = 2B points, padded with zeroes. For each block of B input frames,
+ * the last 2B frames are transformed and kept in a frequency domain delay
+ * line. Output blocks are the sums, over partitions, of the products of the
+ * delayed input spectra with the partition spectra, transformed back, keeping
+ * the last B frames (overlap-save).
+ *
+ * All the signals are real, so pairs of them share complex transforms:
+ *  - two input channels are transformed together, as the real and imaginary
+ *    parts, and their spectra are separated using the Hermitian symmetry;
+ *  - the responses of two output channels are stored as the real and
+ *    imaginary parts of a single response, so that one inverse transform
+ *    gives both output channels.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef CONVOLUTION_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+
+#include "convolution.h"
+
+struct convolution
+{
+    unsigned partition; /**< B */
+    unsigned size;      /**< N = 2B */
+    unsigned parts;     /**< Partitions per response */
+    unsigned inputs;
+    unsigned outputs;
+    unsigned pairs;     /**< Output pairs */
+
+    unsigned fill;      /**< Frames in the current input block */
+    unsigned head;      /**< Newest spectrum of the delay lines */
+
+    float *in_block;    /**< inputs x N, previous then current block */
+    float *out_block;   /**< outputs x B */
+    float *fdl_re;      /**< inputs x parts x N */
+    float *fdl_im;
+    float *resp_re;     /**< inputs x pairs x parts x N */
+    float *resp_im;
+    unsigned *used;     /**< inputs x pairs, non-zero partitions */
+
+    float *work_re;     /**< N */
+    float *work_im;
+    float *twiddle_re;  /**< N, for the stage of half size h at h + j */
+    float *twiddle_im;
+    unsigned *bitrev;   /**< N */
+};
+
+/*****************************************************************************
+ * FFT
+ *****************************************************************************/
+static void FFT(const convolution_t *conv, float *restrict re,
+                float *restrict im, bool inverse)
+{
+    const unsigned n = conv->size;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned j = conv->bitrev[i];
+        if (j > i)
+        {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (unsigned half = 1; half < n; half *= 2)
+    {
+        const float *restrict wre = conv->twiddle_re + half;
+        const float *restrict wim = conv->twiddle_im + half;
+        const float sign = inverse ? 1.f : -1.f;
+
+        for (unsigned i = 0; i < n; i += 2 * half)
+        {
+            float *restrict are = re + i, *restrict aim = im + i;
+            float *restrict bre = re + i + half, *restrict bim = im + i + half;
+
+            for (unsigned j = 0; j < half; j++)
+            {
+                const float wr = wre[j], wi = sign * wim[j];
+                const float tr = bre[j] * wr - bim[j] * wi;
+                const float ti = bre[j] * wi + bim[j] * wr;
+
+                bre[j] = are[j] - tr;
+                bim[j] = aim[j] - ti;
+                are[j] += tr;
+                aim[j] += ti;
+            }
+        }
+    }
+}
+
+static void MultiplyAdd(float *restrict acc_re, float *restrict acc_im,
+                        const float *restrict xre, const float *restrict xim,
+                        const float *restrict hre, const float *restrict him,
+                        unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        acc_re[i] += xre[i] * hre[i] - xim[i] * him[i];
+        acc_im[i] += xre[i] * him[i] + xim[i] * hre[i];
+    }
+}
+
+/*****************************************************************************
+ * Engine
+ *****************************************************************************/
+static inline size_t Spectrum(const convolution_t *conv, unsigned input,
+                              unsigned part)
+{
+    return ((size_t)input * conv->parts + part) * conv->size;
+}
+
+static inline size_t Response(const convolution_t *conv, unsigned input,
+                              unsigned pair, unsigned part)
+{
+    return (((size_t)input * conv->pairs + pair) * conv->parts + part)
+           * conv->size;
+}
+
+convolution_t *convolution_New(unsigned partition, unsigned inputs,
+                               unsigned outputs, unsigned length)
+{
+    assert(partition >= 2 && (partition & (partition - 1)) == 0);
+    assert(inputs > 0 && outputs > 0 && length > 0);
+
+    convolution_t *conv = malloc(sizeof (*conv));
+    if (unlikely(conv == NULL))
+        return NULL;
+
+    const unsigned n = 2 * partition;
+
+    conv->partition = partition;
+    conv->size = n;
+    conv->parts = (length + partition - 1) / partition;
+    conv->inputs = inputs;
+    conv->outputs = outputs;
+    conv->pairs = (outputs + 1) / 2;
+
+    const size_t fdl = (size_t)inputs * conv->parts * n;
+    const size_t resp = fdl * conv->pairs;
+
+    conv->in_block = calloc((size_t)inputs * n, sizeof (float));
+    conv->out_block = calloc((size_t)outputs * partition, sizeof (float));
+    conv->fdl_re = calloc(fdl, sizeof (float));
+    conv->fdl_im = calloc(fdl, sizeof (float));
+    conv->resp_re = calloc(resp, sizeof (float));
+    conv->resp_im = calloc(resp, sizeof (float));
+    conv->used = calloc((size_t)inputs * conv->pairs, sizeof (unsigned));
+    conv->work_re = vlc_alloc(n, sizeof (float));
+    conv->work_im = vlc_alloc(n, sizeof (float));
+    conv->twiddle_re = vlc_alloc(n, sizeof (float));
+    conv->twiddle_im = vlc_alloc(n, sizeof (float));
+    conv->bitrev = vlc_alloc(n, sizeof (unsigned));
+    if (unlikely(conv->in_block == NULL || conv->out_block == NULL
+              || conv->fdl_re == NULL || conv->fdl_im == NULL
+              || conv->resp_re == NULL || conv->resp_im == NULL
+              || conv->used == NULL || conv->work_re == NULL
+              || conv->work_im == NULL || conv->twiddle_re == NULL
+              || conv->twiddle_im == NULL || conv->bitrev == NULL))
+    {
+        convolution_Delete(conv);
+        return NULL;
+    }
+
+    for (unsigned half = 1; half < n; half *= 2)
+        for (unsigned j = 0; j < half; j++)
+        {
+            const double theta = M_PI * j / half;
+            conv->twiddle_re[half + j] = cos(theta);
+            conv->twiddle_im[half + j] = sin(theta);
+        }
+
+    unsigned bits = 0;
+    while ((1u << bits) < n)
+        bits++;
+    for (unsigned i = 0; i < n; i++)
+    {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; b++)
+            if (i & (1u << b))
+                r |= 1u << (bits - 1 - b);
+        conv->bitrev[i] = r;
+    }
+
+    conv->fill = 0;
+    conv->head = 0;
+    return conv;
+}
+
+void convolution_Delete(convolution_t *conv)
+{
+    free(conv->in_block);
+    free(conv->out_block);
+    free(conv->fdl_re);
+    free(conv->fdl_im);
+    free(conv->resp_re);
+    free(conv->resp_im);
+    free(conv->used);
+    free(conv->work_re);
+    free(conv->work_im);
+    free(conv->twiddle_re);
+    free(conv->twiddle_im);
+    free(conv->bitrev);
+    free(conv);
+}
+
+void convolution_AddResponse(convolution_t *conv, unsigned input,
+                             unsigned output, const float *response,
+                             unsigned length)
+{
+    const unsigned b = conv->partition;
+    const unsigned pair = output / 2;
+
+    assert(input < conv->inputs && output < conv->outputs);
+    length = __MIN(length, conv->parts * b);
+
+    for (unsigned p = 0; p * b < length; p++)
+    {
+        const unsigned taps = __MIN(length - p * b, b);
+        bool empty = true;
+
+        for (unsigned i = 0; i < taps; i++)
+        {
+            conv->work_re[i] = response[p * b + i];
+            if (response[p * b + i] != 0.f)
+                empty = false;
+        }
+        if (empty)
+            continue;
+
+        memset(conv->work_re + taps, 0, (conv->size - taps) * sizeof (float));
+        memset(conv->work_im, 0, conv->size * sizeof (float));
+        FFT(conv, conv->work_re, conv->work_im, false);
+
+        float *re = conv->resp_re + Response(conv, input, pair, p);
+        float *im = conv->resp_im + Response(conv, input, pair, p);
+
+        if (output & 1)
+            /* imaginary part of the pair */
+            for (unsigned k = 0; k < conv->size; k++)
+            {
+                re[k] -= conv->work_im[k];
+                im[k] += conv->work_re[k];
+            }
+        else
+            for (unsigned k = 0; k < conv->size; k++)
+            {
+                re[k] += conv->work_re[k];
+                im[k] += conv->work_im[k];
+            }
+
+        unsigned *used = &conv->used[input * conv->pairs + pair];
+        *used = __MAX(*used, p + 1);
+    }
+}
+
+/* Transforms the last 2B frames of each input into the delay lines */
+static void ForwardInputs(convolution_t *conv)
+{
+    const unsigned n = conv->size;
+
+    for (unsigned i = 0; i < conv->inputs; i += 2)
+    {
+        float *zre = conv->work_re, *zim = conv->work_im;
+        float *are = conv->fdl_re + Spectrum(conv, i, conv->head);
+        float *aim = conv->fdl_im + Spectrum(conv, i, conv->head);
+
+        memcpy(zre, conv->in_block + (size_t)i * n, n * sizeof (float));
+        if (i + 1 < conv->inputs)
+            memcpy(zim, conv->in_block + (size_t)(i + 1) * n,
+                   n * sizeof (float));
+        else
+            memset(zim, 0, n * sizeof (float));
+
+        FFT(conv, zre, zim, false);
+
+        if (i + 1 >= conv->inputs)
+        {
+            memcpy(are, zre, n * sizeof (float));
+            memcpy(aim, zim, n * sizeof (float));
+            continue;
+        }
+
+        /* Z = A + iB: A[k] = (Z[k] + Z*[-k]) / 2, B[k] = (Z[k] - Z*[-k]) / 2i */
+        float *bre = conv->fdl_re + Spectrum(conv, i + 1, conv->head);
+        float *bim = conv->fdl_im + Spectrum(conv, i + 1, conv->head);
+
+        for (unsigned k = 0; k < n; k++)
+        {
+            const unsigned m = (n - k) & (n - 1);
+
+            are[k] = .5f * (zre[k] + zre[m]);
+            aim[k] = .5f * (zim[k] - zim[m]);
+            bre[k] = .5f * (zim[k] + zim[m]);
+            bim[k] = .5f * (zre[m] - zre[k]);
+        }
+    }
+}
+
+static void ProcessBlock(convolution_t *conv)
+{
+    const unsigned n = conv->size, b = conv->partition;
+    const float scale = 1.f / n;
+
+    conv->head = (conv->head + conv->parts - 1) % conv->parts;
+    ForwardInputs(conv);
+
+    for (unsigned i = 0; i < conv->inputs; i++)
+    {
+        float *block = conv->in_block + (size_t)i * n;
+        memcpy(block, block + b, b * sizeof (float));
+    }
+
+    for (unsigned o = 0; o < conv->pairs; o++)
+    {
+        float *acc_re = conv->work_re, *acc_im = conv->work_im;
+
+        memset(acc_re, 0, n * sizeof (float));
+        memset(acc_im, 0, n * sizeof (float));
+
+        for (unsigned i = 0; i < conv->inputs; i++)
+        {
+            const unsigned used = conv->used[i * conv->pairs + o];
+
+            for (unsigned p = 0; p < used; p++)
+            {
+                const unsigned d = (conv->head + p) % conv->parts;
+
+                MultiplyAdd(acc_re, acc_im,
+                            conv->fdl_re + Spectrum(conv, i, d),
+                            conv->fdl_im + Spectrum(conv, i, d),
+                            conv->resp_re + Response(conv, i, o, p),
+                            conv->resp_im + Response(conv, i, o, p), n);
+            }
+        }
+
+        FFT(conv, acc_re, acc_im, true);
+
+        float *left = conv->out_block + (size_t)(2 * o) * b;
+        for (unsigned f = 0; f < b; f++)
+            left[f] = acc_re[b + f] * scale;
+        if (2 * o + 1 < conv->outputs)
+        {
+            float *right = left + b;
+            for (unsigned f = 0; f < b; f++)
+                right[f] = acc_im[b + f] * scale;
+        }
+    }
+}
+
+void convolution_Process(convolution_t *conv, float *out, const float *in,
+                         unsigned frames)
+{
+    const unsigned b = conv->partition;
+
+    while (frames > 0)
+    {
+        const unsigned count = __MIN(frames, b - conv->fill);
+
+        for (unsigned i = 0; i < conv->inputs; i++)
+        {
+            float *block = conv->in_block + (size_t)i * conv->size + b
+                         + conv->fill;
+            for (unsigned f = 0; f < count; f++)
+                block[f] = in[f * conv->inputs + i];
+        }
+        for (unsigned o = 0; o < conv->outputs; o++)
+        {
+            const float *block = conv->out_block + (size_t)o * b + conv->fill;
+            for (unsigned f = 0; f < count; f++)
+                out[f * conv->outputs + o] = block[f];
+        }
+
+        conv->fill += count;
+        in += count * conv->inputs;
+        out += count * conv->outputs;
+        frames -= count;
+
+        if (conv->fill == b)
+        {
+            ProcessBlock(conv);
+            conv->fill = 0;
+        }
+    }
+}
+
+void convolution_Flush(convolution_t *conv)
+{
+    const size_t fdl = (size_t)conv->inputs * conv->parts * conv->size;
+
+    memset(conv->in_block, 0, (size_t)conv->inputs * conv->size
+                              * sizeof (float));
+    memset(conv->out_block, 0, (size_t)conv->outputs * conv->partition
+                               * sizeof (float));
+    memset(conv->fdl_re, 0, fdl * sizeof (float));
+    memset(conv->fdl_im, 0, fdl * sizeof (float));
+    conv->fill = 0;
+}
+
+#ifdef CONVOLUTION_TEST
+/*****************************************************************************
+ * Test and benchmark
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_CHANNELS 3
+#define TEST_LENGTH 700
+#define TEST_FRAMES 4000
+
+static float RandomSample(void)
+{
+    return rand() / (float)RAND_MAX - .5f;
+}
+
+/* Compares with a direct convolution, processing blocks of random sizes */
+static void Check(unsigned partition, unsigned inputs, unsigned outputs)
+{
+    static float responses[MAX_CHANNELS][MAX_CHANNELS][TEST_LENGTH];
+    static float in[TEST_FRAMES * MAX_CHANNELS];
+    static float out[TEST_FRAMES * MAX_CHANNELS];
+
+    convolution_t *conv = convolution_New(partition, inputs, outputs,
+                                          TEST_LENGTH);
+    assert(conv != NULL);
+
+    for (unsigned i = 0; i < inputs; i++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            /* some responses are sparse, with empty partitions */
+            for (unsigned t = 0; t < TEST_LENGTH; t++)
+                responses[i][o][t] = ((i + o) & 1) && t % 97 != 5
+                                   ? 0.f : RandomSample();
+            convolution_AddResponse(conv, i, o, responses[i][o],
+                                    TEST_LENGTH);
+        }
+
+    for (unsigned f = 0; f < TEST_FRAMES * inputs; f++)
+        in[f] = RandomSample();
+
+    for (unsigned pos = 0; pos < TEST_FRAMES; )
+    {
+        unsigned count = 1 + rand() % (3 * partition);
+
+        count = __MIN(count, TEST_FRAMES - pos);
+        convolution_Process(conv, out + pos * outputs, in + pos * inputs,
+                            count);
+        pos += count;
+    }
+
+    for (unsigned f = partition; f < TEST_FRAMES; f++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            double ref = 0.;
+
+            for (unsigned i = 0; i < inputs; i++)
+                for (unsigned t = 0; t < TEST_LENGTH && t <= f - partition;
+                     t++)
+                    ref += responses[i][o][t]
+                         * in[(f - partition - t) * inputs + i];
+
+            if (fabs(out[f * outputs + o] - ref) > 1e-3)
+            {
+                fprintf(stderr, "%u partition, %u -> %u channels, frame %u "
+                        "output %u: %f instead of %f\n", partition, inputs,
+                        outputs, f, o, out[f * outputs + o], ref);
+                abort();
+            }
+        }
+
+    convolution_Delete(conv);
+}
+
+#define RATE 48000
+#define BENCH_LENGTH (RATE / 4)
+#define BENCH_SECONDS 4
+#define BENCH_BLOCK 1024
+
+/* Prints the CPU load per input channel, rendered to two outputs, for a
+ * 250 ms response */
+static void Bench(unsigned partition, unsigned inputs)
+{
+    static float response[BENCH_LENGTH];
+    static float in[BENCH_BLOCK * 8];
+    static float out[BENCH_BLOCK * 2];
+
+    convolution_t *conv = convolution_New(partition, inputs, 2,
+                                          BENCH_LENGTH);
+    assert(conv != NULL);
+
+    for (unsigned t = 0; t < BENCH_LENGTH; t++)
+        response[t] = RandomSample() * expf(-t * 20.f / BENCH_LENGTH);
+    for (unsigned i = 0; i < inputs; i++)
+    {
+        convolution_AddResponse(conv, i, 0, response, BENCH_LENGTH);
+        convolution_AddResponse(conv, i, 1, response, BENCH_LENGTH);
+    }
+    for (unsigned f = 0; f < BENCH_BLOCK * inputs; f++)
+        in[f] = RandomSample();
+
+    vlc_tick_t start = mdate();
+    for (unsigned pos = 0; pos < BENCH_SECONDS * RATE; pos += BENCH_BLOCK)
+        convolution_Process(conv, out, in, BENCH_BLOCK);
+    vlc_tick_t duration = mdate() - start;
+
+    printf("%4u frames partition (%5.2f ms), %u channels: "
+           "%5.2f%% CPU per channel\n", partition, partition * 1000. / RATE,
+           inputs, 100. * duration / (BENCH_SECONDS * CLOCK_FREQ) / inputs);
+    convolution_Delete(conv);
+}
+
+int main(void)
+{
+    alarm(60);
+
+    for (unsigned partition = 2; partition <= 512; partition *= 4)
+        for (unsigned inputs = 1; inputs <= MAX_CHANNELS; inputs++)
+            for (unsigned outputs = 1; outputs <= MAX_CHANNELS; outputs++)
+                Check(partition, inputs, outputs);
+
+    for (unsigned partition = 64; partition <= 2048; partition *= 2)
+    {
+        Bench(partition, 2);
+        Bench(partition, 8);
+    }
+    return 0;
+}
+#endif
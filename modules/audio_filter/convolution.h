@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * convolution.h: uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CONVOLUTION_H
+#define VLC_CONVOLUTION_H 1
+
+/**
+ * Convolution of interleaved input channels with a matrix of impulse
+ * responses, one per input and output channel.
+ *
+ * The responses are cut in partitions of the same size, and filtered by
+ * overlap-save in the frequency domain. The output is delayed by one
+ * partition, which is the latency of the engine, while the processing cost
+ * grows as the partitions get smaller.
+ */
+typedef struct convolution convolution_t;
+
+/**
+ * Creates a convolution engine with zero responses.
+ *
+ * \param partition latency in frames, a power of two
+ * \param length maximum length of the responses in frames
+ * \return the engine, or NULL on error
+ */
+convolution_t *convolution_New(unsigned partition, unsigned inputs,
+                               unsigned outputs, unsigned length);
+
+void convolution_Delete(convolution_t *);
+
+/**
+ * Adds an impulse response from one input channel to one output channel.
+ *
+ * Responses longer than the length given at creation are truncated.
+ */
+void convolution_AddResponse(convolution_t *, unsigned input, unsigned output,
+                             const float *response, unsigned length);
+
+/**
+ * Filters interleaved frames.
+ *
+ * \param out frames of the output channels, delayed by one partition
+ * \param in frames of the input channels
+ */
+void convolution_Process(convolution_t *, float *out, const float *in,
+                         unsigned frames);
+
+/**
+ * Clears the history of the input signal.
+ */
+void convolution_Flush(convolution_t *);
+
+#endif
@@ -37,15 +37,16 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
-static void CalcPeakEQCoeffs( float, float, float, float, float * );
-static void CalcShelfEQCoeffs( float, float, float, int, float, float * );
-static void ProcessEQ( const float *, float *, float *, unsigned, unsigned,
-                       const float *, unsigned );
+static void CalcPeakEQCoeffs( float, float, float, float, biquad_coeffs_t * );
+static void CalcShelfEQCoeffs( float, float, float, int, float,
+                               biquad_coeffs_t * );
 static block_t *DoWork( filter_t *, block_t * );
 
 vlc_module_begin ()
@@ -92,7 +93,7 @@ struct filter_sys_t
     float   f_f3, f_Q3, f_gain3;
     float   f_highf, f_highgain;
     /* Filter computed coeffs */
-    float   coeffs[5*5];
+    biquad_coeffs_t coeffs[5];
     /* State */
     float  *p_state;
 };
@@ -137,17 +138,23 @@ static int Open( vlc_object_t *p_this )
 
     i_samplerate = p_filter->fmt_in.audio.i_rate;
     CalcPeakEQCoeffs(p_sys->f_f1, p_sys->f_Q1, p_sys->f_gain1,
-                     i_samplerate, p_sys->coeffs+0*5);
+                     i_samplerate, p_sys->coeffs+0);
     CalcPeakEQCoeffs(p_sys->f_f2, p_sys->f_Q2, p_sys->f_gain2,
-                     i_samplerate, p_sys->coeffs+1*5);
+                     i_samplerate, p_sys->coeffs+1);
     CalcPeakEQCoeffs(p_sys->f_f3, p_sys->f_Q3, p_sys->f_gain3,
-                     i_samplerate, p_sys->coeffs+2*5);
+                     i_samplerate, p_sys->coeffs+2);
     CalcShelfEQCoeffs(p_sys->f_lowf, 1, p_sys->f_lowgain, 0,
-                      i_samplerate, p_sys->coeffs+3*5);
+                      i_samplerate, p_sys->coeffs+3);
     CalcShelfEQCoeffs(p_sys->f_highf, 1, p_sys->f_highgain, 0,
-                      i_samplerate, p_sys->coeffs+4*5);
-    p_sys->p_state = (float*)calloc( p_filter->fmt_in.audio.i_channels*5*4,
+                      i_samplerate, p_sys->coeffs+4);
+    p_sys->p_state = (float*)calloc( BIQUAD_CASCADE_STATE(
+                                        p_filter->fmt_in.audio.i_channels, 5 ),
                                      sizeof(float) );
+    if( !p_sys->p_state )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
 
     return VLC_SUCCESS;
 }
@@ -166,26 +173,20 @@ static void Close( vlc_object_t *p_this )
  *****************************************************************************/
 static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
-    ProcessEQ( (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
-               p_filter->p_sys->p_state,
-               p_filter->fmt_in.audio.i_channels, p_in_buf->i_nb_samples,
-               p_filter->p_sys->coeffs, 5 );
+    biquad_Cascade( (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
+                    p_in_buf->i_nb_samples, p_filter->fmt_in.audio.i_channels,
+                    p_filter->p_sys->coeffs, 5, p_filter->p_sys->p_state );
     return p_in_buf;
 }
 
 /*
  * Calculate direct form IIR coefficients for peaking EQ
- * coeffs[0] = b0
- * coeffs[1] = b1
- * coeffs[2] = b2
- * coeffs[3] = a1
- * coeffs[4] = a2
  *
  * Equations taken from RBJ audio EQ cookbook
  * (http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt)
  */
 static void CalcPeakEQCoeffs( float f0, float Q, float gainDB, float Fs,
-                              float *coeffs )
+                              biquad_coeffs_t *coeffs )
 {
     float A;
     float w0;
@@ -212,26 +213,21 @@ static void CalcPeakEQCoeffs( float f0, float Q, float gainDB, float Fs,
     a2 = 1 - alpha/A;
  
     // Store values to coeffs and normalize by 1/a0
-    coeffs[0] = b0/a0;
-    coeffs[1] = b1/a0;
-    coeffs[2] = b2/a0;
-    coeffs[3] = a1/a0;
-    coeffs[4] = a2/a0;
+    coeffs->b0 = b0/a0;
+    coeffs->b1 = b1/a0;
+    coeffs->b2 = b2/a0;
+    coeffs->a1 = a1/a0;
+    coeffs->a2 = a2/a0;
 }
 
 /*
  * Calculate direct form IIR coefficients for low/high shelf EQ
- * coeffs[0] = b0
- * coeffs[1] = b1
- * coeffs[2] = b2
- * coeffs[3] = a1
- * coeffs[4] = a2
  *
  * Equations taken from RBJ audio EQ cookbook
  * (http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt)
  */
 static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
-                               float Fs, float *coeffs )
+                               float Fs, biquad_coeffs_t *coeffs )
 {
     float A;
     float w0;
@@ -267,56 +263,9 @@ static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
         a2 =        (A+1) + (A-1)*cosf(w0) - 2*sqrtf(A)*alpha;
     }
     // Store values to coeffs and normalize by 1/a0
-    coeffs[0] = b0/a0;
-    coeffs[1] = b1/a0;
-    coeffs[2] = b2/a0;
-    coeffs[3] = a1/a0;
-    coeffs[4] = a2/a0;
+    coeffs->b0 = b0/a0;
+    coeffs->b1 = b1/a0;
+    coeffs->b2 = b2/a0;
+    coeffs->a1 = a1/a0;
+    coeffs->a2 = a2/a0;
 }
-
-/*
-  src is assumed to be interleaved
-  dest is assumed to be interleaved
-  size of state is 4*channels*eqCount
-  samples is not premultiplied by channels
-  size of coeffs is 5*eqCount
-*/
-void ProcessEQ( const float *src, float *dest, float *state,
-                unsigned channels, unsigned samples, const float *coeffs,
-                unsigned eqCount )
-{
-    unsigned i, chn, eq;
-    float   b0, b1, b2, a1, a2;
-    float   x, y = 0;
-    const float *src1 = src;
-    float *dest1 = dest;
-
-    for (i = 0; i < samples; i++)
-    {
-        float *state1 = state;
-        for (chn = 0; chn < channels; chn++)
-        {
-            const float *coeffs1 = coeffs;
-            x = *src1++;
-            /* Direct form 1 IIRs */
-            for (eq = 0; eq < eqCount; eq++)
-            {
-                b0 = coeffs1[0];
-                b1 = coeffs1[1];
-                b2 = coeffs1[2];
-                a1 = coeffs1[3];
-                a2 = coeffs1[4];
-                coeffs1 += 5;
-                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
-                state1[1] = state1[0];
-                state1[0] = x;
-                state1[3] = state1[2];
-                state1[2] = y;
-                x = y;
-                state1 += 4;
-            }
-            *dest1++ = y;
-        }
-    }
-}
-
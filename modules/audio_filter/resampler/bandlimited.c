@@ -31,6 +31,13 @@
  * It uses a Kaiser-windowed sinc-function low-pass filter and the width of the
  * filter is 13 samples.
  *
+ * The filter coefficients are precomputed for each phase of the output
+ * samples, so that the inner products can use SIMD instructions. The phases
+ * are exact when the rates have a small common period (44.1 <-> 48 kHz,
+ * 48 <-> 96 kHz...). Otherwise, for instance while the audio output adjusts
+ * the rate to keep in sync, the outputs of the two nearest phases out of
+ * BL_INTERP_PHASES are linearly interpolated.
+ *
  *****************************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -46,6 +53,7 @@
 #include <assert.h>
 
 #include "bandlimited.h"
+#include "polyphase.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -55,17 +63,24 @@
 static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 static block_t *Resample( filter_t *, block_t * );
+static void SetupPhases( filter_t *, double d_factor, size_t i_filter_wing );
 
 static void ResampleFloat( filter_t *p_filter,
                            block_t **pp_out_buf,  size_t *pi_out,
                            float **pp_in,
                            int i_in, int i_in_end,
                            double d_factor, bool b_factor_old,
+                           bool b_phases,
                            int i_nb_channels, int i_bytes_per_frame );
 
 /*****************************************************************************
  * Local structures
  *****************************************************************************/
+#define BL_MAX_PHASES      1024        /* exact phases, for small periods */
+#define BL_MAX_COEFS       (1 << 18)   /* size limit of the exact tables */
+#define BL_INTERP_PHASES   128         /* interpolated phases otherwise */
+#define BL_MAX_WING_TAPS   64
+
 struct filter_sys_t
 {
     int32_t *p_buf;                        /* this filter introduces a delay */
@@ -78,6 +93,17 @@ struct filter_sys_t
     bool b_first;
 
     date_t end_date;
+
+    /* Precomputed filters for the current rates, or NULL */
+    polyphase_t *p_phases;
+    unsigned int i_phases_in_rate;
+    unsigned int i_phases_out_rate;
+    bool b_phases_up;                           /* built for d_factor >= 1 */
+    bool b_phases_interp;
+    unsigned int i_phases_div;         /* remainder units per exact phase */
+    unsigned int i_phases_left;          /* taps before the current sample */
+    unsigned int i_phases_right;          /* taps after the current sample */
+    unsigned int pi_phases_rem[BL_INTERP_PHASES + 1]; /* interpolated ones */
 };
 
 /*****************************************************************************
@@ -208,6 +234,9 @@ static block_t *Resample( filter_t * p_filter, block_t * p_in_buf )
         p_sys->d_old_factor + 0.5;
     d_scale_factor = SMALL_FILTER_SCALE * d_factor + 0.5;
 
+    /* Precompute the filters for the current rates */
+    SetupPhases( p_filter, d_factor, i_filter_wing );
+
     /* Apply the old rate until we have enough samples for the new one */
     i_in = p_sys->i_old_wing;
     p_in += p_sys->i_old_wing * i_nb_channels;
@@ -216,10 +245,16 @@ static block_t *Resample( filter_t * p_filter, block_t * p_in_buf )
     if( p_sys->i_old_wing <= i_in_nb )
         i_old_in_end = __MIN( i_filter_wing, i_in_nb - p_sys->i_old_wing );
 
+    /* The filters may not fit in the old wing, if the rates changed */
+    bool b_old_phases = p_sys->p_phases != NULL
+        && p_sys->b_phases_up == ( p_sys->d_old_factor >= 1 )
+        && p_sys->i_phases_left <= p_sys->i_old_wing + 1
+        && i_old_in_end + p_sys->i_phases_right + 1 <= i_in_nb;
+
     ResampleFloat( p_filter,
                    &p_out_buf, &i_out, &p_in,
                    i_in, i_old_in_end,
-                   p_sys->d_old_factor, true,
+                   p_sys->d_old_factor, true, b_old_phases,
                    i_nb_channels, i_bytes_per_frame );
     i_in = __MAX( i_in, i_old_in_end );
 
@@ -235,6 +270,8 @@ static block_t *Resample( filter_t * p_filter, block_t * p_in_buf )
                        &p_out_buf, &i_out, &p_in,
                        i_in, i_in_nb - i_filter_wing,
                        d_factor, false,
+                       p_sys->p_phases != NULL
+                        && p_sys->b_phases_up == ( d_factor >= 1 ),
                        i_nb_channels, i_bytes_per_frame );
 
         /* Finalize aout buffer */
@@ -307,6 +344,8 @@ static int OpenFilter( vlc_object_t *p_this )
 
     p_sys->i_old_wing = 0;
     p_sys->b_first = true;
+    p_sys->p_phases = NULL;
+    p_sys->b_phases_interp = false;
     p_filter->pf_audio_filter = Resample;
 
     msg_Dbg( p_this, "%4.4s/%iKHz/%i->%4.4s/%iKHz/%i",
@@ -329,6 +368,8 @@ static int OpenFilter( vlc_object_t *p_this )
 static void CloseFilter( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
+    if( p_filter->p_sys->p_phases )
+        polyphase_Delete( p_filter->p_sys->p_phases );
     free( p_filter->p_sys->p_buf );
     free( p_filter->p_sys );
 }
@@ -432,6 +473,246 @@ static void FilterFloatUD( const float Imp[], const float ImpD[], uint16_t Nwing
     }
 }
 
+/*****************************************************************************
+ * WingTaps: computes the coefficients used by FilterFloatUP/FilterFloatUD
+ *****************************************************************************
+ * Returns the number of taps, or 0 if there are more than i_max.
+ *****************************************************************************/
+static unsigned WingTaps( float *p_taps, unsigned i_max,
+                          uint32_t ui_remainder, uint32_t ui_output_rate,
+                          uint32_t ui_input_rate, bool b_up, int16_t Inc )
+{
+    const float *Imp = SMALL_FILTER_FLOAT_IMP, *ImpD = SMALL_FILTER_FLOAT_IMPD;
+    const float *Hp, *Hdp, *End = &Imp[SMALL_FILTER_NWING];
+    unsigned i_taps = 0;
+
+    if( b_up )
+    {
+        Hp = &Imp[(ui_remainder<<Nhc)/ui_output_rate];
+        Hdp = &ImpD[(ui_remainder<<Nhc)/ui_output_rate];
+
+        uint32_t ui_linear_remainder = (ui_remainder<<Nhc) -
+                            (ui_remainder<<Nhc)/ui_output_rate*ui_output_rate;
+
+        if( Inc == 1 )
+        {
+            End--;
+            if( ui_remainder == 0 )
+            {
+                Hp += Npc;
+                Hdp += Npc;
+            }
+        }
+
+        while( Hp < End )
+        {
+            if( i_taps == i_max )
+                return 0;
+            float t = *Hp;
+            t += *Hdp * ui_linear_remainder / ui_output_rate / Npc;
+            p_taps[i_taps++] = t;
+            Hdp += Npc;
+            Hp += Npc;
+        }
+        return i_taps;
+    }
+
+    int ui_counter = 0;
+
+    Hp = Imp + (ui_remainder<<Nhc) / ui_input_rate;
+    Hdp = ImpD + (ui_remainder<<Nhc) / ui_input_rate;
+
+    if( Inc == 1 )
+    {
+        End--;
+        if( ui_remainder == 0 )
+        {
+            Hp = Imp + (ui_output_rate << Nhc) / ui_input_rate;
+            Hdp = ImpD + (ui_output_rate << Nhc) / ui_input_rate;
+            ui_counter++;
+        }
+    }
+
+    while( Hp < End )
+    {
+        if( i_taps == i_max )
+            return 0;
+        float t = *Hp;
+        uint32_t ui_linear_remainder =
+          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) -
+          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) /
+          ui_input_rate * ui_input_rate;
+        t += *Hdp * ui_linear_remainder / ui_input_rate / Npc;
+        p_taps[i_taps++] = t;
+
+        ui_counter++;
+        Hp = Imp + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
+                    / ui_input_rate;
+        Hdp = ImpD + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
+                     / ui_input_rate;
+    }
+    return i_taps;
+}
+
+/*****************************************************************************
+ * SetupPhases: precomputes the filters for the current rates
+ *****************************************************************************/
+static void SetupPhases( filter_t *p_filter, double d_factor,
+                         size_t i_filter_wing )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+    const unsigned i_out_rate = p_filter->fmt_out.audio.i_rate;
+    const unsigned i_nb_channels = p_filter->fmt_in.audio.i_channels;
+    const bool b_up = d_factor >= 1;
+
+    if( p_sys->p_phases != NULL && p_sys->i_phases_in_rate == i_in_rate
+     && p_sys->i_phases_out_rate == i_out_rate && p_sys->b_phases_up == b_up )
+        return;
+
+    /* The interpolated filters are kept while the input rate drifts: they
+     * only depend on the phase when upsampling, and when downsampling they
+     * are kept until their taps would move by a step of the impulse
+     * response table. */
+    if( p_sys->p_phases != NULL && p_sys->b_phases_interp
+     && p_sys->i_phases_out_rate == i_out_rate && p_sys->b_phases_up == b_up
+     && p_sys->i_phases_left <= i_filter_wing
+     && p_sys->i_phases_right + 1 <= i_filter_wing
+     && ( b_up || (uint64_t)abs( (int)( i_in_rate - p_sys->i_phases_in_rate ) )
+                  * SMALL_FILTER_NWING < i_in_rate ) )
+        return;
+
+    if( p_sys->p_phases != NULL )
+    {
+        polyphase_Delete( p_sys->p_phases );
+        p_sys->p_phases = NULL;
+    }
+
+    if( i_nb_channels > POLYPHASE_MAX_CHANNELS )
+        return;
+
+    /* The remainder goes through multiples of the common divisor */
+    const unsigned i_div = GCD( i_in_rate, i_out_rate );
+    bool b_interp = i_out_rate / i_div > BL_MAX_PHASES;
+    unsigned i_phases, i_left, i_right;
+    unsigned pi_rem[BL_MAX_PHASES];
+    float p_taps[2][BL_MAX_WING_TAPS];
+
+retry:
+    i_phases = b_interp ? BL_INTERP_PHASES : i_out_rate / i_div;
+    i_left = i_right = 0;
+    for( unsigned i = 0; i < i_phases; i++ )
+    {
+        pi_rem[i] = b_interp ? (uint64_t)i * i_out_rate / BL_INTERP_PHASES
+                             : i * i_div;
+
+        unsigned n = WingTaps( p_taps[0], BL_MAX_WING_TAPS, pi_rem[i],
+                               i_out_rate, i_in_rate, b_up, -1 );
+        unsigned m = WingTaps( p_taps[1], BL_MAX_WING_TAPS,
+                               i_out_rate - pi_rem[i],
+                               i_out_rate, i_in_rate, b_up, 1 );
+        if( n == 0 || m == 0 )
+            return;
+        i_left = __MAX( i_left, n );
+        i_right = __MAX( i_right, m );
+    }
+
+    /* The filters must fit in the samples kept from the previous buffers,
+     * with one more frame for the interpolation. */
+    if( i_left > i_filter_wing || i_right + 1 > i_filter_wing )
+        return;
+    if( !b_interp
+     && (size_t)i_phases * (i_left + i_right) * i_nb_channels > BL_MAX_COEFS )
+    {
+        b_interp = true;
+        goto retry;
+    }
+
+    polyphase_t *p_table = polyphase_New( i_phases, i_left + i_right,
+                                          i_nb_channels );
+    if( unlikely(p_table == NULL) )
+        return;
+
+    for( unsigned i = 0; i < i_phases; i++ )
+    {
+        float p_row[2 * BL_MAX_WING_TAPS] = { 0.f };
+
+        unsigned n = WingTaps( p_taps[0], BL_MAX_WING_TAPS, pi_rem[i],
+                               i_out_rate, i_in_rate, b_up, -1 );
+        unsigned m = WingTaps( p_taps[1], BL_MAX_WING_TAPS,
+                               i_out_rate - pi_rem[i],
+                               i_out_rate, i_in_rate, b_up, 1 );
+        /* Oldest input frame first */
+        for( unsigned k = 0; k < n; k++ )
+            p_row[i_left - 1 - k] = p_taps[0][k];
+        for( unsigned k = 0; k < m; k++ )
+            p_row[i_left + k] = p_taps[1][k];
+        polyphase_SetTaps( p_table, i, p_row );
+    }
+
+    if( b_interp )
+    {
+        memcpy( p_sys->pi_phases_rem, pi_rem, i_phases * sizeof(unsigned) );
+        p_sys->pi_phases_rem[i_phases] = i_out_rate;
+    }
+
+    /* Do not log every rate adjustment of the audio output */
+    if( !b_interp || !p_sys->b_phases_interp )
+        msg_Dbg( p_filter, "%u %s phases of %u taps, %s inner products",
+                 i_phases, b_interp ? "interpolated" : "exact",
+                 i_left + i_right, p_table->name );
+
+    p_sys->p_phases = p_table;
+    p_sys->i_phases_in_rate = i_in_rate;
+    p_sys->i_phases_out_rate = i_out_rate;
+    p_sys->b_phases_up = b_up;
+    p_sys->b_phases_interp = b_interp;
+    p_sys->i_phases_div = i_div;
+    p_sys->i_phases_left = i_left;
+    p_sys->i_phases_right = i_right;
+}
+
+/*****************************************************************************
+ * FilterPhases: computes one output frame with the precomputed filters
+ *****************************************************************************/
+static void FilterPhases( filter_sys_t *p_sys, const float *p_in,
+                          float *p_out, uint32_t ui_output_rate,
+                          int i_nb_channels )
+{
+    const polyphase_t *p_table = p_sys->p_phases;
+    const float *p_first = p_in - (p_sys->i_phases_left - 1) * i_nb_channels;
+    const unsigned i_rem = p_sys->i_remainder;
+
+    if( !p_sys->b_phases_interp )
+    {
+        /* The remainder is a multiple of the divisor, unless the rates
+         * changed since the last discontinuity */
+        polyphase_Filter( p_table, i_rem / p_sys->i_phases_div, p_first,
+                          p_out );
+        return;
+    }
+
+    const unsigned i_phase = i_rem * BL_INTERP_PHASES / ui_output_rate;
+    const unsigned i_low = p_sys->pi_phases_rem[i_phase];
+    const unsigned i_high = p_sys->pi_phases_rem[i_phase + 1];
+
+    polyphase_Filter( p_table, i_phase, p_first, p_out );
+    if( i_rem == i_low )
+        return;
+
+    /* The phase following the last one is the first one of the next
+     * input frame */
+    float p_next[POLYPHASE_MAX_CHANNELS];
+    if( i_phase + 1 < BL_INTERP_PHASES )
+        polyphase_Filter( p_table, i_phase + 1, p_first, p_next );
+    else
+        polyphase_Filter( p_table, 0, p_first + i_nb_channels, p_next );
+
+    const float f_weight = (float)(i_rem - i_low) / (i_high - i_low);
+    for( int i = 0; i < i_nb_channels; i++ )
+        p_out[i] += f_weight * (p_next[i] - p_out[i]);
+}
+
 static int ReallocBuffer( block_t **pp_out_buf,
                           float **pp_out, size_t i_out,
                           int i_nb_channels, int i_bytes_per_frame )
@@ -457,6 +738,7 @@ static void ResampleFloat( filter_t *p_filter,
                            float **pp_in,
                            int i_in, int i_in_end,
                            double d_factor, bool b_factor_old,
+                           bool b_phases,
                            int i_nb_channels, int i_bytes_per_frame )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -486,7 +768,12 @@ static void ResampleFloat( filter_t *p_filter,
                                i_out, i_nb_channels, i_bytes_per_frame ) )
                 return;
 
-            if( d_factor >= 1 )
+            if( b_phases )
+            {
+                FilterPhases( p_sys, p_in, p_out,
+                              p_filter->fmt_out.audio.i_rate, i_nb_channels );
+            }
+            else if( d_factor >= 1 )
             {
                 /* FilterFloatUP() is faster if we can use it */
 
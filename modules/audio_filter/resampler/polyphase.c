@@ -0,0 +1,438 @@
+/*****************************************************************************
+ * polyphase.c: polyphase filter tables and inner products
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef POLYPHASE_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "polyphase.h"
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define POLYPHASE_X86 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define POLYPHASE_NEON 1
+# include <arm_neon.h>
+#endif
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static void DotC(float *out, const float *coefs, const float *in,
+                 unsigned len, unsigned channels)
+{
+    float sum[POLYPHASE_MAX_CHANNELS] = { 0.f };
+
+    for (unsigned i = 0; i < len; i += channels)
+        for (unsigned c = 0; c < channels; c++)
+            sum[c] += coefs[i + c] * in[i + c];
+
+    memcpy(out, sum, channels * sizeof (float));
+}
+
+/* The SIMD kernels require the number of channels to divide the vector size,
+ * so that every lane always accumulates the same channel. */
+#define DOT_KERNEL(name, attr, channels) \
+attr \
+static void name##channels(float *out, const float *coefs, const float *in, \
+                           unsigned len, unsigned unused) \
+{ \
+    (void) unused; \
+    name(out, coefs, in, len, channels); \
+}
+
+#ifdef POLYPHASE_X86
+/*****************************************************************************
+ * SSE
+ *****************************************************************************/
+/* Reduces the lanes and adds the remaining frames, less than a vector */
+VLC_SSE
+static inline void StoreSSE(float *out, __m128 v, const float *coefs,
+                            const float *in, unsigned len,
+                            const unsigned channels)
+{
+    if (channels <= 2)
+    {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        if (channels == 1)
+            v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, v);
+    for (unsigned c = 0; c < channels; c++)
+        out[c] = lanes[c];
+    for (unsigned i = 0; i < len; i += channels)
+        for (unsigned c = 0; c < channels; c++)
+            out[c] += coefs[i + c] * in[i + c];
+}
+
+VLC_SSE
+static inline void DotSSE(float *out, const float *coefs, const float *in,
+                          unsigned len, const unsigned channels)
+{
+    __m128 acc = _mm_setzero_ps();
+    unsigned i = 0;
+
+    for (; i + 4 <= len; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(coefs + i),
+                                         _mm_loadu_ps(in + i)));
+    StoreSSE(out, acc, coefs + i, in + i, len - i, channels);
+}
+
+DOT_KERNEL(DotSSE, VLC_SSE, 1)
+DOT_KERNEL(DotSSE, VLC_SSE, 2)
+DOT_KERNEL(DotSSE, VLC_SSE, 4)
+
+/* 5.1: three vectors span two frames, the lanes rotate by two channels */
+VLC_SSE
+static void DotSSE6(float *out, const float *coefs, const float *in,
+                    unsigned len, unsigned channels)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    assert(channels == 6);
+    (void) channels;
+    for (; i + 12 <= len; i += 12)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coefs + i),
+                                           _mm_loadu_ps(in + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coefs + i + 4),
+                                           _mm_loadu_ps(in + i + 4)));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(coefs + i + 8),
+                                           _mm_loadu_ps(in + i + 8)));
+    }
+
+    float l0[4], l1[4], l2[4];
+    _mm_storeu_ps(l0, acc0);
+    _mm_storeu_ps(l1, acc1);
+    _mm_storeu_ps(l2, acc2);
+    out[0] = l0[0] + l1[2];
+    out[1] = l0[1] + l1[3];
+    out[2] = l0[2] + l2[0];
+    out[3] = l0[3] + l2[1];
+    out[4] = l1[0] + l2[2];
+    out[5] = l1[1] + l2[3];
+
+    for (; i < len; i += 6)
+        for (unsigned c = 0; c < 6; c++)
+            out[c] += coefs[i + c] * in[i + c];
+}
+
+/*****************************************************************************
+ * AVX
+ *****************************************************************************/
+# define VLC_AVX __attribute__ ((__target__ ("avx")))
+
+VLC_AVX
+static inline void DotAVX(float *out, const float *coefs, const float *in,
+                          unsigned len, const unsigned channels)
+{
+    __m256 acc = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for (; i + 8 <= len; i += 8)
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(coefs + i),
+                                               _mm256_loadu_ps(in + i)));
+
+    if (channels == 8)
+    {
+        _mm256_storeu_ps(out, acc);
+        return;
+    }
+
+    /* Fold the upper half, and finish with 4 lanes */
+    __m128 v = _mm_add_ps(_mm256_castps256_ps128(acc),
+                          _mm256_extractf128_ps(acc, 1));
+    if (i + 4 <= len)
+    {
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(coefs + i),
+                                     _mm_loadu_ps(in + i)));
+        i += 4;
+    }
+    StoreSSE(out, v, coefs + i, in + i, len - i, channels);
+}
+
+DOT_KERNEL(DotAVX, VLC_AVX, 1)
+DOT_KERNEL(DotAVX, VLC_AVX, 2)
+DOT_KERNEL(DotAVX, VLC_AVX, 4)
+DOT_KERNEL(DotAVX, VLC_AVX, 8)
+#endif
+
+#ifdef POLYPHASE_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static inline void DotNEON(float *out, const float *coefs, const float *in,
+                           unsigned len, const unsigned channels)
+{
+    float32x4_t acc = vdupq_n_f32(0.f);
+    unsigned i = 0;
+
+    for (; i + 4 <= len; i += 4)
+        acc = vmlaq_f32(acc, vld1q_f32(coefs + i), vld1q_f32(in + i));
+
+    if (channels == 4)
+        vst1q_f32(out, acc);
+    else
+    {
+        float32x2_t v = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        if (channels == 1)
+            v = vpadd_f32(v, v);
+
+        float lanes[2];
+        vst1_f32(lanes, v);
+        for (unsigned c = 0; c < channels; c++)
+            out[c] = lanes[c];
+    }
+
+    /* Remaining frames, less than a vector */
+    for (; i < len; i += channels)
+        for (unsigned c = 0; c < channels; c++)
+            out[c] += coefs[i + c] * in[i + c];
+}
+
+DOT_KERNEL(DotNEON, , 1)
+DOT_KERNEL(DotNEON, , 2)
+DOT_KERNEL(DotNEON, , 4)
+
+static bool NEON_Available(void)
+{
+# if defined(__aarch64__)
+    return vlc_CPU_ARM64_NEON();
+# else
+    return vlc_CPU_ARM_NEON();
+# endif
+}
+#endif
+
+typedef struct
+{
+    const char     *name;
+    polyphase_dot_t dot[POLYPHASE_MAX_CHANNELS + 1]; /**< by channels */
+} polyphase_kernels_t;
+
+#ifdef POLYPHASE_X86
+static const polyphase_kernels_t kernels_sse = {
+    "SSE", { [1] = DotSSE1, [2] = DotSSE2, [4] = DotSSE4, [6] = DotSSE6 },
+};
+
+static const polyphase_kernels_t kernels_avx = {
+    "AVX", { [1] = DotAVX1, [2] = DotAVX2, [4] = DotAVX4, [6] = DotSSE6,
+             [8] = DotAVX8 },
+};
+#endif
+#ifdef POLYPHASE_NEON
+static const polyphase_kernels_t kernels_neon = {
+    "NEON", { [1] = DotNEON1, [2] = DotNEON2, [4] = DotNEON4 },
+};
+#endif
+
+static const polyphase_kernels_t *GetKernels(void)
+{
+#ifdef POLYPHASE_X86
+    if (vlc_CPU_AVX())
+        return &kernels_avx;
+    if (vlc_CPU_SSE())
+        return &kernels_sse;
+#endif
+#ifdef POLYPHASE_NEON
+    if (NEON_Available())
+        return &kernels_neon;
+#endif
+    return NULL;
+}
+
+polyphase_t *polyphase_New(unsigned phases, unsigned taps, unsigned channels)
+{
+    assert(phases > 0 && taps > 0);
+    assert(channels > 0 && channels <= POLYPHASE_MAX_CHANNELS);
+
+    polyphase_t *table = malloc(sizeof (*table));
+    if (unlikely(table == NULL))
+        return NULL;
+
+    table->phases = phases;
+    table->taps = taps;
+    table->channels = channels;
+    table->stride = taps * channels;
+    table->coefs = calloc(phases, table->stride * sizeof (float));
+    if (unlikely(table->coefs == NULL))
+    {
+        free(table);
+        return NULL;
+    }
+
+    const polyphase_kernels_t *kernels = GetKernels();
+    if (kernels != NULL && kernels->dot[channels] != NULL)
+    {
+        table->dot = kernels->dot[channels];
+        table->name = kernels->name;
+    }
+    else
+    {
+        table->dot = DotC;
+        table->name = "C";
+    }
+    return table;
+}
+
+void polyphase_Delete(polyphase_t *table)
+{
+    free(table->coefs);
+    free(table);
+}
+
+void polyphase_SetTaps(polyphase_t *table, unsigned phase, const float *taps)
+{
+    float *row = table->coefs + phase * table->stride;
+
+    assert(phase < table->phases);
+    for (unsigned i = 0; i < table->taps; i++)
+        for (unsigned c = 0; c < table->channels; c++)
+            *(row++) = taps[i];
+}
+
+#ifdef POLYPHASE_TEST
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t seed = 0x12345678;
+
+static float Rand(void)
+{
+    /* xorshift32 */
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (int32_t)seed / 2147483648.f;
+}
+
+#define MAX_TAPS 64
+#define BENCH_FRAMES 2000000
+
+static void Check(const polyphase_kernels_t *k)
+{
+    float coefs[MAX_TAPS * POLYPHASE_MAX_CHANNELS];
+    float in[MAX_TAPS * POLYPHASE_MAX_CHANNELS];
+
+    for (unsigned i = 0; i < ARRAY_SIZE(coefs); i++)
+    {
+        coefs[i] = Rand();
+        in[i] = Rand();
+    }
+
+    for (unsigned channels = 1; channels <= POLYPHASE_MAX_CHANNELS;
+         channels++)
+    {
+        if (k->dot[channels] == NULL)
+            continue;
+
+        for (unsigned taps = 1; taps <= MAX_TAPS; taps++)
+            /* Unaligned rows */
+            for (unsigned offset = 0; offset < 3; offset++)
+            {
+                const unsigned len = taps * channels;
+                float ref[POLYPHASE_MAX_CHANNELS], out[POLYPHASE_MAX_CHANNELS];
+
+                if (offset + len > ARRAY_SIZE(in))
+                    continue;
+
+                DotC(ref, coefs + offset, in + offset, len, channels);
+                k->dot[channels](out, coefs + offset, in + offset, len,
+                                 channels);
+                for (unsigned c = 0; c < channels; c++)
+                    if (fabsf(out[c] - ref[c]) > 1e-5f * taps)
+                    {
+                        fprintf(stderr, "%s: %u channels, %u taps: "
+                                "%f instead of %f\n", k->name, channels,
+                                taps, out[c], ref[c]);
+                        abort();
+                    }
+            }
+    }
+}
+
+static void Bench(const polyphase_kernels_t *k, unsigned taps,
+                  unsigned channels)
+{
+    polyphase_dot_t dot = k->dot[channels];
+    if (dot == NULL)
+        return;
+
+    const unsigned len = taps * channels;
+    float *coefs = malloc(len * sizeof (float));
+    float *in = malloc((len + BENCH_FRAMES / 1000 * channels)
+                       * sizeof (float));
+    float out[POLYPHASE_MAX_CHANNELS];
+    assert(coefs != NULL && in != NULL);
+
+    for (unsigned i = 0; i < len; i++)
+        coefs[i] = Rand();
+    for (unsigned i = 0; i < len + BENCH_FRAMES / 1000 * channels; i++)
+        in[i] = Rand();
+
+    vlc_tick_t start = mdate();
+    for (unsigned i = 0; i < BENCH_FRAMES; i++)
+        dot(out, coefs, in + (i % 1000) * channels, len, channels);
+    vlc_tick_t duration = mdate() - start;
+
+    printf("%-4s %u taps, %u channels: %6.1f Mframes/s\n", k->name, taps,
+           channels, (double)BENCH_FRAMES / __MAX(duration, 1));
+    free(coefs);
+    free(in);
+}
+
+int main(void)
+{
+    static const polyphase_kernels_t kernels_c = {
+        "C", { DotC, DotC, DotC, DotC, DotC, DotC, DotC, DotC, DotC, DotC },
+    };
+    const polyphase_kernels_t *list[] = { &kernels_c, GetKernels() };
+    const unsigned count = list[1] != NULL ? 2 : 1;
+
+    alarm(60);
+
+    if (count > 1)
+        Check(list[1]);
+    for (unsigned i = 0; i < count; i++)
+    {
+        /* 44.1 <-> 48 kHz stereo and 5.1, 96 -> 48 kHz stereo */
+        Bench(list[i], 12, 2);
+        Bench(list[i], 12, 6);
+        Bench(list[i], 26, 2);
+    }
+    return 0;
+}
+#endif
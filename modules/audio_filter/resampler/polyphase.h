@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * polyphase.h: polyphase filter tables and inner products
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_POLYPHASE_H
+#define VLC_POLYPHASE_H 1
+
+#define POLYPHASE_MAX_CHANNELS 9
+
+/**
+ * Computes the inner product of len interleaved samples of the given number
+ * of channels with as many coefficients: out[c] is the sum of
+ * coefs[i] * in[i] for all i such that i % channels == c.
+ */
+typedef void (*polyphase_dot_t)(float *out, const float *coefs,
+                                const float *in, unsigned len,
+                                unsigned channels);
+
+/**
+ * Table of FIR filters, one per phase of the output samples.
+ *
+ * Each row holds the taps of one phase for consecutive input frames, with
+ * every tap repeated for each channel, so that the inner product runs over
+ * contiguous interleaved samples.
+ */
+typedef struct
+{
+    unsigned phases;   /**< Number of rows */
+    unsigned taps;     /**< Input frames per row */
+    unsigned channels; /**< Interleaved channels */
+    unsigned stride;   /**< Coefficients per row */
+    float   *coefs;
+    polyphase_dot_t dot;
+    const char *name;  /**< Name of the inner product kernel */
+} polyphase_t;
+
+/**
+ * Allocates a table with zero coefficients, and selects the best inner
+ * product kernel for the running CPU.
+ *
+ * \return the table, or NULL on error
+ */
+polyphase_t *polyphase_New(unsigned phases, unsigned taps, unsigned channels);
+
+void polyphase_Delete(polyphase_t *);
+
+/**
+ * Sets the taps of one phase.
+ *
+ * \param taps table->taps coefficients, for the oldest input frame first
+ */
+void polyphase_SetTaps(polyphase_t *, unsigned phase, const float *taps);
+
+/**
+ * Filters one output frame.
+ *
+ * \param in first input frame covered by the filter
+ * \param out output frame
+ */
+static inline void polyphase_Filter(const polyphase_t *table, unsigned phase,
+                                    const float *in, float *out)
+{
+    table->dot(out, table->coefs + phase * table->stride, in, table->stride,
+               table->channels);
+}
+
+#endif
@@ -34,10 +34,20 @@
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 #include <vlc_atomic.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define SCALETEMPO_X86 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define SCALETEMPO_NEON 1
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -69,6 +79,10 @@ vlc_module_begin ()
         N_("Overlap Length"), N_("Percentage of stride to overlap"), true )
     add_integer_with_range( "scaletempo-search", 14, 0, 200,
         N_("Search Length"), N_("Length in milliseconds to search for best overlap position"), true )
+    add_bool( "scaletempo-fast-search", false,
+        N_("Fast search"), N_("Search for the best overlap position on a "
+        "decimated mono signal first, then refine it at full resolution. "
+        "This is much faster with many channels or long searches."), true )
 #ifdef PITCH_SHIFTER
     add_float_with_range( "pitch-shift", 0, -12, 12,
         N_("Pitch Shift"), N_("Pitch shift in semitones."), false )
@@ -89,6 +103,8 @@ vlc_module_end ()
  * Scaletempo smooths the overlap further by searching within the input buffer
  * for the best overlap position.  Scaletempo uses a statistical cross correlation
  * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here.
+ * The fast search first finds the best position on a signal mixed down to mono
+ * and decimated, then only searches around it at full resolution.
  *
  * NOTE:
  * sample: a single audio sample for one channel
@@ -130,6 +146,13 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    float   (*dot)( const float *a, const float *b, unsigned n );
+    /* coarse search */
+    bool      fast_search;
+    unsigned  frames_pre_corr_coarse;
+    unsigned  frames_search_coarse;
+    float    *buf_pre_corr_coarse;
+    float    *buf_queue_coarse;
 #ifdef PITCH_SHIFTER
     /* pitch */
     filter_t * resampler;
@@ -137,33 +160,122 @@ struct filter_sys_t
 #endif
 };
 
+/*****************************************************************************
+ * dot: inner product of the windowed overlap with a search position
+ *****************************************************************************/
+static float dot_c( const float *a, const float *b, unsigned n )
+{
+    float sum = 0;
+    for( unsigned i = 0; i < n; i++ )
+        sum += a[i] * b[i];
+    return sum;
+}
+
+#ifdef SCALETEMPO_X86
+VLC_SSE
+static float dot_sse( const float *a, const float *b, unsigned n )
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    unsigned i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                             _mm_loadu_ps( b + i ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                             _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    acc0 = _mm_add_ps( acc0, acc1 );
+    acc0 = _mm_add_ps( acc0, _mm_movehl_ps( acc0, acc0 ) );
+    acc0 = _mm_add_ss( acc0, _mm_shuffle_ps( acc0, acc0, 1 ) );
+
+    float sum = _mm_cvtss_f32( acc0 );
+    for( ; i < n; i++ )
+        sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__ ((__target__ ("avx")))
+static float dot_avx( const float *a, const float *b, unsigned n )
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for( ; i + 16 <= n; i += 16 ) {
+        acc0 = _mm256_add_ps( acc0, _mm256_mul_ps( _mm256_loadu_ps( a + i ),
+                                                   _mm256_loadu_ps( b + i ) ) );
+        acc1 = _mm256_add_ps( acc1, _mm256_mul_ps( _mm256_loadu_ps( a + i + 8 ),
+                                                   _mm256_loadu_ps( b + i + 8 ) ) );
+    }
+    acc0 = _mm256_add_ps( acc0, acc1 );
+
+    __m128 v = _mm_add_ps( _mm256_castps256_ps128( acc0 ),
+                           _mm256_extractf128_ps( acc0, 1 ) );
+    if( i + 4 <= n ) {
+        v = _mm_add_ps( v, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                       _mm_loadu_ps( b + i ) ) );
+        i += 4;
+        if( i + 4 <= n ) {
+            v = _mm_add_ps( v, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                           _mm_loadu_ps( b + i ) ) );
+            i += 4;
+        }
+    }
+    v = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+    v = _mm_add_ss( v, _mm_shuffle_ps( v, v, 1 ) );
+
+    float sum = _mm_cvtss_f32( v );
+    for( ; i < n; i++ )
+        sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
+#ifdef SCALETEMPO_NEON
+static float dot_neon( const float *a, const float *b, unsigned n )
+{
+    float32x4_t acc0 = vdupq_n_f32( 0.f ), acc1 = vdupq_n_f32( 0.f );
+    unsigned i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        acc0 = vmlaq_f32( acc0, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+        acc1 = vmlaq_f32( acc1, vld1q_f32( a + i + 4 ), vld1q_f32( b + i + 4 ) );
+    }
+    acc0 = vaddq_f32( acc0, acc1 );
+
+    float32x2_t v = vadd_f32( vget_low_f32( acc0 ), vget_high_f32( acc0 ) );
+    float sum = vget_lane_f32( vpadd_f32( v, v ), 0 );
+    for( ; i < n; i++ )
+        sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
+static void pre_correlate_float( filter_sys_t *p )
+{
+    float *pw  = p->table_window;
+    float *po  = (float *)p->buf_overlap + p->samples_per_frame;
+    float *ppc = p->buf_pre_corr;
+    unsigned i;
+
+    for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
+      *ppc++ = *pw++ * *po++;
+    }
+}
+
 static unsigned best_overlap_offset_float( filter_t *p_filter )
 {
     filter_sys_t *p = p_filter->p_sys;
-    float *pw, *po, *ppc, *search_start;
+    const unsigned samples_corr = p->samples_overlap - p->samples_per_frame;
+    float *search_start;
     float best_corr = INT_MIN;
     unsigned best_off = 0;
-    unsigned i, off;
+    unsigned off;
 
-    pw  = p->table_window;
-    po  = p->buf_overlap;
-    po += p->samples_per_frame;
-    ppc = p->buf_pre_corr;
-    for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-      *ppc++ = *pw++ * *po++;
-    }
+    pre_correlate_float( p );
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->dot( p->buf_pre_corr, search_start, samples_corr );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -174,6 +286,95 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+/*****************************************************************************
+ * best_overlap_offset_coarse: calculate best offset, coarse to fine
+ *****************************************************************************/
+#define SCALETEMPO_DECIMATION 4
+
+/* Mixes down to mono and sums groups of frames, which also low-passes the
+ * signal so that the coarse correlation does not alias */
+static void decimate_float( float *dst, const float *src, unsigned frames_out,
+                            unsigned samples_per_frame )
+{
+    const unsigned samples_in = SCALETEMPO_DECIMATION * samples_per_frame;
+    for( unsigned i = 0; i < frames_out; i++ ) {
+        float sum = 0;
+        for( unsigned j = 0; j < samples_in; j++ )
+            sum += *src++;
+        dst[i] = sum;
+    }
+}
+
+/* The coarse correlation is only sampled every SCALETEMPO_DECIMATION frames,
+ * so its highest peak is not always the one closest to the best position at
+ * full resolution: several peaks are refined. */
+#define SCALETEMPO_CANDIDATES 3
+
+static unsigned best_overlap_offset_coarse( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const unsigned samples_corr = p->samples_overlap - p->samples_per_frame;
+    float *search_start = (float *)p->buf_queue + p->samples_per_frame;
+    float cand_corr[SCALETEMPO_CANDIDATES];
+    unsigned cand_off[SCALETEMPO_CANDIDATES];
+    unsigned cands = 0;
+    float prev_corr = INT_MIN, prev_prev_corr = INT_MIN;
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    unsigned off;
+
+    pre_correlate_float( p );
+    decimate_float( p->buf_pre_corr_coarse, p->buf_pre_corr,
+                    p->frames_pre_corr_coarse, p->samples_per_frame );
+    decimate_float( p->buf_queue_coarse, search_start,
+                    p->frames_search_coarse + p->frames_pre_corr_coarse,
+                    p->samples_per_frame );
+
+    /* keep the highest local maxima of the coarse correlation */
+    for( off = 0; off <= p->frames_search_coarse; off++ ) {
+      float corr = off < p->frames_search_coarse
+                 ? p->dot( p->buf_pre_corr_coarse, p->buf_queue_coarse + off,
+                           p->frames_pre_corr_coarse )
+                 : INT_MIN;
+      if( off > 0 && prev_corr > prev_prev_corr && prev_corr >= corr ) {
+        unsigned i = cands < SCALETEMPO_CANDIDATES ? cands++ : cands;
+        while( i > 0 && cand_corr[i - 1] < prev_corr ) {
+          if( i < SCALETEMPO_CANDIDATES ) {
+            cand_corr[i] = cand_corr[i - 1];
+            cand_off[i]  = cand_off[i - 1];
+          }
+          i--;
+        }
+        if( i < SCALETEMPO_CANDIDATES ) {
+          cand_corr[i] = prev_corr;
+          cand_off[i]  = off - 1;
+        }
+      }
+      prev_prev_corr = prev_corr;
+      prev_corr      = corr;
+    }
+
+    /* refine around the coarse peaks */
+    for( unsigned c = 0; c < cands; c++ ) {
+      unsigned center = cand_off[c] * SCALETEMPO_DECIMATION;
+      unsigned start  = center >= SCALETEMPO_DECIMATION - 1
+                      ? center - ( SCALETEMPO_DECIMATION - 1 ) : 0;
+      unsigned end    = __MIN( center + SCALETEMPO_DECIMATION, p->frames_search );
+
+      for( off = start; off < end; off++ ) {
+        float corr = p->dot( p->buf_pre_corr,
+                             search_start + off * p->samples_per_frame,
+                             samples_corr );
+        if( corr > best_corr ) {
+          best_corr = corr;
+          best_off  = off;
+        }
+      }
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -362,6 +563,23 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+
+        /* The coarse search needs a few decimated frames to correlate, and
+         * reads up to SCALETEMPO_DECIMATION - 1 frames past the search
+         * window, which the stride covers */
+        p->frames_pre_corr_coarse = ( frames_overlap - 1 ) / SCALETEMPO_DECIMATION;
+        p->frames_search_coarse   = ( p->frames_search + SCALETEMPO_DECIMATION - 1 )
+                                  / SCALETEMPO_DECIMATION;
+        if( p->fast_search && p->frames_pre_corr_coarse >= 2
+         && frames_stride >= SCALETEMPO_DECIMATION )
+        {
+            p->buf_pre_corr_coarse = vlc_alloc( p->frames_pre_corr_coarse, sizeof (float) );
+            p->buf_queue_coarse    = vlc_alloc( p->frames_search_coarse
+                                              + p->frames_pre_corr_coarse, sizeof (float) );
+            if( ! p->buf_pre_corr_coarse || ! p->buf_queue_coarse )
+                return VLC_ENOMEM;
+            p->best_overlap_offset = best_overlap_offset_coarse;
+        }
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -391,7 +609,7 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode, %s search",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
@@ -399,7 +617,8 @@ static int reinit_buffers( filter_t *p_filter )
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
-             "fl32");
+             "fl32",
+             p->best_overlap_offset == best_overlap_offset_coarse ? "coarse" : "full" );
 
     return VLC_SUCCESS;
 }
@@ -431,15 +650,35 @@ static int Open( vlc_object_t *p_this )
     p_sys->ms_stride       = var_InheritInteger( p_this, "scaletempo-stride" );
     p_sys->percent_overlap = var_InheritFloat( p_this, "scaletempo-overlap" );
     p_sys->ms_search       = var_InheritInteger( p_this, "scaletempo-search" );
-
-    msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search",
-             p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search );
+    p_sys->fast_search     = var_InheritBool( p_this, "scaletempo-fast-search" );
+
+    msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search%s",
+             p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search,
+             p_sys->fast_search ? " (fast)" : "" );
+
+    p_sys->dot = dot_c;
+#ifdef SCALETEMPO_X86
+    if( vlc_CPU_AVX() )
+        p_sys->dot = dot_avx;
+    else if( vlc_CPU_SSE() )
+        p_sys->dot = dot_sse;
+#endif
+#ifdef SCALETEMPO_NEON
+# ifdef __aarch64__
+    if( vlc_CPU_ARM64_NEON() )
+# else
+    if( vlc_CPU_ARM_NEON() )
+# endif
+        p_sys->dot = dot_neon;
+#endif
 
     p_sys->buf_queue      = NULL;
     p_sys->buf_overlap    = NULL;
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->buf_pre_corr_coarse = NULL;
+    p_sys->buf_queue_coarse    = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -536,6 +775,8 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->buf_pre_corr_coarse );
+    free( p_sys->buf_queue_coarse );
     free( p_sys );
 }
 
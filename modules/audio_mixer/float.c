@@ -35,6 +35,8 @@
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "../audio_filter/converter/pcm.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -60,9 +62,8 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
+    pcm_AmplifyFl32( (float *)p_buffer->p_buffer,
+                     p_buffer->i_buffer / sizeof(float), f_multiplier );
 
     (void) p_volume;
 }
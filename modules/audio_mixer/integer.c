@@ -30,6 +30,8 @@
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "../audio_filter/converter/pcm.h"
+
 static int Activate (vlc_object_t *);
 
 vlc_module_begin ()
@@ -63,22 +65,12 @@ static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
 
 static void FilterS16N (audio_volume_t *vol, block_t *block, float volume)
 {
-    int16_t *p = (int16_t *)block->p_buffer;
-
     int_fast16_t mult = lroundf (volume * 0x1.p8f);
     if (mult == (1 << 8))
         return;
 
-    for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
-    {
-        int_fast32_t s = (*p * (int_fast32_t)mult) >> 8;
-        if (s > INT16_MAX)
-            s = INT16_MAX;
-        else
-        if (s < INT16_MIN)
-            s = INT16_MIN;
-        *(p++) = s;
-    }
+    pcm_AmplifyS16 ((int16_t *)block->p_buffer,
+                    block->i_buffer / sizeof (int16_t), mult);
     (void) vol;
 }
 
@@ -0,0 +1,336 @@
+/*****************************************************************************
+ * metrics.c: Prometheus metrics exporter
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stddef.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_interface.h>
+#include <vlc_input.h>
+#include <vlc_httpd.h>
+#include <vlc_memstream.h>
+
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define URL_TEXT N_("Metrics URL")
+#define URL_LONGTEXT N_( \
+    "Path of the metrics on the HTTP server (see http-host and http-port).")
+
+#define USER_TEXT N_("Username")
+#define USER_LONGTEXT N_( \
+    "User name required to read the metrics (none by default).")
+
+#define PASS_TEXT N_("Password")
+#define PASS_LONGTEXT N_( \
+    "Password required to read the metrics (none by default).")
+
+vlc_module_begin ()
+    set_shortname( N_("Metrics") )
+    set_description( N_("Prometheus metrics exporter") )
+    set_category( CAT_INTERFACE )
+    set_subcategory( SUBCAT_INTERFACE_CONTROL )
+    add_string( "metrics-url", "/metrics", URL_TEXT, URL_LONGTEXT, true )
+    add_string( "metrics-user", NULL, USER_TEXT, USER_LONGTEXT, true )
+    add_password( "metrics-password", NULL, PASS_TEXT, PASS_LONGTEXT, true )
+    set_capability( "interface", 0 )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Metrics
+ *****************************************************************************/
+struct intf_sys_t
+{
+    httpd_host_t *host;
+    httpd_file_t *file;
+};
+
+#define INT(field) offsetof(input_stats_t, field), false
+#define FLT(field) offsetof(input_stats_t, field), true
+
+static const struct
+{
+    const char *name;
+    const char *type;
+    const char *help;
+    size_t offset;
+    bool is_float;
+    double scale;
+} metrics[] = {
+    { "vlc_input_read_bytes_total", "counter",
+      "Bytes read from the access", INT(i_read_bytes), 1. },
+    { "vlc_input_read_packets_total", "counter",
+      "Packets read from the access", INT(i_read_packets), 1. },
+    { "vlc_input_bitrate_bytes", "gauge",
+      "Access bitrate, in bytes per second", FLT(f_input_bitrate), 1e6 },
+    { "vlc_demux_read_bytes_total", "counter",
+      "Bytes sent by the demuxer", INT(i_demux_read_bytes), 1. },
+    { "vlc_demux_bitrate_bytes", "gauge",
+      "Demuxer bitrate, in bytes per second", FLT(f_demux_bitrate), 1e6 },
+    { "vlc_demux_corrupted_total", "counter",
+      "Corrupted blocks sent by the demuxer", INT(i_demux_corrupted), 1. },
+    { "vlc_demux_discontinuity_total", "counter",
+      "Discontinuities sent by the demuxer", INT(i_demux_discontinuity), 1. },
+    { "vlc_decoder_buffered_bytes", "gauge",
+      "Bytes waiting in the decoder queues", INT(i_decoder_buffered), 1. },
+    { "vlc_decoded_video_total", "counter",
+      "Decoded video frames", INT(i_decoded_video), 1. },
+    { "vlc_decoded_audio_total", "counter",
+      "Decoded audio blocks", INT(i_decoded_audio), 1. },
+    { "vlc_displayed_pictures_total", "counter",
+      "Displayed pictures", INT(i_displayed_pictures), 1. },
+    { "vlc_lost_pictures_total", "counter",
+      "Pictures dropped or displayed late", INT(i_lost_pictures), 1. },
+    { "vlc_played_audio_buffers_total", "counter",
+      "Played audio buffers", INT(i_played_abuffers), 1. },
+    { "vlc_lost_audio_buffers_total", "counter",
+      "Audio buffers dropped or played late", INT(i_lost_abuffers), 1. },
+    { "vlc_audio_drift_seconds", "gauge",
+      "Last measured audio output drift", INT(i_audio_drift), 1e-6 },
+    { "vlc_sout_sent_packets_total", "counter",
+      "Packets sent by the stream output", INT(i_sent_packets), 1. },
+    { "vlc_sout_sent_bytes_total", "counter",
+      "Bytes sent by the stream output", INT(i_sent_bytes), 1. },
+    { "vlc_sout_bitrate_bytes", "gauge",
+      "Stream output bitrate, in bytes per second", FLT(f_send_bitrate), 1e6 },
+    { "vlc_clock_drift_seconds", "gauge",
+      "Estimated drift of the input clock", INT(i_clock_drift), 1e-6 },
+    { "vlc_clock_resets_total", "counter",
+      "Reference points set by the input clock", INT(i_clock_resets), 1. },
+};
+
+#undef FLT
+#undef INT
+
+#define METRICS_COUNT ARRAY_SIZE(metrics)
+
+/* Clock jitter histogram, with the sum in the last slot */
+typedef int64_t jitter_t[INPUT_CLOCK_JITTER_BUCKETS + 1];
+
+static double GetMetric(const input_stats_t *stats, size_t i)
+{
+    const void *p = (const char *)stats + metrics[i].offset;
+
+    if (metrics[i].is_float)
+        return *(const float *)p * metrics[i].scale;
+    return *(const int64_t *)p * metrics[i].scale;
+}
+
+/* Writes a label value, escaped as required by the text exposition format */
+static void WriteLabel(struct vlc_memstream *ms, const char *str)
+{
+    for (; *str != '\0'; str++)
+        switch (*str)
+        {
+            case '\\': vlc_memstream_puts(ms, "\\\\"); break;
+            case '"':  vlc_memstream_puts(ms, "\\\""); break;
+            case '\n': vlc_memstream_puts(ms, "\\n"); break;
+            default:   vlc_memstream_putc(ms, *str); break;
+        }
+}
+
+static int Fill(httpd_file_sys_t *opaque, httpd_file_t *file,
+                uint8_t *request, uint8_t **data, int *len)
+{
+    intf_thread_t *intf = (intf_thread_t *)opaque;
+    struct vlc_memstream ms;
+    size_t count;
+
+    (void) file; (void) request;
+
+    input_thread_t **inputs = input_GetAll(intf, &count);
+    double (*values)[METRICS_COUNT] = vlc_alloc(count, sizeof (*values));
+    jitter_t *jitters = vlc_alloc(count, sizeof (*jitters));
+    char **uris = vlc_alloc(count, sizeof (*uris));
+
+    if (unlikely(count > 0
+              && (values == NULL || jitters == NULL || uris == NULL)))
+    {
+        for (size_t i = 0; i < count; i++)
+            vlc_object_release(inputs[i]);
+        count = 0;
+    }
+
+    /* Take a snapshot of the statistics, as computed by the input threads */
+    for (size_t i = 0; i < count; i++)
+    {
+        input_item_t *item = input_GetItem(inputs[i]);
+
+        vlc_mutex_lock(&item->lock);
+        uris[i] = item->psz_uri != NULL ? strdup(item->psz_uri) : NULL;
+        if (item->p_stats != NULL)
+        {
+            vlc_mutex_lock(&item->p_stats->lock);
+            for (size_t m = 0; m < METRICS_COUNT; m++)
+                values[i][m] = GetMetric(item->p_stats, m);
+            for (size_t b = 0; b < INPUT_CLOCK_JITTER_BUCKETS; b++)
+                jitters[i][b] = item->p_stats->i_clock_jitter[b];
+            jitters[i][INPUT_CLOCK_JITTER_BUCKETS] =
+                item->p_stats->i_clock_jitter_sum;
+            vlc_mutex_unlock(&item->p_stats->lock);
+        }
+        else
+        {
+            for (size_t m = 0; m < METRICS_COUNT; m++)
+                values[i][m] = 0.;
+            for (size_t b = 0; b <= INPUT_CLOCK_JITTER_BUCKETS; b++)
+                jitters[i][b] = 0;
+        }
+        vlc_mutex_unlock(&item->lock);
+
+        vlc_object_release(inputs[i]);
+    }
+    free(inputs);
+
+    vlc_memstream_open(&ms);
+    vlc_memstream_printf(&ms, "# HELP vlc_inputs Running inputs\n"
+                         "# TYPE vlc_inputs gauge\n"
+                         "vlc_inputs %zu\n", count);
+
+    for (size_t m = 0; m < METRICS_COUNT && count > 0; m++)
+    {
+        vlc_memstream_printf(&ms, "# HELP %s %s\n# TYPE %s %s\n",
+                             metrics[m].name, metrics[m].help,
+                             metrics[m].name, metrics[m].type);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            vlc_memstream_printf(&ms, "%s{input=\"%zu\",uri=\"",
+                                 metrics[m].name, i);
+            WriteLabel(&ms, uris[i] != NULL ? uris[i] : "");
+            vlc_memstream_printf(&ms, "\"} %.17g\n", values[i][m]);
+        }
+    }
+
+    if (count > 0)
+        vlc_memstream_puts(&ms, "# HELP vlc_clock_jitter_seconds Distance "
+                           "between the clock references and their expected "
+                           "dates\n# TYPE vlc_clock_jitter_seconds histogram\n");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int64_t total = 0;
+
+        for (size_t b = 0; b < INPUT_CLOCK_JITTER_BUCKETS; b++)
+        {
+            total += jitters[i][b];
+            vlc_memstream_printf(&ms, "vlc_clock_jitter_seconds_bucket{"
+                                 "input=\"%zu\",uri=\"", i);
+            WriteLabel(&ms, uris[i] != NULL ? uris[i] : "");
+            if (b < INPUT_CLOCK_JITTER_BUCKETS - 1)
+                vlc_memstream_printf(&ms, "\",le=\"%g\"} %"PRId64"\n",
+                                     (1 << b) * 1e-3, total);
+            else
+                vlc_memstream_printf(&ms, "\",le=\"+Inf\"} %"PRId64"\n",
+                                     total);
+        }
+
+        vlc_memstream_printf(&ms, "vlc_clock_jitter_seconds_sum{"
+                             "input=\"%zu\",uri=\"", i);
+        WriteLabel(&ms, uris[i] != NULL ? uris[i] : "");
+        vlc_memstream_printf(&ms, "\"} %.17g\n",
+                             jitters[i][INPUT_CLOCK_JITTER_BUCKETS] * 1e-6);
+        vlc_memstream_printf(&ms, "vlc_clock_jitter_seconds_count{"
+                             "input=\"%zu\",uri=\"", i);
+        WriteLabel(&ms, uris[i] != NULL ? uris[i] : "");
+        vlc_memstream_printf(&ms, "\"} %"PRId64"\n", total);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        free(uris[i]);
+    free(uris);
+    free(jitters);
+    free(values);
+
+    if (vlc_memstream_close(&ms))
+        return VLC_ENOMEM;
+
+    *data = (uint8_t *)ms.ptr;
+    *len = ms.length;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Open: initialize the interface
+ *****************************************************************************/
+static int Open(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = malloc(sizeof (*sys));
+
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    if (!var_InheritBool(intf, "stats"))
+        msg_Warn(intf, "statistics are disabled, metrics will stay null");
+
+    sys->host = vlc_http_HostNew(obj);
+    if (sys->host == NULL)
+    {
+        free(sys);
+        return VLC_EGENERIC;
+    }
+
+    char *url = var_InheritString(intf, "metrics-url");
+    char *user = var_InheritString(intf, "metrics-user");
+    char *pass = var_InheritString(intf, "metrics-password");
+
+    sys->file = httpd_FileNew(sys->host, url ? url : "/metrics",
+                              "text/plain; version=0.0.4", user, pass,
+                              Fill, (httpd_file_sys_t *)intf);
+    free(pass);
+    free(user);
+    free(url);
+
+    if (sys->file == NULL)
+    {
+        httpd_HostDelete(sys->host);
+        free(sys);
+        return VLC_EGENERIC;
+    }
+
+    intf->p_sys = sys;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close: destroy the interface
+ *****************************************************************************/
+static void Close(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = intf->p_sys;
+
+    httpd_FileDelete(sys->file);
+    httpd_HostDelete(sys->host);
+    free(sys);
+}
@@ -49,6 +49,7 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("AIFF demuxer" ) )
     set_capability( "demux", 10 )
+    add_signature( 0, "FORM" )
     set_callbacks( Open, Close )
     add_shortcut( "aiff" )
 vlc_module_end ()
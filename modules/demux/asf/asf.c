@@ -61,6 +61,7 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("ASF/WMV demuxer") )
     set_capability( "demux", 200 )
+    add_signature( 0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11\xa6\xd9" )
     set_callbacks( Open, Close )
     add_shortcut( "asf", "wmv" )
 vlc_module_end ()
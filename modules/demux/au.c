@@ -50,6 +50,7 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("AU demuxer") )
     set_capability( "demux", 10 )
+    add_signature( 0, ".snd" )
     set_callbacks( Open, Close )
     add_shortcut( "au" )
 vlc_module_end ()
@@ -52,6 +52,7 @@ set_category( CAT_INPUT )
 set_subcategory( SUBCAT_INPUT_DEMUX )
 set_description( N_( "CAF demuxer" ))
 set_capability( "demux", 140 )
+add_signature( 0, "caff" )
 set_callbacks( Open, Close )
 add_shortcut( "caf" )
 vlc_module_end ()
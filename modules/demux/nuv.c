@@ -49,6 +49,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("Nuv demuxer") )
     set_capability( "demux", 145 )
+    add_signature( 0, "MythTVVideo" )
+    add_signature( 0, "NuppelVideo" )
     set_callbacks( Open, Close )
     add_shortcut( "nuv" )
 vlc_module_end ()
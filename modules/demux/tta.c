@@ -47,6 +47,7 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 145 )
+    add_signature( 0, "TTA1" )
 
     set_callbacks( Open, Close )
     add_shortcut( "tta" )
@@ -69,6 +69,10 @@ static vlc_log_cb Open(vlc_object_t *obj, void **sysp)
     if (!var_InheritBool(obj, "syslog"))
         return NULL;
 
+    /* Same debug switch as the syslog logger */
+    if (!var_InheritBool(obj, "syslog-debug"))
+        var_SetInteger(obj, "verbosity", VLC_MSG_WARN);
+
     (void) sysp;
     return Log;
 }
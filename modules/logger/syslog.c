@@ -120,6 +120,8 @@ static vlc_log_cb Open(vlc_object_t *obj, void **sysp)
     int mask = LOG_MASK(LOG_ERR) | LOG_MASK(LOG_WARNING) | LOG_MASK(LOG_INFO);
     if (var_InheritBool(obj, "syslog-debug"))
         mask |= LOG_MASK(LOG_DEBUG);
+    else /* do not even format the debug messages */
+        var_SetInteger(obj, "verbosity", VLC_MSG_WARN);
 
     setlogmask(mask);
 
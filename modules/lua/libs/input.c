@@ -224,6 +224,21 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_INT( lost_abuffers )
 #undef STATS_INT
 #undef STATS_FLOAT
+
+        /* Startup stages reached, in microseconds */
+        static const char names[INPUT_STARTUP_COUNT][14] = {
+            "access", "stream_filter", "demux", "first_block", "decoder",
+            "first_frame", "first_picture", "first_audio",
+        };
+        lua_newtable( L );
+        for( unsigned i = 0; i < INPUT_STARTUP_COUNT; i++ )
+        {
+            if( p_stats->i_startup[i] < 0 )
+                continue;
+            lua_pushinteger( L, p_stats->i_startup[i] );
+            lua_setfield( L, -2, names[i] );
+        }
+        lua_setfield( L, -2, "startup" );
         vlc_mutex_unlock( &p_item->p_stats->lock );
     }
     vlc_mutex_unlock( &p_item->lock );
@@ -52,6 +52,10 @@
     "Create \"Fast Start\" files. " \
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
+#define FRAGDURATION_TEXT N_("Fragment duration")
+#define FRAGDURATION_LONGTEXT N_(\
+    "Maximum duration of the fragments, in milliseconds. " \
+    "Fragments are cut earlier on keyframes.")
 
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
@@ -80,6 +84,9 @@ add_submodule ()
     set_shortname("MP4 Frag")
     add_shortcut("mp4frag", "mp4stream")
     set_capability("sout mux", 0)
+    add_integer(SOUT_CFG_PREFIX "fragment-duration", 1500,
+                FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT, true)
+        change_integer_range(1, 60000)
     set_callbacks(OpenFrag, CloseFrag)
 
 vlc_module_end ()
@@ -91,6 +98,10 @@ static const char *const ppsz_sout_options[] = {
     "faststart", NULL
 };
 
+static const char *const ppsz_frag_options[] = {
+    "fragment-duration", NULL
+};
+
 static int Control(sout_mux_t *, int, va_list);
 static int AddStream(sout_mux_t *, sout_input_t *);
 static void DelStream(sout_mux_t *, sout_input_t *);
@@ -173,6 +184,7 @@ struct sout_mux_sys_t
     /* mp4frag */
     bool           b_fragmented;
     vlc_tick_t     i_written_duration;
+    vlc_tick_t     i_fragment_length;
     uint32_t       i_mfhd_sequence;
 };
 
@@ -803,8 +815,6 @@ static void box_send(sout_mux_t *p_mux,  bo_t *box)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  (CLOCK_FREQ * 3/2)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -1226,6 +1236,13 @@ static int OpenFrag(vlc_object_t *p_this)
     p_sys->i_start_dts = VLC_TICK_INVALID;
     p_sys->i_mfhd_sequence = 1;
 
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_frag_options, p_mux->p_cfg);
+    p_sys->i_fragment_length = CLOCK_FREQ / 1000 *
+        var_GetInteger(p_mux, SOUT_CFG_PREFIX "fragment-duration");
+    /* Segmenting outputs announce it as the fragments upper bound */
+    sout_AccessOutControl(p_mux->p_access, ACCESS_OUT_SET_FRAGMENT_DURATION,
+                          (vlc_tick_t) p_sys->i_fragment_length);
+
     return VLC_SUCCESS;
 }
 
@@ -1233,7 +1250,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    vlc_tick_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    vlc_tick_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
 
@@ -1446,7 +1463,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->mux.i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->mux.i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1495,7 +1512,7 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
@@ -246,6 +246,14 @@ static int transcode_audio_new( sout_stream_t *p_stream,
 
 void transcode_audio_close( sout_stream_id_sys_t *id )
 {
+    /* Stop the pipeline first, as its stages use the encoder */
+    if( id->p_filter_stage )
+        transcode_stage_Delete( id->p_filter_stage );
+    id->p_filter_stage = NULL;
+    if( id->p_encoder_stage )
+        transcode_stage_Delete( id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+
     /* Close decoder */
     if( id->p_decoder->p_module )
         module_unneed( id->p_decoder, id->p_decoder->p_module );
@@ -265,129 +273,187 @@ void transcode_audio_close( sout_stream_id_sys_t *id )
         aout_FiltersDelete( (vlc_object_t *)NULL, id->p_af_chain );
 }
 
-int transcode_audio_process( sout_stream_t *p_stream,
-                                    sout_stream_id_sys_t *id,
-                                    block_t *in, block_t **out )
+/* Filters a decoded audio block, and passes it on to the encoder. This runs
+ * on the filter stage thread if the transcoding is pipelined. */
+static int transcode_audio_filter_process( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id,
+                                           block_t *p_audio_buf, block_t **out )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    *out = NULL;
 
-    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
-    if( ret != VLCDEC_SUCCESS )
-        return VLC_EGENERIC;
-
-    block_t *p_audio_bufs = transcode_dequeue_all_audios( id );
-    if( p_audio_bufs == NULL )
-        goto end;
-
-    do
+    vlc_mutex_lock(&id->fifo.lock);
+    if( unlikely( !id->p_encoder->p_module ) )
     {
-        block_t *p_audio_buf = p_audio_bufs;
-        p_audio_bufs = p_audio_bufs->p_next;
-        p_audio_buf->p_next = NULL;
-
-        if( id->b_error )
+        if( transcode_audio_initialize_encoder( id, p_stream ) )
         {
-            block_Release( p_audio_buf );
-            continue;
+            msg_Err( p_stream, "cannot create audio chain" );
+            vlc_mutex_unlock(&id->fifo.lock);
+            goto error;
         }
+        if( unlikely( transcode_audio_initialize_filters( p_stream, id, p_sys ) != VLC_SUCCESS ) )
+        {
+            vlc_mutex_unlock(&id->fifo.lock);
+            goto error;
+        }
+        date_Init( &id->next_input_pts, id->audio_dec_out.i_rate, 1 );
+        date_Set( &id->next_input_pts, p_audio_buf->i_pts );
 
-        vlc_mutex_lock(&id->fifo.lock);
-        if( unlikely( !id->p_encoder->p_module ) )
+        /* Added with the first output when pipelined */
+        if( !id->id && !p_sys->b_pipeline )
         {
-            if( transcode_audio_initialize_encoder( id, p_stream ) )
-            {
-                msg_Err( p_stream, "cannot create audio chain" );
-                vlc_mutex_unlock(&id->fifo.lock);
-                goto error;
-            }
-            if( unlikely( transcode_audio_initialize_filters( p_stream, id, p_sys ) != VLC_SUCCESS ) )
+            id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+            if (!id->id)
             {
                 vlc_mutex_unlock(&id->fifo.lock);
                 goto error;
             }
-            date_Init( &id->next_input_pts, id->audio_dec_out.i_rate, 1 );
-            date_Set( &id->next_input_pts, p_audio_buf->i_pts );
-
-            if (!id->id)
-            {
-                id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
-                if (!id->id)
-                {
-                    vlc_mutex_unlock(&id->fifo.lock);
-                    goto error;
-                }
-            }
         }
+    }
 
-        /* Check if audio format has changed, and filters need reinit */
-        if( unlikely( ( id->audio_dec_out.i_rate != id->fmt_audio.i_rate ) ||
-                      ( id->audio_dec_out.i_physical_channels != id->fmt_audio.i_physical_channels ) ) )
+    /* Check if audio format has changed, and filters need reinit */
+    if( unlikely( ( id->audio_dec_out.i_rate != id->fmt_audio.i_rate ) ||
+                  ( id->audio_dec_out.i_physical_channels != id->fmt_audio.i_physical_channels ) ) )
+    {
+        msg_Info( p_stream, "Audio changed, trying to reinitialize filters" );
+        if( id->p_af_chain != NULL )
+            aout_FiltersDelete( (vlc_object_t *)NULL, id->p_af_chain );
+
+        if( transcode_audio_initialize_filters( p_stream, id, p_sys ) != VLC_SUCCESS )
         {
-            msg_Info( p_stream, "Audio changed, trying to reinitialize filters" );
-            if( id->p_af_chain != NULL )
-                aout_FiltersDelete( (vlc_object_t *)NULL, id->p_af_chain );
+            vlc_mutex_unlock(&id->fifo.lock);
+            goto error;
+        }
 
-            if( transcode_audio_initialize_filters( p_stream, id, p_sys ) != VLC_SUCCESS )
-            {
-                vlc_mutex_unlock(&id->fifo.lock);
-                goto error;
-            }
+        /* Set next_input_pts to run with new samplerate */
+        date_Init( &id->next_input_pts, id->fmt_audio.i_rate, 1 );
+        date_Set( &id->next_input_pts, p_audio_buf->i_pts );
+    }
+    vlc_mutex_unlock(&id->fifo.lock);
 
-            /* Set next_input_pts to run with new samplerate */
-            date_Init( &id->next_input_pts, id->fmt_audio.i_rate, 1 );
-            date_Set( &id->next_input_pts, p_audio_buf->i_pts );
-        }
-        vlc_mutex_unlock(&id->fifo.lock);
+    if( p_sys->b_master_sync )
+    {
+        vlc_tick_t i_pts = date_Get( &id->next_input_pts );
+        vlc_tick_t i_drift = 0;
 
-        if( p_sys->b_master_sync )
-        {
-            vlc_tick_t i_pts = date_Get( &id->next_input_pts );
-            vlc_tick_t i_drift = 0;
+        if( likely( p_audio_buf->i_pts != VLC_TICK_INVALID ) )
+            i_drift = p_audio_buf->i_pts - i_pts;
 
-            if( likely( p_audio_buf->i_pts != VLC_TICK_INVALID ) )
+        if ( unlikely(i_drift > MASTER_SYNC_MAX_DRIFT
+             || i_drift < -MASTER_SYNC_MAX_DRIFT) )
+        {
+            msg_Dbg( p_stream,
+                "audio drift is too high (%"PRId64"), resetting master sync",
+                i_drift );
+            date_Set( &id->next_input_pts, p_audio_buf->i_pts );
+            i_pts = date_Get( &id->next_input_pts );
+            if( likely(p_audio_buf->i_pts != VLC_TICK_INVALID ) )
                 i_drift = p_audio_buf->i_pts - i_pts;
-
-            if ( unlikely(i_drift > MASTER_SYNC_MAX_DRIFT
-                 || i_drift < -MASTER_SYNC_MAX_DRIFT) )
-            {
-                msg_Dbg( p_stream,
-                    "audio drift is too high (%"PRId64"), resetting master sync",
-                    i_drift );
-                date_Set( &id->next_input_pts, p_audio_buf->i_pts );
-                i_pts = date_Get( &id->next_input_pts );
-                if( likely(p_audio_buf->i_pts != VLC_TICK_INVALID ) )
-                    i_drift = p_audio_buf->i_pts - i_pts;
-            }
-            p_sys->i_master_drift = i_drift;
-            date_Increment( &id->next_input_pts, p_audio_buf->i_nb_samples );
         }
+        atomic_store( &p_sys->i_master_drift, i_drift );
+        date_Increment( &id->next_input_pts, p_audio_buf->i_nb_samples );
+    }
 
-        p_audio_buf->i_dts = p_audio_buf->i_pts;
+    p_audio_buf->i_dts = p_audio_buf->i_pts;
 
-        /* Run filter chain */
-        p_audio_buf = aout_FiltersPlay( id->p_af_chain, p_audio_buf,
-                                        INPUT_RATE_DEFAULT );
-        if( !p_audio_buf )
-            goto error;
+    /* Run filter chain */
+    p_audio_buf = aout_FiltersPlay( id->p_af_chain, p_audio_buf,
+                                    INPUT_RATE_DEFAULT );
+    if( !p_audio_buf )
+        goto error;
 
-        p_audio_buf->i_dts = p_audio_buf->i_pts;
+    p_audio_buf->i_dts = p_audio_buf->i_pts;
 
-        block_t *p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
+    if( id->p_encoder_stage )
+        return transcode_stage_Push( id->p_encoder_stage, p_audio_buf );
+
+    block_t *p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
+
+    block_ChainAppend( out, p_block );
+    block_Release( p_audio_buf );
+    return VLC_SUCCESS;
 
-        block_ChainAppend( out, p_block );
-        block_Release( p_audio_buf );
-        continue;
 error:
-        if( p_audio_buf )
+    if( p_audio_buf )
+        block_Release( p_audio_buf );
+    return VLC_EGENERIC;
+}
+
+static int transcode_audio_filter_stage( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         void *p_item, block_t **out )
+{
+    return transcode_audio_filter_process( p_stream, id, p_item, out );
+}
+
+static int transcode_audio_encoder_stage( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id,
+                                          void *p_item, block_t **out )
+{
+    block_t *p_audio_buf = p_item;
+    VLC_UNUSED( p_stream );
+
+    block_ChainAppend( out, id->p_encoder->pf_encode_audio( id->p_encoder,
+                                                            p_audio_buf ) );
+    block_Release( p_audio_buf );
+    return VLC_SUCCESS;
+}
+
+static void transcode_audio_release( void *p_item )
+{
+    block_Release( p_item );
+}
+
+int transcode_audio_process( sout_stream_t *p_stream,
+                                    sout_stream_id_sys_t *id,
+                                    block_t *in, block_t **out )
+{
+    *out = NULL;
+
+    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
+    if( ret != VLCDEC_SUCCESS )
+        return VLC_EGENERIC;
+
+    block_t *p_audio_bufs = transcode_dequeue_all_audios( id );
+    if( p_audio_bufs == NULL )
+        goto end;
+
+    do
+    {
+        block_t *p_audio_buf = p_audio_bufs;
+        p_audio_bufs = p_audio_bufs->p_next;
+        p_audio_buf->p_next = NULL;
+
+        if( id->b_error )
+        {
             block_Release( p_audio_buf );
-        id->b_error = true;
+            continue;
+        }
+
+        if( id->p_filter_stage )
+            ret = transcode_stage_Push( id->p_filter_stage, p_audio_buf );
+        else
+            ret = transcode_audio_filter_process( p_stream, id, p_audio_buf, out );
+        if( ret != VLC_SUCCESS )
+            id->b_error = true;
     } while( p_audio_bufs );
 
 end:
+    /* Pick up what the encoder stage has output. */
+    if( id->p_encoder_stage )
+        block_ChainAppend( out, transcode_stage_Dequeue( id->p_encoder_stage ) );
+
     /* Drain encoder */
     if( unlikely( !id->b_error && in == NULL ) )
     {
+        if( id->p_filter_stage )
+        {
+            if( transcode_stage_Drain( id->p_filter_stage ) != VLC_SUCCESS )
+                id->b_error = true;
+            transcode_stage_Drain( id->p_encoder_stage );
+            block_ChainAppend( out,
+                transcode_stage_Dequeue( id->p_encoder_stage ) );
+        }
+
         if( id->p_encoder->p_module )
         {
             block_t *p_block;
@@ -398,6 +464,20 @@ end:
         }
     }
 
+    /* The pipelined encoder was opened on the filter stage thread. Its
+     * stream is added here, as the next streams are not thread-safe. */
+    if( *out && !id->id )
+    {
+        id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+        if( !id->id )
+        {
+            msg_Err( p_stream, "cannot add this stream" );
+            block_ChainRelease( *out );
+            *out = NULL;
+            id->b_error = true;
+        }
+    }
+
     return id->b_error ? VLC_EGENERIC : VLC_SUCCESS;
 }
 
@@ -456,5 +536,26 @@ bool transcode_audio_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
             aout_FiltersDelete( (vlc_object_t *)NULL, id->p_af_chain );
         id->p_af_chain = NULL;
     }
+
+    if( p_sys->b_pipeline )
+    {
+        id->p_filter_stage =
+            transcode_stage_New( p_stream, id, "audio filter",
+                                 VLC_THREAD_PRIORITY_AUDIO,
+                                 transcode_audio_filter_stage,
+                                 transcode_audio_release );
+        if( id->p_filter_stage )
+            id->p_encoder_stage =
+                transcode_stage_New( p_stream, id, "audio encoder",
+                                     VLC_THREAD_PRIORITY_AUDIO,
+                                     transcode_audio_encoder_stage,
+                                     transcode_audio_release );
+        if( !id->p_encoder_stage )
+        {
+            msg_Err( p_stream, "cannot create audio pipeline" );
+            transcode_audio_close( id );
+            return false;
+        }
+    }
     return true;
 }
@@ -0,0 +1,269 @@
+/*****************************************************************************
+ * pipeline.c: transcoding stream output module (pipeline stages)
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#include "transcode.h"
+
+/* A stage is a thread taking its items (pictures or audio blocks) from a
+ * bounded queue. Pushing to a full queue blocks, so that a slow stage holds
+ * the previous ones back instead of buffering without limit. Each stage
+ * keeps its statistics, and prints them every STAGE_REPORT_PERIOD. */
+#define STAGE_REPORT_PERIOD (5 * CLOCK_FREQ)
+
+typedef struct
+{
+    void        *p_item;
+    vlc_tick_t  i_date;     /**< date when the item was queued */
+} stage_entry_t;
+
+struct transcode_stage_t
+{
+    sout_stream_t        *p_stream;
+    sout_stream_id_sys_t *id;
+    const char           *psz_name;
+    transcode_stage_process_cb pf_process;
+    void               (*pf_release)( void * );
+
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;   /**< an item was queued, or abort */
+    vlc_cond_t      room;   /**< an item was dequeued, or the stage is idle */
+    bool            b_abort;
+    bool            b_busy;
+    bool            b_error;
+
+    stage_entry_t   *p_queue;
+    unsigned int    i_size;
+    unsigned int    i_first;
+    unsigned int    i_count;
+
+    /* Output of the last stage, picked up by the stream output thread */
+    block_t         *p_out;
+
+    /* Statistics since the last report */
+    unsigned int    i_items;
+    vlc_tick_t      i_latency;
+    vlc_tick_t      i_latency_max;
+    vlc_tick_t      i_processing;
+    uint64_t        i_occupancy;
+    unsigned int    i_occupancy_max;
+    vlc_tick_t      i_report;
+};
+
+static void StageReport( transcode_stage_t *p_stage, vlc_tick_t now )
+{
+    const vlc_tick_t i_period = now - p_stage->i_report;
+
+    if( p_stage->i_items > 0 )
+        msg_Dbg( p_stage->p_stream, "%s stage: %.2f items/s, "
+                 "latency %.2f ms (max %.2f ms), busy %.0f%%, "
+                 "queue %.2f/%u (max %u)", p_stage->psz_name,
+                 (double)p_stage->i_items * CLOCK_FREQ / i_period,
+                 (double)p_stage->i_latency / p_stage->i_items / 1000.,
+                 (double)p_stage->i_latency_max / 1000.,
+                 100. * p_stage->i_processing / i_period,
+                 (double)p_stage->i_occupancy / p_stage->i_items,
+                 p_stage->i_size, p_stage->i_occupancy_max );
+
+    p_stage->i_items = 0;
+    p_stage->i_latency = p_stage->i_latency_max = 0;
+    p_stage->i_processing = 0;
+    p_stage->i_occupancy = 0;
+    p_stage->i_occupancy_max = 0;
+    p_stage->i_report = now;
+}
+
+static void *StageThread( void *obj )
+{
+    transcode_stage_t *p_stage = obj;
+    int canc = vlc_savecancel ();
+
+    vlc_mutex_lock( &p_stage->lock );
+
+    for( ;; )
+    {
+        while( !p_stage->b_abort && p_stage->i_count == 0 )
+            vlc_cond_wait( &p_stage->wait, &p_stage->lock );
+        if( p_stage->b_abort )
+            break;
+
+        stage_entry_t entry = p_stage->p_queue[p_stage->i_first];
+        p_stage->i_first = ( p_stage->i_first + 1 ) % p_stage->i_size;
+        p_stage->i_count--;
+        p_stage->b_busy = true;
+        vlc_cond_signal( &p_stage->room );
+        const bool b_error = p_stage->b_error;
+
+        /* release lock while processing */
+        vlc_mutex_unlock( &p_stage->lock );
+
+        const vlc_tick_t i_start = mdate();
+        block_t *p_out = NULL;
+        int i_ret = VLC_SUCCESS;
+
+        if( !b_error )
+            i_ret = p_stage->pf_process( p_stage->p_stream, p_stage->id,
+                                         entry.p_item, &p_out );
+        else
+            p_stage->pf_release( entry.p_item );
+        const vlc_tick_t now = mdate();
+
+        vlc_mutex_lock( &p_stage->lock );
+
+        block_ChainAppend( &p_stage->p_out, p_out );
+        if( i_ret != VLC_SUCCESS )
+            p_stage->b_error = true;
+        p_stage->b_busy = false;
+        vlc_cond_broadcast( &p_stage->room );
+
+        p_stage->i_items++;
+        p_stage->i_latency += now - entry.i_date;
+        p_stage->i_latency_max = __MAX( p_stage->i_latency_max,
+                                        now - entry.i_date );
+        p_stage->i_processing += now - i_start;
+        if( now - p_stage->i_report >= STAGE_REPORT_PERIOD )
+            StageReport( p_stage, now );
+    }
+
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+transcode_stage_t *transcode_stage_New( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id,
+                                        const char *psz_name, int i_priority,
+                                        transcode_stage_process_cb pf_process,
+                                        void (*pf_release)( void * ) )
+{
+    transcode_stage_t *p_stage = calloc( 1, sizeof( *p_stage ) );
+    if( !p_stage )
+        return NULL;
+
+    p_stage->p_stream = p_stream;
+    p_stage->id = id;
+    p_stage->psz_name = psz_name;
+    p_stage->pf_process = pf_process;
+    p_stage->pf_release = pf_release;
+
+    p_stage->i_size = __MAX( p_stream->p_sys->pool_size, 1 );
+    p_stage->p_queue = vlc_alloc( p_stage->i_size, sizeof( *p_stage->p_queue ) );
+    if( !p_stage->p_queue )
+    {
+        free( p_stage );
+        return NULL;
+    }
+
+    vlc_mutex_init( &p_stage->lock );
+    vlc_cond_init( &p_stage->wait );
+    vlc_cond_init( &p_stage->room );
+    p_stage->i_report = mdate();
+
+    if( p_stream->p_sys->b_high_priority )
+        i_priority = VLC_THREAD_PRIORITY_OUTPUT;
+    if( vlc_clone( &p_stage->thread, StageThread, p_stage, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn %s thread", psz_name );
+        vlc_cond_destroy( &p_stage->room );
+        vlc_cond_destroy( &p_stage->wait );
+        vlc_mutex_destroy( &p_stage->lock );
+        free( p_stage->p_queue );
+        free( p_stage );
+        return NULL;
+    }
+
+    return p_stage;
+}
+
+void transcode_stage_Delete( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    p_stage->b_abort = true;
+    vlc_cond_signal( &p_stage->wait );
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_join( p_stage->thread, NULL );
+
+    /* Release what was not processed */
+    for( ; p_stage->i_count > 0; p_stage->i_count-- )
+    {
+        p_stage->pf_release( p_stage->p_queue[p_stage->i_first].p_item );
+        p_stage->i_first = ( p_stage->i_first + 1 ) % p_stage->i_size;
+    }
+    block_ChainRelease( p_stage->p_out );
+
+    vlc_cond_destroy( &p_stage->room );
+    vlc_cond_destroy( &p_stage->wait );
+    vlc_mutex_destroy( &p_stage->lock );
+    free( p_stage->p_queue );
+    free( p_stage );
+}
+
+int transcode_stage_Push( transcode_stage_t *p_stage, void *p_item )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    while( p_stage->i_count == p_stage->i_size && !p_stage->b_error )
+        vlc_cond_wait( &p_stage->room, &p_stage->lock );
+
+    if( p_stage->b_error )
+    {
+        vlc_mutex_unlock( &p_stage->lock );
+        p_stage->pf_release( p_item );
+        return VLC_EGENERIC;
+    }
+
+    stage_entry_t *p_entry = &p_stage->p_queue[
+        ( p_stage->i_first + p_stage->i_count ) % p_stage->i_size];
+    p_entry->p_item = p_item;
+    p_entry->i_date = mdate();
+    p_stage->i_count++;
+    p_stage->i_occupancy += p_stage->i_count;
+    p_stage->i_occupancy_max = __MAX( p_stage->i_occupancy_max,
+                                      p_stage->i_count );
+    vlc_cond_signal( &p_stage->wait );
+    vlc_mutex_unlock( &p_stage->lock );
+    return VLC_SUCCESS;
+}
+
+int transcode_stage_Drain( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    while( p_stage->i_count > 0 || p_stage->b_busy )
+        vlc_cond_wait( &p_stage->room, &p_stage->lock );
+    const bool b_error = p_stage->b_error;
+    vlc_mutex_unlock( &p_stage->lock );
+
+    return b_error ? VLC_EGENERIC : VLC_SUCCESS;
+}
+
+block_t *transcode_stage_Dequeue( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    block_t *p_out = p_stage->p_out;
+    p_stage->p_out = NULL;
+    vlc_mutex_unlock( &p_stage->lock );
+
+    return p_out;
+}
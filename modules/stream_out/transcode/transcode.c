@@ -76,6 +76,17 @@
 #define MAXHEIGHT_TEXT N_("Maximum video height")
 #define MAXHEIGHT_LONGTEXT N_( \
     "Maximum output video height." )
+#define RENDITIONS_TEXT N_("Video renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Colon-separated list of video renditions, as WIDTHxHEIGHT or " \
+    "WIDTHxHEIGHT@BITRATE (either dimension can be omitted). The video is " \
+    "decoded and filtered once, then each rendition is scaled and encoded " \
+    "in its own thread, to its own stream. The stream of the N-th " \
+    "rendition gets the ES id of the source plus N*1000." )
+#define PIPELINE_TEXT N_("Pipeline the transcoding")
+#define PIPELINE_LONGTEXT N_( \
+    "Filter and encode the audio and video in their own threads, separate " \
+    "from the decoder, with queues of pool-size entries between them." )
 #define VFILTER_TEXT N_("Video filter")
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
@@ -176,6 +187,8 @@ vlc_module_begin ()
                  MAXWIDTH_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "maxheight", 0, MAXHEIGHT_TEXT,
                  MAXHEIGHT_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
 
@@ -215,6 +228,8 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "pipeline", false, PIPELINE_TEXT,
+              PIPELINE_LONGTEXT, true )
 
 vlc_module_end ()
 
@@ -224,7 +239,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "renditions", "pipeline", NULL
 };
 
 /*****************************************************************************
@@ -234,6 +249,59 @@ static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/*****************************************************************************
+ * ParseRenditions: parse the list of video renditions
+ *****************************************************************************/
+static int ParseRenditions( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                            const char *psz_list )
+{
+    char *psz_dup = strdup( psz_list );
+    char *psz, *psz_state;
+
+    if( !psz_dup )
+        return VLC_ENOMEM;
+
+    for( psz = strtok_r( psz_dup, ":", &psz_state ); psz != NULL;
+         psz = strtok_r( NULL, ":", &psz_state ) )
+    {
+        transcode_rendition_cfg_t cfg = { .i_bitrate = p_sys->i_vbitrate };
+        char *psz_end;
+
+        cfg.i_width = strtoul( psz, &psz_end, 10 );
+        if( *psz_end != 'x' )
+            goto error;
+        cfg.i_height = strtoul( psz_end + 1, &psz_end, 10 );
+        if( *psz_end == '@' )
+        {
+            cfg.i_bitrate = strtol( psz_end + 1, &psz_end, 10 );
+            if( cfg.i_bitrate < 16000 ) cfg.i_bitrate *= 1000;
+        }
+        if( *psz_end != '\0' )
+            goto error;
+
+        transcode_rendition_cfg_t *p_cfg =
+            realloc( p_sys->p_renditions,
+                     ( p_sys->i_renditions + 1 ) * sizeof( *p_cfg ) );
+        if( !p_cfg )
+        {
+            free( psz_dup );
+            return VLC_ENOMEM;
+        }
+        p_cfg[p_sys->i_renditions++] = cfg;
+        p_sys->p_renditions = p_cfg;
+
+        msg_Dbg( p_stream, "video rendition %ux%u %dkb/s",
+                 cfg.i_width, cfg.i_height, cfg.i_bitrate / 1000 );
+    }
+    free( psz_dup );
+    return VLC_SUCCESS;
+
+error:
+    msg_Err( p_stream, "invalid video rendition `%s'", psz );
+    free( psz_dup );
+    return VLC_EGENERIC;
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -249,7 +317,7 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
     p_sys = calloc( 1, sizeof( *p_sys ) );
-    p_sys->i_master_drift = 0;
+    atomic_init( &p_sys->i_master_drift, 0 );
 
     config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
                    p_stream->p_cfg );
@@ -365,9 +433,23 @@ static int Open( vlc_object_t *p_this )
                               &p_sys->p_deinterlace_cfg, psz_string ) );
     free( psz_string );
 
+    p_sys->p_renditions = NULL;
+    p_sys->i_renditions = 0;
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "renditions" );
+    if( psz_string && *psz_string &&
+        ParseRenditions( p_stream, p_sys, psz_string ) != VLC_SUCCESS )
+    {
+        free( psz_string );
+        p_stream->p_sys = p_sys;
+        Close( p_this );
+        return VLC_EGENERIC;
+    }
+    free( psz_string );
+
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
+    p_sys->b_pipeline = var_GetBool( p_stream, SOUT_CFG_PREFIX "pipeline" );
 
     if( p_sys->i_vcodec )
     {
@@ -442,6 +524,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_renditions );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
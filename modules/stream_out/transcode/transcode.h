@@ -10,10 +10,22 @@
 #include <vlc_codec.h>
 
 #include <vlc_picture_fifo.h>
+#include <vlc_atomic.h>
 
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+/* Size and bitrate of a video rendition (0 to use the common setting) */
+typedef struct
+{
+    unsigned int    i_width;
+    unsigned int    i_height;
+    int             i_bitrate;
+} transcode_rendition_cfg_t;
+
+typedef struct transcode_rendition_t transcode_rendition_t;
+typedef struct transcode_stage_t transcode_stage_t;
+
 struct sout_stream_sys_t
 {
     sout_stream_id_sys_t *id_video;
@@ -54,6 +66,12 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    transcode_rendition_cfg_t *p_renditions;
+    unsigned int    i_renditions;
+
+    /* Decode, filter and encode in separate threads */
+    bool            b_pipeline;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -65,7 +83,7 @@ struct sout_stream_sys_t
     /* Sync */
     bool            b_master_sync;
     /* i_master drift is how much audio buffer is ahead of calculated pts */
-    vlc_tick_t      i_master_drift;
+    atomic_int_least64_t i_master_drift;
 };
 
 struct aout_filters;
@@ -109,6 +127,10 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
              video_format_t  video_dec_out; /* only rw from pf_vout_format_update() */
+             /* Copied before decoding, so that the filter stage does not
+              * access the decoder, and the decoder not the encoder */
+             vlc_fourcc_t    i_encoder_chroma;
+             video_orientation_t orientation;
          };
          struct
          {
@@ -122,12 +144,38 @@ struct sout_stream_id_sys_t
     /* Encoder */
     encoder_t       *p_encoder;
 
+    /* Video renditions, encoded from the same filtered pictures */
+    transcode_rendition_t **pp_renditions;
+    unsigned int    i_renditions;
+    bool            b_renditions_open;
+    vlc_tick_t      i_renditions_report;
+
+    /* Pipeline stages, after the decoder */
+    transcode_stage_t *p_filter_stage;
+    transcode_stage_t *p_encoder_stage;
+
     /* Sync */
     date_t          next_input_pts; /**< Incoming calculated PTS */
     date_t          next_output_pts; /**< output calculated PTS */
 
 };
 
+/* PIPELINE */
+
+/* Processes one item of a stage, and returns the blocks to output if any */
+typedef int (*transcode_stage_process_cb)( sout_stream_t *,
+                                           sout_stream_id_sys_t *,
+                                           void *, block_t ** );
+
+transcode_stage_t *transcode_stage_New( sout_stream_t *, sout_stream_id_sys_t *,
+                                        const char *, int,
+                                        transcode_stage_process_cb,
+                                        void (*)( void * ) );
+void     transcode_stage_Delete ( transcode_stage_t * );
+int      transcode_stage_Push   ( transcode_stage_t *, void * );
+int      transcode_stage_Drain  ( transcode_stage_t * );
+block_t *transcode_stage_Dequeue( transcode_stage_t * );
+
 /* SPU */
 
 void transcode_spu_close  ( sout_stream_t *, sout_stream_id_sys_t * );
@@ -64,7 +64,7 @@ static int video_update_format_decoder( decoder_t *p_dec )
     /* will need proper chroma for get_buffer */
     p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
 
-    if( id->p_encoder->fmt_in.i_codec == p_dec->fmt_out.i_codec ||
+    if( id->i_encoder_chroma == p_dec->fmt_out.i_codec ||
         video_format_IsSimilar( &id->video_dec_out,
                                 &p_dec->fmt_out.video ) )
         return 0;
@@ -72,12 +72,20 @@ static int video_update_format_decoder( decoder_t *p_dec )
     id->video_dec_out.p_palette = NULL;
 
     msg_Dbg( stream, "Checking if filter chain %4.4s -> %4.4s is possible",
-                 (char *)&p_dec->fmt_out.i_codec, (char*)&id->p_encoder->fmt_in.i_codec );
+                 (char *)&p_dec->fmt_out.i_codec, (char*)&id->i_encoder_chroma );
     test_chain = filter_chain_NewVideo( stream, false, &filter_owner );
     filter_chain_Reset( test_chain, &p_dec->fmt_out, &p_dec->fmt_out );
 
+    /* The encoder format is owned by the filter stage, which may be
+     * running on its own thread */
+    es_format_t fmt_enc;
+    es_format_Init( &fmt_enc, VIDEO_ES, id->i_encoder_chroma );
+    fmt_enc.video = p_dec->fmt_out.video;
+    fmt_enc.video.i_chroma = id->i_encoder_chroma;
+    fmt_enc.video.p_palette = NULL;
+
     int chain_works = filter_chain_AppendConverter( test_chain, &p_dec->fmt_out,
-                                  &id->p_encoder->fmt_in );
+                                                    &fmt_enc );
     filter_chain_Delete( test_chain );
     msg_Dbg( stream, "Filter chain testing done, input chroma %4.4s seems to be %s for transcode",
                      (char *)&p_dec->fmt_out.video.i_chroma,
@@ -101,6 +109,12 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
+/* Whether the pictures are encoded by the shared encoder thread */
+static bool transcode_video_threaded( const sout_stream_sys_t *p_sys )
+{
+    return p_sys->i_threads >= 1 && !p_sys->i_renditions && !p_sys->b_pipeline;
+}
+
 static void* EncoderThread( void *obj )
 {
     sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
@@ -155,6 +169,255 @@ static void* EncoderThread( void *obj )
     return NULL;
 }
 
+/*
+ * Video renditions
+ *
+ * The pictures are decoded and filtered once, then pushed to every
+ * rendition. Each one scales and converts them to its own size, and encodes
+ * them to its own stream, on its own thread.
+ */
+#define RENDITIONS_REPORT_PERIOD (5 * CLOCK_FREQ)
+/* ES id distance between the renditions of one stream */
+#define RENDITION_ES_ID_STEP 1000
+
+struct transcode_rendition_t
+{
+    sout_stream_t   *p_stream;
+    encoder_t       *p_encoder;
+    sout_stream_id_sys_t *id;
+
+    /* Scaling and chroma conversion to the encoder input format */
+    filter_chain_t  *p_conv_chain;
+    video_format_t  fmt_src;
+    bool            b_error;
+
+    vlc_thread_t    thread;
+    bool            b_thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      cond;
+    vlc_sem_t       picture_pool_has_room;
+    picture_fifo_t  *pp_pics;
+    unsigned int    i_pics;
+    unsigned int    i_pics_max;
+    bool            b_abort;
+    block_t         *p_buffers;
+
+    /* Statistics */
+    unsigned int    i_encoded;
+    unsigned int    i_reported;
+};
+
+static picture_t *RenditionConvert( transcode_rendition_t *r, picture_t *p_pic )
+{
+    encoder_t *p_enc = r->p_encoder;
+
+    if( r->p_conv_chain == NULL ||
+        !video_format_IsSimilar( &r->fmt_src, &p_pic->format ) )
+    {
+        filter_owner_t owner = {
+            .sys = r->p_stream->p_sys,
+            .video = {
+                .buffer_new = transcode_video_filter_buffer_new,
+            },
+        };
+        es_format_t fmt_src;
+
+        if( r->p_conv_chain )
+            filter_chain_Delete( r->p_conv_chain );
+        r->p_conv_chain = filter_chain_NewVideo( r->p_stream, false, &owner );
+        if( !r->p_conv_chain )
+            goto error;
+
+        es_format_Init( &fmt_src, VIDEO_ES, p_pic->format.i_chroma );
+        fmt_src.video = p_pic->format;
+        filter_chain_Reset( r->p_conv_chain, &fmt_src, &p_enc->fmt_in );
+
+        if( ( fmt_src.video.i_chroma != p_enc->fmt_in.video.i_chroma ) ||
+            ( fmt_src.video.i_width != p_enc->fmt_in.video.i_width ) ||
+            ( fmt_src.video.i_height != p_enc->fmt_in.video.i_height ) )
+        {
+            if( filter_chain_AppendConverter( r->p_conv_chain, &fmt_src,
+                                              &p_enc->fmt_in ) )
+            {
+                msg_Err( r->p_stream, "cannot convert %4.4s %ux%u to %4.4s %ux%u",
+                         (const char *)&fmt_src.video.i_chroma,
+                         fmt_src.video.i_width, fmt_src.video.i_height,
+                         (const char *)&p_enc->fmt_in.video.i_chroma,
+                         p_enc->fmt_in.video.i_width,
+                         p_enc->fmt_in.video.i_height );
+                goto error;
+            }
+        }
+        r->fmt_src = p_pic->format;
+        r->fmt_src.p_palette = NULL;
+    }
+
+    return filter_chain_VideoFilter( r->p_conv_chain, p_pic );
+
+error:
+    r->b_error = true;
+    picture_Release( p_pic );
+    return NULL;
+}
+
+static void* RenditionThread( void *obj )
+{
+    transcode_rendition_t *r = obj;
+    encoder_t *p_enc = r->p_encoder;
+    int canc = vlc_savecancel ();
+    block_t *p_block;
+
+    vlc_mutex_lock( &r->lock );
+
+    for( ;; )
+    {
+        picture_t *p_pic = picture_fifo_Pop( r->pp_pics );
+
+        /* Encode what we have in the fifo on closing */
+        if( p_pic == NULL )
+        {
+            if( r->b_abort )
+                break;
+            vlc_cond_wait( &r->cond, &r->lock );
+            continue;
+        }
+        r->i_pics--;
+        vlc_sem_post( &r->picture_pool_has_room );
+
+        /* release lock while scaling and encoding */
+        vlc_mutex_unlock( &r->lock );
+        p_block = NULL;
+        if( !r->b_error )
+            p_pic = RenditionConvert( r, p_pic );
+        else
+        {
+            picture_Release( p_pic );
+            p_pic = NULL;
+        }
+        if( p_pic )
+        {
+            p_block = p_enc->pf_encode_video( p_enc, p_pic );
+            picture_Release( p_pic );
+        }
+        vlc_mutex_lock( &r->lock );
+
+        if( p_pic )
+            r->i_encoded++;
+        block_ChainAppend( &r->p_buffers, p_block );
+    }
+
+    vlc_mutex_unlock( &r->lock );
+
+    /* Now flush encoder */
+    do {
+        p_block = p_enc->pf_encode_video( p_enc, NULL );
+        vlc_mutex_lock( &r->lock );
+        block_ChainAppend( &r->p_buffers, p_block );
+        vlc_mutex_unlock( &r->lock );
+    } while( p_block );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+static void transcode_rendition_push( transcode_rendition_t *r,
+                                      picture_t *p_pic )
+{
+    vlc_sem_wait( &r->picture_pool_has_room );
+    vlc_mutex_lock( &r->lock );
+    picture_fifo_Push( r->pp_pics, p_pic );
+    if( ++r->i_pics > r->i_pics_max )
+        r->i_pics_max = r->i_pics;
+    vlc_cond_signal( &r->cond );
+    vlc_mutex_unlock( &r->lock );
+}
+
+static void transcode_rendition_join( transcode_rendition_t *r )
+{
+    vlc_mutex_lock( &r->lock );
+    r->b_abort = true;
+    vlc_cond_signal( &r->cond );
+    vlc_mutex_unlock( &r->lock );
+
+    vlc_join( r->thread, NULL );
+    r->b_thread = false;
+}
+
+static transcode_rendition_t *transcode_rendition_new( sout_stream_t *p_stream,
+                                                       sout_stream_id_sys_t *id,
+                                                       unsigned int i_rendition )
+{
+    const transcode_rendition_cfg_t *p_cfg = &p_stream->p_sys->p_renditions[i_rendition];
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    transcode_rendition_t *r = calloc( 1, sizeof( *r ) );
+
+    if( !r )
+        return NULL;
+
+    r->p_stream = p_stream;
+    r->pp_pics = picture_fifo_New();
+    if( !r->pp_pics )
+    {
+        free( r );
+        return NULL;
+    }
+
+    r->p_encoder = sout_EncoderCreate( p_stream );
+    if( !r->p_encoder )
+    {
+        picture_fifo_Delete( r->pp_pics );
+        free( r );
+        return NULL;
+    }
+    r->p_encoder->p_module = NULL;
+
+    /* Same codec and settings as the probed encoder, with the size and
+     * bitrate of the rendition */
+    es_format_Copy( &r->p_encoder->fmt_in, &id->p_encoder->fmt_in );
+    es_format_Copy( &r->p_encoder->fmt_out, &id->p_encoder->fmt_out );
+    r->p_encoder->fmt_out.video.i_visible_width  = p_cfg->i_width & ~1;
+    r->p_encoder->fmt_out.video.i_visible_height = p_cfg->i_height & ~1;
+    r->p_encoder->fmt_out.i_bitrate = p_cfg->i_bitrate;
+    /* Each rendition is a separate elementary stream downstream */
+    r->p_encoder->fmt_out.i_id = id->p_encoder->fmt_out.i_id +
+                                 ( i_rendition + 1 ) * RENDITION_ES_ID_STEP;
+    r->p_encoder->i_threads = p_sys->i_threads;
+    r->p_encoder->p_cfg = p_sys->p_video_cfg;
+
+    vlc_mutex_init( &r->lock );
+    vlc_cond_init( &r->cond );
+    vlc_sem_init( &r->picture_pool_has_room, __MAX( p_sys->pool_size, 1 ) );
+
+    return r;
+}
+
+static void transcode_rendition_delete( sout_stream_t *p_stream,
+                                        transcode_rendition_t *r )
+{
+    if( r->b_thread )
+        transcode_rendition_join( r );
+
+    picture_fifo_Delete( r->pp_pics );
+    block_ChainRelease( r->p_buffers );
+
+    if( r->id )
+        sout_StreamIdDel( p_stream->p_next, r->id );
+    if( r->p_encoder->p_module )
+        module_unneed( r->p_encoder, r->p_encoder->p_module );
+    if( r->p_conv_chain )
+        filter_chain_Delete( r->p_conv_chain );
+
+    vlc_sem_destroy( &r->picture_pool_has_room );
+    vlc_cond_destroy( &r->cond );
+    vlc_mutex_destroy( &r->lock );
+
+    es_format_Clean( &r->p_encoder->fmt_in );
+    es_format_Clean( &r->p_encoder->fmt_out );
+    vlc_object_release( r->p_encoder );
+    free( r );
+}
+
 static int decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
 {
     sout_stream_id_sys_t *id = p_dec->p_queue_ctx;
@@ -265,7 +528,12 @@ static int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *i
     id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
+    /* Read by the decoder callbacks, which cannot use the encoder format */
+    id->i_encoder_chroma = id->p_encoder->fmt_in.i_codec;
+    id->orientation = id->p_decoder->fmt_in.video.orientation;
+
+    /* Each rendition and pipeline has its own encoder thread */
+    if( !transcode_video_threaded( p_sys ) )
         return VLC_SUCCESS;
 
     int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
@@ -299,7 +567,8 @@ static int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *i
 }
 
 static void transcode_video_filter_init( sout_stream_t *p_stream,
-                                         sout_stream_id_sys_t *id )
+                                         sout_stream_id_sys_t *id,
+                                         picture_t *p_pic )
 {
     filter_owner_t owner = {
         .sys = p_stream->p_sys,
@@ -307,17 +576,22 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
             .buffer_new = transcode_video_filter_buffer_new,
         },
     };
-    const es_format_t *p_fmt_out = &id->p_decoder->fmt_out;
+    /* The decoder format belongs to the decoder thread, the picture
+     * carries a copy of it */
+    es_format_t fmt_dec;
+    es_format_Init( &fmt_dec, VIDEO_ES, p_pic->format.i_chroma );
+    fmt_dec.video = p_pic->format;
+    const es_format_t *p_fmt_out = &fmt_dec;
 
     id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
     id->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
     filter_chain_Reset( id->p_f_chain, p_fmt_out, p_fmt_out );
 
     /* Check that we have visible_width/height*/
-    if( !id->p_decoder->fmt_out.video.i_visible_height )
-        id->p_decoder->fmt_out.video.i_visible_height = id->p_decoder->fmt_out.video.i_height;
-    if( !id->p_decoder->fmt_out.video.i_visible_width )
-        id->p_decoder->fmt_out.video.i_visible_width = id->p_decoder->fmt_out.video.i_width;
+    if( !fmt_dec.video.i_visible_height )
+        fmt_dec.video.i_visible_height = fmt_dec.video.i_height;
+    if( !fmt_dec.video.i_visible_width )
+        fmt_dec.video.i_visible_width = fmt_dec.video.i_width;
 
     /* Deinterlace */
     if( p_stream->p_sys->psz_deinterlace != NULL )
@@ -325,8 +599,7 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
         filter_chain_AppendFilter( id->p_f_chain,
                                    p_stream->p_sys->psz_deinterlace,
                                    p_stream->p_sys->p_deinterlace_cfg,
-                                   &id->p_decoder->fmt_out,
-                                   &id->p_decoder->fmt_out );
+                                   &fmt_dec, &fmt_dec );
 
         p_fmt_out = filter_chain_GetFmtOut( id->p_f_chain );
     }
@@ -365,10 +638,10 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
     }
 
     /* Keep colorspace etc info along */
-    id->p_encoder->fmt_in.video.space     = id->p_decoder->fmt_out.video.space;
-    id->p_encoder->fmt_in.video.transfer  = id->p_decoder->fmt_out.video.transfer;
-    id->p_encoder->fmt_in.video.primaries = id->p_decoder->fmt_out.video.primaries;
-    id->p_encoder->fmt_in.video.b_color_range_full = id->p_decoder->fmt_out.video.b_color_range_full;
+    id->p_encoder->fmt_in.video.space     = fmt_dec.video.space;
+    id->p_encoder->fmt_in.video.transfer  = fmt_dec.video.transfer;
+    id->p_encoder->fmt_in.video.primaries = fmt_dec.video.primaries;
+    id->p_encoder->fmt_in.video.b_color_range_full = fmt_dec.video.b_color_range_full;
 }
 
 /* Take care of the scaling and chroma conversions. */
@@ -391,48 +664,48 @@ static int conversion_video_filter_append( sout_stream_id_sys_t *id,
 }
 
 static void transcode_video_framerate_init( sout_stream_t *p_stream,
-                                            sout_stream_id_sys_t *id,
+                                            encoder_t *p_enc,
                                             const video_format_t *p_vid_out )
 {
     /* Handle frame rate conversion */
-    if( !id->p_encoder->fmt_out.video.i_frame_rate ||
-        !id->p_encoder->fmt_out.video.i_frame_rate_base )
+    if( !p_enc->fmt_out.video.i_frame_rate ||
+        !p_enc->fmt_out.video.i_frame_rate_base )
     {
         if( p_vid_out->i_frame_rate &&
             p_vid_out->i_frame_rate_base )
         {
-            id->p_encoder->fmt_out.video.i_frame_rate =
+            p_enc->fmt_out.video.i_frame_rate =
                 p_vid_out->i_frame_rate;
-            id->p_encoder->fmt_out.video.i_frame_rate_base =
+            p_enc->fmt_out.video.i_frame_rate_base =
                 p_vid_out->i_frame_rate_base;
         }
         else
         {
             /* Pick a sensible default value */
-            id->p_encoder->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
-            id->p_encoder->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
+            p_enc->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
+            p_enc->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
         }
     }
 
-    id->p_encoder->fmt_in.video.i_frame_rate =
-        id->p_encoder->fmt_out.video.i_frame_rate;
-    id->p_encoder->fmt_in.video.i_frame_rate_base =
-        id->p_encoder->fmt_out.video.i_frame_rate_base;
+    p_enc->fmt_in.video.i_frame_rate =
+        p_enc->fmt_out.video.i_frame_rate;
+    p_enc->fmt_in.video.i_frame_rate_base =
+        p_enc->fmt_out.video.i_frame_rate_base;
 
-    vlc_ureduce( &id->p_encoder->fmt_in.video.i_frame_rate,
-        &id->p_encoder->fmt_in.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base,
+    vlc_ureduce( &p_enc->fmt_in.video.i_frame_rate,
+        &p_enc->fmt_in.video.i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base,
         0 );
      msg_Dbg( p_stream, "source fps %u/%u, destination %u/%u",
-        id->p_decoder->fmt_out.video.i_frame_rate,
-        id->p_decoder->fmt_out.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base );
+        p_vid_out->i_frame_rate,
+        p_vid_out->i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base );
 }
 
 static void transcode_video_size_init( sout_stream_t *p_stream,
-                                     sout_stream_id_sys_t *id,
+                                     encoder_t *p_enc,
                                      const video_format_t *p_vid_out )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -465,8 +738,8 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
     msg_Dbg( p_stream, "source pixel aspect is %f:1", f_aspect );
 
     /* Calculate scaling factor for specified parameters */
-    if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-        id->p_encoder->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
+    if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+        p_enc->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
     {
         /* Global scaling. Make sure width will remain a factor of 16 */
         float f_real_scale;
@@ -485,26 +758,26 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
         f_scale_width = f_real_scale;
         f_scale_height = (float) i_new_height / (float) i_src_visible_height;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height <= 0 )
+    else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+             p_enc->fmt_out.video.i_visible_height <= 0 )
     {
         /* Only width specified */
-        f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
+        f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
         f_scale_height = f_scale_width;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height > 0 )
+    else if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+             p_enc->fmt_out.video.i_visible_height > 0 )
     {
          /* Only height specified */
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
          f_scale_width = f_scale_height;
      }
-     else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-              id->p_encoder->fmt_out.video.i_visible_height > 0 )
+     else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+              p_enc->fmt_out.video.i_visible_height > 0 )
      {
          /* Width and height specified */
-         f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
      }
 
      /* check maxwidth and maxheight */
@@ -541,15 +814,15 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
      if( i_dst_height & 1 ) ++i_dst_height;
 
      /* Store calculated values */
-     id->p_encoder->fmt_out.video.i_width = i_dst_width;
-     id->p_encoder->fmt_out.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_out.video.i_height = i_dst_height;
-     id->p_encoder->fmt_out.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_out.video.i_width = i_dst_width;
+     p_enc->fmt_out.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_out.video.i_height = i_dst_height;
+     p_enc->fmt_out.video.i_visible_height = i_dst_visible_height;
 
-     id->p_encoder->fmt_in.video.i_width = i_dst_width;
-     id->p_encoder->fmt_in.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_in.video.i_height = i_dst_height;
-     id->p_encoder->fmt_in.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_in.video.i_width = i_dst_width;
+     p_enc->fmt_in.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_in.video.i_height = i_dst_height;
+     p_enc->fmt_in.video.i_visible_height = i_dst_visible_height;
 
      msg_Dbg( p_stream, "source %ix%i, destination %ix%i",
          i_src_visible_width, i_src_visible_height,
@@ -558,7 +831,7 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
 }
 
 static void transcode_video_sar_init( sout_stream_t *p_stream,
-                                     sout_stream_id_sys_t *id,
+                                     encoder_t *p_enc,
                                      const video_format_t *p_vid_out )
 {
     int i_src_visible_width = p_vid_out->i_visible_width;
@@ -570,32 +843,32 @@ static void transcode_video_sar_init( sout_stream_t *p_stream,
         i_src_visible_height = p_vid_out->i_height;
 
     /* Check whether a particular aspect ratio was requested */
-    if( id->p_encoder->fmt_out.video.i_sar_num <= 0 ||
-        id->p_encoder->fmt_out.video.i_sar_den <= 0 )
+    if( p_enc->fmt_out.video.i_sar_num <= 0 ||
+        p_enc->fmt_out.video.i_sar_den <= 0 )
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     (uint64_t)p_vid_out->i_sar_num * id->p_encoder->fmt_out.video.i_width * p_vid_out->i_height,
-                     (uint64_t)p_vid_out->i_sar_den * id->p_encoder->fmt_out.video.i_height * p_vid_out->i_width,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     (uint64_t)p_vid_out->i_sar_num * p_enc->fmt_out.video.i_width * p_vid_out->i_height,
+                     (uint64_t)p_vid_out->i_sar_den * p_enc->fmt_out.video.i_height * p_vid_out->i_width,
                      0 );
     }
     else
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     id->p_encoder->fmt_out.video.i_sar_num,
-                     id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     p_enc->fmt_out.video.i_sar_num,
+                     p_enc->fmt_out.video.i_sar_den,
                      0 );
     }
 
-    id->p_encoder->fmt_in.video.i_sar_num =
-        id->p_encoder->fmt_out.video.i_sar_num;
-    id->p_encoder->fmt_in.video.i_sar_den =
-        id->p_encoder->fmt_out.video.i_sar_den;
+    p_enc->fmt_in.video.i_sar_num =
+        p_enc->fmt_out.video.i_sar_num;
+    p_enc->fmt_in.video.i_sar_den =
+        p_enc->fmt_out.video.i_sar_den;
 
     msg_Dbg( p_stream, "encoder aspect is %i:%i",
-             id->p_encoder->fmt_out.video.i_sar_num * id->p_encoder->fmt_out.video.i_width,
-             id->p_encoder->fmt_out.video.i_sar_den * id->p_encoder->fmt_out.video.i_height );
+             p_enc->fmt_out.video.i_sar_num * p_enc->fmt_out.video.i_width,
+             p_enc->fmt_out.video.i_sar_den * p_enc->fmt_out.video.i_height );
 
 }
 
@@ -606,16 +879,15 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
     const video_format_t *p_vid_out = video_output_format( id, p_pic );
 
     id->p_encoder->fmt_in.video.orientation =
-        id->p_encoder->fmt_out.video.orientation =
-        id->p_decoder->fmt_in.video.orientation;
+        id->p_encoder->fmt_out.video.orientation = id->orientation;
 
-    transcode_video_framerate_init( p_stream, id, p_vid_out );
+    transcode_video_framerate_init( p_stream, id->p_encoder, p_vid_out );
 
-    transcode_video_size_init( p_stream, id, p_vid_out );
-    transcode_video_sar_init( p_stream, id, p_vid_out );
+    transcode_video_size_init( p_stream, id->p_encoder, p_vid_out );
+    transcode_video_sar_init( p_stream, id->p_encoder, p_vid_out );
 
     msg_Dbg( p_stream, "source chroma: %4.4s, destination %4.4s",
-             (const char *)&id->p_decoder->fmt_out.video.i_chroma,
+             (const char *)&p_pic->format.i_chroma,
              (const char *)&id->p_encoder->fmt_in.video.i_chroma);
 }
 
@@ -645,6 +917,10 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     id->p_encoder->fmt_out.i_codec =
         vlc_fourcc_GetCodec( VIDEO_ES, id->p_encoder->fmt_out.i_codec );
 
+    /* Added with the first output when pipelined */
+    if( p_sys->b_pipeline )
+        return VLC_SUCCESS;
+
     id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
     if( !id->id )
     {
@@ -655,10 +931,171 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
+/* The pictures are filtered at the size and chroma of the decoder, every
+ * rendition scales and converts them on its own. */
+static void transcode_video_fanout_init( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         picture_t *p_pic )
+{
+    encoder_t *p_enc = id->p_encoder;
+
+    video_format_Clean( &p_enc->fmt_in.video );
+    video_format_Copy( &p_enc->fmt_in.video, &p_pic->format );
+    p_enc->fmt_in.i_codec = p_pic->format.i_chroma;
+
+    transcode_video_framerate_init( p_stream, p_enc, &p_pic->format );
+}
+
+static int transcode_rendition_open( sout_stream_t *p_stream,
+                                     sout_stream_id_sys_t *id,
+                                     transcode_rendition_t *r,
+                                     picture_t *p_pic )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    encoder_t *p_enc = r->p_encoder;
+    const video_format_t *p_vid_out = video_output_format( id, p_pic );
+
+    p_enc->fmt_in.video.orientation =
+        p_enc->fmt_out.video.orientation = id->orientation;
+
+    transcode_video_framerate_init( p_stream, p_enc, p_vid_out );
+    transcode_video_size_init( p_stream, p_enc, p_vid_out );
+    transcode_video_sar_init( p_stream, p_enc, p_vid_out );
+
+    /* Keep colorspace etc info along */
+    p_enc->fmt_in.video.space     = p_pic->format.space;
+    p_enc->fmt_in.video.transfer  = p_pic->format.transfer;
+    p_enc->fmt_in.video.primaries = p_pic->format.primaries;
+    p_enc->fmt_in.video.b_color_range_full = p_pic->format.b_color_range_full;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( !p_enc->p_module )
+    {
+        msg_Err( p_stream, "cannot find video encoder (module:%s fourcc:%4.4s)",
+                 p_sys->psz_venc ? p_sys->psz_venc : "any",
+                 (char *)&p_sys->i_vcodec );
+        return VLC_EGENERIC;
+    }
+
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+
+    /*  */
+    p_enc->fmt_out.i_codec =
+        vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+
+    /* Added with the first output when pipelined */
+    if( !p_sys->b_pipeline )
+    {
+        r->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+        if( !r->id )
+        {
+            msg_Err( p_stream, "cannot add this stream" );
+            return VLC_EGENERIC;
+        }
+    }
+
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+    if( vlc_clone( &r->thread, RenditionThread, r, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn encoder thread" );
+        return VLC_EGENERIC;
+    }
+    r->b_thread = true;
+
+    msg_Dbg( p_stream, "rendition %ix%i %4.4s %dkb/s",
+             p_enc->fmt_out.video.i_visible_width,
+             p_enc->fmt_out.video.i_visible_height,
+             (const char *)&p_enc->fmt_in.video.i_chroma,
+             p_enc->fmt_out.i_bitrate / 1000 );
+    return VLC_SUCCESS;
+}
+
+static int transcode_video_renditions_open( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id,
+                                            picture_t *p_pic )
+{
+    for( unsigned int i = 0; i < id->i_renditions; i++ )
+        if( transcode_rendition_open( p_stream, id, id->pp_renditions[i],
+                                      p_pic ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+
+    id->b_renditions_open = true;
+    return VLC_SUCCESS;
+}
+
+/* Sends what the renditions encoded, and reports their rate and queue
+ * depth once in a while. */
+static void transcode_video_renditions_send( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    const vlc_tick_t now = mdate();
+
+    if( id->i_renditions_report == 0 )
+        id->i_renditions_report = now;
+    const bool b_report =
+        now - id->i_renditions_report >= RENDITIONS_REPORT_PERIOD;
+
+    for( unsigned int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *r = id->pp_renditions[i];
+
+        vlc_mutex_lock( &r->lock );
+        block_t *p_out = r->p_buffers;
+        r->p_buffers = NULL;
+        const unsigned int i_encoded = r->i_encoded;
+        const unsigned int i_pics = r->i_pics;
+        const unsigned int i_pics_max = r->i_pics_max;
+        if( b_report )
+            r->i_pics_max = r->i_pics;
+        vlc_mutex_unlock( &r->lock );
+
+        if( p_out && !r->id )
+            r->id = sout_StreamIdAdd( p_stream->p_next,
+                                      &r->p_encoder->fmt_out );
+        if( p_out )
+        {
+            if( r->id )
+                sout_StreamIdSend( p_stream->p_next, r->id, p_out );
+            else
+                block_ChainRelease( p_out );
+        }
+
+        if( b_report )
+        {
+            msg_Dbg( p_stream, "rendition %ix%i: %.2f fps, queue %u/%u (max %u)",
+                     r->p_encoder->fmt_out.video.i_visible_width,
+                     r->p_encoder->fmt_out.video.i_visible_height,
+                     (double)( i_encoded - r->i_reported ) * CLOCK_FREQ /
+                         ( now - id->i_renditions_report ),
+                     i_pics, __MAX( p_stream->p_sys->pool_size, 1 ),
+                     i_pics_max );
+            r->i_reported = i_encoded;
+        }
+    }
+
+    if( b_report )
+        id->i_renditions_report = now;
+}
+
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    /* Stop the pipeline first, as its stages feed the encoders */
+    if( id->p_filter_stage )
+        transcode_stage_Delete( id->p_filter_stage );
+    id->p_filter_stage = NULL;
+    if( id->p_encoder_stage )
+        transcode_stage_Delete( id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+
+    for( unsigned int i = 0; i < id->i_renditions; i++ )
+        transcode_rendition_delete( p_stream, id->pp_renditions[i] );
+    free( id->pp_renditions );
+    id->pp_renditions = NULL;
+    id->i_renditions = 0;
+
+    if( transcode_video_threaded( p_stream->p_sys ) && !p_stream->p_sys->b_abort )
     {
         vlc_mutex_lock( &p_stream->p_sys->lock_out );
         p_stream->p_sys->b_abort = true;
@@ -671,7 +1108,7 @@ void transcode_video_close( sout_stream_t *p_stream,
         block_ChainRelease( p_stream->p_sys->p_buffers );
     }
 
-    if( p_stream->p_sys->i_threads >= 1 )
+    if( transcode_video_threaded( p_stream->p_sys ) )
     {
         vlc_mutex_destroy( &p_stream->p_sys->lock_out );
         vlc_cond_destroy( &p_stream->p_sys->cond );
@@ -713,8 +1150,15 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
             fmt.i_y_offset       = 0;
         }
 
+        video_format_t fmt_src = id->fmt_input_video;
+        if( !fmt_src.i_visible_width || !fmt_src.i_visible_height )
+        {
+            fmt_src.i_visible_width  = fmt_src.i_width;
+            fmt_src.i_visible_height = fmt_src.i_height;
+        }
+
         subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
-                                             &id->p_decoder->fmt_out.video,
+                                             &fmt_src,
                                              p_pic->date, p_pic->date, false );
 
         /* Overlay subpicture */
@@ -740,6 +1184,21 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         }
     }
 
+    if( id->i_renditions )
+    {
+        for( unsigned int i = 0; i < id->i_renditions; i++ )
+            transcode_rendition_push( id->pp_renditions[i],
+                                      picture_Hold( p_pic ) );
+        picture_Release( p_pic );
+        return;
+    }
+
+    if( id->p_encoder_stage )
+    {
+        transcode_stage_Push( id->p_encoder_stage, p_pic );
+        return;
+    }
+
     if( p_sys->i_threads == 0 )
     {
         block_t *p_block;
@@ -761,118 +1220,185 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         picture_Release( p_pic );
 }
 
-int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
-                                    block_t *in, block_t **out )
+/* Filters a decoded picture, and passes it on to the encoder(s). This runs
+ * on the filter stage thread if the transcoding is pipelined. */
+static int transcode_video_filter_process( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id,
+                                           picture_t *p_pic, block_t **out )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    *out = NULL;
-
-    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
-    if( ret != VLCDEC_SUCCESS )
-        return VLC_EGENERIC;
 
-    picture_t *p_pics = transcode_dequeue_all_pics( id );
-    if( p_pics == NULL )
-        goto end;
-
-    do
+    if( unlikely (
+         ( id->p_encoder->p_module || id->b_renditions_open ) && p_pic &&
+         !video_format_IsSimilar( &id->fmt_input_video, &p_pic->format )
+        )
+      )
     {
-        picture_t *p_pic = p_pics;
-        p_pics = p_pics->p_next;
-        p_pic->p_next = NULL;
-
-        if( id->b_error )
+        msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
+                    id->fmt_input_video.i_sar_num, p_pic->format.i_sar_num,
+                    id->fmt_input_video.i_sar_den, p_pic->format.i_sar_den
+                );
+        /* Close filters */
+        if( id->p_f_chain )
+            filter_chain_Delete( id->p_f_chain );
+        id->p_f_chain = NULL;
+        if( id->p_uf_chain )
+            filter_chain_Delete( id->p_uf_chain );
+        id->p_uf_chain = NULL;
+
+        if( id->i_renditions )
         {
-            picture_Release( p_pic );
-            continue;
+            /* The renditions adapt their own converters */
+            transcode_video_fanout_init( p_stream, id, p_pic );
         }
-
-        if( unlikely (
-             id->p_encoder->p_module && p_pic &&
-             !video_format_IsSimilar( &id->fmt_input_video, &p_pic->format )
-            )
-          )
+        else
         {
-            msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
-                        id->fmt_input_video.i_sar_num, p_pic->format.i_sar_num,
-                        id->fmt_input_video.i_sar_den, p_pic->format.i_sar_den
-                    );
-            /* Close filters */
-            if( id->p_f_chain )
-                filter_chain_Delete( id->p_f_chain );
-            id->p_f_chain = NULL;
-            if( id->p_uf_chain )
-                filter_chain_Delete( id->p_uf_chain );
-            id->p_uf_chain = NULL;
-
             /* Reinitialize filters */
             id->p_encoder->fmt_out.video.i_visible_width  = p_sys->i_width & ~1;
             id->p_encoder->fmt_out.video.i_visible_height = p_sys->i_height & ~1;
             id->p_encoder->fmt_out.video.i_sar_num = id->p_encoder->fmt_out.video.i_sar_den = 0;
 
             transcode_video_encoder_init( p_stream, id, p_pic );
-            transcode_video_filter_init( p_stream, id );
-            if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
-                goto error;
-            memcpy( &id->fmt_input_video, &p_pic->format, sizeof(video_format_t));
         }
+        transcode_video_filter_init( p_stream, id, p_pic );
+        if( !id->i_renditions &&
+            conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
+            goto error;
+        memcpy( &id->fmt_input_video, &p_pic->format, sizeof(video_format_t));
+    }
 
 
-        if( unlikely( !id->p_encoder->p_module && p_pic ) )
-        {
-            if( id->p_f_chain )
-                filter_chain_Delete( id->p_f_chain );
-            if( id->p_uf_chain )
-                filter_chain_Delete( id->p_uf_chain );
-            id->p_f_chain = id->p_uf_chain = NULL;
+    if( unlikely( id->i_renditions && !id->b_renditions_open && p_pic ) )
+    {
+        if( id->p_f_chain )
+            filter_chain_Delete( id->p_f_chain );
+        if( id->p_uf_chain )
+            filter_chain_Delete( id->p_uf_chain );
+        id->p_f_chain = id->p_uf_chain = NULL;
+
+        transcode_video_fanout_init( p_stream, id, p_pic );
+        transcode_video_filter_init( p_stream, id, p_pic );
+        memcpy( &id->fmt_input_video, &p_pic->format, sizeof(video_format_t));
+
+        if( transcode_video_renditions_open( p_stream, id, p_pic ) != VLC_SUCCESS )
+            goto error;
+    }
 
-            transcode_video_encoder_init( p_stream, id, p_pic );
-            transcode_video_filter_init( p_stream, id );
-            if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
-                goto error;
-            memcpy( &id->fmt_input_video, &p_pic->format, sizeof(video_format_t));
+    if( unlikely( !id->i_renditions && !id->p_encoder->p_module && p_pic ) )
+    {
+        if( id->p_f_chain )
+            filter_chain_Delete( id->p_f_chain );
+        if( id->p_uf_chain )
+            filter_chain_Delete( id->p_uf_chain );
+        id->p_f_chain = id->p_uf_chain = NULL;
+
+        transcode_video_encoder_init( p_stream, id, p_pic );
+        transcode_video_filter_init( p_stream, id, p_pic );
+        if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
+            goto error;
+        memcpy( &id->fmt_input_video, &p_pic->format, sizeof(video_format_t));
+
+        if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
+            goto error;
+    }
 
-            if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
-                goto error;
-        }
+    /* Run the filter and output chains; first with the picture,
+     * and then with NULL as many times as we need until they
+     * stop outputting frames.
+     */
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
         for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
+            picture_t *p_user_filtered_pic = p_filtered_pic;
 
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
                 break;
 
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
+            OutputFrame( p_stream, p_user_filtered_pic, id, out );
 
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
+            p_filtered_pic = NULL;
+        }
 
-                p_filtered_pic = NULL;
-            }
+        p_pic = NULL;
+    }
+    return VLC_SUCCESS;
 
-            p_pic = NULL;
-        }
-        continue;
 error:
-        if( p_pic )
+    if( p_pic )
+        picture_Release( p_pic );
+    return VLC_EGENERIC;
+}
+
+static int transcode_video_filter_stage( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         void *p_item, block_t **out )
+{
+    return transcode_video_filter_process( p_stream, id, p_item, out );
+}
+
+static int transcode_video_encoder_stage( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id,
+                                          void *p_item, block_t **out )
+{
+    picture_t *p_pic = p_item;
+    VLC_UNUSED( p_stream );
+
+    block_ChainAppend( out, id->p_encoder->pf_encode_video( id->p_encoder,
+                                                            p_pic ) );
+    picture_Release( p_pic );
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_release( void *p_item )
+{
+    picture_Release( p_item );
+}
+
+int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                                    block_t *in, block_t **out )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    *out = NULL;
+
+    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
+    if( ret != VLCDEC_SUCCESS )
+        return VLC_EGENERIC;
+
+    picture_t *p_pics = transcode_dequeue_all_pics( id );
+    if( p_pics == NULL )
+        goto end;
+
+    do
+    {
+        picture_t *p_pic = p_pics;
+        p_pics = p_pics->p_next;
+        p_pic->p_next = NULL;
+
+        if( id->b_error )
+        {
             picture_Release( p_pic );
-        id->b_error = true;
+            continue;
+        }
+
+        if( id->p_filter_stage )
+            ret = transcode_stage_Push( id->p_filter_stage, p_pic );
+        else
+            ret = transcode_video_filter_process( p_stream, id, p_pic, out );
+        if( ret != VLC_SUCCESS )
+            id->b_error = true;
     } while( p_pics );
 
-    if( p_sys->i_threads >= 1 )
+    if( transcode_video_threaded( p_sys ) )
     {
         /* Pick up any return data the encoder thread wants to output. */
         vlc_mutex_lock( &p_sys->lock_out );
@@ -882,11 +1408,31 @@ error:
     }
 
 end:
+    /* Pick up what the encoder stage has output. */
+    if( id->p_encoder_stage )
+        block_ChainAppend( out, transcode_stage_Dequeue( id->p_encoder_stage ) );
+
     /* Drain encoder */
     if( unlikely( !id->b_error && in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
+        if( id->p_filter_stage &&
+            transcode_stage_Drain( id->p_filter_stage ) != VLC_SUCCESS )
+            id->b_error = true;
+
+        if( id->i_renditions )
+        {
+            for( unsigned int i = 0; i < id->i_renditions; i++ )
+                if( id->pp_renditions[i]->b_thread )
+                    transcode_rendition_join( id->pp_renditions[i] );
+        }
+        else if( p_sys->i_threads == 0 || id->p_encoder_stage )
         {
+            if( id->p_encoder_stage )
+            {
+                transcode_stage_Drain( id->p_encoder_stage );
+                block_ChainAppend( out,
+                    transcode_stage_Dequeue( id->p_encoder_stage ) );
+            }
             if( id->p_encoder->p_module )
             {
                 block_t *p_block;
@@ -914,6 +1460,23 @@ end:
         }
     }
 
+    if( id->i_renditions )
+        transcode_video_renditions_send( p_stream, id );
+
+    /* The pipelined encoder was opened on the filter stage thread. Its
+     * stream is added here, as the next streams are not thread-safe. */
+    if( *out && !id->id )
+    {
+        id->id = sout_StreamIdAdd( p_stream->p_next, &id->p_encoder->fmt_out );
+        if( !id->id )
+        {
+            msg_Err( p_stream, "cannot add this stream" );
+            block_ChainRelease( *out );
+            *out = NULL;
+            id->b_error = true;
+        }
+    }
+
     return id->b_error ? VLC_EGENERIC : VLC_SUCCESS;
 }
 
@@ -952,6 +1515,48 @@ bool transcode_video_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
         id->p_encoder->fmt_in.video.i_frame_rate_base = id->p_encoder->fmt_out.video.i_frame_rate_base = (p_sys->fps_den ? p_sys->fps_den : 1);
     }
 
+    if( p_sys->i_renditions > 0 )
+    {
+        id->pp_renditions = vlc_alloc( p_sys->i_renditions,
+                                       sizeof( *id->pp_renditions ) );
+        for( unsigned int i = 0; id->pp_renditions && i < p_sys->i_renditions; i++ )
+        {
+            id->pp_renditions[i] =
+                transcode_rendition_new( p_stream, id, i );
+            if( !id->pp_renditions[i] )
+                break;
+            id->i_renditions++;
+        }
+        if( id->i_renditions < p_sys->i_renditions )
+        {
+            msg_Err( p_stream, "cannot create video renditions" );
+            transcode_video_close( p_stream, id );
+            return false;
+        }
+    }
+
+    if( p_sys->b_pipeline )
+    {
+        id->p_filter_stage =
+            transcode_stage_New( p_stream, id, "video filter",
+                                 VLC_THREAD_PRIORITY_VIDEO,
+                                 transcode_video_filter_stage,
+                                 transcode_video_release );
+        /* The renditions have their own encoder threads */
+        if( id->p_filter_stage && !id->i_renditions )
+            id->p_encoder_stage =
+                transcode_stage_New( p_stream, id, "video encoder",
+                                     VLC_THREAD_PRIORITY_VIDEO,
+                                     transcode_video_encoder_stage,
+                                     transcode_video_release );
+        if( !id->p_filter_stage || ( !id->i_renditions && !id->p_encoder_stage ) )
+        {
+            msg_Err( p_stream, "cannot create video pipeline" );
+            transcode_video_close( p_stream, id );
+            return false;
+        }
+    }
+
     return true;
 }
 
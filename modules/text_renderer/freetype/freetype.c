@@ -115,6 +115,13 @@ static void Destroy( vlc_object_t * );
 #define SHADOW_ANGLE_TEXT N_("Shadow angle")
 #define SHADOW_DISTANCE_TEXT N_("Shadow distance")
 
+#define CACHE_SIZE_TEXT N_("Glyph cache size (KiB)")
+#define CACHE_SIZE_LONGTEXT N_("Maximum memory used to keep rendered glyphs " \
+    "across subtitles, 0 disables the cache.")
+#define SHAPE_CACHE_SIZE_TEXT N_("Shaped text cache size (KiB)")
+#define SHAPE_CACHE_SIZE_LONGTEXT N_("Maximum memory used to keep the " \
+    "result of text shaping across subtitles, 0 disables the cache.")
+
 #define TEXT_DIRECTION_TEXT N_("Text direction")
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
 
@@ -233,6 +240,11 @@ vlc_module_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer( "freetype-cache-size", 4096, CACHE_SIZE_TEXT,
+                 CACHE_SIZE_LONGTEXT, true )
+    add_integer( "freetype-shape-cache-size", 256, SHAPE_CACHE_SIZE_TEXT,
+                 SHAPE_CACHE_SIZE_LONGTEXT, true )
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1352,6 +1364,7 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
     }
 
     FreeLines( p_lines );
+    UpdateLayoutCachesStats( p_filter );
 
     free( psz_text );
     FreeStylesArray( pp_styles, i_styles );
@@ -1403,6 +1416,13 @@ static int Create( vlc_object_t *p_this )
 
     p_sys->i_scale = 100;
 
+    /* Glyph and shaped runs caches, with their statistics */
+    InitLayoutCaches( p_filter );
+    var_Create( p_filter, "freetype-glyph-cache-hits", VLC_VAR_INTEGER );
+    var_Create( p_filter, "freetype-glyph-cache-misses", VLC_VAR_INTEGER );
+    var_Create( p_filter, "freetype-shape-cache-hits", VLC_VAR_INTEGER );
+    var_Create( p_filter, "freetype-shape-cache-misses", VLC_VAR_INTEGER );
+
     /* default style to apply to incomplete segments styles */
     p_sys->p_default_style = text_style_Create( STYLE_FULLY_SET );
     if(unlikely(!p_sys->p_default_style))
@@ -1525,6 +1545,13 @@ static void Destroy( vlc_object_t *p_this )
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
 
+    /* Caches reference the faces */
+    CleanLayoutCaches( p_filter );
+    var_Destroy( p_filter, "freetype-glyph-cache-hits" );
+    var_Destroy( p_filter, "freetype-glyph-cache-misses" );
+    var_Destroy( p_filter, "freetype-shape-cache-hits" );
+    var_Destroy( p_filter, "freetype-shape-cache-misses" );
+
     /* Fonts dicts */
     vlc_dictionary_clear( &p_sys->fallback_map, FreeFamilies, p_filter );
     vlc_dictionary_clear( &p_sys->face_map, FreeFace, p_filter );
@@ -42,6 +42,8 @@
 #include <vlc_text_style.h>                             /* text_style_t */
 #include <vlc_arrays.h>                                 /* vlc_dictionary_t */
 
+#include "lru_cache.h"
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
@@ -108,6 +110,12 @@ struct filter_sys_t
 
     int               i_fallback_counter;
 
+    /** Rasterised glyphs cache, see text_layout.c */
+    lru_cache_t       glyph_cache;
+
+    /** Shaped runs cache, see text_layout.c */
+    lru_cache_t       shape_cache;
+
     /* Current scaling of the text, default is 100 (%) */
     int               i_scale;
 
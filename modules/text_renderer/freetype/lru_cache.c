@@ -0,0 +1,212 @@
+/*****************************************************************************
+ * lru_cache.c : Size-bounded LRU cache for rendered text
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype_cache
+ * @{
+ * \file
+ * Size-bounded LRU cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "lru_cache.h"
+
+struct lru_cache_entry_t
+{
+    lru_cache_entry_t *p_hash_next;
+    lru_cache_entry_t *p_prev;
+    lru_cache_entry_t *p_next;
+
+    uint32_t           i_hash;
+    size_t             i_cost;
+    void              *p_value;
+
+    size_t             i_key_size;
+    uint8_t            p_key[];
+};
+
+#define LRU_CACHE_MIN_BUCKETS 64
+
+static uint32_t Hash( const void *p_key, size_t i_key_size )
+{
+    /* FNV-1a */
+    const uint8_t *p = p_key;
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key_size; i++ )
+    {
+        i_hash ^= p[i];
+        i_hash *= 16777619u;
+    }
+    return i_hash;
+}
+
+void LRUCacheInit( lru_cache_t *p_cache, size_t i_max_cost,
+                   void (*pf_free)( void *, void * ), void *p_opaque )
+{
+    memset( p_cache, 0, sizeof( *p_cache ) );
+    p_cache->i_max_cost = i_max_cost;
+    p_cache->pf_free = pf_free;
+    p_cache->p_opaque = p_opaque;
+}
+
+static void Unlink( lru_cache_t *p_cache, lru_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void PushFront( lru_cache_t *p_cache, lru_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Evict( lru_cache_t *p_cache, lru_cache_entry_t *p_entry )
+{
+    lru_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash % p_cache->i_buckets];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    Unlink( p_cache, p_entry );
+    p_cache->i_cost -= p_entry->i_cost;
+    p_cache->i_count--;
+
+    p_cache->pf_free( p_entry->p_value, p_cache->p_opaque );
+    free( p_entry );
+}
+
+void LRUCacheClean( lru_cache_t *p_cache )
+{
+    for( lru_cache_entry_t *p_entry = p_cache->p_first; p_entry; )
+    {
+        lru_cache_entry_t *p_next = p_entry->p_next;
+        p_cache->pf_free( p_entry->p_value, p_cache->p_opaque );
+        free( p_entry );
+        p_entry = p_next;
+    }
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = NULL;
+    p_cache->i_buckets = 0;
+    p_cache->i_count = 0;
+    p_cache->i_cost = 0;
+    p_cache->p_first = p_cache->p_last = NULL;
+}
+
+void *LRUCacheGet( lru_cache_t *p_cache, const void *p_key, size_t i_key_size )
+{
+    if( !p_cache->i_buckets )
+    {
+        p_cache->i_misses++;
+        return NULL;
+    }
+
+    const uint32_t i_hash = Hash( p_key, i_key_size );
+    for( lru_cache_entry_t *p_entry = p_cache->pp_buckets[i_hash % p_cache->i_buckets];
+         p_entry; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key_size == i_key_size
+         && !memcmp( p_entry->p_key, p_key, i_key_size ) )
+        {
+            if( p_cache->p_first != p_entry )
+            {
+                Unlink( p_cache, p_entry );
+                PushFront( p_cache, p_entry );
+            }
+            p_cache->i_hits++;
+            return p_entry->p_value;
+        }
+    }
+    p_cache->i_misses++;
+    return NULL;
+}
+
+static int Grow( lru_cache_t *p_cache )
+{
+    unsigned i_buckets = __MAX( LRU_CACHE_MIN_BUCKETS, p_cache->i_buckets * 2 );
+    lru_cache_entry_t **pp_buckets = calloc( i_buckets, sizeof( *pp_buckets ) );
+    if( unlikely( !pp_buckets ) )
+        return VLC_ENOMEM;
+
+    for( lru_cache_entry_t *p_entry = p_cache->p_first; p_entry;
+         p_entry = p_entry->p_next )
+    {
+        lru_cache_entry_t **pp = &pp_buckets[p_entry->i_hash % i_buckets];
+        p_entry->p_hash_next = *pp;
+        *pp = p_entry;
+    }
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+    return VLC_SUCCESS;
+}
+
+int LRUCachePut( lru_cache_t *p_cache, const void *p_key, size_t i_key_size,
+                 void *p_value, size_t i_cost )
+{
+    if( i_cost > p_cache->i_max_cost )
+        return VLC_EGENERIC;
+
+    if( p_cache->i_count >= p_cache->i_buckets * 2 && Grow( p_cache ) )
+        return VLC_ENOMEM;
+
+    lru_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key_size );
+    if( unlikely( !p_entry ) )
+        return VLC_ENOMEM;
+
+    while( p_cache->p_last && p_cache->i_cost + i_cost > p_cache->i_max_cost )
+    {
+        Evict( p_cache, p_cache->p_last );
+        p_cache->i_evictions++;
+    }
+
+    p_entry->i_hash = Hash( p_key, i_key_size );
+    p_entry->i_cost = i_cost;
+    p_entry->p_value = p_value;
+    p_entry->i_key_size = i_key_size;
+    memcpy( p_entry->p_key, p_key, i_key_size );
+
+    lru_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash % p_cache->i_buckets];
+    p_entry->p_hash_next = *pp;
+    *pp = p_entry;
+    PushFront( p_cache, p_entry );
+
+    p_cache->i_cost += i_cost;
+    p_cache->i_count++;
+    return VLC_SUCCESS;
+}
+
+/** @} */
@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * lru_cache.h : Size-bounded LRU cache for rendered text
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+/** \defgroup freetype_cache Freetype caches
+ * \ingroup freetype
+ * Binary-keyed LRU cache, bounded by the cost of its values. It backs the
+ * rasterised glyph cache and the shaped run cache of the text layout.
+ * @{
+ * \file
+ */
+
+typedef struct lru_cache_entry_t lru_cache_entry_t;
+
+typedef struct
+{
+    lru_cache_entry_t **pp_buckets;
+    unsigned            i_buckets;
+    unsigned            i_count;
+
+    lru_cache_entry_t  *p_first;        /**< most recently used */
+    lru_cache_entry_t  *p_last;         /**< least recently used */
+
+    size_t              i_cost;         /**< current total cost */
+    size_t              i_max_cost;     /**< 0 disables the cache */
+
+    void              (*pf_free)( void *p_value, void *p_opaque );
+    void               *p_opaque;
+
+    /* Statistics */
+    uint64_t            i_hits;
+    uint64_t            i_misses;
+    uint64_t            i_evictions;
+} lru_cache_t;
+
+void LRUCacheInit( lru_cache_t *p_cache, size_t i_max_cost,
+                   void (*pf_free)( void *, void * ), void *p_opaque );
+void LRUCacheClean( lru_cache_t *p_cache );
+
+static inline bool LRUCacheEnabled( const lru_cache_t *p_cache )
+{
+    return p_cache->i_max_cost > 0;
+}
+
+/**
+ * Looks up a value and marks it as the most recently used.
+ * The returned value remains owned by the cache, and is only valid until
+ * the next LRUCachePut() call.
+ */
+void *LRUCacheGet( lru_cache_t *p_cache, const void *p_key, size_t i_key_size );
+
+/**
+ * Inserts a value, evicting the least recently used ones to stay below the
+ * maximum cost. The cache takes ownership of the value on success only.
+ */
+int LRUCachePut( lru_cache_t *p_cache, const void *p_key, size_t i_key_size,
+                 void *p_value, size_t i_cost );
+
+/** @} */
+
+#endif
@@ -113,10 +113,45 @@ typedef struct run_desc_t
     hb_glyph_info_t            *p_glyph_infos;
     hb_glyph_position_t        *p_glyph_positions;
     unsigned int                i_glyph_count;
+    void                       *p_cached_shape; /**< copy of a cached shaping */
 #endif
 
 } run_desc_t;
 
+/**
+ * Glyph cache key. The same glyph index may be rendered differently
+ * depending on the face size, the emulated styles, the outline stroke, and
+ * the sub-pixel phase of the pen.
+ */
+typedef struct glyph_cache_key_t
+{
+    FT_Face  p_face;                    /**< NULL if the glyph is not cacheable */
+    FT_Fixed i_x_scale;
+    FT_Fixed i_y_scale;
+    FT_UInt  i_glyph_index;
+    int      i_kind;
+    bool     b_emboldened;
+    bool     b_obliqued;
+    FT_Fixed i_stroke_radius;           /**< 0 when not outlined */
+    FT_Pos   i_x_phase;                 /**< 26.6 fractional pen position */
+    FT_Pos   i_y_phase;
+} glyph_cache_key_t;
+
+enum
+{
+    GLYPH_CACHE_SOURCE,                 /**< loaded, styled and stroked outlines */
+    GLYPH_CACHE_GLYPH,                  /**< rasterised glyph */
+    GLYPH_CACHE_OUTLINE,                /**< rasterised stroked outline */
+};
+
+typedef struct cached_glyph_t
+{
+    FT_Glyph p_glyph;
+    FT_Glyph p_outline;                 /**< GLYPH_CACHE_SOURCE only */
+    FT_Pos   i_x_advance;
+    FT_Pos   i_y_advance;
+} cached_glyph_t;
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -132,6 +167,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -164,6 +200,166 @@ typedef struct paragraph_t
 
 } paragraph_t;
 
+/*****************************************************************************
+ * Glyph and shaped runs caches
+ *****************************************************************************/
+static void FreeCachedGlyph( void *p_value, void *p_opaque )
+{
+    VLC_UNUSED( p_opaque );
+    cached_glyph_t *p_cached = p_value;
+
+    if( p_cached->p_glyph )
+        FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+static void FreeCachedShape( void *p_value, void *p_opaque )
+{
+    VLC_UNUSED( p_opaque );
+    free( p_value );
+}
+
+/* Approximate memory use of a glyph, used as its cache cost */
+static size_t GlyphCost( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &( (FT_BitmapGlyph)p_glyph )->bitmap;
+        return sizeof( FT_BitmapGlyphRec )
+             + (size_t)abs( p_bitmap->pitch ) * p_bitmap->rows;
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &( (FT_OutlineGlyph)p_glyph )->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+int InitLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    int64_t i_glyph_kb = var_InheritInteger( p_filter, "freetype-cache-size" );
+    int64_t i_shape_kb = var_InheritInteger( p_filter, "freetype-shape-cache-size" );
+
+    LRUCacheInit( &p_sys->glyph_cache, __MAX( i_glyph_kb, 0 ) * 1024,
+                  FreeCachedGlyph, NULL );
+    LRUCacheInit( &p_sys->shape_cache, __MAX( i_shape_kb, 0 ) * 1024,
+                  FreeCachedShape, NULL );
+    return VLC_SUCCESS;
+}
+
+static void DumpCacheStats( filter_t *p_filter, const char *psz_name,
+                            const lru_cache_t *p_cache )
+{
+    const uint64_t i_lookups = p_cache->i_hits + p_cache->i_misses;
+    if( !i_lookups )
+        return;
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses "
+             "(%.1f%% hit rate), %"PRIu64" evictions, %zu/%zu KiB used",
+             psz_name, p_cache->i_hits, p_cache->i_misses,
+             100.0 * p_cache->i_hits / i_lookups, p_cache->i_evictions,
+             p_cache->i_cost / 1024, p_cache->i_max_cost / 1024 );
+}
+
+void UpdateLayoutCachesStats( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    var_SetInteger( p_filter, "freetype-glyph-cache-hits",
+                    p_sys->glyph_cache.i_hits );
+    var_SetInteger( p_filter, "freetype-glyph-cache-misses",
+                    p_sys->glyph_cache.i_misses );
+    var_SetInteger( p_filter, "freetype-shape-cache-hits",
+                    p_sys->shape_cache.i_hits );
+    var_SetInteger( p_filter, "freetype-shape-cache-misses",
+                    p_sys->shape_cache.i_misses );
+}
+
+void CleanLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    DumpCacheStats( p_filter, "glyph", &p_sys->glyph_cache );
+    DumpCacheStats( p_filter, "shaped runs", &p_sys->shape_cache );
+    LRUCacheClean( &p_sys->glyph_cache );
+    LRUCacheClean( &p_sys->shape_cache );
+}
+
+/**
+ * Renders *pp_glyph at p_origin, like FT_Glyph_To_Bitmap(), going through
+ * the rasterised glyphs cache.
+ *
+ * The bitmap is rasterised once per sub-pixel phase of the origin: moving
+ * an outline by whole pixels only moves its bitmap.
+ */
+static FT_Error RenderGlyph( filter_t *p_filter,
+                             const glyph_cache_key_t *p_source_key, int i_kind,
+                             FT_Glyph *pp_glyph, const FT_Vector *p_origin,
+                             bool b_destroy )
+{
+    lru_cache_t *p_cache = &p_filter->p_sys->glyph_cache;
+
+    if( !LRUCacheEnabled( p_cache ) || !p_source_key->p_face
+     || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   (FT_Vector *)p_origin, b_destroy );
+
+    glyph_cache_key_t key = *p_source_key;
+    key.i_kind = i_kind;
+    key.i_x_phase = p_origin->x & 63;
+    key.i_y_phase = p_origin->y & 63;
+
+    FT_Glyph p_bitmap;
+    cached_glyph_t *p_cached = LRUCacheGet( p_cache, &key, sizeof( key ) );
+    if( p_cached )
+    {
+        if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmap ) )
+            return FT_Err_Out_Of_Memory;
+    }
+    else
+    {
+        FT_Vector phase = { .x = key.i_x_phase, .y = key.i_y_phase };
+        FT_Glyph p_rendered = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_rendered, FT_RENDER_MODE_NORMAL,
+                                               &phase, 0 );
+        if( i_error )
+            return i_error;
+
+        if( FT_Glyph_Copy( p_rendered, &p_bitmap ) )
+        {
+            FT_Done_Glyph( p_rendered );
+            return FT_Err_Out_Of_Memory;
+        }
+
+        p_cached = calloc( 1, sizeof( *p_cached ) );
+        if( p_cached )
+        {
+            p_cached->p_glyph = p_rendered;
+            if( LRUCachePut( p_cache, &key, sizeof( key ), p_cached,
+                             sizeof( *p_cached ) + GlyphCost( p_rendered ) ) )
+                FreeCachedGlyph( p_cached, NULL );
+        }
+        else
+            FT_Done_Glyph( p_rendered );
+    }
+
+    FT_BitmapGlyph p_bitmap_glyph = (FT_BitmapGlyph)p_bitmap;
+    p_bitmap_glyph->left += ( p_origin->x - key.i_x_phase ) / 64;
+    p_bitmap_glyph->top  += ( p_origin->y - key.i_y_phase ) / 64;
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 static void FreeLine( line_desc_t *p_line )
 {
     for( int i = 0; i < p_line->i_character_count; i++ )
@@ -664,6 +860,82 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
 }
 
 #ifdef HAVE_HARFBUZZ
+/**
+ * Shaped runs cache: the key is the face, its size, the script, the
+ * direction and the code points of the run.
+ */
+typedef struct shape_cache_key_t
+{
+    FT_Face         p_face;
+    FT_Fixed        i_x_scale;
+    FT_Fixed        i_y_scale;
+    hb_script_t     script;
+    hb_direction_t  direction;
+    int             i_length;
+    uni_char_t      p_code_points[];
+} shape_cache_key_t;
+
+typedef struct cached_shape_t
+{
+    unsigned int    i_glyph_count;
+    hb_glyph_info_t p_infos[];          /* followed by the positions */
+} cached_shape_t;
+
+static inline size_t CachedShapeSize( unsigned int i_glyph_count )
+{
+    return sizeof( cached_shape_t ) + i_glyph_count *
+           ( sizeof( hb_glyph_info_t ) + sizeof( hb_glyph_position_t ) );
+}
+
+static inline hb_glyph_position_t *CachedShapePositions( cached_shape_t *p_shape )
+{
+    return (hb_glyph_position_t *)( p_shape->p_infos + p_shape->i_glyph_count );
+}
+
+static shape_cache_key_t *NewShapeKey( const paragraph_t *p_paragraph,
+                                       const run_desc_t *p_run,
+                                       size_t *pi_key_size )
+{
+    const int i_length = p_run->i_end_offset - p_run->i_start_offset;
+    const size_t i_key_size = sizeof( shape_cache_key_t )
+                            + i_length * sizeof( uni_char_t );
+
+    /* calloc() clears the padding, which is part of the key */
+    shape_cache_key_t *p_key = calloc( 1, i_key_size );
+    if( !p_key )
+        return NULL;
+
+    p_key->p_face = p_run->p_face;
+    p_key->i_x_scale = p_run->p_face->size->metrics.x_scale;
+    p_key->i_y_scale = p_run->p_face->size->metrics.y_scale;
+    p_key->script = p_run->script;
+    p_key->direction = p_run->direction;
+    p_key->i_length = i_length;
+    memcpy( p_key->p_code_points,
+            p_paragraph->p_code_points + p_run->i_start_offset,
+            i_length * sizeof( uni_char_t ) );
+    *pi_key_size = i_key_size;
+    return p_key;
+}
+
+static void CacheShape( lru_cache_t *p_cache, const shape_cache_key_t *p_key,
+                        size_t i_key_size, const run_desc_t *p_run )
+{
+    const size_t i_size = CachedShapeSize( p_run->i_glyph_count );
+    cached_shape_t *p_shape = malloc( i_size );
+    if( !p_shape )
+        return;
+
+    p_shape->i_glyph_count = p_run->i_glyph_count;
+    memcpy( p_shape->p_infos, p_run->p_glyph_infos,
+            p_run->i_glyph_count * sizeof( hb_glyph_info_t ) );
+    memcpy( CachedShapePositions( p_shape ), p_run->p_glyph_positions,
+            p_run->i_glyph_count * sizeof( hb_glyph_position_t ) );
+
+    if( LRUCachePut( p_cache, p_key, i_key_size, p_shape, i_size + i_key_size ) )
+        free( p_shape );
+}
+
 /**
  * Shape an itemized paragraph using HarfBuzz.
  * This is where the glyphs of complex scripts get their positions
@@ -717,11 +989,40 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        shape_cache_key_t *p_key = NULL;
+        size_t i_key_size = 0;
+        if( LRUCacheEnabled( &p_sys->shape_cache ) )
+            p_key = NewShapeKey( p_paragraph, p_run, &i_key_size );
+
+        cached_shape_t *p_cached = p_key ?
+            LRUCacheGet( &p_sys->shape_cache, p_key, i_key_size ) : NULL;
+        if( p_cached )
+        {
+            /* Copy it, as later insertions may evict the cached one */
+            const size_t i_size = CachedShapeSize( p_cached->i_glyph_count );
+            cached_shape_t *p_shape = malloc( i_size );
+            free( p_key );
+            if( !p_shape )
+            {
+                i_ret = VLC_ENOMEM;
+                goto error;
+            }
+            memcpy( p_shape, p_cached, i_size );
+
+            p_run->p_cached_shape = p_shape;
+            p_run->p_glyph_infos = p_shape->p_infos;
+            p_run->p_glyph_positions = CachedShapePositions( p_shape );
+            p_run->i_glyph_count = p_shape->i_glyph_count;
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -730,6 +1031,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
+            free( p_key );
             goto error;
         }
 
@@ -749,9 +1051,16 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         {
             msg_Err( p_filter,
                      "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
+            free( p_key );
             goto error;
         }
 
+        if( p_key )
+        {
+            CacheShape( &p_sys->shape_cache, p_key, i_key_size, p_run );
+            free( p_key );
+        }
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -815,8 +1124,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_cached_shape );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -830,6 +1142,7 @@ error:
             hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
         if( p_paragraph->p_runs[ i ].p_buffer )
             hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_cached_shape );
     }
 
     if( p_new_paragraph )
@@ -929,6 +1242,35 @@ static int ZeroNsmAdvance( paragraph_t *p_paragraph )
 #endif
 #endif
 
+/**
+ * Stores copies of the loaded outlines of a glyph, so that loading, style
+ * emulation and stroking can be skipped the next time it is needed.
+ */
+static void CacheGlyphSource( lru_cache_t *p_cache,
+                              const glyph_cache_key_t *p_key,
+                              const glyph_bitmaps_t *p_bitmaps,
+                              const FT_Vector *p_advance )
+{
+    cached_glyph_t *p_cached = calloc( 1, sizeof( *p_cached ) );
+    if( !p_cached )
+        return;
+
+    if( FT_Glyph_Copy( p_bitmaps->p_glyph, &p_cached->p_glyph )
+     || ( p_bitmaps->p_outline
+       && FT_Glyph_Copy( p_bitmaps->p_outline, &p_cached->p_outline ) ) )
+    {
+        FreeCachedGlyph( p_cached, NULL );
+        return;
+    }
+    p_cached->i_x_advance = p_advance->x;
+    p_cached->i_y_advance = p_advance->y;
+
+    if( LRUCachePut( p_cache, p_key, sizeof( *p_key ), p_cached,
+                     sizeof( *p_cached ) + GlyphCost( p_cached->p_glyph )
+                                         + GlyphCost( p_cached->p_outline ) ) )
+        FreeCachedGlyph( p_cached, NULL );
+}
+
 /**
  * Load the glyphs of a paragraph. When shaping with HarfBuzz the glyph indices
  * have already been determined at this point, as well as the advance values.
@@ -971,18 +1313,31 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
         }
 
+        glyph_cache_key_t key;
+        memset( &key, 0, sizeof( key ) ); /* the padding is hashed too */
+        key.p_face = p_face;
+        key.i_x_scale = p_face->size->metrics.x_scale;
+        key.i_y_scale = p_face->size->metrics.y_scale;
+        key.i_kind = GLYPH_CACHE_SOURCE;
+        key.b_emboldened = ( p_style->i_style_flags & STYLE_BOLD )
+                        && !( p_face->style_flags & FT_STYLE_FLAG_BOLD );
+        key.b_obliqued = ( p_style->i_style_flags & STYLE_ITALIC )
+                      && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC );
+        key.i_stroke_radius = i_radius;
+
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
         {
             int i_glyph_index;
@@ -1001,6 +1356,7 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         p_bitmaps->p_shadow = 0; \
         p_bitmaps->i_x_advance = 0; \
         p_bitmaps->i_y_advance = 0; \
+        p_bitmaps->cache_key.p_face = NULL; \
         continue; \
     }
 
@@ -1033,39 +1389,63 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            key.i_glyph_index = i_glyph_index;
+            p_bitmaps->cache_key = key;
+
+            FT_Vector advance;
+            cached_glyph_t *p_cached = NULL;
+            if( LRUCacheEnabled( &p_sys->glyph_cache ) )
+                p_cached = LRUCacheGet( &p_sys->glyph_cache, &key, sizeof( key ) );
+            if( p_cached )
+            {
+                p_bitmaps->p_outline = 0;
+                if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
+                if( p_cached->p_outline
+                 && FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+                    p_bitmaps->p_outline = 0;
+                advance.x = p_cached->i_x_advance;
+                advance.y = p_cached->i_y_advance;
+            }
+            else
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+                if( key.b_emboldened )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( key.b_obliqued )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-#undef SKIP_GLYPH
+                if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_Stroke( &p_bitmaps->p_outline,
+                                          p_filter->p_sys->p_stroker, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
+                advance = p_face->glyph->advance;
 
-            if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_Stroke( &p_bitmaps->p_outline,
-                                      p_filter->p_sys->p_stroker, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                if( LRUCacheEnabled( &p_sys->glyph_cache ) )
+                    CacheGlyphSource( &p_sys->glyph_cache, &key, p_bitmaps,
+                                      &advance );
             }
 
+#undef SKIP_GLYPH
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1170,8 +1550,10 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->cache_key,
+                             p_bitmaps->p_outline ? GLYPH_CACHE_OUTLINE
+                                                  : GLYPH_CACHE_GLYPH,
+                             &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1179,8 +1561,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->cache_key, GLYPH_CACHE_GLYPH,
+                             &p_bitmaps->p_glyph, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1196,8 +1578,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, &p_bitmaps->cache_key, GLYPH_CACHE_OUTLINE,
+                             &p_bitmaps->p_outline, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
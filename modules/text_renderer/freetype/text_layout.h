@@ -60,6 +60,10 @@ struct line_desc_t
     FT_BBox          bbox;
 };
 
+int  InitLayoutCaches( filter_t *p_filter );
+void UpdateLayoutCachesStats( filter_t *p_filter );
+void CleanLayoutCaches( filter_t *p_filter );
+
 void FreeLines( line_desc_t *p_lines );
 line_desc_t *NewLine( int i_count );
 
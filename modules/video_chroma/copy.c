@@ -36,6 +36,15 @@
 #include <assert.h>
 
 #include "copy.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(__GNUC__)
+# define COPY_AVX2 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define COPY_NEON 1
+# include <arm_neon.h>
+#endif
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift);
@@ -52,27 +61,243 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
 #define ASSERT_3PLANES ASSERT_2PLANES; \
     ASSERT_PLANE(2)
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
+/* Wide pictures are split in bands of at least COPY_BAND_MIN_LINES luma
+ * lines, copied by the calling thread and up to COPY_MAX_THREADS workers,
+ * each with its own cache. A single thread cannot saturate the memory
+ * bandwidth when copying from uncached surfaces. */
+#define COPY_PARALLEL_MIN_WIDTH 3840 /* bytes */
+#define COPY_BAND_MIN_LINES 128
+#define COPY_MAX_THREADS 3
+
+typedef void (*copy_band_t)(picture_t *dst, const uint8_t *src[static 3],
+                            const size_t src_pitch[static 3], unsigned height,
+                            int bitshift, const copy_cache_t *cache);
+
+struct copy_job
+{
+    copy_band_t     copy;
+    picture_t      *dst;
+    const uint8_t **src;
+    const size_t   *src_pitch;
+    unsigned        src_planes;
+    unsigned        height;
+    unsigned        band_height;
+    int             bitshift;
+};
+
+struct copy_worker
+{
+    copy_pool_t  *pool;
+    vlc_thread_t  thread;
+    copy_cache_t  cache;
+};
+
+struct copy_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    vlc_cond_t  done;
+
+    const struct copy_job *job;
+    unsigned    bands;
+    unsigned    next;
+    unsigned    pending;
+    bool        closing;
+
+    unsigned    count;
+    struct copy_worker workers[];
+};
+
+static void CopyBand(const struct copy_job *job, unsigned band,
+                     const copy_cache_t *cache)
+{
+    const unsigned y = band * job->band_height;
+    const unsigned height = __MIN(job->band_height, job->height - y);
+    const uint8_t *src[3] = { NULL, NULL, NULL };
+    size_t src_pitch[3] = { 0, 0, 0 };
+
+    /* All the multi-planar formats are 4:2:0 */
+    for (unsigned n = 0; n < job->src_planes; n++) {
+        const unsigned lines = n > 0 ? y / 2 : y;
+        src[n] = job->src[n] + lines * job->src_pitch[n];
+        src_pitch[n] = job->src_pitch[n];
+    }
+
+    picture_t dst = *job->dst;
+    for (int n = 0; n < dst.i_planes; n++) {
+        const unsigned lines = n > 0 ? y / 2 : y;
+        dst.p[n].p_pixels += lines * dst.p[n].i_pitch;
+    }
+
+    job->copy(&dst, src, src_pitch, height, job->bitshift, cache);
+}
+
+static void *CopyWorker(void *data)
+{
+    struct copy_worker *worker = data;
+    copy_pool_t *pool = worker->pool;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->closing && pool->next >= pool->bands)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->closing)
+            break;
+
+        const unsigned band = pool->next++;
+        vlc_mutex_unlock(&pool->lock);
+
+        CopyBand(pool->job, band, &worker->cache);
+
+        vlc_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            vlc_cond_signal(&pool->done);
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* Returns false if the picture is too small to be worth splitting, in which
+ * case the caller copies it itself. */
+static bool CopyParallel(const copy_cache_t *cache, copy_band_t copy,
+                         picture_t *dst, const uint8_t *src[],
+                         const size_t src_pitch[], unsigned src_planes,
+                         unsigned height, int bitshift)
+{
+    copy_pool_t *pool = cache->pool;
+    if (pool == NULL)
+        return false;
+
+    unsigned bands = __MIN(pool->count + 1, height / COPY_BAND_MIN_LINES);
+    if (bands < 2)
+        return false;
+
+    /* Keep the bands on even lines, for the chroma planes */
+    const unsigned band_height = ((height + bands - 1) / bands + 1) & ~1u;
+    const struct copy_job job = {
+        .copy = copy, .dst = dst, .src = src, .src_pitch = src_pitch,
+        .src_planes = src_planes, .height = height,
+        .band_height = band_height, .bitshift = bitshift,
+    };
+    bands = (height + band_height - 1) / band_height;
+
+    /* The bands copied by this thread must not be split again */
+    copy_cache_t local = *cache;
+    local.pool = NULL;
+
+    vlc_mutex_lock(&pool->lock);
+    pool->job = &job;
+    pool->bands = bands;
+    pool->next = 0;
+    pool->pending = bands;
+    vlc_cond_broadcast(&pool->wait);
+
+    while (pool->next < pool->bands) {
+        const unsigned band = pool->next++;
+        vlc_mutex_unlock(&pool->lock);
+
+        CopyBand(&job, band, &local);
+
+        vlc_mutex_lock(&pool->lock);
+        pool->pending--;
+    }
+    while (pool->pending > 0)
+        vlc_cond_wait(&pool->done, &pool->lock);
+
+    pool->job = NULL;
+    pool->bands = 0;
+    vlc_mutex_unlock(&pool->lock);
+    return true;
+}
+
+static void CopyPoolDelete(copy_pool_t *pool)
+{
+    vlc_mutex_lock(&pool->lock);
+    pool->closing = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->count; i++) {
+        vlc_join(pool->workers[i].thread, NULL);
+        CopyCleanCache(&pool->workers[i].cache);
+    }
+
+    vlc_cond_destroy(&pool->done);
+    vlc_cond_destroy(&pool->wait);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static copy_pool_t *CopyPoolNew(unsigned width, unsigned threads)
+{
+    copy_pool_t *pool = malloc(sizeof (*pool)
+                               + threads * sizeof (pool->workers[0]));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->job = NULL;
+    pool->bands = 0;
+    pool->next = 0;
+    pool->pending = 0;
+    pool->closing = false;
+    pool->count = 0;
+
+    while (pool->count < threads) {
+        struct copy_worker *worker = &pool->workers[pool->count];
+
+        worker->pool = pool;
+        if (CopyInitCacheThreads(&worker->cache, width, 0))
+            break;
+        if (vlc_clone(&worker->thread, CopyWorker, worker,
+                      VLC_THREAD_PRIORITY_VIDEO)) {
+            CopyCleanCache(&worker->cache);
+            break;
+        }
+        pool->count++;
+    }
+
+    if (pool->count == 0) {
+        CopyPoolDelete(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+int CopyInitCacheThreads(copy_cache_t *cache, unsigned width, unsigned threads)
 {
 #ifdef CAN_COMPILE_SSE2
     cache->size = __MAX((width + 0x3f) & ~ 0x3f, 16384);
     cache->buffer = aligned_alloc(64, cache->size);
     if (!cache->buffer)
         return VLC_EGENERIC;
-#else
-    (void) cache; (void) width;
 #endif
+    /* Not fatal: the pictures are then copied by the calling thread */
+    cache->pool = threads > 0 ? CopyPoolNew(width, threads) : NULL;
     return VLC_SUCCESS;
 }
 
+int CopyInitCache(copy_cache_t *cache, unsigned width)
+{
+    unsigned threads = 0;
+
+    if (width >= COPY_PARALLEL_MIN_WIDTH)
+        threads = __MIN(vlc_GetCPUCount(), COPY_MAX_THREADS + 1) - 1;
+    return CopyInitCacheThreads(cache, width, threads);
+}
+
 void CopyCleanCache(copy_cache_t *cache)
 {
+    if (cache->pool != NULL) {
+        CopyPoolDelete(cache->pool);
+        cache->pool = NULL;
+    }
 #ifdef CAN_COMPILE_SSE2
     aligned_free(cache->buffer);
     cache->buffer = NULL;
     cache->size   = 0;
-#else
-    (void) cache;
 #endif
 }
 
@@ -461,6 +686,107 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
 #undef LOAD64
 }
 
+#ifdef COPY_AVX2
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+/* vpshufb and vpunpck* work within 128-bits lanes: the lanes are reordered
+ * with vpermq and vperm2i128. */
+VLC_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height,
+                              uint8_t pixel_size)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x < (width & ~31); x += 32) {
+            const __m256i u = _mm256_loadu_si256((const __m256i *)&srcu[x]);
+            const __m256i v = _mm256_loadu_si256((const __m256i *)&srcv[x]);
+            __m256i lo, hi;
+
+            if (pixel_size == 1) {
+                lo = _mm256_unpacklo_epi8(u, v);
+                hi = _mm256_unpackhi_epi8(u, v);
+            } else {
+                lo = _mm256_unpacklo_epi16(u, v);
+                hi = _mm256_unpackhi_epi16(u, v);
+            }
+            _mm256_storeu_si256((__m256i *)&dst[2*x],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2*x+32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        if (pixel_size == 1) {
+            for (; x < width; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        } else {
+            for (; x < width; x += 2) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcu[x + 1];
+                dst[2*x+2] = srcv[x];
+                dst[2*x+3] = srcv[x + 1];
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height, uint8_t pixel_size)
+{
+    static const uint8_t shuffle_8[] = { 0, 2, 4, 6, 8, 10, 12, 14,
+                                         1, 3, 5, 7, 9, 11, 13, 15 };
+    static const uint8_t shuffle_16[] = {  0,  1,  4,  5,  8,  9, 12, 13,
+                                           2,  3,  6,  7, 10, 11, 14, 15 };
+    const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+            (const __m128i *)(pixel_size == 1 ? shuffle_8 : shuffle_16)));
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x < (width & ~31); x += 32) {
+            /* Each lane holds its U then its V samples */
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[2*x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[2*x+32]);
+
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xd8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xd8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        if (pixel_size == 1) {
+            for (; x < width; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        } else {
+            for (; x < width; x += 2) {
+                dstu[x] = src[2*x+0];
+                dstu[x+1] = src[2*x+1];
+                dstv[x] = src[2*x+2];
+                dstv[x+1] = src[2*x+3];
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+#endif /* COPY_AVX2 */
+
 static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           const uint8_t *src, size_t src_pitch,
                           uint8_t *cache, size_t cache_size,
@@ -516,6 +842,13 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
                      cachev_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
+#ifdef COPY_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_InterleaveUV(dst, dst_pitch, cache, w16,
+                              cache + w16 * hblock, w16,
+                              copy_pitch, hblock, pixel_size);
+        else
+#endif
         SSE_InterleaveUV(dst, dst_pitch, cache, w16,
                          cache + w16 * hblock, w16,
                          copy_pitch, hblock, pixel_size);
@@ -546,6 +879,12 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
         CopyFromUswc(cache, w16, src, src_pitch, cache_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
+#ifdef COPY_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                         cache, w16, copy_pitch, hblock, pixel_size);
+        else
+#endif
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
                     cache, w16, copy_pitch, hblock, pixel_size);
 
@@ -645,6 +984,39 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
     }
 }
 
+/* Adapters running the copy functions on a band of lines */
+#define COPY_BAND(name) \
+static void name##_Band(picture_t *dst, const uint8_t *src[static 3], \
+                        const size_t src_pitch[static 3], unsigned height, \
+                        int bitshift, const copy_cache_t *cache) \
+{ \
+    (void) bitshift; \
+    name(dst, src, src_pitch, height, cache); \
+}
+
+#define COPY_BAND16(name) \
+static void name##_Band(picture_t *dst, const uint8_t *src[static 3], \
+                        const size_t src_pitch[static 3], unsigned height, \
+                        int bitshift, const copy_cache_t *cache) \
+{ \
+    name(dst, src, src_pitch, height, bitshift, cache); \
+}
+
+static void CopyPacked_Band(picture_t *dst, const uint8_t *src[static 3],
+                            const size_t src_pitch[static 3], unsigned height,
+                            int bitshift, const copy_cache_t *cache)
+{
+    (void) bitshift;
+    CopyPacked(dst, src[0], src_pitch[0], height, cache);
+}
+
+COPY_BAND(Copy420_SP_to_SP)
+COPY_BAND(Copy420_SP_to_P)
+COPY_BAND16(Copy420_16_SP_to_P)
+COPY_BAND(Copy420_P_to_SP)
+COPY_BAND16(Copy420_16_P_to_SP)
+COPY_BAND(Copy420_P_to_P)
+
 void CopyPacked(picture_t *dst, const uint8_t *src, const size_t src_pitch,
                 unsigned height, const copy_cache_t *cache)
 {
@@ -652,6 +1024,10 @@ void CopyPacked(picture_t *dst, const uint8_t *src, const size_t src_pitch,
     assert(src); assert(src_pitch);
     assert(height);
 
+    if (CopyParallel(cache, CopyPacked_Band, dst, &src, &src_pitch, 1,
+                     height, 0))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE4_1())
         return SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch, src, src_pitch,
@@ -668,6 +1044,10 @@ void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
                       const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    if (CopyParallel(cache, Copy420_SP_to_SP_Band, dst, src, src_pitch, 2,
+                     height, 0))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_SP(dst, src, src_pitch, height, cache);
@@ -740,11 +1120,119 @@ static void SplitPlanes16(uint8_t *dstu, size_t dstu_pitch,
         SPLIT_PLANES_SHIFTL(uint16_t, 4, (-bitshift) & 0xf);
 }
 
+#ifdef COPY_NEON
+static bool NEON_Available(void)
+{
+# ifdef __aarch64__
+    return vlc_CPU_ARM64_NEON();
+# else
+    return vlc_CPU_ARM_NEON();
+# endif
+}
+
+static inline uint16_t Shift16(uint16_t v, int bitshift)
+{
+    return bitshift >= 0 ? v >> bitshift : v << -bitshift;
+}
+
+/* A positive bitshift value shifts 16 bits samples to the right. The pitches
+ * and copy_pitch are in bytes. */
+static void NEON_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
+                             uint8_t *dstv, size_t dstv_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned height, uint8_t pixel_size, int bitshift)
+{
+    const size_t copy_pitch = __MIN(__MIN(src_pitch / 2, dstu_pitch), dstv_pitch);
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1) {
+            for (; x + 16 <= copy_pitch; x += 16) {
+                const uint8x16x2_t uv = vld2q_u8(&src[2*x]);
+                vst1q_u8(&dstu[x], uv.val[0]);
+                vst1q_u8(&dstv[x], uv.val[1]);
+            }
+            for (; x < copy_pitch; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        } else {
+            const uint16_t *src16 = (const uint16_t *)src;
+            uint16_t *dstu16 = (uint16_t *)dstu, *dstv16 = (uint16_t *)dstv;
+
+            for (; x + 8 <= copy_pitch / 2; x += 8) {
+                const uint16x8x2_t uv = vld2q_u16(&src16[2*x]);
+                vst1q_u16(&dstu16[x], vshlq_u16(uv.val[0], shift));
+                vst1q_u16(&dstv16[x], vshlq_u16(uv.val[1], shift));
+            }
+            for (; x < copy_pitch / 2; x++) {
+                dstu16[x] = Shift16(src16[2*x+0], bitshift);
+                dstv16[x] = Shift16(src16[2*x+1], bitshift);
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+
+static void NEON_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
+                                  const uint8_t *srcu, size_t srcu_pitch,
+                                  const uint8_t *srcv, size_t srcv_pitch,
+                                  unsigned height, uint8_t pixel_size,
+                                  int bitshift)
+{
+    const size_t copy_pitch = __MIN(__MIN(dst_pitch / 2, srcu_pitch), srcv_pitch);
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1) {
+            for (; x + 16 <= copy_pitch; x += 16) {
+                uint8x16x2_t uv;
+                uv.val[0] = vld1q_u8(&srcu[x]);
+                uv.val[1] = vld1q_u8(&srcv[x]);
+                vst2q_u8(&dst[2*x], uv);
+            }
+            for (; x < copy_pitch; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        } else {
+            const uint16_t *srcu16 = (const uint16_t *)srcu;
+            const uint16_t *srcv16 = (const uint16_t *)srcv;
+            uint16_t *dst16 = (uint16_t *)dst;
+
+            for (; x + 8 <= copy_pitch / 2; x += 8) {
+                uint16x8x2_t uv;
+                uv.val[0] = vshlq_u16(vld1q_u16(&srcu16[x]), shift);
+                uv.val[1] = vshlq_u16(vld1q_u16(&srcv16[x]), shift);
+                vst2q_u16(&dst16[2*x], uv);
+            }
+            for (; x < copy_pitch / 2; x++) {
+                dst16[2*x+0] = Shift16(srcu16[x], bitshift);
+                dst16[2*x+1] = Shift16(srcv16[x], bitshift);
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst  += dst_pitch;
+    }
+}
+#endif /* COPY_NEON */
+
 void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
                      const size_t src_pitch[static 2], unsigned height,
                      const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    if (CopyParallel(cache, Copy420_SP_to_P_Band, dst, src, src_pitch, 2,
+                     height, 0))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 1, 0, cache);
@@ -754,6 +1242,12 @@ void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, 0);
+#ifdef COPY_NEON
+    if (NEON_Available())
+        return NEON_SplitPlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                                dst->p[2].p_pixels, dst->p[2].i_pitch,
+                                src[1], src_pitch[1], (height+1)/2, 1, 0);
+#endif
     SplitPlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
                 dst->p[2].p_pixels, dst->p[2].i_pitch,
                 src[1], src_pitch[1], (height+1)/2);
@@ -765,6 +1259,9 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 {
     ASSERT_2PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    if (CopyParallel(cache, Copy420_16_SP_to_P_Band, dst, src, src_pitch, 2,
+                     height, bitshift))
+        return;
 
 #ifdef CAN_COMPILE_SSE3
     if (vlc_CPU_SSSE3())
@@ -775,6 +1272,13 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, bitshift);
+#ifdef COPY_NEON
+    if (NEON_Available())
+        return NEON_SplitPlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                                dst->p[2].p_pixels, dst->p[2].i_pitch,
+                                src[1], src_pitch[1], (height+1)/2, 2,
+                                bitshift);
+#endif
     SplitPlanes16(dst->p[1].p_pixels, dst->p[1].i_pitch,
                   dst->p[2].p_pixels, dst->p[2].i_pitch,
                   src[1], src_pitch[1], (height+1)/2, bitshift);
@@ -821,6 +1325,10 @@ void Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
                      const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    if (CopyParallel(cache, Copy420_P_to_SP_Band, dst, src, src_pitch, 3,
+                     height, 0))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 1, 0, cache);
@@ -830,6 +1338,13 @@ void Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, 0);
+#ifdef COPY_NEON
+    if (NEON_Available())
+        return NEON_InterleavePlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                                     src[U_PLANE], src_pitch[U_PLANE],
+                                     src[V_PLANE], src_pitch[V_PLANE],
+                                     (height+1)/2, 1, 0);
+#endif
 
     const unsigned copy_lines = (height+1) / 2;
     const unsigned copy_pitch = __MIN(src_pitch[1], dst->p[1].i_pitch / 2);
@@ -850,6 +1365,10 @@ void Copy420_16_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 {
     ASSERT_3PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    if (CopyParallel(cache, Copy420_16_P_to_SP_Band, dst, src, src_pitch, 3,
+                     height, bitshift))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSSE3())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 2, bitshift, cache);
@@ -859,6 +1378,13 @@ void Copy420_16_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, bitshift);
+#ifdef COPY_NEON
+    if (NEON_Available())
+        return NEON_InterleavePlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                                     src[U_PLANE], src_pitch[U_PLANE],
+                                     src[V_PLANE], src_pitch[V_PLANE],
+                                     (height+1)/2, 2, bitshift);
+#endif
 
     const unsigned copy_lines = (height+1) / 2;
     const unsigned copy_pitch = src_pitch[1] / 2;
@@ -925,6 +1451,10 @@ void Copy420_P_to_P(picture_t *dst, const uint8_t *src[static 3],
                     const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    if (CopyParallel(cache, Copy420_P_to_P_Band, dst, src, src_pitch, 3,
+                     height, 0))
+        return;
+
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_P_to_P(dst, src, src_pitch, height, cache);
@@ -1158,6 +1688,63 @@ static picture_t *pic_new_unaligned(const video_format_t *fmt)
     return picture_NewFromResource(fmt, &rsc);
 }
 
+/* Reports the bandwidth (bytes read and written per second) of the 4K
+ * copies, from the calling thread only and with the worker threads */
+static void bench(const struct test_conv *conv, const struct test_dst *test_dst)
+{
+    video_format_t fmt;
+    video_format_Init(&fmt, 0);
+    video_format_Setup(&fmt, conv->src_chroma, 3840, 2160, 3840, 2160, 1, 1);
+
+    const vlc_chroma_description_t *src_dsc =
+        vlc_fourcc_GetChromaDescription(conv->src_chroma);
+    picture_t *src = picture_NewFromFormat(&fmt);
+    assert(src);
+    piccheck(src, src_dsc, true);
+    fmt.i_chroma = test_dst->chroma;
+    picture_t *dst = picture_NewFromFormat(&fmt);
+    assert(dst);
+
+    const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                      src->p[U_PLANE].p_pixels,
+                                      src->p[V_PLANE].p_pixels };
+    const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                       src->p[U_PLANE].i_pitch,
+                                       src->p[V_PLANE].i_pitch };
+    const double bytes = 2. * 3840 * 2160 * 3 / 2 * src_dsc->pixel_size;
+
+    for (unsigned threads = 0; threads <= COPY_MAX_THREADS;
+         threads += COPY_MAX_THREADS)
+    {
+        copy_cache_t cache;
+        int ret = CopyInitCacheThreads(&cache, 3840 * src_dsc->pixel_size,
+                                       threads);
+        assert(ret == VLC_SUCCESS);
+
+        const unsigned count = 16;
+        vlc_tick_t start = mdate();
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (test_dst->bitshift == 0)
+                test_dst->conv(dst, src_planes, src_pitches, 2160, &cache);
+            else
+                test_dst->conv16(dst, src_planes, src_pitches, 2160,
+                                 test_dst->bitshift, &cache);
+        }
+        vlc_tick_t duration = mdate() - start;
+
+        fprintf(stderr, "bandwidth: 3840 x 2160 %4.4s -> %4.4s, %u threads: "
+                "%.2f GB/s\n", (const char *) &conv->src_chroma,
+                (const char *) &test_dst->chroma,
+                cache.pool != NULL ? cache.pool->count + 1 : 1,
+                bytes * count / duration / 1000.);
+        CopyCleanCache(&cache);
+    }
+    piccheck(dst, vlc_fourcc_GetChromaDescription(test_dst->chroma), false);
+    picture_Release(dst);
+    picture_Release(src);
+}
+
 int main(void)
 {
     alarm(10);
@@ -1170,6 +1757,8 @@ int main(void)
     }
 #endif
 
+    for (unsigned threads = 0; threads <= COPY_MAX_THREADS;
+         threads += COPY_MAX_THREADS)
     for (size_t i = 0; i < NB_CONVS; ++i)
     {
         const struct test_conv *conv = &convs[i];
@@ -1193,8 +1782,8 @@ int main(void)
             piccheck(src, src_dsc, true);
 
             copy_cache_t cache;
-            int ret = CopyInitCache(&cache, src->format.i_width
-                                    * src_dsc->pixel_size);
+            int ret = CopyInitCacheThreads(&cache, src->format.i_width
+                                           * src_dsc->pixel_size, threads);
             assert(ret == VLC_SUCCESS);
 
             for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
@@ -1215,11 +1804,12 @@ int main(void)
                                                    src->p[U_PLANE].i_pitch,
                                                    src->p[V_PLANE].i_pitch };
 
-                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
+                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s, "
+                        "%u threads\n",
                         size->i_width, size->i_height,
                         size->i_visible_width, size->i_visible_height,
                         (const char *) &src->format.i_chroma,
-                        (const char *) &dst->format.i_chroma);
+                        (const char *) &dst->format.i_chroma, threads);
                 if (test_dst->bitshift == 0)
                     test_dst->conv(dst, src_planes, src_pitches,
                                    src->format.i_visible_height, &cache);
@@ -1234,6 +1824,9 @@ int main(void)
             CopyCleanCache(&cache);
         }
     }
+
+    bench(&convs[0], &convs[0].dsts[0]);
+    bench(&convs[2], &convs[2].dsts[0]);
     return 0;
 }
 
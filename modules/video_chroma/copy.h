@@ -26,14 +26,23 @@
 
 #include <assert.h>
 
+typedef struct copy_pool copy_pool_t;
+
 typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
 # endif
+    copy_pool_t *pool;
 } copy_cache_t;
 
+/* Initialize a cache for lines of up to width bytes. Wide pictures are split
+ * in bands of lines copied concurrently by a few worker threads. */
 int  CopyInitCache(copy_cache_t *cache, unsigned width);
+/* Same as CopyInitCache() with an explicit number of worker threads, 0 to
+ * only copy from the calling thread. */
+int  CopyInitCacheThreads(copy_cache_t *cache, unsigned width,
+                          unsigned threads);
 void CopyCleanCache(copy_cache_t *cache);
 
 /* YUVY/RGB copies */
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ * yuv_rgb.c: SIMD YUV 4:2:0 to 32 bits RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#include "yuv_rgb_simd.h"
+
+#define MATRIX_TEXT N_("Conversion matrix")
+#define MATRIX_LONGTEXT N_( \
+    "YUV to RGB matrix. By default, the color space of the video is used, " \
+    "or BT.709 for HD and BT.601 for SD if it is not specified.")
+
+static const char *const matrix_values[] = { "auto", "bt601", "bt709", "bt2020" };
+static const char *const matrix_texts[] = {
+    N_("Automatic"), "BT.601", "BT.709", "BT.2020" };
+
+static int  Open (vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin ()
+    set_description(N_("SIMD YUV to RGB conversions"))
+    set_shortname(N_("YUV to RGB"))
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    set_capability("video converter", 200)
+    add_string("yuvrgb-matrix", "auto", MATRIX_TEXT, MATRIX_LONGTEXT, true)
+        change_string_list(matrix_values, matrix_texts)
+    set_callbacks(Open, Close)
+vlc_module_end ()
+
+struct filter_sys_t
+{
+    yuv_rgb_row_t   row;
+    yuv_rgb_coefs_t coefs;
+    bool            semiplanar;
+    bool            swap_planes;
+};
+
+static void Convert(filter_t *filter, picture_t *src, picture_t *dst)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned width  = filter->fmt_in.video.i_visible_width;
+    const unsigned height = filter->fmt_in.video.i_visible_height;
+    const plane_t *c0 = &src->p[sys->swap_planes ? 2 : 1];
+    const plane_t *c1 = &src->p[sys->swap_planes ? 1 : 2];
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *luma = &src->p[0].p_pixels[y * src->p[0].i_pitch];
+        const uint8_t *p0 = &c0->p_pixels[(y / 2) * c0->i_pitch];
+        const uint8_t *p1 = sys->semiplanar
+                          ? NULL : &c1->p_pixels[(y / 2) * c1->i_pitch];
+
+        sys->row(&dst->p[0].p_pixels[y * dst->p[0].i_pitch],
+                 luma, p0, p1, width, &sys->coefs);
+    }
+}
+
+VIDEO_FILTER_WRAPPER(Convert)
+
+/* Returns whether the 32 bits output keeps R, G and B in the first three
+ * bytes, and in which order */
+static int GetOutputOrder(const video_format_t *fmt, bool *bgr)
+{
+    switch (fmt->i_chroma)
+    {
+        case VLC_CODEC_RGBA:
+            *bgr = false;
+            return VLC_SUCCESS;
+        case VLC_CODEC_BGRA:
+            *bgr = true;
+            return VLC_SUCCESS;
+        case VLC_CODEC_RGB32:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    video_format_t rgb = *fmt;
+    video_format_FixRgb(&rgb);
+
+#ifdef WORDS_BIGENDIAN
+    if (rgb.i_rmask == 0xff000000 && rgb.i_gmask == 0x00ff0000
+     && rgb.i_bmask == 0x0000ff00)
+        *bgr = false;
+    else if (rgb.i_rmask == 0x0000ff00 && rgb.i_gmask == 0x00ff0000
+          && rgb.i_bmask == 0xff000000)
+        *bgr = true;
+#else
+    if (rgb.i_rmask == 0x000000ff && rgb.i_gmask == 0x0000ff00
+     && rgb.i_bmask == 0x00ff0000)
+        *bgr = false;
+    else if (rgb.i_rmask == 0x00ff0000 && rgb.i_gmask == 0x0000ff00
+          && rgb.i_bmask == 0x000000ff)
+        *bgr = true;
+#endif
+    else
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+
+    if (in->i_visible_width != out->i_visible_width
+     || in->i_visible_height != out->i_visible_height
+     || in->orientation != out->orientation)
+        return VLC_EGENERIC;
+
+    bool bgr;
+    if (GetOutputOrder(out, &bgr))
+        return VLC_EGENERIC;
+
+    const yuv_rgb_kernels_t *kernels = yuv_rgb_kernels_Get();
+    bool full_range = in->b_color_range_full;
+    bool semiplanar = false, swap_planes = false, swap_uv = false;
+    unsigned bits = 8, in_shift = 0;
+    yuv_rgb_row_t row;
+
+    switch (in->i_chroma)
+    {
+        case VLC_CODEC_J420:
+            full_range = true;
+            /* fall through */
+        case VLC_CODEC_I420:
+        case VLC_CODEC_YV12:
+            swap_planes = in->i_chroma == VLC_CODEC_YV12;
+            break;
+        case VLC_CODEC_NV21:
+            swap_uv = true;
+            /* fall through */
+        case VLC_CODEC_NV12:
+            semiplanar = true;
+            break;
+        case VLC_CODEC_I420_12L:
+            bits = 12;
+            break;
+        case VLC_CODEC_I420_10L:
+            bits = 10;
+            break;
+        case VLC_CODEC_P010:
+            bits = 10;
+            in_shift = 6;
+            semiplanar = true;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    if (bits == 8)
+    {
+        /* The i420_rgb and swscale plugins are faster than the C kernels */
+        if (kernels == NULL)
+            return VLC_EGENERIC;
+        row = semiplanar ? kernels->semiplanar8 : kernels->planar8;
+    }
+    else
+    {
+        if (kernels == NULL)
+            kernels = &yuv_rgb_kernels_c;
+        row = semiplanar ? kernels->semiplanar16 : kernels->planar16;
+    }
+
+    video_format_t fmt = *in;
+    video_format_AdjustColorSpace(&fmt);
+
+    char *matrix = var_InheritString(filter, "yuvrgb-matrix");
+    if (matrix != NULL)
+    {
+        if (!strcmp(matrix, "bt601"))
+            fmt.space = COLOR_SPACE_BT601;
+        else if (!strcmp(matrix, "bt709"))
+            fmt.space = COLOR_SPACE_BT709;
+        else if (!strcmp(matrix, "bt2020"))
+            fmt.space = COLOR_SPACE_BT2020;
+        free(matrix);
+    }
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->row = row;
+    sys->semiplanar = semiplanar;
+    sys->swap_planes = swap_planes;
+    yuv_rgb_SetupCoefs(&sys->coefs, fmt.space, full_range, bits, in_shift,
+                       swap_uv, bgr);
+
+    msg_Dbg(filter, "%4.4s to %4.4s, %s matrix, %s range, %s kernels",
+            (const char *)&in->i_chroma, (const char *)&out->i_chroma,
+            fmt.space == COLOR_SPACE_BT2020 ? "BT.2020" :
+            fmt.space == COLOR_SPACE_BT709 ? "BT.709" : "BT.601",
+            full_range ? "full" : "limited", kernels->name);
+
+    filter->p_sys = sys;
+    filter->pf_video_filter = Convert_Filter;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    free(filter->p_sys);
+}
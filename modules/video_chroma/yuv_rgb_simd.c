@@ -0,0 +1,840 @@
+/*****************************************************************************
+ * yuv_rgb_simd.c: YUV 4:2:0 to 32 bits RGB row kernels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef YUV_RGB_TEST
+# undef NDEBUG
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_cpu.h>
+
+#include "yuv_rgb_simd.h"
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define YUV_RGB_X86 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define YUV_RGB_NEON 1
+# include <arm_neon.h>
+#endif
+
+#define COEF_BITS 13
+
+void yuv_rgb_SetupCoefs(yuv_rgb_coefs_t *k, video_color_space_t space,
+                        bool full_range, unsigned bits, unsigned in_shift,
+                        bool swap_uv, bool bgr)
+{
+    double kr, kb;
+
+    switch (space)
+    {
+        case COLOR_SPACE_BT2020:
+            kr = .2627; kb = .0593;
+            break;
+        case COLOR_SPACE_BT709:
+            kr = .2126; kb = .0722;
+            break;
+        default:
+            kr = .299; kb = .114;
+            break;
+    }
+
+    const double kg = 1. - kr - kb;
+    const double ys = full_range ? 1. : 255. / 219.;
+    const double cs = full_range ? 1. : 255. / 224.;
+    const double scale = 1 << COEF_BITS;
+
+    /* (U, V) coefficients of R, G and B */
+    int16_t c[3][2] = {
+        { 0, lrint(scale * cs * 2. * (1. - kr)) },
+        { -lrint(scale * cs * 2. * (1. - kb) * kb / kg),
+          -lrint(scale * cs * 2. * (1. - kr) * kr / kg) },
+        { lrint(scale * cs * 2. * (1. - kb)), 0 },
+    };
+
+    k->y_offset = full_range ? 0 : 16 << (bits - 8);
+    k->c_offset = 128 << (bits - 8);
+    k->y_coef   = lrint(scale * ys);
+    k->shift    = COEF_BITS + bits - 8;
+    k->round    = 1 << (k->shift - 1);
+    k->in_shift = in_shift;
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        const unsigned ch = bgr ? 2 - i : i;
+        k->c_coef[i][0] = c[ch][swap_uv ? 1 : 0];
+        k->c_coef[i][1] = c[ch][swap_uv ? 0 : 1];
+    }
+}
+
+/*****************************************************************************
+ * C
+ *****************************************************************************/
+static inline uint8_t Clip8(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline void PixelC(uint8_t *d, int y, int c0, int c1,
+                          const yuv_rgb_coefs_t *k)
+{
+    const int l = k->y_coef * (y - k->y_offset) + k->round;
+    c0 -= k->c_offset;
+    c1 -= k->c_offset;
+
+    for (unsigned i = 0; i < 3; i++)
+        d[i] = Clip8((l + k->c_coef[i][0] * c0 + k->c_coef[i][1] * c1)
+                     >> k->shift);
+    d[3] = 0xff;
+}
+
+#define ROW_C(name, type, semiplanar) \
+static void name(uint8_t *dst, const void *py, const void *pc0, \
+                 const void *pc1, unsigned x, unsigned width, \
+                 const yuv_rgb_coefs_t *k) \
+{ \
+    const type *y = py, *c0 = pc0, *c1 = pc1; \
+    const unsigned s = k->in_shift; \
+    for (; x < width; x++) \
+    { \
+        const unsigned c = x >> 1; \
+        if (semiplanar) \
+            PixelC(&dst[4 * x], y[x] >> s, c0[2 * c] >> s, \
+                   c0[2 * c + 1] >> s, k); \
+        else \
+            PixelC(&dst[4 * x], y[x] >> s, c0[c] >> s, c1[c] >> s, k); \
+    } \
+}
+
+ROW_C(Planar8Tail, uint8_t, false)
+ROW_C(SemiPlanar8Tail, uint8_t, true)
+ROW_C(Planar16Tail, uint16_t, false)
+ROW_C(SemiPlanar16Tail, uint16_t, true)
+
+static void Planar8C(uint8_t *dst, const void *y, const void *c0,
+                     const void *c1, unsigned width, const yuv_rgb_coefs_t *k)
+{
+    Planar8Tail(dst, y, c0, c1, 0, width, k);
+}
+
+static void SemiPlanar8C(uint8_t *dst, const void *y, const void *c0,
+                         const void *c1, unsigned width,
+                         const yuv_rgb_coefs_t *k)
+{
+    SemiPlanar8Tail(dst, y, c0, c1, 0, width, k);
+}
+
+static void Planar16C(uint8_t *dst, const void *y, const void *c0,
+                      const void *c1, unsigned width, const yuv_rgb_coefs_t *k)
+{
+    Planar16Tail(dst, y, c0, c1, 0, width, k);
+}
+
+static void SemiPlanar16C(uint8_t *dst, const void *y, const void *c0,
+                          const void *c1, unsigned width,
+                          const yuv_rgb_coefs_t *k)
+{
+    SemiPlanar16Tail(dst, y, c0, c1, 0, width, k);
+}
+
+const yuv_rgb_kernels_t yuv_rgb_kernels_c = {
+    "C",
+    Planar8C,
+    SemiPlanar8C,
+    Planar16C,
+    SemiPlanar16C,
+};
+
+#ifdef YUV_RGB_X86
+/*****************************************************************************
+ * SSE2
+ *****************************************************************************/
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+
+typedef struct
+{
+    __m128i y_offset, c_offset, y_coef, round, c_coef[3];
+    __m128i shift, in_shift;
+} coefs_sse2_t;
+
+VLC_SSE2
+static inline void LoadCoefsSSE2(coefs_sse2_t *v, const yuv_rgb_coefs_t *k)
+{
+    v->y_offset = _mm_set1_epi16(k->y_offset);
+    v->c_offset = _mm_set1_epi16(k->c_offset);
+    v->y_coef   = _mm_set1_epi32((uint16_t)k->y_coef);
+    v->round    = _mm_set1_epi32(k->round);
+    for (unsigned i = 0; i < 3; i++)
+        v->c_coef[i] = _mm_set1_epi32((uint16_t)k->c_coef[i][0]
+                                      | ((uint32_t)k->c_coef[i][1] << 16));
+    v->shift    = _mm_cvtsi32_si128(k->shift);
+    v->in_shift = _mm_cvtsi32_si128(k->in_shift);
+}
+
+VLC_SSE2
+static inline __m128i ChannelSSE2(__m128i llo, __m128i lhi, __m128i clo,
+                                  __m128i chi, __m128i coef, __m128i shift)
+{
+    __m128i lo = _mm_add_epi32(llo, _mm_madd_epi16(clo, coef));
+    __m128i hi = _mm_add_epi32(lhi, _mm_madd_epi16(chi, coef));
+    lo = _mm_sra_epi32(lo, shift);
+    hi = _mm_sra_epi32(hi, shift);
+    return _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+}
+
+/* Converts 8 pixels from 8 luma samples and 4 (c0, c1) chroma pairs,
+ * all as 16 bits lanes */
+VLC_SSE2
+static inline void PixelsSSE2(uint8_t *dst, __m128i y, __m128i c,
+                              const coefs_sse2_t *v)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    y = _mm_sub_epi16(y, v->y_offset);
+    c = _mm_sub_epi16(c, v->c_offset);
+
+    __m128i llo = _mm_madd_epi16(_mm_unpacklo_epi16(y, zero), v->y_coef);
+    __m128i lhi = _mm_madd_epi16(_mm_unpackhi_epi16(y, zero), v->y_coef);
+    llo = _mm_add_epi32(llo, v->round);
+    lhi = _mm_add_epi32(lhi, v->round);
+
+    /* Each chroma pair is shared by two pixels */
+    __m128i clo = _mm_unpacklo_epi32(c, c);
+    __m128i chi = _mm_unpackhi_epi32(c, c);
+
+    __m128i b0 = ChannelSSE2(llo, lhi, clo, chi, v->c_coef[0], v->shift);
+    __m128i b1 = ChannelSSE2(llo, lhi, clo, chi, v->c_coef[1], v->shift);
+    __m128i b2 = ChannelSSE2(llo, lhi, clo, chi, v->c_coef[2], v->shift);
+
+    __m128i b01 = _mm_unpacklo_epi8(b0, b1);
+    __m128i b23 = _mm_unpacklo_epi8(b2, _mm_set1_epi8(-1));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(b01, b23));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(b01, b23));
+}
+
+VLC_SSE2
+static inline __m128i Load32SSE2(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof (v));
+    return _mm_cvtsi32_si128(v);
+}
+
+VLC_SSE2
+static void Planar8SSE2(uint8_t *dst, const void *py, const void *pc0,
+                        const void *pc1, unsigned width,
+                        const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c0 = pc0, *c1 = pc1;
+    const __m128i zero = _mm_setzero_si128();
+    coefs_sse2_t v;
+    unsigned x = 0;
+
+    LoadCoefsSSE2(&v, k);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i vy = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&y[x]), zero);
+        __m128i vc = _mm_unpacklo_epi8(
+            _mm_unpacklo_epi8(Load32SSE2(&c0[x / 2]), Load32SSE2(&c1[x / 2])),
+            zero);
+        PixelsSSE2(&dst[4 * x], vy, vc, &v);
+    }
+    Planar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_SSE2
+static void SemiPlanar8SSE2(uint8_t *dst, const void *py, const void *pc0,
+                            const void *pc1, unsigned width,
+                            const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c = pc0;
+    const __m128i zero = _mm_setzero_si128();
+    coefs_sse2_t v;
+    unsigned x = 0;
+
+    LoadCoefsSSE2(&v, k);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i vy = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&y[x]), zero);
+        __m128i vc = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&c[x]), zero);
+        PixelsSSE2(&dst[4 * x], vy, vc, &v);
+    }
+    SemiPlanar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_SSE2
+static void Planar16SSE2(uint8_t *dst, const void *py, const void *pc0,
+                         const void *pc1, unsigned width,
+                         const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c0 = pc0, *c1 = pc1;
+    coefs_sse2_t v;
+    unsigned x = 0;
+
+    LoadCoefsSSE2(&v, k);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i vy = _mm_loadu_si128((const __m128i *)&y[x]);
+        __m128i vc = _mm_unpacklo_epi16(
+            _mm_loadl_epi64((const __m128i *)&c0[x / 2]),
+            _mm_loadl_epi64((const __m128i *)&c1[x / 2]));
+        PixelsSSE2(&dst[4 * x], _mm_srl_epi16(vy, v.in_shift),
+                   _mm_srl_epi16(vc, v.in_shift), &v);
+    }
+    Planar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_SSE2
+static void SemiPlanar16SSE2(uint8_t *dst, const void *py, const void *pc0,
+                             const void *pc1, unsigned width,
+                             const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c = pc0;
+    coefs_sse2_t v;
+    unsigned x = 0;
+
+    LoadCoefsSSE2(&v, k);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i vy = _mm_loadu_si128((const __m128i *)&y[x]);
+        __m128i vc = _mm_loadu_si128((const __m128i *)&c[x]);
+        PixelsSSE2(&dst[4 * x], _mm_srl_epi16(vy, v.in_shift),
+                   _mm_srl_epi16(vc, v.in_shift), &v);
+    }
+    SemiPlanar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static const yuv_rgb_kernels_t kernels_sse2 = {
+    "SSE2",
+    Planar8SSE2,
+    SemiPlanar8SSE2,
+    Planar16SSE2,
+    SemiPlanar16SSE2,
+};
+
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+typedef struct
+{
+    __m256i y_offset, c_offset, y_coef, round, c_coef[3];
+    __m128i shift, in_shift;
+} coefs_avx2_t;
+
+VLC_AVX2
+static inline void LoadCoefsAVX2(coefs_avx2_t *v, const yuv_rgb_coefs_t *k)
+{
+    v->y_offset = _mm256_set1_epi16(k->y_offset);
+    v->c_offset = _mm256_set1_epi16(k->c_offset);
+    v->y_coef   = _mm256_set1_epi32((uint16_t)k->y_coef);
+    v->round    = _mm256_set1_epi32(k->round);
+    for (unsigned i = 0; i < 3; i++)
+        v->c_coef[i] = _mm256_set1_epi32((uint16_t)k->c_coef[i][0]
+                                         | ((uint32_t)k->c_coef[i][1] << 16));
+    v->shift    = _mm_cvtsi32_si128(k->shift);
+    v->in_shift = _mm_cvtsi32_si128(k->in_shift);
+}
+
+VLC_AVX2
+static inline __m256i ChannelAVX2(__m256i llo, __m256i lhi, __m256i clo,
+                                  __m256i chi, __m256i coef, __m128i shift)
+{
+    __m256i lo = _mm256_add_epi32(llo, _mm256_madd_epi16(clo, coef));
+    __m256i hi = _mm256_add_epi32(lhi, _mm256_madd_epi16(chi, coef));
+    lo = _mm256_sra_epi32(lo, shift);
+    hi = _mm256_sra_epi32(hi, shift);
+    return _mm256_packus_epi16(_mm256_packs_epi32(lo, hi),
+                               _mm256_setzero_si256());
+}
+
+/* Converts 16 pixels. The luma lanes hold pixels 0-7 then 8-15, the chroma
+ * lanes hold the pairs of pixels 0-7 then 8-15, so that all the unpacking
+ * stays within 128 bits lanes until the final stores. */
+VLC_AVX2
+static inline void PixelsAVX2(uint8_t *dst, __m256i y, __m256i c,
+                              const coefs_avx2_t *v)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    y = _mm256_sub_epi16(y, v->y_offset);
+    c = _mm256_sub_epi16(c, v->c_offset);
+
+    __m256i llo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y, zero), v->y_coef);
+    __m256i lhi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y, zero), v->y_coef);
+    llo = _mm256_add_epi32(llo, v->round);
+    lhi = _mm256_add_epi32(lhi, v->round);
+
+    __m256i clo = _mm256_unpacklo_epi32(c, c);
+    __m256i chi = _mm256_unpackhi_epi32(c, c);
+
+    __m256i b0 = ChannelAVX2(llo, lhi, clo, chi, v->c_coef[0], v->shift);
+    __m256i b1 = ChannelAVX2(llo, lhi, clo, chi, v->c_coef[1], v->shift);
+    __m256i b2 = ChannelAVX2(llo, lhi, clo, chi, v->c_coef[2], v->shift);
+
+    __m256i b01 = _mm256_unpacklo_epi8(b0, b1);
+    __m256i b23 = _mm256_unpacklo_epi8(b2, _mm256_set1_epi8(-1));
+    __m256i plo = _mm256_unpacklo_epi16(b01, b23); /* pixels 0-3, 8-11 */
+    __m256i phi = _mm256_unpackhi_epi16(b01, b23); /* pixels 4-7, 12-15 */
+    _mm256_storeu_si256((__m256i *)dst,
+                        _mm256_permute2x128_si256(plo, phi, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 32),
+                        _mm256_permute2x128_si256(plo, phi, 0x31));
+}
+
+VLC_AVX2
+static void Planar8AVX2(uint8_t *dst, const void *py, const void *pc0,
+                        const void *pc1, unsigned width,
+                        const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c0 = pc0, *c1 = pc1;
+    coefs_avx2_t v;
+    unsigned x = 0;
+
+    LoadCoefsAVX2(&v, k);
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i vy = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128((const __m128i *)&y[x]));
+        __m256i vc = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&c0[x / 2]),
+            _mm_loadl_epi64((const __m128i *)&c1[x / 2])));
+        PixelsAVX2(&dst[4 * x], vy, vc, &v);
+    }
+    Planar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_AVX2
+static void SemiPlanar8AVX2(uint8_t *dst, const void *py, const void *pc0,
+                            const void *pc1, unsigned width,
+                            const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c = pc0;
+    coefs_avx2_t v;
+    unsigned x = 0;
+
+    LoadCoefsAVX2(&v, k);
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i vy = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128((const __m128i *)&y[x]));
+        __m256i vc = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128((const __m128i *)&c[x]));
+        PixelsAVX2(&dst[4 * x], vy, vc, &v);
+    }
+    SemiPlanar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_AVX2
+static void Planar16AVX2(uint8_t *dst, const void *py, const void *pc0,
+                         const void *pc1, unsigned width,
+                         const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c0 = pc0, *c1 = pc1;
+    coefs_avx2_t v;
+    unsigned x = 0;
+
+    LoadCoefsAVX2(&v, k);
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i vy = _mm256_loadu_si256((const __m256i *)&y[x]);
+        __m128i u = _mm_loadu_si128((const __m128i *)&c0[x / 2]);
+        __m128i w = _mm_loadu_si128((const __m128i *)&c1[x / 2]);
+        __m256i vc = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_unpacklo_epi16(u, w)),
+            _mm_unpackhi_epi16(u, w), 1);
+        PixelsAVX2(&dst[4 * x], _mm256_srl_epi16(vy, v.in_shift),
+                   _mm256_srl_epi16(vc, v.in_shift), &v);
+    }
+    Planar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+VLC_AVX2
+static void SemiPlanar16AVX2(uint8_t *dst, const void *py, const void *pc0,
+                             const void *pc1, unsigned width,
+                             const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c = pc0;
+    coefs_avx2_t v;
+    unsigned x = 0;
+
+    LoadCoefsAVX2(&v, k);
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i vy = _mm256_loadu_si256((const __m256i *)&y[x]);
+        __m256i vc = _mm256_loadu_si256((const __m256i *)&c[x]);
+        PixelsAVX2(&dst[4 * x], _mm256_srl_epi16(vy, v.in_shift),
+                   _mm256_srl_epi16(vc, v.in_shift), &v);
+    }
+    SemiPlanar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static const yuv_rgb_kernels_t kernels_avx2 = {
+    "AVX2",
+    Planar8AVX2,
+    SemiPlanar8AVX2,
+    Planar16AVX2,
+    SemiPlanar16AVX2,
+};
+#endif /* YUV_RGB_X86 */
+
+#ifdef YUV_RGB_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+typedef struct
+{
+    int16x8_t y_offset, c_offset;
+    int32x4_t round, shift;
+    int16x8_t in_shift;
+    int16_t   y_coef, c_coef[3][2];
+} coefs_neon_t;
+
+static inline void LoadCoefsNEON(coefs_neon_t *v, const yuv_rgb_coefs_t *k)
+{
+    v->y_offset = vdupq_n_s16(k->y_offset);
+    v->c_offset = vdupq_n_s16(k->c_offset);
+    v->round    = vdupq_n_s32(k->round);
+    v->shift    = vdupq_n_s32(-(int)k->shift);
+    v->in_shift = vdupq_n_s16(-(int)k->in_shift);
+    v->y_coef   = k->y_coef;
+    memcpy(v->c_coef, k->c_coef, sizeof (v->c_coef));
+}
+
+static inline uint8x8_t ChannelNEON(int32x4_t llo, int32x4_t lhi,
+                                    int16x8_t c0, int16x8_t c1,
+                                    const int16_t coef[2], int32x4_t shift)
+{
+    int32x4_t lo = vmlal_n_s16(llo, vget_low_s16(c0), coef[0]);
+    int32x4_t hi = vmlal_n_s16(lhi, vget_high_s16(c0), coef[0]);
+    lo = vmlal_n_s16(lo, vget_low_s16(c1), coef[1]);
+    hi = vmlal_n_s16(hi, vget_high_s16(c1), coef[1]);
+    lo = vshlq_s32(lo, shift);
+    hi = vshlq_s32(hi, shift);
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+}
+
+/* Converts 8 pixels, the chroma samples being already duplicated */
+static inline void PixelsNEON(uint8_t *dst, int16x8_t y, int16x8_t c0,
+                              int16x8_t c1, const coefs_neon_t *v)
+{
+    y  = vsubq_s16(y, v->y_offset);
+    c0 = vsubq_s16(c0, v->c_offset);
+    c1 = vsubq_s16(c1, v->c_offset);
+
+    int32x4_t llo = vmlal_n_s16(v->round, vget_low_s16(y), v->y_coef);
+    int32x4_t lhi = vmlal_n_s16(v->round, vget_high_s16(y), v->y_coef);
+
+    uint8x8x4_t px;
+    for (unsigned i = 0; i < 3; i++)
+        px.val[i] = ChannelNEON(llo, lhi, c0, c1, v->c_coef[i], v->shift);
+    px.val[3] = vdup_n_u8(0xff);
+    vst4_u8(dst, px);
+}
+
+static inline void Pixels16NEON(uint8_t *dst, uint8x16_t y, uint8x8_t c0,
+                                uint8x8_t c1, const coefs_neon_t *v)
+{
+    int16x8x2_t u = vzipq_s16(vreinterpretq_s16_u16(vmovl_u8(c0)),
+                              vreinterpretq_s16_u16(vmovl_u8(c0)));
+    int16x8x2_t w = vzipq_s16(vreinterpretq_s16_u16(vmovl_u8(c1)),
+                              vreinterpretq_s16_u16(vmovl_u8(c1)));
+
+    PixelsNEON(dst, vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y))),
+               u.val[0], w.val[0], v);
+    PixelsNEON(dst + 32, vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y))),
+               u.val[1], w.val[1], v);
+}
+
+static void Planar8NEON(uint8_t *dst, const void *py, const void *pc0,
+                        const void *pc1, unsigned width,
+                        const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c0 = pc0, *c1 = pc1;
+    coefs_neon_t v;
+    unsigned x = 0;
+
+    LoadCoefsNEON(&v, k);
+    for (; x + 16 <= width; x += 16)
+        Pixels16NEON(&dst[4 * x], vld1q_u8(&y[x]), vld1_u8(&c0[x / 2]),
+                     vld1_u8(&c1[x / 2]), &v);
+    Planar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static void SemiPlanar8NEON(uint8_t *dst, const void *py, const void *pc0,
+                            const void *pc1, unsigned width,
+                            const yuv_rgb_coefs_t *k)
+{
+    const uint8_t *y = py, *c = pc0;
+    coefs_neon_t v;
+    unsigned x = 0;
+
+    LoadCoefsNEON(&v, k);
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x8x2_t vc = vld2_u8(&c[x]);
+        Pixels16NEON(&dst[4 * x], vld1q_u8(&y[x]), vc.val[0], vc.val[1], &v);
+    }
+    SemiPlanar8Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static inline int16x8_t Load16NEON(uint16x8_t s, const coefs_neon_t *v)
+{
+    return vreinterpretq_s16_u16(vshlq_u16(s, v->in_shift));
+}
+
+static inline int16x8_t Dup16NEON(uint16x4_t s, const coefs_neon_t *v)
+{
+    uint16x4x2_t d = vzip_u16(s, s);
+    return Load16NEON(vcombine_u16(d.val[0], d.val[1]), v);
+}
+
+static void Planar16NEON(uint8_t *dst, const void *py, const void *pc0,
+                         const void *pc1, unsigned width,
+                         const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c0 = pc0, *c1 = pc1;
+    coefs_neon_t v;
+    unsigned x = 0;
+
+    LoadCoefsNEON(&v, k);
+    for (; x + 8 <= width; x += 8)
+        PixelsNEON(&dst[4 * x], Load16NEON(vld1q_u16(&y[x]), &v),
+                   Dup16NEON(vld1_u16(&c0[x / 2]), &v),
+                   Dup16NEON(vld1_u16(&c1[x / 2]), &v), &v);
+    Planar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static void SemiPlanar16NEON(uint8_t *dst, const void *py, const void *pc0,
+                             const void *pc1, unsigned width,
+                             const yuv_rgb_coefs_t *k)
+{
+    const uint16_t *y = py, *c = pc0;
+    coefs_neon_t v;
+    unsigned x = 0;
+
+    LoadCoefsNEON(&v, k);
+    for (; x + 8 <= width; x += 8)
+    {
+        uint16x4x2_t vc = vld2_u16(&c[x]);
+        PixelsNEON(&dst[4 * x], Load16NEON(vld1q_u16(&y[x]), &v),
+                   Dup16NEON(vc.val[0], &v), Dup16NEON(vc.val[1], &v), &v);
+    }
+    SemiPlanar16Tail(dst, py, pc0, pc1, x, width, k);
+}
+
+static const yuv_rgb_kernels_t kernels_neon = {
+    "NEON",
+    Planar8NEON,
+    SemiPlanar8NEON,
+    Planar16NEON,
+    SemiPlanar16NEON,
+};
+#endif /* YUV_RGB_NEON */
+
+const yuv_rgb_kernels_t *yuv_rgb_kernels_Get(void)
+{
+#ifdef YUV_RGB_X86
+    if (vlc_CPU_AVX2())
+        return &kernels_avx2;
+    if (vlc_CPU_SSE2())
+        return &kernels_sse2;
+#endif
+#ifdef YUV_RGB_NEON
+# if defined(__aarch64__)
+    if (vlc_CPU_ARM64_NEON())
+# else
+    if (vlc_CPU_ARM_NEON())
+# endif
+        return &kernels_neon;
+#endif
+    return NULL;
+}
+
+#ifdef YUV_RGB_TEST
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t Rand(void)
+{
+    /* xorshift32 */
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+struct test_layout
+{
+    const char *name;
+    size_t      offset;     /* of the kernel in yuv_rgb_kernels_t */
+    unsigned    bits;
+    unsigned    in_shift;
+    bool        semiplanar;
+};
+
+static const struct test_layout layouts[] = {
+    { "I420",     offsetof(yuv_rgb_kernels_t, planar8),      8,  0, false },
+    { "NV12",     offsetof(yuv_rgb_kernels_t, semiplanar8),  8,  0, true  },
+    { "I420_10L", offsetof(yuv_rgb_kernels_t, planar16),     10, 0, false },
+    { "I420_12L", offsetof(yuv_rgb_kernels_t, planar16),     12, 0, false },
+    { "P010",     offsetof(yuv_rgb_kernels_t, semiplanar16), 10, 6, true  },
+};
+
+#define MAX_WIDTH 1920
+#define BENCH_LINES 1080
+
+static yuv_rgb_row_t GetRow(const yuv_rgb_kernels_t *kernels,
+                            const struct test_layout *layout)
+{
+    return *(const yuv_rgb_row_t *)((const char *)kernels + layout->offset);
+}
+
+static void Fill(void *buf, size_t count, const struct test_layout *layout)
+{
+    if (layout->bits == 8)
+        for (size_t i = 0; i < count; i++)
+            ((uint8_t *)buf)[i] = Rand();
+    else
+        for (size_t i = 0; i < count; i++)
+            ((uint16_t *)buf)[i] = (Rand() & ((1 << layout->bits) - 1))
+                                   << layout->in_shift;
+}
+
+static void Check(const yuv_rgb_kernels_t *kernels)
+{
+    const size_t size = 2 * MAX_WIDTH;
+    uint16_t *y = malloc(size), *c0 = malloc(size), *c1 = malloc(size);
+    uint8_t *ref = malloc(4 * MAX_WIDTH), *out = malloc(4 * MAX_WIDTH);
+    assert(y && c0 && c1 && ref && out);
+
+    for (size_t l = 0; l < ARRAY_SIZE(layouts); l++)
+    {
+        const struct test_layout *layout = &layouts[l];
+        yuv_rgb_row_t row = GetRow(kernels, layout);
+        yuv_rgb_row_t row_c = GetRow(&yuv_rgb_kernels_c, layout);
+
+        for (int space = COLOR_SPACE_BT601; space <= COLOR_SPACE_BT2020; space++)
+            for (unsigned flags = 0; flags < 8; flags++)
+            {
+                yuv_rgb_coefs_t k;
+                yuv_rgb_SetupCoefs(&k, space, flags & 1, layout->bits,
+                                   layout->in_shift, flags & 2, flags & 4);
+
+                for (unsigned width = 1; width <= 70; width++)
+                {
+                    Fill(y, MAX_WIDTH, layout);
+                    Fill(c0, MAX_WIDTH, layout);
+                    Fill(c1, MAX_WIDTH, layout);
+                    memset(out, 0, 4 * width + 4);
+
+                    row_c(ref, y, c0, c1, width, &k);
+                    row(out, y, c0, c1, width, &k);
+                    if (memcmp(ref, out, 4 * width) || out[4 * width])
+                    {
+                        fprintf(stderr, "%s %s: mismatch (space %d, flags %u,"
+                                " width %u)\n", kernels->name, layout->name,
+                                space, flags, width);
+                        abort();
+                    }
+                }
+            }
+    }
+    free(y); free(c0); free(c1); free(ref); free(out);
+}
+
+static void Bench(const yuv_rgb_kernels_t *kernels)
+{
+    const size_t size = 2 * MAX_WIDTH;
+    uint16_t *y = malloc(size), *c0 = malloc(size), *c1 = malloc(size);
+    uint8_t *out = malloc(4 * MAX_WIDTH);
+    assert(y && c0 && c1 && out);
+
+    for (size_t l = 0; l < ARRAY_SIZE(layouts); l++)
+    {
+        const struct test_layout *layout = &layouts[l];
+        yuv_rgb_row_t row = GetRow(kernels, layout);
+        yuv_rgb_coefs_t k;
+
+        yuv_rgb_SetupCoefs(&k, COLOR_SPACE_BT709, false, layout->bits,
+                           layout->in_shift, false, true);
+        Fill(y, MAX_WIDTH, layout);
+        Fill(c0, MAX_WIDTH, layout);
+        Fill(c1, MAX_WIDTH, layout);
+
+        const unsigned frames = 10;
+        vlc_tick_t start = mdate();
+        for (unsigned f = 0; f < frames; f++)
+            for (unsigned j = 0; j < BENCH_LINES; j++)
+                row(out, y, c0, c1, MAX_WIDTH, &k);
+        vlc_tick_t duration = mdate() - start;
+
+        printf("%-5s %-9s %8.1f Mpixels/s\n", kernels->name, layout->name,
+               (double)frames * MAX_WIDTH * BENCH_LINES
+               / __MAX(duration, 1));
+    }
+    free(y); free(c0); free(c1); free(out);
+}
+
+int main(void)
+{
+    const yuv_rgb_kernels_t *list[4];
+    unsigned count = 0;
+
+    alarm(60);
+
+    list[count++] = &yuv_rgb_kernels_c;
+#ifdef YUV_RGB_X86
+    if (vlc_CPU_SSE2())
+        list[count++] = &kernels_sse2;
+    if (vlc_CPU_AVX2())
+        list[count++] = &kernels_avx2;
+#endif
+#ifdef YUV_RGB_NEON
+# if defined(__aarch64__)
+    if (vlc_CPU_ARM64_NEON())
+# else
+    if (vlc_CPU_ARM_NEON())
+# endif
+        list[count++] = &kernels_neon;
+#endif
+
+    for (unsigned i = 1; i < count; i++)
+        Check(list[i]);
+    for (unsigned i = 0; i < count; i++)
+        Bench(list[i]);
+    return 0;
+}
+#endif
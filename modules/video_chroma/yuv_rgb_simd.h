@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * yuv_rgb_simd.h: YUV 4:2:0 to 32 bits RGB row kernels
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_YUV_RGB_SIMD_H
+#define VLC_YUV_RGB_SIMD_H 1
+
+/**
+ * Fixed point conversion coefficients.
+ *
+ * For each pixel, with y, c0 and c1 the luma and chroma samples shifted
+ * right by in_shift and minus their offsets, the output byte i is
+ *   clip((y_coef * y + round + c_coef[i][0] * c0 + c_coef[i][1] * c1) >> shift)
+ * and the fourth byte is 0xff.
+ *
+ * The byte order of the output and the order of the chroma samples are
+ * folded into c_coef[], so that all the kernels are bit-exact with each
+ * other regardless of the formats.
+ */
+typedef struct
+{
+    int16_t  y_offset;
+    int16_t  c_offset;
+    int16_t  y_coef;
+    int16_t  c_coef[3][2];
+    int32_t  round;
+    unsigned shift;
+    unsigned in_shift;
+} yuv_rgb_coefs_t;
+
+/**
+ * Converts one row of width pixels. The chroma samples are shared by pairs
+ * of pixels. Planar kernels read c0 and c1 from separate planes, semi-planar
+ * ones read interleaved (c0, c1) pairs from c0. 16 bits kernels read
+ * little-endian samples of at most 12 significant bits after in_shift.
+ */
+typedef void (*yuv_rgb_row_t)(uint8_t *dst, const void *y, const void *c0,
+                              const void *c1, unsigned width,
+                              const yuv_rgb_coefs_t *);
+
+typedef struct
+{
+    const char   *name;
+    yuv_rgb_row_t planar8;
+    yuv_rgb_row_t semiplanar8;
+    yuv_rgb_row_t planar16;
+    yuv_rgb_row_t semiplanar16;
+} yuv_rgb_kernels_t;
+
+/**
+ * Initializes the coefficients.
+ *
+ * \param space BT.601, BT.709 or BT.2020 matrix
+ * \param full_range whether the input uses the full range
+ * \param bits significant bits of the samples (8 to 12)
+ * \param in_shift right shift of the samples (6 for P010)
+ * \param swap_uv whether the chroma samples come as (V, U)
+ * \param bgr whether the output bytes are B, G, R instead of R, G, B
+ */
+void yuv_rgb_SetupCoefs(yuv_rgb_coefs_t *, video_color_space_t space,
+                        bool full_range, unsigned bits, unsigned in_shift,
+                        bool swap_uv, bool bgr);
+
+/**
+ * Returns the best kernels supported by the running CPU, or NULL if only
+ * the C ones are available.
+ */
+const yuv_rgb_kernels_t *yuv_rgb_kernels_Get(void);
+
+extern const yuv_rgb_kernels_t yuv_rgb_kernels_c;
+
+#endif
@@ -33,6 +33,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "blend_simd.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -40,9 +41,14 @@
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define SIMD_TEXT N_("Use SIMD blending")
+#define SIMD_LONGTEXT N_("Use the SSE4.1/AVX2/NEON routines for the most " \
+    "common blending cases when the CPU supports them.")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_capability("video blending", 100)
+    add_bool("blend-simd", true, SIMD_TEXT, SIMD_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -79,6 +85,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -623,11 +641,133 @@ static const struct {
 #undef YUV
 };
 
+/*****************************************************************************
+ * Accelerated paths
+ *
+ * They handle the hottest cases (subtitles and OSD onto the usual decoder
+ * and display chromas) row by row through the blend_simd.c kernels, and
+ * produce exactly the same output as the generic templates above.
+ *****************************************************************************/
+#define BLEND_CHUNK 512 /* pixels processed per kernel call, must be even */
+
+typedef void (*blend_fast_function_t)(const blend_kernels_t *,
+                                      const CPicture &dst_data,
+                                      const CPicture &src_data,
+                                      unsigned width, unsigned height,
+                                      int alpha);
+
+static inline uint8_t *planeAt(const picture_t *picture, unsigned plane,
+                               unsigned x, unsigned y)
+{
+    return &picture->p[plane].p_pixels[y * picture->p[plane].i_pitch + x];
+}
+
+template <bool swap_uv, bool semiplanar>
+void BlendYUVATo420Fast(const blend_kernels_t *k,
+                        const CPicture &dst_data, const CPicture &src_data,
+                        unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    /* First column landing on a chroma sample, see CPicture*::isFull() */
+    const unsigned cx = dx % 2;
+
+    uint8_t a[BLEND_CHUNK];
+    uint8_t ca[BLEND_CHUNK / 2], cu[BLEND_CHUNK / 2], cv[BLEND_CHUNK / 2];
+    uint8_t ia[BLEND_CHUNK], iuv[BLEND_CHUNK];
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *sp[4];
+        for (unsigned i = 0; i < 4; i++)
+            sp[i] = planeAt(src, i, sx, sy + y);
+
+        uint8_t *luma = planeAt(dst, 0, dx, dy + y);
+        const bool full = ((dy + y) % 2) == 0;
+        uint8_t *cp[2];
+        if (semiplanar) {
+            cp[0] = planeAt(dst, 1, (dx + cx) / 2 * 2, (dy + y) / 2);
+        } else {
+            cp[0] = planeAt(dst, swap_uv ? 2 : 1, (dx + cx) / 2, (dy + y) / 2);
+            cp[1] = planeAt(dst, swap_uv ? 1 : 2, (dx + cx) / 2, (dy + y) / 2);
+        }
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned n = __MIN(width - x, BLEND_CHUNK);
+
+            k->scale_alpha(a, &sp[3][x], alpha, n);
+            k->merge(&luma[x], &sp[0][x], a, n);
+            if (!full || n <= cx)
+                continue;
+
+            const unsigned m = (n - cx + 1) / 2;
+            k->pack_even(ca, &a[cx], m);
+            k->pack_even(cu, &sp[1][x + cx], m);
+            k->pack_even(cv, &sp[2][x + cx], m);
+            if (semiplanar) {
+                k->interleave(iuv, swap_uv ? cv : cu, swap_uv ? cu : cv, m);
+                k->interleave(ia, ca, ca, m);
+                k->merge(&cp[0][x], iuv, ia, 2 * m);
+            } else {
+                k->merge(&cp[0][x / 2], cu, ca, m);
+                k->merge(&cp[1][x / 2], cv, ca, m);
+            }
+        }
+    }
+}
+
+static void BlendRGBAToRGB32Fast(const blend_kernels_t *k,
+                                 const CPicture &dst_data,
+                                 const CPicture &src_data,
+                                 unsigned width, unsigned height, int alpha)
+{
+    const video_format_t *fmt = dst_data.getFormat();
+    unsigned off[3];
+#ifdef WORDS_BIGENDIAN
+    off[0] = (32 - fmt->i_lrshift) / 8;
+    off[1] = (32 - fmt->i_lgshift) / 8;
+    off[2] = (32 - fmt->i_lbshift) / 8;
+#else
+    off[0] = fmt->i_lrshift / 8;
+    off[1] = fmt->i_lgshift / 8;
+    off[2] = fmt->i_lbshift / 8;
+#endif
+    if (off[0] > 3 || off[1] > 3 || off[2] > 3 ||
+        off[0] == off[1] || off[0] == off[2] || off[1] == off[2]) {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >
+            (dst_data, src_data, width, height, alpha);
+        return;
+    }
+
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    for (unsigned y = 0; y < height; y++)
+        k->merge_rgba_x4(planeAt(dst, 0, 4 * dst_data.getX(), dst_data.getY() + y),
+                         planeAt(src, 0, 4 * src_data.getX(), src_data.getY() + y),
+                         alpha, off, width);
+}
+
+static const struct {
+    vlc_fourcc_t          dst;
+    vlc_fourcc_t          src;
+    blend_fast_function_t blend;
+} fast_blends[] = {
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, BlendYUVATo420Fast<false, false> },
+    { VLC_CODEC_J420,  VLC_CODEC_YUVA, BlendYUVATo420Fast<false, false> },
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, BlendYUVATo420Fast<true,  false> },
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA, BlendYUVATo420Fast<false, true>  },
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA, BlendYUVATo420Fast<true,  true>  },
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRGBAToRGB32Fast },
+};
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), fast(NULL), kernels(NULL)
     {
     }
-    blend_function_t blend;
+    blend_function_t      blend;
+    blend_fast_function_t fast;
+    const blend_kernels_t *kernels;
 };
 
 /**
@@ -655,13 +795,16 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+    if (sys->fast)
+        sys->fast(sys->kernels, dst_data, src_data, width, height, alpha);
+    else
+        sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -683,6 +826,18 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
+    if (var_InheritBool(filter, "blend-simd"))
+        sys->kernels = blend_kernels_Get();
+    if (sys->kernels) {
+        for (size_t i = 0; i < sizeof(fast_blends) / sizeof(*fast_blends); i++) {
+            if (fast_blends[i].src == src && fast_blends[i].dst == dst)
+                sys->fast = fast_blends[i].blend;
+        }
+        if (sys->fast)
+            msg_Dbg(filter, "using %s blending (chroma: %4.4s -> %4.4s)",
+                    sys->kernels->name, (char *)&src, (char *)&dst);
+    }
+
     filter->pf_video_blend = Blend;
     filter->p_sys          = sys;
     return VLC_SUCCESS;
@@ -0,0 +1,507 @@
+/*****************************************************************************
+ * blend_simd.c: SIMD row kernels for the blend module
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "blend_simd.h"
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+# define BLEND_X86 1
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+# define BLEND_NEON 1
+# include <arm_neon.h>
+#endif
+
+/*****************************************************************************
+ * Scalar tails (same arithmetic as blend.cpp)
+ *****************************************************************************/
+static inline unsigned div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static inline void ScaleAlphaC(uint8_t *a, const uint8_t *sa, unsigned alpha,
+                               unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+        a[i] = div255(alpha * sa[i]);
+}
+
+static inline void MergeC(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                          unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+        d[i] = div255((255 - a[i]) * d[i] + s[i] * a[i]);
+}
+
+static inline void PackEvenC(uint8_t *d, const uint8_t *s, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+        d[i] = s[2 * i];
+}
+
+static inline void InterleaveC(uint8_t *d, const uint8_t *s0,
+                               const uint8_t *s1, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        d[2 * i + 0] = s0[i];
+        d[2 * i + 1] = s1[i];
+    }
+}
+
+static inline void MergeRGBAx4C(uint8_t *d, const uint8_t *rgba,
+                                unsigned alpha, const unsigned off[3],
+                                unsigned n)
+{
+    for (unsigned i = 0; i < n; i++, d += 4, rgba += 4)
+    {
+        const unsigned a = div255(alpha * rgba[3]);
+        for (unsigned c = 0; c < 3; c++)
+            d[off[c]] = div255((255 - a) * d[off[c]] + rgba[c] * a);
+    }
+}
+
+#ifdef BLEND_X86
+/*****************************************************************************
+ * SSE4.1
+ *****************************************************************************/
+# define VLC_SSE4_1 __attribute__ ((__target__ ("sse4.1")))
+
+VLC_SSE4_1
+static inline __m128i Div255SSE(__m128i v)
+{
+    /* ((v >> 8) + v + 1) >> 8, with 16-bits lanes */
+    v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+    v = _mm_add_epi16(v, _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+VLC_SSE4_1
+static inline __m128i MergeSSE(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ff   = _mm_set1_epi16(255);
+
+    __m128i al = _mm_cvtepu8_epi16(a);
+    __m128i ah = _mm_unpackhi_epi8(a, zero);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(d),
+                                               _mm_sub_epi16(ff, al)),
+                               _mm_mullo_epi16(_mm_cvtepu8_epi16(s), al));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+                                               _mm_sub_epi16(ff, ah)),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), ah));
+    return _mm_packus_epi16(Div255SSE(lo), Div255SSE(hi));
+}
+
+VLC_SSE4_1
+static void ScaleAlphaSSE4_1(uint8_t *a, const uint8_t *sa, unsigned alpha,
+                             unsigned n)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)&sa[i]);
+        __m128i lo = Div255SSE(_mm_mullo_epi16(_mm_cvtepu8_epi16(s), va));
+        __m128i hi = Div255SSE(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), va));
+        _mm_storeu_si128((__m128i *)&a[i], _mm_packus_epi16(lo, hi));
+    }
+    ScaleAlphaC(&a[i], &sa[i], alpha, n - i);
+}
+
+VLC_SSE4_1
+static void MergeSSE4_1(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                        unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *)&a[i]);
+        if (_mm_testz_si128(va, va))
+            continue; /* fully transparent */
+        __m128i vd = _mm_loadu_si128((const __m128i *)&d[i]);
+        __m128i vs = _mm_loadu_si128((const __m128i *)&s[i]);
+        _mm_storeu_si128((__m128i *)&d[i], MergeSSE(vd, vs, va));
+    }
+    MergeC(&d[i], &s[i], &a[i], n - i);
+}
+
+VLC_SSE4_1
+static void PackEvenSSE4_1(uint8_t *d, const uint8_t *s, unsigned n)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    unsigned i = 0;
+
+    /* Do not read the odd byte past the last even sample */
+    for (; i + 17 <= n; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)&s[2 * i]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)&s[2 * i + 16]);
+        _mm_storeu_si128((__m128i *)&d[i],
+                         _mm_packus_epi16(_mm_and_si128(lo, mask),
+                                          _mm_and_si128(hi, mask)));
+    }
+    PackEvenC(&d[i], &s[2 * i], n - i);
+}
+
+VLC_SSE4_1
+static void InterleaveSSE4_1(uint8_t *d, const uint8_t *s0, const uint8_t *s1,
+                             unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)&s0[i]);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)&s1[i]);
+        _mm_storeu_si128((__m128i *)&d[2 * i],      _mm_unpacklo_epi8(v0, v1));
+        _mm_storeu_si128((__m128i *)&d[2 * i + 16], _mm_unpackhi_epi8(v0, v1));
+    }
+    InterleaveC(&d[2 * i], &s0[i], &s1[i], n - i);
+}
+
+/* Builds the byte shuffles placing the source R, G, B bytes and the pixel
+ * alpha at the destination offsets, for 4 pixels (one 128-bits lane) */
+static void BuildRGBAShuffles(uint8_t shuf_s[16], uint8_t shuf_a[16],
+                              const unsigned off[3])
+{
+    memset(shuf_s, 0x80, 16);
+    memset(shuf_a, 0x80, 16);
+    for (unsigned p = 0; p < 4; p++)
+        for (unsigned c = 0; c < 3; c++)
+        {
+            shuf_s[4 * p + off[c]] = 4 * p + c;
+            shuf_a[4 * p + off[c]] = 4 * p;
+        }
+}
+
+VLC_SSE4_1
+static void MergeRGBAx4SSE4_1(uint8_t *d, const uint8_t *rgba, unsigned alpha,
+                              const unsigned off[3], unsigned n)
+{
+    uint8_t shuf_s[16], shuf_a[16];
+    BuildRGBAShuffles(shuf_s, shuf_a, off);
+
+    const __m128i ms = _mm_loadu_si128((const __m128i *)shuf_s);
+    const __m128i ma = _mm_loadu_si128((const __m128i *)shuf_a);
+    const __m128i va = _mm_set1_epi32(alpha);
+    unsigned i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)&rgba[4 * i]);
+        /* alpha * A in the low 16 bits of each pixel, upper bits stay 0 */
+        __m128i a = Div255SSE(_mm_mullo_epi16(_mm_srli_epi32(s, 24), va));
+        if (_mm_testz_si128(a, a))
+            continue;
+        __m128i vd = _mm_loadu_si128((const __m128i *)&d[4 * i]);
+        __m128i vr = MergeSSE(vd, _mm_shuffle_epi8(s, ms),
+                              _mm_shuffle_epi8(a, ma));
+        _mm_storeu_si128((__m128i *)&d[4 * i], vr);
+    }
+    MergeRGBAx4C(&d[4 * i], &rgba[4 * i], alpha, off, n - i);
+}
+
+static const blend_kernels_t kernels_sse4_1 = {
+    "sse4.1",
+    ScaleAlphaSSE4_1,
+    MergeSSE4_1,
+    PackEvenSSE4_1,
+    InterleaveSSE4_1,
+    MergeRGBAx4SSE4_1,
+};
+
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+VLC_AVX2
+static inline __m256i Div255AVX2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+/* The unpack/pack pairs below work within 128-bits lanes, and so restore
+ * the original byte order. */
+VLC_AVX2
+static inline __m256i MergeAVX2(__m256i d, __m256i s, __m256i a)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ff   = _mm256_set1_epi16(255);
+
+    __m256i al = _mm256_unpacklo_epi8(a, zero);
+    __m256i ah = _mm256_unpackhi_epi8(a, zero);
+    __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+                           _mm256_sub_epi16(ff, al)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), al));
+    __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+                           _mm256_sub_epi16(ff, ah)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), ah));
+    return _mm256_packus_epi16(Div255AVX2(lo), Div255AVX2(hi));
+}
+
+VLC_AVX2
+static void ScaleAlphaAVX2(uint8_t *a, const uint8_t *sa, unsigned alpha,
+                           unsigned n)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&sa[i]);
+        __m256i lo = Div255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), va));
+        __m256i hi = Div255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), va));
+        _mm256_storeu_si256((__m256i *)&a[i], _mm256_packus_epi16(lo, hi));
+    }
+    ScaleAlphaSSE4_1(&a[i], &sa[i], alpha, n - i);
+}
+
+VLC_AVX2
+static void MergeAVX2Row(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                         unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+        if (_mm256_testz_si256(va, va))
+            continue;
+        __m256i vd = _mm256_loadu_si256((const __m256i *)&d[i]);
+        __m256i vs = _mm256_loadu_si256((const __m256i *)&s[i]);
+        _mm256_storeu_si256((__m256i *)&d[i], MergeAVX2(vd, vs, va));
+    }
+    MergeSSE4_1(&d[i], &s[i], &a[i], n - i);
+}
+
+VLC_AVX2
+static void PackEvenAVX2(uint8_t *d, const uint8_t *s, unsigned n)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    unsigned i = 0;
+
+    for (; i + 33 <= n; i += 32)
+    {
+        __m256i lo = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&s[2 * i]), mask);
+        __m256i hi = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&s[2 * i + 32]), mask);
+        /* packus interleaves the 128-bits lanes: fix the qword order */
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi),
+                                             _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)&d[i], p);
+    }
+    PackEvenSSE4_1(&d[i], &s[2 * i], n - i);
+}
+
+VLC_AVX2
+static void InterleaveAVX2(uint8_t *d, const uint8_t *s0, const uint8_t *s1,
+                           unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)&s0[i]);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)&s1[i]);
+        __m256i lo = _mm256_unpacklo_epi8(v0, v1);
+        __m256i hi = _mm256_unpackhi_epi8(v0, v1);
+        _mm256_storeu_si256((__m256i *)&d[2 * i],
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)&d[2 * i + 32],
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    InterleaveSSE4_1(&d[2 * i], &s0[i], &s1[i], n - i);
+}
+
+VLC_AVX2
+static void MergeRGBAx4AVX2(uint8_t *d, const uint8_t *rgba, unsigned alpha,
+                            const unsigned off[3], unsigned n)
+{
+    uint8_t shuf_s[16], shuf_a[16];
+    BuildRGBAShuffles(shuf_s, shuf_a, off);
+
+    /* vpshufb works per 128-bits lane, each holding 4 pixels */
+    const __m256i ms = _mm256_broadcastsi128_si256(
+                            _mm_loadu_si128((const __m128i *)shuf_s));
+    const __m256i ma = _mm256_broadcastsi128_si256(
+                            _mm_loadu_si128((const __m128i *)shuf_a));
+    const __m256i va = _mm256_set1_epi32(alpha);
+    unsigned i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&rgba[4 * i]);
+        __m256i a = Div255AVX2(_mm256_mullo_epi16(_mm256_srli_epi32(s, 24), va));
+        if (_mm256_testz_si256(a, a))
+            continue;
+        __m256i vd = _mm256_loadu_si256((const __m256i *)&d[4 * i]);
+        __m256i vr = MergeAVX2(vd, _mm256_shuffle_epi8(s, ms),
+                               _mm256_shuffle_epi8(a, ma));
+        _mm256_storeu_si256((__m256i *)&d[4 * i], vr);
+    }
+    MergeRGBAx4SSE4_1(&d[4 * i], &rgba[4 * i], alpha, off, n - i);
+}
+
+static const blend_kernels_t kernels_avx2 = {
+    "avx2",
+    ScaleAlphaAVX2,
+    MergeAVX2Row,
+    PackEvenAVX2,
+    InterleaveAVX2,
+    MergeRGBAx4AVX2,
+};
+#endif /* BLEND_X86 */
+
+#ifdef BLEND_NEON
+/*****************************************************************************
+ * NEON
+ *****************************************************************************/
+static inline uint8x8_t Div255NEON(uint16x8_t v)
+{
+    v = vaddq_u16(v, vshrq_n_u16(v, 8));
+    v = vaddq_u16(v, vdupq_n_u16(1));
+    return vshrn_n_u16(v, 8);
+}
+
+static inline uint8x16_t MergeNEON(uint8x16_t d, uint8x16_t s, uint8x16_t a)
+{
+    const uint8x16_t ia = vsubq_u8(vdupq_n_u8(255), a);
+
+    uint16x8_t lo = vmull_u8(vget_low_u8(d), vget_low_u8(ia));
+    lo = vmlal_u8(lo, vget_low_u8(s), vget_low_u8(a));
+    uint16x8_t hi = vmull_u8(vget_high_u8(d), vget_high_u8(ia));
+    hi = vmlal_u8(hi, vget_high_u8(s), vget_high_u8(a));
+    return vcombine_u8(Div255NEON(lo), Div255NEON(hi));
+}
+
+static inline uint8x16_t ScaleNEON(uint8x16_t s, uint8x8_t va)
+{
+    return vcombine_u8(Div255NEON(vmull_u8(vget_low_u8(s), va)),
+                       Div255NEON(vmull_u8(vget_high_u8(s), va)));
+}
+
+static void ScaleAlphaNEON(uint8_t *a, const uint8_t *sa, unsigned alpha,
+                           unsigned n)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+        vst1q_u8(&a[i], ScaleNEON(vld1q_u8(&sa[i]), va));
+    ScaleAlphaC(&a[i], &sa[i], alpha, n - i);
+}
+
+static void MergeNEONRow(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                         unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+        vst1q_u8(&d[i], MergeNEON(vld1q_u8(&d[i]), vld1q_u8(&s[i]),
+                                  vld1q_u8(&a[i])));
+    MergeC(&d[i], &s[i], &a[i], n - i);
+}
+
+static void PackEvenNEON(uint8_t *d, const uint8_t *s, unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 17 <= n; i += 16)
+        vst1q_u8(&d[i], vld2q_u8(&s[2 * i]).val[0]);
+    PackEvenC(&d[i], &s[2 * i], n - i);
+}
+
+static void InterleaveNEON(uint8_t *d, const uint8_t *s0, const uint8_t *s1,
+                           unsigned n)
+{
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16x2_t v = { { vld1q_u8(&s0[i]), vld1q_u8(&s1[i]) } };
+        vst2q_u8(&d[2 * i], v);
+    }
+    InterleaveC(&d[2 * i], &s0[i], &s1[i], n - i);
+}
+
+static void MergeRGBAx4NEON(uint8_t *d, const uint8_t *rgba, unsigned alpha,
+                            const unsigned off[3], unsigned n)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16x4_t s = vld4q_u8(&rgba[4 * i]);
+        uint8x16x4_t v = vld4q_u8(&d[4 * i]);
+        uint8x16_t a = ScaleNEON(s.val[3], va);
+
+        for (unsigned c = 0; c < 3; c++)
+            v.val[off[c]] = MergeNEON(v.val[off[c]], s.val[c], a);
+        vst4q_u8(&d[4 * i], v);
+    }
+    MergeRGBAx4C(&d[4 * i], &rgba[4 * i], alpha, off, n - i);
+}
+
+static const blend_kernels_t kernels_neon = {
+    "neon",
+    ScaleAlphaNEON,
+    MergeNEONRow,
+    PackEvenNEON,
+    InterleaveNEON,
+    MergeRGBAx4NEON,
+};
+#endif /* BLEND_NEON */
+
+const blend_kernels_t *blend_kernels_Get(void)
+{
+#ifdef BLEND_X86
+    if (vlc_CPU_AVX2())
+        return &kernels_avx2;
+    if (vlc_CPU_SSE4_1())
+        return &kernels_sse4_1;
+#endif
+#ifdef BLEND_NEON
+# if defined(__aarch64__)
+    if (vlc_CPU_ARM64_NEON())
+# else
+    if (vlc_CPU_ARM_NEON())
+# endif
+        return &kernels_neon;
+#endif
+    return NULL;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * blend_simd.h: SIMD row kernels for the blend module
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BLEND_SIMD_H
+#define VLC_BLEND_SIMD_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Row kernels used by the accelerated blending paths.
+ *
+ * All kernels are bit-exact with the scalar templates of blend.cpp: the
+ * alpha division uses the same div255() approximation.
+ */
+typedef struct
+{
+    const char *name;
+
+    /* a[i] = div255(alpha * sa[i]) */
+    void (*scale_alpha)(uint8_t *a, const uint8_t *sa, unsigned alpha,
+                        unsigned n);
+    /* d[i] = div255((255 - a[i]) * d[i] + s[i] * a[i]) */
+    void (*merge)(uint8_t *d, const uint8_t *s, const uint8_t *a, unsigned n);
+    /* d[i] = s[2 * i] */
+    void (*pack_even)(uint8_t *d, const uint8_t *s, unsigned n);
+    /* d[2 * i] = s0[i], d[2 * i + 1] = s1[i] */
+    void (*interleave)(uint8_t *d, const uint8_t *s0, const uint8_t *s1,
+                       unsigned n);
+    /* Blends n RGBA pixels onto a 4 bytes per pixel destination without
+     * alpha, off[] being the byte offsets of R, G and B in the destination */
+    void (*merge_rgba_x4)(uint8_t *d, const uint8_t *rgba, unsigned alpha,
+                          const unsigned off[3], unsigned n);
+} blend_kernels_t;
+
+/**
+ * Returns the best kernels supported by the running CPU.
+ */
+const blend_kernels_t *blend_kernels_Get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -69,6 +69,25 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define SIZES_TEXT N_("Synthetic region sizes")
+#define SIZES_LONGTEXT N_("Comma separated list of WIDTHxHEIGHT regions to " \
+                          "blend with generated pictures instead of the " \
+                          "base and blend images (e.g. 320x240,1920x1080)")
+
+#define PATTERNS_TEXT N_("Synthetic alpha patterns")
+#define PATTERNS_LONGTEXT N_("Comma separated list of alpha patterns used " \
+                             "for the generated blend pictures: opaque, " \
+                             "transparent, gradient, random, subtitle")
+
+#define SEED_TEXT N_("Random seed")
+#define SEED_LONGTEXT N_("Seed of the generated pictures, so that runs " \
+                         "can be reproduced")
+
+#define COMPARE_TEXT N_("Compare with the C implementation")
+#define COMPARE_LONGTEXT N_("Also run each synthetic case with the SIMD " \
+                            "blending disabled, check that both outputs " \
+                            "match and report the speedup")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -96,12 +115,21 @@ vlc_module_begin ()
     add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
               BLEND_CHROMA_LONGTEXT, false )
 
+    set_section( N_("Synthetic benchmark"), NULL )
+    add_string( CFG_PREFIX "sizes", NULL, SIZES_TEXT, SIZES_LONGTEXT, false )
+    add_string( CFG_PREFIX "alpha-patterns",
+                "opaque,transparent,gradient,random,subtitle",
+                PATTERNS_TEXT, PATTERNS_LONGTEXT, false )
+    add_integer( CFG_PREFIX "seed", 1, SEED_TEXT, SEED_LONGTEXT, true )
+    add_bool( CFG_PREFIX "compare", true, COMPARE_TEXT, COMPARE_LONGTEXT,
+              false )
+
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "blend-chroma", "sizes", "alpha-patterns", "seed", "compare", NULL
 };
 
 /*****************************************************************************
@@ -117,8 +145,22 @@ struct filter_sys_t
 
     vlc_fourcc_t i_base_chroma;
     vlc_fourcc_t i_blend_chroma;
+
+    char *psz_sizes;
+    char *psz_patterns;
+    uint32_t i_seed;
+    bool b_compare;
 };
 
+static vlc_fourcc_t blendbench_GetChroma( filter_t *p_filter, const char *psz_var )
+{
+    char *psz_temp = var_CreateGetStringCommand( p_filter, psz_var );
+    vlc_fourcc_t i_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
+        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
+    free( psz_temp );
+    return i_chroma;
+}
+
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
                                  vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
 {
@@ -176,6 +218,33 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
 
+    p_sys->psz_sizes = var_CreateGetNonEmptyString( p_filter,
+                                                    CFG_PREFIX "sizes" );
+    if( p_sys->psz_sizes != NULL )
+    {
+        /* Synthetic mode: the pictures are generated for each case */
+        p_sys->psz_patterns = var_CreateGetString( p_filter,
+                                                   CFG_PREFIX "alpha-patterns" );
+        p_sys->i_seed = var_CreateGetInteger( p_filter, CFG_PREFIX "seed" );
+        p_sys->b_compare = var_CreateGetBool( p_filter, CFG_PREFIX "compare" );
+        p_sys->i_base_chroma =
+            blendbench_GetChroma( p_filter, CFG_PREFIX "base-chroma" );
+        p_sys->i_blend_chroma =
+            blendbench_GetChroma( p_filter, CFG_PREFIX "blend-chroma" );
+        p_sys->p_base_image = p_sys->p_blend_image = NULL;
+
+        if( p_sys->i_blend_chroma == VLC_CODEC_YUVP )
+        {
+            msg_Err( p_filter, "Palettized blend pictures cannot be generated" );
+            free( p_sys->psz_patterns );
+            free( p_sys->psz_sizes );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+    p_sys->psz_patterns = NULL;
+
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
         VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
@@ -220,45 +289,305 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    if( p_sys->p_base_image )
+        picture_Release( p_sys->p_base_image );
+    if( p_sys->p_blend_image )
+        picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_patterns );
+    free( p_sys->psz_sizes );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * blendbench_Run: blends p_blend_pic onto p_base i_loops times
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static int blendbench_Run( filter_t *p_filter, picture_t *p_base,
+                           picture_t *p_blend_pic, int i_loops, int i_alpha,
+                           bool b_simd, vlc_tick_t *p_time )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
-
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        return VLC_ENOMEM;
+
+    /* Let the blend module pick (or not) its SIMD routines */
+    var_Create( p_blend, "blend-simd", VLC_VAR_BOOL );
+    var_SetBool( p_blend, "blend-simd", b_simd );
+
+    p_blend->fmt_out.video = p_base->format;
+    p_blend->fmt_in.video = p_blend_pic->format;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
         vlc_object_release( p_blend );
-        return NULL;
+        return VLC_EGENERIC;
     }
 
     vlc_tick_t time = mdate();
-    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    for( int i_iter = 0; i_iter < i_loops; ++i_iter )
+    {
+        p_blend->pf_video_blend( p_blend, p_base, p_blend_pic,
+                                 0, 0, i_alpha );
+    }
+    *p_time = mdate() - time;
+
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Synthetic pictures
+ *****************************************************************************/
+static uint32_t blendbench_Rand( uint32_t *p_state )
+{
+    /* xorshift32, the same sequence on every platform */
+    uint32_t x = *p_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *p_state = x;
+}
+
+static void blendbench_FillNoise( picture_t *p_pic, uint32_t i_seed )
+{
+    uint32_t i_state = i_seed ? i_seed : 1;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = blendbench_Rand( &i_state );
+    }
+}
+
+static int blendbench_GetAlpha( const char *psz_pattern, unsigned x, unsigned y,
+                                unsigned i_width, unsigned i_height,
+                                uint32_t *p_state )
+{
+    if( !strcmp( psz_pattern, "opaque" ) )
+        return 255;
+    if( !strcmp( psz_pattern, "transparent" ) )
+        return 0;
+    if( !strcmp( psz_pattern, "gradient" ) )
+        return i_width > 1 ? x * 255 / (i_width - 1) : 255;
+    if( !strcmp( psz_pattern, "random" ) )
+        return blendbench_Rand( p_state ) & 0xff;
+    if( !strcmp( psz_pattern, "subtitle" ) )
+    {
+        /* Mostly transparent picture with opaque glyph-like runs at the
+         * bottom, like a rendered subtitle region */
+        if( y < i_height * 4 / 5 )
+            return 0;
+        return (blendbench_Rand( p_state ) & 3) ? 255 : 0;
+    }
+    return -1;
+}
+
+static int blendbench_FillAlpha( picture_t *p_pic, const char *psz_pattern,
+                                 uint32_t i_seed )
+{
+    const video_format_t *p_fmt = &p_pic->format;
+    uint32_t i_state = i_seed ? i_seed : 1;
+    uint8_t *p_alpha;
+    int i_pitch, i_step;
+
+    switch( p_fmt->i_chroma )
+    {
+        case VLC_CODEC_YUVA:
+            p_alpha = p_pic->p[A_PLANE].p_pixels;
+            i_pitch = p_pic->p[A_PLANE].i_pitch;
+            i_step  = 1;
+            break;
+        case VLC_CODEC_RGBA:
+        case VLC_CODEC_BGRA:
+            p_alpha = p_pic->p[0].p_pixels + 3;
+            i_pitch = p_pic->p[0].i_pitch;
+            i_step  = 4;
+            break;
+        default:
+            /* No alpha channel, keep the noise */
+            return VLC_SUCCESS;
+    }
+
+    for( unsigned y = 0; y < p_fmt->i_visible_height; y++ )
+        for( unsigned x = 0; x < p_fmt->i_visible_width; x++ )
+        {
+            int i_alpha = blendbench_GetAlpha( psz_pattern, x, y,
+                                               p_fmt->i_visible_width,
+                                               p_fmt->i_visible_height,
+                                               &i_state );
+            if( i_alpha < 0 )
+                return VLC_EGENERIC;
+            p_alpha[y * i_pitch + x * i_step] = i_alpha;
+        }
+    return VLC_SUCCESS;
+}
+
+static picture_t *blendbench_NewPicture( vlc_fourcc_t i_chroma,
+                                         unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    return picture_NewFromFormat( &fmt );
+}
+
+static bool blendbench_Equal( const picture_t *p_a, const picture_t *p_b )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+    {
+        const plane_t *pa = &p_a->p[i], *pb = &p_b->p[i];
+        for( int y = 0; y < pa->i_visible_lines; y++ )
+            if( memcmp( &pa->p_pixels[y * pa->i_pitch],
+                        &pb->p_pixels[y * pb->i_pitch],
+                        pa->i_visible_pitch ) )
+                return false;
+    }
+    return true;
+}
+
+static void blendbench_RunCase( filter_t *p_filter, unsigned i_width,
+                                unsigned i_height, const char *psz_pattern )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_base = NULL, *p_blend_pic = NULL, *p_ref = NULL;
+    vlc_tick_t i_time, i_time_c = 0;
+
+    p_base = blendbench_NewPicture( p_sys->i_base_chroma, i_width, i_height );
+    p_blend_pic = blendbench_NewPicture( p_sys->i_blend_chroma,
+                                         i_width, i_height );
+    if( !p_base || !p_blend_pic )
+        goto end;
+
+    blendbench_FillNoise( p_blend_pic, p_sys->i_seed + 1 );
+    if( blendbench_FillAlpha( p_blend_pic, psz_pattern, p_sys->i_seed + 2 ) )
+    {
+        msg_Err( p_filter, "Unknown alpha pattern %s", psz_pattern );
+        goto end;
+    }
+
+    if( p_sys->b_compare )
+    {
+        /* Check the output of a single blend against the C routines */
+        p_ref = blendbench_NewPicture( p_sys->i_base_chroma,
+                                       i_width, i_height );
+        if( !p_ref )
+            goto end;
+        blendbench_FillNoise( p_ref, p_sys->i_seed );
+        blendbench_FillNoise( p_base, p_sys->i_seed );
+        if( blendbench_Run( p_filter, p_ref, p_blend_pic, 1, p_sys->i_alpha,
+                            false, &i_time )
+         || blendbench_Run( p_filter, p_base, p_blend_pic, 1, p_sys->i_alpha,
+                            true, &i_time ) )
+            goto error;
+        if( !blendbench_Equal( p_ref, p_base ) )
+            msg_Warn( p_filter, "%ux%u %s: SIMD and C outputs differ",
+                      i_width, i_height, psz_pattern );
+
+        blendbench_FillNoise( p_base, p_sys->i_seed );
+        if( blendbench_Run( p_filter, p_base, p_blend_pic, p_sys->i_loops,
+                            p_sys->i_alpha, false, &i_time_c ) )
+            goto error;
+    }
+
+    blendbench_FillNoise( p_base, p_sys->i_seed );
+    if( blendbench_Run( p_filter, p_base, p_blend_pic, p_sys->i_loops,
+                        p_sys->i_alpha, true, &i_time ) )
+        goto error;
+
+    const double f_pixels = (double)p_sys->i_loops * i_width * i_height;
+    if( i_time_c > 0 )
+        msg_Info( p_filter, "%4.4s -> %4.4s %5ux%-5u %-11s: "
+                  "%8.2f Mpixels/s (C: %8.2f Mpixels/s, x%.2f)",
+                  (const char *)&p_sys->i_blend_chroma,
+                  (const char *)&p_sys->i_base_chroma,
+                  i_width, i_height, psz_pattern,
+                  f_pixels / __MAX(i_time, 1), f_pixels / i_time_c,
+                  (double)i_time_c / __MAX(i_time, 1) );
+    else
+        msg_Info( p_filter, "%4.4s -> %4.4s %5ux%-5u %-11s: %8.2f Mpixels/s",
+                  (const char *)&p_sys->i_blend_chroma,
+                  (const char *)&p_sys->i_base_chroma,
+                  i_width, i_height, psz_pattern,
+                  f_pixels / __MAX(i_time, 1) );
+    goto end;
+
+error:
+    msg_Err( p_filter, "no blending routine for %4.4s -> %4.4s",
+             (const char *)&p_sys->i_blend_chroma,
+             (const char *)&p_sys->i_base_chroma );
+end:
+    if( p_ref )
+        picture_Release( p_ref );
+    if( p_blend_pic )
+        picture_Release( p_blend_pic );
+    if( p_base )
+        picture_Release( p_base );
+}
+
+static void blendbench_RunSynthetic( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    char *psz_sizes = strdup( p_sys->psz_sizes );
+    char *psz_size_save, *psz_size;
+
+    if( !psz_sizes )
+        return;
+
+    for( psz_size = strtok_r( psz_sizes, ",", &psz_size_save ); psz_size;
+         psz_size = strtok_r( NULL, ",", &psz_size_save ) )
+    {
+        unsigned i_width, i_height;
+        if( sscanf( psz_size, "%ux%u", &i_width, &i_height ) != 2
+         || !i_width || !i_height )
+        {
+            msg_Err( p_filter, "Invalid region size %s", psz_size );
+            continue;
+        }
+
+        char *psz_patterns = strdup( p_sys->psz_patterns ? p_sys->psz_patterns
+                                                         : "opaque" );
+        char *psz_pattern_save, *psz_pattern;
+        if( !psz_patterns )
+            break;
+        for( psz_pattern = strtok_r( psz_patterns, ",", &psz_pattern_save );
+             psz_pattern;
+             psz_pattern = strtok_r( NULL, ",", &psz_pattern_save ) )
+            blendbench_RunCase( p_filter, i_width, i_height, psz_pattern );
+        free( psz_patterns );
+    }
+    free( psz_sizes );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    vlc_tick_t time;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    if( p_sys->psz_sizes != NULL )
+    {
+        blendbench_RunSynthetic( p_filter );
+        p_sys->b_done = true;
+        return p_pic;
+    }
+
+    if( blendbench_Run( p_filter, p_sys->p_base_image, p_sys->p_blend_image,
+                        p_sys->i_loops, p_sys->i_alpha, true, &time ) )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
-                                 0, 0, p_sys->i_alpha );
+        picture_Release( p_pic );
+        return NULL;
     }
-    time = mdate() - time;
 
     msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
               time / 1000000.0f );
@@ -268,10 +597,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
 
-    module_unneed( p_blend, p_blend->p_module );
-
-    vlc_object_release( p_blend );
-
     p_sys->b_done = true;
     return p_pic;
 }
@@ -41,6 +41,7 @@
 
 static int OpenDummy( vlc_object_t * );
 static int OpenStats( vlc_object_t * );
+static int OpenBench( vlc_object_t * );
 static void Close( vlc_object_t * );
 
 vlc_module_begin ()
@@ -59,6 +60,12 @@ vlc_module_begin ()
     set_capability( "vout display", 0 )
     add_shortcut( "stats" )
     set_callbacks( OpenStats, Close )
+
+    add_submodule ()
+    set_description( N_("Benchmark video output") )
+    set_capability( "vout display", 0 )
+    add_shortcut( "bench" )
+    set_callbacks( OpenBench, Close )
 vlc_module_end ()
 
 
@@ -118,6 +125,18 @@ static int OpenStats(vlc_object_t *object)
     return Open(object, DisplayStat);
 }
 
+static int OpenBench(vlc_object_t *object)
+{
+    vout_display_t *vd = (vout_display_t *)object;
+
+    /* Pictures are discarded, but the video output still waits for their
+     * display date: report the timings it collected when it is closed. */
+    var_SetBool(vd->obj.parent, "vout-frame-stats", true);
+    msg_Dbg(vd, "frame timing statistics will be reported at exit, "
+            "or when the \"frame-stats\" variable is triggered");
+    return Open(object, Display);
+}
+
 static void Close(vlc_object_t *object)
 {
     vout_display_t *vd = (vout_display_t *)object;
@@ -83,6 +83,19 @@ typedef struct
         bool discontinuity;
     } sync;
 
+    struct
+    {
+        bool enabled; /**< Low latency mode */
+        bool measured; /**< Whether the estimates below are valid */
+        vlc_tick_t margin; /**< Mean advance of the buffers on their PTS */
+        vlc_tick_t jitter; /**< Mean deviation of the advance */
+        vlc_tick_t floor; /**< Lowest recent advance */
+        vlc_tick_t offset; /**< Advance of playback on the PTS */
+        vlc_tick_t drift; /**< Smoothed drift */
+        int resampling; /**< Current resampling (Hz) */
+        unsigned underruns;
+    } jitter;
+
     int initial_stereo_mode; /**< Initial stereo mode set by options */
 
     audio_sample_format_t input_format;
@@ -93,6 +106,7 @@ typedef struct
 
     atomic_uint buffers_lost;
     atomic_uint buffers_played;
+    atomic_int_least64_t drift; /**< last measured drift (statistics) */
     atomic_uchar restart;
 } aout_owner_t;
 
@@ -153,8 +167,9 @@ bool aout_ChangeFilterString( vlc_object_t *manager, vlc_object_t *aout,
 int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
                 const audio_replay_gain_t *, const aout_request_vout_t *);
 void aout_DecDelete(audio_output_t *);
-int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
-void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *);
+int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate, bool *played);
+void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *,
+                           vlc_tick_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, vlc_tick_t i_date);
 void aout_DecFlush(audio_output_t *, bool wait);
 void aout_RequestRestart (audio_output_t *, unsigned);
@@ -37,6 +37,17 @@
 #include "aout_internal.h"
 #include "libvlc.h"
 
+/* Low latency mode */
+/** Minimum amount of audio buffered ahead of playback */
+#define AOUT_LOW_LATENCY_MIN            (CLOCK_FREQ / 100)
+/** Amount of audio buffered ahead of playback, in mean deviations of the
+ * arrival times of the buffers */
+#define AOUT_LOW_LATENCY_JITTER         4
+/** Time over which the drift is corrected by resampling */
+#define AOUT_LOW_LATENCY_CORRECTION     (2 * CLOCK_FREQ)
+/* Max resampling (in %) */
+#define AOUT_LOW_LATENCY_MAX_RESAMPLING 1
+
 /**
  * Creates an audio output
  */
@@ -110,10 +121,17 @@ error:
     owner->sync.end = VLC_TICK_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
     owner->sync.discontinuity = true;
+    owner->jitter.enabled = var_InheritBool (p_aout, "audio-low-latency");
+    owner->jitter.measured = false;
+    owner->jitter.offset = 0;
+    owner->jitter.drift = 0;
+    owner->jitter.resampling = 0;
+    owner->jitter.underruns = 0;
     aout_OutputUnlock (p_aout);
 
     atomic_init (&owner->buffers_lost, 0);
     atomic_init (&owner->buffers_played, 0);
+    atomic_init (&owner->drift, 0);
     atomic_store (&owner->vp.update, true);
     return 0;
 }
@@ -170,6 +188,7 @@ static int aout_CheckReady (audio_output_t *aout)
         msg_Dbg (aout, "restarting filters...");
         owner->sync.end = VLC_TICK_INVALID;
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+        owner->jitter.resampling = 0;
 
         if (owner->mixer_format.i_format)
         {
@@ -210,9 +229,84 @@ static void aout_StopResampling (audio_output_t *aout)
     aout_owner_t *owner = aout_owner (aout);
 
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+    owner->jitter.resampling = 0;
+    owner->jitter.drift = 0;
     aout_FiltersAdjustResampling (owner->filters, 0);
 }
 
+/**
+ * Tracks the advance of the buffers on their PTS when they reach the audio
+ * output, and derives how far ahead of the PTS playback can run while
+ * keeping enough audio buffered to absorb the jitter of the input.
+ */
+static void aout_DecUpdateJitter (audio_output_t *aout, vlc_tick_t advance)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    if (!owner->jitter.measured)
+    {
+        owner->jitter.margin = advance;
+        owner->jitter.jitter = 0;
+        owner->jitter.floor = advance;
+        owner->jitter.measured = true;
+    }
+    else
+    {   /* Mean deviation, as for the RTP interarrival jitter */
+        vlc_tick_t deviation = advance - owner->jitter.margin;
+
+        owner->jitter.margin += deviation / 16;
+        owner->jitter.jitter += (llabs (deviation) - owner->jitter.jitter) / 16;
+
+        /* The floor follows drops at once, but rises slowly */
+        if (advance < owner->jitter.floor)
+            owner->jitter.floor = advance;
+        else
+            owner->jitter.floor += (advance - owner->jitter.floor) / 256;
+    }
+
+    if (advance < owner->jitter.offset)
+    {   /* The buffer arrived after its playback time */
+        owner->jitter.underruns++;
+        var_SetInteger (aout, "audio-buffer-underruns",
+                        owner->jitter.underruns);
+    }
+
+    vlc_tick_t target = AOUT_LOW_LATENCY_MIN
+                      + AOUT_LOW_LATENCY_JITTER * owner->jitter.jitter;
+
+    owner->jitter.offset = __MAX(owner->jitter.floor - target, 0);
+    var_SetInteger (aout, "audio-buffer-depth",
+                    advance - owner->jitter.offset);
+    var_SetInteger (aout, "audio-buffer-target", target);
+}
+
+/**
+ * Corrects the drift with a resampling proportional to it, rather than
+ * switching resampling on and off.
+ */
+static void aout_DecAdjustResampling (audio_output_t *aout, vlc_tick_t drift)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    const int rate = owner->input_format.i_rate;
+    const int max = rate * AOUT_LOW_LATENCY_MAX_RESAMPLING / 100;
+
+    /* Smooth out the jitter of the output timing */
+    owner->jitter.drift += (drift - owner->jitter.drift) / 8;
+
+    int resampling = owner->jitter.drift * rate / AOUT_LOW_LATENCY_CORRECTION;
+    resampling = VLC_CLIP(resampling, -max, max);
+
+    if (resampling == owner->jitter.resampling)
+        return;
+
+    if (resampling != 0)
+        aout_FiltersAdjustResampling (owner->filters,
+                                      resampling - owner->jitter.resampling);
+    else
+        aout_FiltersAdjustResampling (owner->filters, 0);
+    owner->jitter.resampling = resampling;
+}
+
 static void aout_DecSilence (audio_output_t *aout, vlc_tick_t length, vlc_tick_t pts)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -301,9 +395,17 @@ static void aout_DecSynchronize (audio_output_t *aout, vlc_tick_t dec_pts,
         drift = 0;
     }
 
+    atomic_store_explicit(&owner->drift, drift, memory_order_relaxed);
+
     if (!aout_FiltersCanResample(owner->filters))
         return;
 
+    if (owner->jitter.enabled)
+    {
+        aout_DecAdjustResampling (aout, drift);
+        return;
+    }
+
     /* Resampling */
     if (drift > +AOUT_MAX_PTS_DELAY
      && owner->sync.resamp_type != AOUT_RESAMPLING_UP)
@@ -354,10 +456,13 @@ static void aout_DecSynchronize (audio_output_t *aout, vlc_tick_t dec_pts,
 /*****************************************************************************
  * aout_DecPlay : filter & mix the decoded buffer
  *****************************************************************************/
-int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
+int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate,
+                  bool *played)
 {
     aout_owner_t *owner = aout_owner (aout);
 
+    *played = false;
+
     assert (input_rate >= INPUT_RATE_DEFAULT / AOUT_MAX_INPUT_RATE);
     assert (input_rate <= INPUT_RATE_DEFAULT * AOUT_MAX_INPUT_RATE);
     assert (block->i_pts >= VLC_TICK_0);
@@ -401,6 +506,14 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     /* Software volume */
     aout_volume_Amplify (owner->volume, block);
 
+    /* Jitter buffer */
+    if (owner->jitter.enabled)
+    {
+        aout_DecUpdateJitter (aout, advance);
+        block->i_pts -= owner->jitter.offset;
+        block->i_dts -= owner->jitter.offset;
+    }
+
     /* Drift correction */
     aout_DecSynchronize (aout, block->i_pts, input_rate);
 
@@ -409,6 +522,7 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     owner->sync.discontinuity = false;
     aout_OutputPlay (aout, block);
     atomic_fetch_add(&owner->buffers_played, 1);
+    *played = true;
 out:
     aout_OutputUnlock (aout);
     return ret;
@@ -421,12 +535,14 @@ lost:
 }
 
 void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
-                           unsigned *restrict played)
+                           unsigned *restrict played,
+                           vlc_tick_t *restrict drift)
 {
     aout_owner_t *owner = aout_owner (aout);
 
     *lost = atomic_exchange(&owner->buffers_lost, 0);
     *played = atomic_exchange(&owner->buffers_played, 0);
+    *drift = atomic_load_explicit(&owner->drift, memory_order_relaxed);
 }
 
 void aout_DecChangePause (audio_output_t *aout, bool paused, vlc_tick_t date)
@@ -452,6 +568,8 @@ void aout_DecFlush (audio_output_t *aout, bool wait)
 
     aout_OutputLock (aout);
     owner->sync.end = VLC_TICK_INVALID;
+    owner->jitter.measured = false;
+    owner->jitter.offset = 0;
     if (owner->mixer_format.i_format)
     {
         if (wait)
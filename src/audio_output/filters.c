@@ -42,8 +42,162 @@
 #include <libvlc.h>
 #include "aout_internal.h"
 
+/*** Recycled output buffers ***/
+
+/* Maximum number of released buffers kept for reuse */
+#define AOUT_BUFFERS_MAX 4
+
+typedef struct aout_buffers aout_buffers_t;
+
+typedef struct
+{
+    block_t self;
+    aout_buffers_t *pool;
+    size_t capacity;
+} aout_buffer_t;
+
+struct aout_buffers
+{
+    vlc_mutex_t lock;
+    unsigned refs; /**< Owner and buffers not yet released */
+    bool closed;
+    unsigned count;
+    aout_buffer_t *free[AOUT_BUFFERS_MAX];
+    unsigned max_frame_bytes; /**< Widest frame in the filters pipeline */
+};
+
+static aout_buffers_t *aout_buffers_New (void)
+{
+    aout_buffers_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->closed = false;
+    pool->count = 0;
+    pool->max_frame_bytes = 0;
+    return pool;
+}
+
+static void aout_buffers_Unref (aout_buffers_t *pool)
+{
+    /* Called with the lock held */
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+    {
+        vlc_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
+
+/**
+ * Releases the pool. The buffers still in use remain valid, and are freed
+ * when they are released.
+ */
+static void aout_buffers_Delete (aout_buffers_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    pool->closed = true;
+    for (unsigned i = 0; i < pool->count; i++)
+        free (pool->free[i]);
+    pool->count = 0;
+    aout_buffers_Unref (pool);
+}
+
+static void aout_buffer_Release (block_t *block)
+{
+    aout_buffer_t *buf = container_of (block, aout_buffer_t, self);
+    aout_buffers_t *pool = buf->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (!pool->closed && pool->count < AOUT_BUFFERS_MAX)
+    {
+        pool->free[pool->count++] = buf;
+        buf = NULL;
+    }
+    aout_buffers_Unref (pool);
+    free (buf);
+}
+
+static block_t *aout_buffers_Alloc (aout_buffers_t *pool, size_t size)
+{
+    aout_buffer_t *buf = NULL;
+    unsigned best = 0;
+
+    vlc_mutex_lock (&pool->lock);
+    /* Smallest buffer large enough */
+    for (unsigned i = 0; i < pool->count; i++)
+        if (pool->free[i]->capacity >= size
+         && (buf == NULL || pool->free[i]->capacity < buf->capacity))
+        {
+            buf = pool->free[i];
+            best = i;
+        }
+    if (buf != NULL)
+        pool->free[best] = pool->free[--pool->count];
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (buf == NULL)
+    {
+        /* Round up, so that the buffers can be reused for slightly different
+         * numbers of samples */
+        const size_t capacity = (size + 4095) & ~(size_t)4095;
+
+        buf = malloc (sizeof (*buf) + 32 + capacity);
+        if (unlikely(buf == NULL))
+        {
+            vlc_mutex_lock (&pool->lock);
+            aout_buffers_Unref (pool);
+            return NULL;
+        }
+        buf->pool = pool;
+        buf->capacity = capacity;
+    }
+
+    /* Align the samples on 32 bytes, for the SIMD routines */
+    uint8_t *data = (uint8_t *)(buf + 1);
+    data += (-(uintptr_t)data) & 31;
+
+    block_Init (&buf->self, data, buf->capacity);
+    buf->self.i_buffer = size;
+    buf->self.pf_release = aout_buffer_Release;
+    return &buf->self;
+}
+
+typedef struct
+{
+    aout_buffers_t *buffers;
+    const aout_request_vout_t *request_vout;
+} aout_filter_owner_t;
+
+static block_t *aout_filter_NewBuffer (filter_t *filter, size_t size)
+{
+    aout_filter_owner_t *owner = filter->owner.sys;
+    aout_buffers_t *pool = owner->buffers;
+    const unsigned frame_bytes = filter->fmt_out.audio.i_bytes_per_frame;
+
+    if (pool == NULL)
+        return block_Alloc (size);
+
+    /* Leave room for the following filters to process the samples in
+     * place, up to the widest frame of the pipeline. */
+    size_t capacity = size;
+    if (frame_bytes > 0 && frame_bytes < pool->max_frame_bytes)
+        capacity = __MAX(capacity,
+                         size / frame_bytes * pool->max_frame_bytes);
+
+    block_t *block = aout_buffers_Alloc (pool, capacity);
+    if (likely(block != NULL))
+        block->i_buffer = size;
+    return block;
+}
+
 static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
-                               const char *name, filter_owner_sys_t *owner,
+                               const char *name, aout_filter_owner_t *owner,
                                const audio_sample_format_t *infmt,
                                const audio_sample_format_t *outfmt,
                                config_chain_t *cfg, bool const_fmt)
@@ -53,6 +207,8 @@ static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
         return NULL;
 
     filter->owner.sys = owner;
+    if (owner != NULL)
+        filter->owner.audio.buffer_new = aout_filter_NewBuffer;
     filter->p_cfg = cfg;
     filter->fmt_in.audio = *infmt;
     filter->fmt_in.i_codec = infmt->i_format;
@@ -89,19 +245,19 @@ static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
     return filter;
 }
 
-static filter_t *FindConverter (vlc_object_t *obj,
+static filter_t *FindConverter (vlc_object_t *obj, aout_filter_owner_t *owner,
                                 const audio_sample_format_t *infmt,
                                 const audio_sample_format_t *outfmt)
 {
-    return CreateFilter (obj, "audio converter", NULL, NULL, infmt, outfmt,
+    return CreateFilter (obj, "audio converter", NULL, owner, infmt, outfmt,
                          NULL, true);
 }
 
-static filter_t *FindResampler (vlc_object_t *obj,
+static filter_t *FindResampler (vlc_object_t *obj, aout_filter_owner_t *owner,
                                 const audio_sample_format_t *infmt,
                                 const audio_sample_format_t *outfmt)
 {
-    return CreateFilter (obj, "audio resampler", "$audio-resampler", NULL,
+    return CreateFilter (obj, "audio resampler", "$audio-resampler", owner,
                          infmt, outfmt, NULL, true);
 }
 
@@ -119,7 +275,8 @@ static void aout_FiltersPipelineDestroy(filter_t *const *filters, unsigned n)
     }
 }
 
-static filter_t *TryFormat (vlc_object_t *obj, vlc_fourcc_t codec,
+static filter_t *TryFormat (vlc_object_t *obj, aout_filter_owner_t *owner,
+                            vlc_fourcc_t codec,
                             audio_sample_format_t *restrict fmt)
 {
     audio_sample_format_t output = *fmt;
@@ -128,7 +285,7 @@ static filter_t *TryFormat (vlc_object_t *obj, vlc_fourcc_t codec,
     output.i_format = codec;
     aout_FormatPrepare (&output);
 
-    filter_t *filter = FindConverter (obj, fmt, &output);
+    filter_t *filter = FindConverter (obj, owner, fmt, &output);
     if (filter != NULL)
         *fmt = output;
     return filter;
@@ -137,6 +294,7 @@ static filter_t *TryFormat (vlc_object_t *obj, vlc_fourcc_t codec,
 /**
  * Allocates audio format conversion filters
  * @param obj parent VLC object for new filters
+ * @param owner owner of the new filters
  * @param filters table of filters [IN/OUT]
  * @param count pointer to the number of filters in the table [IN/OUT]
  * @param max size of filters table [IN]
@@ -144,7 +302,9 @@ static filter_t *TryFormat (vlc_object_t *obj, vlc_fourcc_t codec,
  * @param outfmt output audio format
  * @return 0 on success, -1 on failure
  */
-static int aout_FiltersPipelineCreate(vlc_object_t *obj, filter_t **filters,
+static int aout_FiltersPipelineCreate(vlc_object_t *obj,
+                                      aout_filter_owner_t *owner,
+                                      filter_t **filters,
                                       unsigned *count, unsigned max,
                                  const audio_sample_format_t *restrict infmt,
                                  const audio_sample_format_t *restrict outfmt,
@@ -171,12 +331,26 @@ static int aout_FiltersPipelineCreate(vlc_object_t *obj, filter_t **filters,
      || infmt->i_chan_mode != outfmt->i_chan_mode
      || infmt->channel_type != outfmt->channel_type)
     {   /* Remixing currently requires FL32... TODO: S16N */
-        if (input.i_format != VLC_CODEC_FL32)
-        {
-            if (n == max)
-                goto overflow;
+        if (n == max)
+            goto overflow;
+
+        audio_sample_format_t output;
+        output.i_format = VLC_CODEC_FL32;
+        output.i_rate = input.i_rate;
+        output.i_physical_channels = outfmt->i_physical_channels;
+        output.channel_type = outfmt->channel_type;
+        output.i_chan_mode = outfmt->i_chan_mode;
+        aout_FormatPrepare (&output);
 
-            filter_t *f = TryFormat (obj, VLC_CODEC_FL32, &input);
+        /* Some converters can convert to FL32 and remix in a single pass */
+        filter_t *f = NULL;
+        if (input.i_format != VLC_CODEC_FL32
+         && infmt->channel_type == outfmt->channel_type)
+            f = FindConverter (obj, owner, &input, &output);
+
+        if (f == NULL && input.i_format != VLC_CODEC_FL32)
+        {
+            f = TryFormat (obj, owner, VLC_CODEC_FL32, &input);
             if (f == NULL)
             {
                 msg_Err (obj, "cannot find %s for conversion pipeline",
@@ -185,30 +359,25 @@ static int aout_FiltersPipelineCreate(vlc_object_t *obj, filter_t **filters,
             }
 
             filters[n++] = f;
+            f = NULL;
+            if (n == max)
+                goto overflow;
         }
 
-        if (n == max)
-            goto overflow;
-
-        audio_sample_format_t output;
-        output.i_format = input.i_format;
-        output.i_rate = input.i_rate;
-        output.i_physical_channels = outfmt->i_physical_channels;
-        output.channel_type = outfmt->channel_type;
-        output.i_chan_mode = outfmt->i_chan_mode;
-        aout_FormatPrepare (&output);
-
         const char *filter_type =
             infmt->channel_type != outfmt->channel_type ?
             "audio renderer" : "audio converter";
 
-        config_chain_t *cfg = NULL;
-        if (headphones)
-            config_ChainParseOptions(&cfg, "{headphones=true}");
-        filter_t *f = CreateFilter (obj, filter_type, NULL, NULL,
-                                    &input, &output, cfg, true);
-        if (cfg)
-            config_ChainDestroy(cfg);
+        if (f == NULL)
+        {
+            config_chain_t *cfg = NULL;
+            if (headphones)
+                config_ChainParseOptions(&cfg, "{headphones=true}");
+            f = CreateFilter (obj, filter_type, NULL, owner,
+                              &input, &output, cfg, true);
+            if (cfg)
+                config_ChainDestroy(cfg);
+        }
 
         if (f == NULL)
         {
@@ -230,7 +399,7 @@ static int aout_FiltersPipelineCreate(vlc_object_t *obj, filter_t **filters,
         audio_sample_format_t output = input;
         output.i_rate = outfmt->i_rate;
 
-        filter_t *f = FindConverter (obj, &input, &output);
+        filter_t *f = FindConverter (obj, owner, &input, &output);
         if (f == NULL)
         {
             msg_Err (obj, "cannot find %s for conversion pipeline",
@@ -248,7 +417,7 @@ static int aout_FiltersPipelineCreate(vlc_object_t *obj, filter_t **filters,
         if (max == 0)
             goto overflow;
 
-        filter_t *f = TryFormat (obj, outfmt->i_format, &input);
+        filter_t *f = TryFormat (obj, owner, outfmt->i_format, &input);
         if (f == NULL)
         {
             msg_Err (obj, "cannot find %s for conversion pipeline",
@@ -351,6 +520,8 @@ struct aout_filters
     unsigned count; /**< Number of filters */
     filter_t *tab[AOUT_MAX_FILTERS]; /**< Configured user filters
         (e.g. equalization) and their conversions */
+
+    aout_filter_owner_t owner; /**< Owner of all the filters */
 };
 
 /** Callback for visualization selection */
@@ -387,7 +558,8 @@ vout_thread_t *aout_filter_RequestVout (filter_t *filter, vout_thread_t *vout,
      * If you want to use visualization filters from another place, you will
      * need to add a new pf_aout_request_vout callback or store a pointer
      * to aout_request_vout_t inside filter_t (i.e. a level of indirection). */
-    const aout_request_vout_t *req = filter->owner.sys;
+    const aout_filter_owner_t *owner = filter->owner.sys;
+    const aout_request_vout_t *req = owner->request_vout;
     char *visual = var_InheritString (filter->obj.parent, "audio-visual");
     /* NOTE: Disable recycling to always close the filter vout because OpenGL
      * visualizations do not use this function to ask for a context. */
@@ -398,7 +570,7 @@ vout_thread_t *aout_filter_RequestVout (filter_t *filter, vout_thread_t *vout,
 }
 
 static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
-                        aout_filters_t *restrict filters, const void *owner,
+                        aout_filters_t *restrict filters,
                         audio_sample_format_t *restrict infmt,
                         const audio_sample_format_t *restrict outfmt,
                         config_chain_t *cfg)
@@ -410,8 +582,8 @@ static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
         return -1;
     }
 
-    filter_t *filter = CreateFilter (obj, type, name,
-                                     (void *)owner, infmt, outfmt, cfg, false);
+    filter_t *filter = CreateFilter (obj, type, name, &filters->owner,
+                                     infmt, outfmt, cfg, false);
     if (filter == NULL)
     {
         msg_Err (obj, "cannot add user %s \"%s\" (skipped)", type, name);
@@ -419,8 +591,9 @@ static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
     }
 
     /* convert to the filter input format if necessary */
-    if (aout_FiltersPipelineCreate (obj, filters->tab, &filters->count,
-                                    max - 1, infmt, &filter->fmt_in.audio, false))
+    if (aout_FiltersPipelineCreate (obj, &filters->owner, filters->tab,
+                                    &filters->count, max - 1, infmt,
+                                    &filter->fmt_in.audio, false))
     {
         msg_Err (filter, "cannot add user %s \"%s\" (skipped)", type, name);
         module_unneed (filter, filter->p_module);
@@ -470,7 +643,7 @@ static int AppendRemapFilter(vlc_object_t *obj, aout_filters_t *restrict filters
     free(config_ChainCreate(&name, &cfg, str));
     if (name != NULL && cfg != NULL)
         ret = AppendFilter(obj, "audio filter", name, filters,
-                           NULL, infmt, outfmt, cfg);
+                           infmt, outfmt, cfg);
     else
         ret = -1;
 
@@ -511,6 +684,8 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     filters->resampler = NULL;
     filters->resampling = 0;
     filters->count = 0;
+    filters->owner.buffers = aout_buffers_New ();
+    filters->owner.request_vout = request_vout;
 
     /* Prepare format structure */
     aout_FormatPrint (obj, "input", infmt);
@@ -526,7 +701,8 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
         if (!AOUT_FMTS_IDENTICAL(infmt, outfmt))
         {
             aout_FormatsPrint (obj, "pass-through:", infmt, outfmt);
-            filters->tab[0] = FindConverter(obj, infmt, outfmt);
+            filters->tab[0] = FindConverter(obj, &filters->owner,
+                                            infmt, outfmt);
             if (filters->tab[0] == NULL)
             {
                 msg_Err (obj, "cannot setup pass-through");
@@ -550,8 +726,9 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
 
         /* convert to the output format (minus resampling) if necessary */
         output_format.i_rate = input_format.i_rate;
-        if (aout_FiltersPipelineCreate (obj, filters->tab, &filters->count,
-                                  AOUT_MAX_FILTERS, &input_format, &output_format,
+        if (aout_FiltersPipelineCreate (obj, &filters->owner, filters->tab,
+                                  &filters->count, AOUT_MAX_FILTERS,
+                                  &input_format, &output_format,
                                   cfg->headphones))
         {
             msg_Warn (obj, "cannot setup audio renderer pipeline");
@@ -574,7 +751,8 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
         audio_sample_format_t input_phys_format = input_format;
         aout_SetWavePhysicalChannels(&input_phys_format);
 
-        filter_t *f = FindConverter (obj, &input_format, &input_phys_format);
+        filter_t *f = FindConverter (obj, &filters->owner, &input_format,
+                                     &input_phys_format);
         if (f == NULL)
         {
             msg_Err (obj, "cannot find channel converter");
@@ -591,7 +769,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     if (var_InheritBool (obj, "audio-time-stretch"))
     {
         if (AppendFilter(obj, "audio filter", "scaletempo",
-                         filters, NULL, &input_format, &output_format, NULL) == 0)
+                         filters, &input_format, &output_format, NULL) == 0)
             filters->rate_filter = filters->tab[filters->count - 1];
     }
 
@@ -601,7 +779,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
                           cfg->remap);
 
         if (input_format.i_channels > 2 && cfg->headphones)
-            AppendFilter(obj, "audio filter", "binauralizer", filters, NULL,
+            AppendFilter(obj, "audio filter", "binauralizer", filters,
                     &input_format, &output_format, NULL);
     }
 
@@ -613,7 +791,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
         while ((name = strsep (&p, " :")) != NULL)
         {
             AppendFilter(obj, "audio filter", name, filters,
-                         NULL, &input_format, &output_format, NULL);
+                         &input_format, &output_format, NULL);
         }
         free (str);
     }
@@ -623,14 +801,15 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
         char *visual = var_InheritString (obj, "audio-visual");
         if (visual != NULL && strcasecmp (visual, "none"))
             AppendFilter(obj, "visualization", visual, filters,
-                         request_vout, &input_format, &output_format, NULL);
+                         &input_format, &output_format, NULL);
         free (visual);
     }
 
     /* convert to the output format (minus resampling) if necessary */
     output_format.i_rate = input_format.i_rate;
-    if (aout_FiltersPipelineCreate (obj, filters->tab, &filters->count,
-                              AOUT_MAX_FILTERS, &input_format, &output_format, false))
+    if (aout_FiltersPipelineCreate (obj, &filters->owner, filters->tab,
+                              &filters->count, AOUT_MAX_FILTERS,
+                              &input_format, &output_format, false))
     {
         msg_Err (obj, "cannot setup filtering pipeline");
         goto error;
@@ -640,7 +819,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     /* insert the resampler */
     output_format.i_rate = outfmt->i_rate;
     assert (AOUT_FMTS_IDENTICAL(&output_format, outfmt));
-    filters->resampler = FindResampler (obj, &input_format,
+    filters->resampler = FindResampler (obj, &filters->owner, &input_format,
                                         &output_format);
     if (filters->resampler == NULL && input_format.i_rate != outfmt->i_rate)
     {
@@ -650,12 +829,30 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     if (filters->rate_filter == NULL)
         filters->rate_filter = filters->resampler;
 
+    /* Size the output buffers for the widest frames of the pipeline, so that
+     * the following filters can convert the samples in place. */
+    if (filters->owner.buffers != NULL)
+    {
+        unsigned max_frame_bytes = 0;
+        for (unsigned i = 0; i < filters->count; i++)
+        {
+            const filter_t *f = filters->tab[i];
+
+            max_frame_bytes = __MAX(max_frame_bytes,
+                                    f->fmt_in.audio.i_bytes_per_frame);
+            max_frame_bytes = __MAX(max_frame_bytes,
+                                    f->fmt_out.audio.i_bytes_per_frame);
+        }
+        filters->owner.buffers->max_frame_bytes = max_frame_bytes;
+    }
     return filters;
 
 error:
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (request_vout != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+    if (filters->owner.buffers != NULL)
+        aout_buffers_Delete (filters->owner.buffers);
     free (filters);
     return NULL;
 }
@@ -676,6 +873,8 @@ void aout_FiltersDelete (vlc_object_t *obj, aout_filters_t *filters)
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (obj != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+    if (filters->owner.buffers != NULL)
+        aout_buffers_Delete (filters->owner.buffers);
     free (filters);
 }
 
@@ -226,6 +226,10 @@ audio_output_t *aout_New (vlc_object_t *parent)
     var_AddCallback (aout, "device", var_CopyDevice, parent);
     /* TODO: 3.0 HACK: only way to signal DTS_HD to aout modules. */
     var_Create (aout, "dtshd", VLC_VAR_BOOL);
+    /* Low latency mode statistics */
+    var_Create (aout, "audio-buffer-depth", VLC_VAR_INTEGER);
+    var_Create (aout, "audio-buffer-target", VLC_VAR_INTEGER);
+    var_Create (aout, "audio-buffer-underruns", VLC_VAR_INTEGER);
 
     aout->event.volume_report = aout_VolumeNotify;
     aout->event.mute_report = aout_MuteNotify;
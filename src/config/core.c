@@ -534,8 +534,10 @@ module_config_t *config_FindConfig(const char *name)
  * Destroys an array of configuration items.
  * \param config start of array of items
  * \param confsize number of items in the array
+ * \param mapped whether the array is in the plugins cache mapping,
+ *               in which case only the values are allocated
  */
-void config_Free (module_config_t *tab, size_t confsize)
+void config_Free (module_config_t *tab, size_t confsize, bool mapped)
 {
     for (size_t j = 0; j < confsize; j++)
     {
@@ -544,14 +546,16 @@ void config_Free (module_config_t *tab, size_t confsize)
         if (IsConfigStringType (p_item->i_type))
         {
             free (p_item->value.psz);
-            if (p_item->list_count)
+            if (p_item->list_count && !mapped)
                 free (p_item->list.psz);
         }
 
-        free (p_item->list_text);
+        if (!mapped)
+            free (p_item->list_text);
     }
 
-    free (tab);
+    if (!mapped)
+        free (tab);
 }
 
 #undef config_ResetAll
@@ -37,6 +37,7 @@
 #include <libvlc.h>
 #include "stream.h"
 #include "input_internal.h"
+#include "event.h"
 
 /* Decode URL (which has had its scheme stripped earlier) to a file path. */
 char *get_path(const char *location)
@@ -199,14 +200,8 @@ static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
 
     if (block != NULL && input != NULL)
     {
-        uint64_t total;
-
-        vlc_mutex_lock(&input_priv(input)->counters.counters_lock);
-        stats_Update(input_priv(input)->counters.p_read_bytes,
-                     block->i_buffer, &total);
-        stats_Update(input_priv(input)->counters.p_input_bitrate, total, NULL);
-        stats_Update(input_priv(input)->counters.p_read_packets, 1, NULL);
-        vlc_mutex_unlock(&input_priv(input)->counters.counters_lock);
+        stats_Update(input_priv(input)->counters.p_read_bytes, block->i_buffer);
+        stats_Update(input_priv(input)->counters.p_read_packets, 1);
     }
 
     return block;
@@ -227,13 +222,8 @@ static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
 
     if (val > 0 && input != NULL)
     {
-        uint64_t total;
-
-        vlc_mutex_lock(&input_priv(input)->counters.counters_lock);
-        stats_Update(input_priv(input)->counters.p_read_bytes, val, &total);
-        stats_Update(input_priv(input)->counters.p_input_bitrate, total, NULL);
-        stats_Update(input_priv(input)->counters.p_read_packets, 1, NULL);
-        vlc_mutex_unlock(&input_priv(input)->counters.counters_lock);
+        stats_Update(input_priv(input)->counters.p_read_bytes, val);
+        stats_Update(input_priv(input)->counters.p_read_packets, 1);
     }
 
     return val;
@@ -283,6 +273,9 @@ stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
         return NULL;
     }
 
+    if (input != NULL)
+        input_SendEventStartup(input, INPUT_STARTUP_ACCESS, VLC_TICK_INVALID);
+
     s->p_input = input;
     s->psz_url = strdup(access->psz_url);
 
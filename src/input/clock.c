@@ -34,6 +34,8 @@
 #include <vlc_input.h>
 #include "clock.h"
 #include <assert.h>
+#include <math.h>
+#include <stdlib.h>
 
 /* TODO:
  * - clean up locking once clock code is stable
@@ -72,6 +74,12 @@
  * dynamic average value.
  * We use the following formula :
  * new_average = (old_average * c_average + new_sample_value) / (c_average +1)
+ *
+ * With the regression smoothing, the drift is instead fitted to a line over
+ * all the clock references received during the last i_cr_average samples
+ * periods of the average. Unlike the average, it follows a difference of
+ * frequency between the stream clock and the system clock without lagging
+ * behind, and it does not skip the references received in between samples.
  */
 
 
@@ -99,6 +107,17 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Maximum number of clock references used by the regression */
+#define CR_WINDOW_MAX (1024)
+
+/* Maximum difference of frequency between the stream clock and the system
+ * clock, in parts per million, assumed by the regression */
+#define CR_MAX_SKEW (1000)
+
+/* Minimum distance to the regression line above which a clock reference is
+ * clamped, as an outlier */
+#define CR_MIN_OUTLIER (CLOCK_FREQ / 100)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -122,6 +141,39 @@ static void    AvgUpdate( average_t *, vlc_tick_t i_value );
 static vlc_tick_t AvgGet( average_t * );
 static void    AvgRescale( average_t *, int i_divider );
 
+/**
+ * This structure holds a linear regression over the last points
+ */
+typedef struct
+{
+    vlc_tick_t i_x;
+    vlc_tick_t i_y;
+} regression_point_t;
+
+typedef struct
+{
+    regression_point_t *p_points; /* circular, CR_WINDOW_MAX entries */
+    unsigned i_first;
+    unsigned i_count;
+
+    /* Maximum distance between the first and the last points */
+    vlc_tick_t i_span;
+
+    /* Fitted line, going through the mean point */
+    double f_mean_x;
+    double f_mean_y;
+    double f_slope;
+    /* Root mean square distance of the points to the line */
+    double f_deviation;
+} regression_t;
+static int     RegInit( regression_t *, bool b_enabled, vlc_tick_t i_span );
+static void    RegClean( regression_t * );
+
+static void    RegReset( regression_t * );
+static void    RegUpdate( regression_t *, vlc_tick_t i_x, vlc_tick_t i_y );
+static vlc_tick_t RegGet( const regression_t *, vlc_tick_t i_x );
+static void    RegSetSpan( regression_t *, vlc_tick_t i_span );
+
 /* */
 typedef struct
 {
@@ -155,8 +207,13 @@ struct input_clock_t
     vlc_tick_t i_buffering_duration;
 
     /* Clock drift */
+    int i_smoothing;
     vlc_tick_t i_next_drift_update;
     average_t drift;
+    regression_t regression;
+
+    /* Statistics */
+    input_clock_stats_t stats;
 
     /* Late statistics */
     struct
@@ -184,11 +241,12 @@ static vlc_tick_t ClockStreamToSystem( input_clock_t *, vlc_tick_t i_stream );
 static vlc_tick_t ClockSystemToStream( input_clock_t *, vlc_tick_t i_system );
 
 static vlc_tick_t ClockGetTsOffset( input_clock_t * );
+static vlc_tick_t ClockGetDrift( input_clock_t *, vlc_tick_t i_stream );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( int i_rate )
+input_clock_t *input_clock_New( int i_rate, int i_smoothing )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
@@ -205,8 +263,19 @@ input_clock_t *input_clock_New( int i_rate )
 
     cl->i_buffering_duration = 0;
 
+    cl->i_smoothing = i_smoothing;
     cl->i_next_drift_update = VLC_TICK_INVALID;
     AvgInit( &cl->drift, 10 );
+    if( RegInit( &cl->regression,
+                 i_smoothing == INPUT_CLOCK_SMOOTHING_REGRESSION,
+                 10 * CLOCK_FREQ/5 ) )
+    {
+        vlc_mutex_destroy( &cl->lock );
+        free( cl );
+        return NULL;
+    }
+
+    memset( &cl->stats, 0, sizeof(cl->stats) );
 
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
@@ -226,6 +295,7 @@ input_clock_t *input_clock_New( int i_rate )
 void input_clock_Delete( input_clock_t *cl )
 {
     AvgClean( &cl->drift );
+    RegClean( &cl->regression );
     vlc_mutex_destroy( &cl->lock );
     free( cl );
 }
@@ -272,6 +342,8 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TICK_INVALID;
         AvgReset( &cl->drift );
+        RegReset( &cl->regression );
+        cl->stats.i_resets++;
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -282,13 +354,33 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* Compute the drift between the stream clock and the system clock
      * when we don't control the source pace */
-    if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
+    if( !b_can_pace_control )
     {
-        const vlc_tick_t i_converted = ClockSystemToStream( cl, i_ck_system );
+        const vlc_tick_t i_drift = ClockSystemToStream( cl, i_ck_system ) - i_ck_stream;
+
+        /* Measure the jitter against the current estimation */
+        if( !b_reset_reference )
+        {
+            const vlc_tick_t i_jitter = llabs( i_drift - ClockGetDrift( cl, i_ck_stream ) );
+            unsigned i_bucket = 0;
+
+            while( i_bucket < INPUT_CLOCK_JITTER_BUCKETS - 1 &&
+                   i_jitter >= (CLOCK_FREQ / 1000) << i_bucket )
+                i_bucket++;
+            cl->stats.pi_jitter[i_bucket]++;
+            cl->stats.i_jitter_sum += i_jitter;
+        }
 
-        AvgUpdate( &cl->drift, i_converted - i_ck_stream );
+        if( cl->i_smoothing == INPUT_CLOCK_SMOOTHING_REGRESSION )
+        {
+            RegUpdate( &cl->regression, i_ck_stream - cl->ref.i_stream, i_drift );
+        }
+        else if( cl->i_next_drift_update < i_ck_system )
+        {
+            AvgUpdate( &cl->drift, i_drift );
 
-        cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
+            cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
+        }
     }
 
     /* Update the extra buffering value */
@@ -314,7 +406,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const vlc_tick_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const vlc_tick_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + ClockGetDrift( cl, i_ck_stream ) );
     const vlc_tick_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
     if( i_late > 0 )
@@ -394,7 +486,7 @@ vlc_tick_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + ClockGetDrift( cl, cl->last.i_stream ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -432,7 +524,7 @@ int input_clock_ConvertTS( vlc_object_t *p_object, input_clock_t *cl,
     /* */
     if( *pi_ts0 > VLC_TICK_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + ClockGetDrift( cl, *pi_ts0 ) );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -441,7 +533,7 @@ int input_clock_ConvertTS( vlc_object_t *p_object, input_clock_t *cl,
     /* XXX we do not update i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TICK_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + ClockGetDrift( cl, *pi_ts1 ) ) +
                   i_ts_delay;
     }
 
@@ -572,6 +664,7 @@ void input_clock_SetJitter( input_clock_t *cl,
 
     if( cl->drift.i_divider != i_cr_average )
         AvgRescale( &cl->drift, i_cr_average );
+    RegSetSpan( &cl->regression, i_cr_average * CLOCK_FREQ/5 );
 
     vlc_mutex_unlock( &cl->lock );
 }
@@ -598,6 +691,17 @@ vlc_tick_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_GetStats( input_clock_t *cl, input_clock_stats_t *p_stats )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    *p_stats = cl->stats;
+    p_stats->i_drift = cl->b_has_reference ?
+                       ClockGetDrift( cl, cl->last.i_stream ) : 0;
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -631,6 +735,16 @@ static vlc_tick_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+/**
+ * It returns the estimated drift to apply to the given stream date.
+ */
+static vlc_tick_t ClockGetDrift( input_clock_t *cl, vlc_tick_t i_stream )
+{
+    if( cl->i_smoothing == INPUT_CLOCK_SMOOTHING_REGRESSION )
+        return RegGet( &cl->regression, i_stream - cl->ref.i_stream );
+    return AvgGet( &cl->drift );
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
@@ -673,3 +787,115 @@ static void AvgRescale( average_t *p_avg, int i_divider )
     p_avg->i_value   = i_tmp / p_avg->i_divider;
     p_avg->i_residue = i_tmp % p_avg->i_divider;
 }
+
+/*****************************************************************************
+ * Linear regression helpers
+ *****************************************************************************/
+static int RegInit( regression_t *p_reg, bool b_enabled, vlc_tick_t i_span )
+{
+    p_reg->p_points = NULL;
+    if( b_enabled )
+    {
+        p_reg->p_points = vlc_alloc( CR_WINDOW_MAX, sizeof(*p_reg->p_points) );
+        if( unlikely(p_reg->p_points == NULL) )
+            return VLC_ENOMEM;
+    }
+    p_reg->i_span = i_span;
+    RegReset( p_reg );
+    return VLC_SUCCESS;
+}
+static void RegClean( regression_t *p_reg )
+{
+    free( p_reg->p_points );
+}
+static void RegReset( regression_t *p_reg )
+{
+    p_reg->i_first = 0;
+    p_reg->i_count = 0;
+    p_reg->f_mean_x = 0.;
+    p_reg->f_mean_y = 0.;
+    p_reg->f_slope = 0.;
+    p_reg->f_deviation = 0.;
+}
+static void RegFit( regression_t *p_reg )
+{
+    double f_mean_x = 0., f_mean_y = 0.;
+
+    for( unsigned i = 0; i < p_reg->i_count; i++ )
+    {
+        const regression_point_t *p = &p_reg->p_points[(p_reg->i_first + i) % CR_WINDOW_MAX];
+        f_mean_x += p->i_x;
+        f_mean_y += p->i_y;
+    }
+    f_mean_x /= p_reg->i_count;
+    f_mean_y /= p_reg->i_count;
+
+    /* Centered sums, the dates relative to the reference point can be
+     * large */
+    double f_sxx = 0., f_sxy = 0., f_syy = 0.;
+    for( unsigned i = 0; i < p_reg->i_count; i++ )
+    {
+        const regression_point_t *p = &p_reg->p_points[(p_reg->i_first + i) % CR_WINDOW_MAX];
+        const double f_dx = p->i_x - f_mean_x;
+        const double f_dy = p->i_y - f_mean_y;
+
+        f_sxx += f_dx * f_dx;
+        f_sxy += f_dx * f_dy;
+        f_syy += f_dy * f_dy;
+    }
+
+    double f_slope = f_sxx > 0. ? f_sxy / f_sxx : 0.;
+    if( f_slope > CR_MAX_SKEW * 1e-6 )
+        f_slope = CR_MAX_SKEW * 1e-6;
+    else if( f_slope < -CR_MAX_SKEW * 1e-6 )
+        f_slope = -CR_MAX_SKEW * 1e-6;
+
+    p_reg->f_mean_x = f_mean_x;
+    p_reg->f_mean_y = f_mean_y;
+    p_reg->f_slope = f_slope;
+    /* The residual sum of squares is Syy - 2 b Sxy + b^2 Sxx */
+    p_reg->f_deviation = sqrt( __MAX( f_syy - 2. * f_slope * f_sxy +
+                                      f_slope * f_slope * f_sxx, 0. ) /
+                               p_reg->i_count );
+}
+static void RegUpdate( regression_t *p_reg, vlc_tick_t i_x, vlc_tick_t i_y )
+{
+    /* Drop the points out of the window */
+    while( p_reg->i_count > 0 &&
+           ( p_reg->i_count >= CR_WINDOW_MAX ||
+             p_reg->p_points[p_reg->i_first].i_x < i_x - p_reg->i_span ) )
+    {
+        p_reg->i_first = (p_reg->i_first + 1) % CR_WINDOW_MAX;
+        p_reg->i_count--;
+    }
+
+    /* Clamp the outliers, so that a burst of references (after a network
+     * stall for example) only moves the line progressively */
+    if( p_reg->i_count >= 8 )
+    {
+        const vlc_tick_t i_expected = RegGet( p_reg, i_x );
+        const vlc_tick_t i_max = __MAX( llround( 4. * p_reg->f_deviation ),
+                                        CR_MIN_OUTLIER );
+
+        if( i_y > i_expected + i_max )
+            i_y = i_expected + i_max;
+        else if( i_y < i_expected - i_max )
+            i_y = i_expected - i_max;
+    }
+
+    regression_point_t *p = &p_reg->p_points[(p_reg->i_first + p_reg->i_count) % CR_WINDOW_MAX];
+    p->i_x = i_x;
+    p->i_y = i_y;
+    p_reg->i_count++;
+
+    RegFit( p_reg );
+}
+static vlc_tick_t RegGet( const regression_t *p_reg, vlc_tick_t i_x )
+{
+    return llround( p_reg->f_mean_y + p_reg->f_slope * (i_x - p_reg->f_mean_x) );
+}
+static void RegSetSpan( regression_t *p_reg, vlc_tick_t i_span )
+{
+    /* The window will shrink on the next update */
+    p_reg->i_span = i_span;
+}
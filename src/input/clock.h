@@ -36,11 +36,42 @@
  */
 typedef struct input_clock_t input_clock_t;
 
+/**
+ * Algorithms used to estimate the drift between the stream clock and the
+ * system clock, when the pace of the source is not controlled.
+ */
+enum input_clock_smoothing_e
+{
+    /** Long term average of the drift, sampled every 200ms */
+    INPUT_CLOCK_SMOOTHING_AVERAGE,
+    /** Linear regression of the drift over the last clock references */
+    INPUT_CLOCK_SMOOTHING_REGRESSION,
+};
+
+/**
+ * Clock statistics
+ */
+typedef struct
+{
+    /** Current drift estimation, in stream clock unit */
+    vlc_tick_t i_drift;
+    /** Number of reference points set, including the first one */
+    unsigned   i_resets;
+    /** Distance between the clock references and their expected dates,
+     * see INPUT_CLOCK_JITTER_BUCKETS */
+    uint64_t   pi_jitter[INPUT_CLOCK_JITTER_BUCKETS];
+    /** Sum of the distances counted in the histogram */
+    vlc_tick_t i_jitter_sum;
+} input_clock_stats_t;
+
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
+ *
+ * \param i_smoothing the drift estimation algorithm
+ * (see input_clock_smoothing_e)
  */
-input_clock_t *input_clock_New( int i_rate );
+input_clock_t *input_clock_New( int i_rate, int i_smoothing );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -136,4 +167,9 @@ void input_clock_SetJitter( input_clock_t *,
  */
 vlc_tick_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the statistics of the clock.
+ */
+void input_clock_GetStats( input_clock_t *, input_clock_stats_t * );
+
 #endif
@@ -574,6 +574,14 @@ int input_vaControl( input_thread_t *p_input, int i_query, va_list args )
             return es_out_ControlModifyPcrSystem( priv->p_es_out_display, b_absolute, i_system );
         }
 
+        case INPUT_GET_STARTUP:
+        {
+            int64_t *pi_delay = va_arg( args, int64_t * );
+
+            input_GetStartup( p_input, pi_delay );
+            return VLC_SUCCESS;
+        }
+
         case INPUT_SET_RENDERER:
         {
             vlc_renderer_item_t* p_item = va_arg( args, vlc_renderer_item_t* );
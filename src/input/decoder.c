@@ -49,6 +49,7 @@
 #include "input_internal.h"
 #include "clock.h"
 #include "decoder.h"
+#include "decoder_pool.h"
 #include "event.h"
 #include "resource.h"
 
@@ -79,6 +80,10 @@ struct decoder_owner_sys_t
     sout_packetizer_input_t *p_sout_input;
 
     vlc_thread_t     thread;
+    /* Shared threads, if the decoder has no thread of its own */
+    decoder_pool_t  *p_pool;
+    decoder_pool_job_t job;
+    bool             b_dead;
 
     void (*pf_update_stat)( decoder_owner_sys_t *, unsigned decoded, unsigned lost );
 
@@ -116,6 +121,7 @@ struct decoder_owner_sys_t
     vlc_tick_t pause_date;
     unsigned frames_countdown;
     bool paused;
+    bool output_paused; /* Only accessed by the thread running the decoder */
 
     bool error;
 
@@ -253,6 +259,23 @@ static int ReloadDecoder( decoder_t *p_dec, bool b_packetizer,
     return VLC_SUCCESS;
 }
 
+/* Lets the shared threads run the other decoders while this one is blocked */
+static void DecoderEnterWait( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->p_pool != NULL )
+        decoder_pool_EnterWait( p_owner->p_pool );
+}
+
+static void DecoderLeaveWait( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->p_pool != NULL )
+        decoder_pool_LeaveWait( p_owner->p_pool );
+}
+
 static void DecoderUpdateFormatLocked( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -587,7 +610,9 @@ static subpicture_t *spu_new_buffer( decoder_t *p_dec,
         if( p_vout )
             break;
 
+        DecoderEnterWait( p_dec );
         msleep( DECODER_SPU_VOUT_WAIT_DURATION );
+        DecoderLeaveWait( p_dec );
     }
 
     if( !p_vout )
@@ -739,12 +764,17 @@ static void DecoderWaitUnblock( decoder_t *p_dec )
 
     vlc_assert_locked( &p_owner->lock );
 
+    if( !p_owner->b_waiting || !p_owner->b_has_data )
+        return;
+
+    DecoderEnterWait( p_dec );
     for( ;; )
     {
         if( !p_owner->b_waiting || !p_owner->b_has_data )
             break;
         vlc_cond_wait( &p_owner->wait_request, &p_owner->lock );
     }
+    DecoderLeaveWait( p_dec );
 }
 
 /* DecoderTimedWait: Interruptible wait
@@ -756,12 +786,14 @@ static int DecoderTimedWait( decoder_t *p_dec, vlc_tick_t deadline )
     if (deadline - mdate() <= 0)
         return VLC_SUCCESS;
 
+    DecoderEnterWait( p_dec );
     vlc_fifo_Lock( p_owner->p_fifo );
     while( !p_owner->flushing
         && vlc_fifo_TimedWaitCond( p_owner->p_fifo, &p_owner->wait_timed,
                                    deadline ) == 0 );
     int ret = p_owner->flushing ? VLC_EGENERIC : VLC_SUCCESS;
     vlc_fifo_Unlock( p_owner->p_fifo );
+    DecoderLeaveWait( p_dec );
     return ret;
 }
 
@@ -1108,16 +1140,20 @@ static void DecoderUpdateStatVideo( decoder_owner_sys_t *p_owner,
     if( p_owner->p_vout != NULL )
     {
         unsigned vout_lost = 0;
+        vlc_tick_t first_displayed;
 
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost,
+                                &first_displayed );
         lost += vout_lost;
+
+        if( displayed > 0 )
+            input_SendEventStartup( p_input, INPUT_STARTUP_FIRST_PICTURE,
+                                    first_displayed );
     }
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
-    stats_Update( input_priv(p_input)->counters.p_decoded_video, decoded, NULL );
-    stats_Update( input_priv(p_input)->counters.p_lost_pictures, lost , NULL);
-    stats_Update( input_priv(p_input)->counters.p_displayed_pictures, displayed, NULL);
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
+    stats_Update( input_priv(p_input)->counters.p_decoded_video, decoded );
+    stats_Update( input_priv(p_input)->counters.p_lost_pictures, lost );
+    stats_Update( input_priv(p_input)->counters.p_displayed_pictures, displayed );
 }
 
 static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
@@ -1126,6 +1162,10 @@ static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
     unsigned i_lost = 0;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_owner->p_input != NULL )
+        input_SendEventStartup( p_owner->p_input, INPUT_STARTUP_FIRST_FRAME,
+                                VLC_TICK_INVALID );
+
     int ret = DecoderPlayVideo( p_dec, p_pic, &i_lost );
 
     p_owner->pf_update_stat( p_owner, 1, i_lost );
@@ -1192,7 +1232,15 @@ static int DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
      && i_rate <= INPUT_RATE_DEFAULT*AOUT_MAX_INPUT_RATE
      && !DecoderTimedWait( p_dec, p_audio->i_pts - AOUT_MAX_PREPARE_TIME ) )
     {
-        int status = aout_DecPlay( p_aout, p_audio, i_rate );
+        /* The samples are played at their date, once the output synced */
+        const vlc_tick_t i_date = p_audio->i_pts;
+
+        bool b_played;
+        int status = aout_DecPlay( p_aout, p_audio, i_rate, &b_played );
+        if( b_played && p_owner->p_input != NULL )
+            input_SendEventStartup( p_owner->p_input,
+                                    INPUT_STARTUP_FIRST_AUDIO, i_date );
+
         if( status == AOUT_DEC_CHANGED )
         {
             /* Only reload the decoder */
@@ -1228,16 +1276,16 @@ static void DecoderUpdateStatAudio( decoder_owner_sys_t *p_owner,
     if( p_owner->p_aout != NULL )
     {
         unsigned aout_lost;
+        vlc_tick_t drift;
 
-        aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played );
+        aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played, &drift );
         lost += aout_lost;
+        stats_Set( input_priv(p_input)->counters.p_audio_drift, drift );
     }
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock);
-    stats_Update( input_priv(p_input)->counters.p_lost_abuffers, lost, NULL );
-    stats_Update( input_priv(p_input)->counters.p_played_abuffers, played, NULL );
-    stats_Update( input_priv(p_input)->counters.p_decoded_audio, decoded, NULL );
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock);
+    stats_Update( input_priv(p_input)->counters.p_lost_abuffers, lost );
+    stats_Update( input_priv(p_input)->counters.p_played_abuffers, played );
+    stats_Update( input_priv(p_input)->counters.p_decoded_audio, decoded );
 }
 
 static int DecoderQueueAudio( decoder_t *p_dec, block_t *p_aout_buf )
@@ -1245,6 +1293,10 @@ static int DecoderQueueAudio( decoder_t *p_dec, block_t *p_aout_buf )
     unsigned lost = 0;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_owner->p_input != NULL )
+        input_SendEventStartup( p_owner->p_input, INPUT_STARTUP_FIRST_FRAME,
+                                VLC_TICK_INVALID );
+
     int ret = DecoderPlayAudio( p_dec, p_aout_buf, &lost );
 
     p_owner->pf_update_stat( p_owner, 1, lost );
@@ -1302,11 +1354,7 @@ static int DecoderQueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
     input_thread_t *p_input = p_owner->p_input;
 
     if( p_input != NULL )
-    {
-        vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
-        stats_Update( input_priv(p_input)->counters.p_decoded_sub, 1, NULL );
-        vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
-    }
+        stats_Update( input_priv(p_input)->counters.p_decoded_sub, 1 );
 
     int i_ret = -1;
     vout_thread_t *p_vout = input_resource_HoldVout( p_owner->p_resource );
@@ -1534,118 +1582,161 @@ static void DecoderProcessFlush( decoder_t *p_dec )
 }
 
 /**
- * The decoding main loop
+ * Handles the next request, or decodes the next block of the decoder.
+ *
+ * The fifo must be locked. It is unlocked while the decoder is running, and
+ * locked again on return.
  *
  * \param p_dec the decoder
+ * \return false if there was nothing to do
  */
-static void *DecoderThread( void *p_data )
+static bool DecoderRunOnce( decoder_t *p_dec )
 {
-    decoder_t *p_dec = (decoder_t *)p_data;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
-    bool paused = false;
 
-    /* The decoder's main loop */
-    vlc_fifo_Lock( p_owner->p_fifo );
-    vlc_fifo_CleanupPush( p_owner->p_fifo );
+    if( p_owner->flushing )
+    {   /* Flush before/regardless of pause. We do not want to resume just
+         * for the sake of flushing (glitches could otherwise happen). */
+        int canc = vlc_savecancel();
 
-    for( ;; )
-    {
-        if( p_owner->flushing )
-        {   /* Flush before/regardless of pause. We do not want to resume just
-             * for the sake of flushing (glitches could otherwise happen). */
-            int canc = vlc_savecancel();
+        vlc_fifo_Unlock( p_owner->p_fifo );
 
-            vlc_fifo_Unlock( p_owner->p_fifo );
+        /* Flush the decoder (and the output) */
+        DecoderProcessFlush( p_dec );
 
-            /* Flush the decoder (and the output) */
-            DecoderProcessFlush( p_dec );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_restorecancel( canc );
 
-            vlc_fifo_Lock( p_owner->p_fifo );
-            vlc_restorecancel( canc );
+        /* Reset flushing after DecoderProcess in case input_DecoderFlush
+         * is called again. This will avoid a second useless flush (but
+         * harmless). */
+        p_owner->flushing = false;
 
-            /* Reset flushing after DecoderProcess in case input_DecoderFlush
-             * is called again. This will avoid a second useless flush (but
-             * harmless). */
-            p_owner->flushing = false;
+        return true;
+    }
 
-            continue;
-        }
+    if( p_owner->output_paused != p_owner->paused )
+    {   /* Update playing/paused status of the output */
+        int canc = vlc_savecancel();
+        vlc_tick_t date = p_owner->pause_date;
+        bool paused = p_owner->paused;
 
-        if( paused != p_owner->paused )
-        {   /* Update playing/paused status of the output */
-            int canc = vlc_savecancel();
-            vlc_tick_t date = p_owner->pause_date;
+        p_owner->output_paused = paused;
+        vlc_fifo_Unlock( p_owner->p_fifo );
 
-            paused = p_owner->paused;
-            vlc_fifo_Unlock( p_owner->p_fifo );
+        /* NOTE: Only the audio and video outputs care about pause. */
+        msg_Dbg( p_dec, "toggling %s", paused ? "resume" : "pause" );
+        if( p_owner->p_vout != NULL )
+            vout_ChangePause( p_owner->p_vout, paused, date );
+        if( p_owner->p_aout != NULL )
+            aout_DecChangePause( p_owner->p_aout, paused, date );
 
-            /* NOTE: Only the audio and video outputs care about pause. */
-            msg_Dbg( p_dec, "toggling %s", paused ? "resume" : "pause" );
-            if( p_owner->p_vout != NULL )
-                vout_ChangePause( p_owner->p_vout, paused, date );
-            if( p_owner->p_aout != NULL )
-                aout_DecChangePause( p_owner->p_aout, paused, date );
+        vlc_restorecancel( canc );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        return true;
+    }
 
-            vlc_restorecancel( canc );
-            vlc_fifo_Lock( p_owner->p_fifo );
-            continue;
-        }
+    if( p_owner->paused && p_owner->frames_countdown == 0 )
+        return false; /* Wait for resumption from pause */
 
-        if( p_owner->paused && p_owner->frames_countdown == 0 )
-        {   /* Wait for resumption from pause */
-            p_owner->b_idle = true;
-            vlc_cond_signal( &p_owner->wait_acknowledge );
-            vlc_fifo_Wait( p_owner->p_fifo );
-            p_owner->b_idle = false;
-            continue;
-        }
+    vlc_cond_signal( &p_owner->wait_fifo );
+    vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
-        vlc_cond_signal( &p_owner->wait_fifo );
-        vlc_testcancel(); /* forced expedited cancellation in case of stop */
+    block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+    if( p_block == NULL )
+    {
+        if( likely(!p_owner->b_draining) )
+            return false; /* Wait for a block to decode (or a request to drain) */
+        /* We have emptied the FIFO and there is a pending request to
+         * drain. Pass p_block = NULL to decoder just once. */
+    }
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
-        if( p_block == NULL )
-        {
-            if( likely(!p_owner->b_draining) )
-            {   /* Wait for a block to decode (or a request to drain) */
-                p_owner->b_idle = true;
-                vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
-                p_owner->b_idle = false;
-                continue;
-            }
-            /* We have emptied the FIFO and there is a pending request to
-             * drain. Pass p_block = NULL to decoder just once. */
-        }
+    vlc_fifo_Unlock( p_owner->p_fifo );
 
-        vlc_fifo_Unlock( p_owner->p_fifo );
+    int canc = vlc_savecancel();
+    DecoderProcess( p_dec, p_block );
 
-        int canc = vlc_savecancel();
-        DecoderProcess( p_dec, p_block );
+    if( p_block == NULL )
+    {   /* Draining: the decoder is drained and all decoded buffers are
+         * queued to the output at this point. Now drain the output. */
+        if( p_owner->p_aout != NULL )
+            aout_DecFlush( p_owner->p_aout, true );
+    }
+    vlc_restorecancel( canc );
 
-        if( p_block == NULL )
-        {   /* Draining: the decoder is drained and all decoded buffers are
-             * queued to the output at this point. Now drain the output. */
-            if( p_owner->p_aout != NULL )
-                aout_DecFlush( p_owner->p_aout, true );
-        }
-        vlc_restorecancel( canc );
+    /* TODO? Wait for draining instead of polling. */
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->b_draining && (p_block == NULL) )
+    {
+        p_owner->b_draining = false;
+        p_owner->drained = true;
+    }
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_cond_signal( &p_owner->wait_acknowledge );
+    vlc_mutex_unlock( &p_owner->lock );
+    return true;
+}
 
-        /* TODO? Wait for draining instead of polling. */
-        vlc_mutex_lock( &p_owner->lock );
-        if( p_owner->b_draining && (p_block == NULL) )
-        {
-            p_owner->b_draining = false;
-            p_owner->drained = true;
-        }
-        vlc_fifo_Lock( p_owner->p_fifo );
+/**
+ * The decoding main loop
+ *
+ * \param p_dec the decoder
+ */
+static void *DecoderThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    /* The decoder's main loop */
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_fifo_CleanupPush( p_owner->p_fifo );
+
+    for( ;; )
+    {
+        if( DecoderRunOnce( p_dec ) )
+            continue;
+
+        p_owner->b_idle = true;
         vlc_cond_signal( &p_owner->wait_acknowledge );
-        vlc_mutex_unlock( &p_owner->lock );
+        vlc_fifo_Wait( p_owner->p_fifo );
+        p_owner->b_idle = false;
     }
     vlc_cleanup_pop();
     vlc_assert_unreachable();
 }
 
+/**
+ * Runs a decoder of the pool until it has nothing left to do
+ *
+ * \param p_dec the decoder
+ */
+static void DecoderPoolRun( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->b_idle = false;
+    while( !p_owner->b_dead && DecoderRunOnce( p_dec ) );
+    p_owner->b_idle = true;
+    vlc_cond_signal( &p_owner->wait_acknowledge );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+/**
+ * Wakes the decoder up, to handle a request or a new block.
+ * The fifo must be locked.
+ */
+static void DecoderSignal( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Schedule( p_owner->p_pool, &p_owner->job );
+    else
+        vlc_fifo_Signal( p_owner->p_fifo );
+}
+
 /**
  * Create a decoder object
  *
@@ -1691,6 +1782,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_description = NULL;
 
     p_owner->paused = false;
+    p_owner->output_paused = false;
     p_owner->pause_date = VLC_TICK_INVALID;
     p_owner->frames_countdown = 0;
 
@@ -1706,6 +1798,10 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
     p_owner->b_idle = false;
 
+    p_owner->p_pool = NULL;
+    decoder_pool_InitJob( &p_owner->job, DecoderPoolRun, p_dec );
+    p_owner->b_dead = false;
+
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
     /* decoder fifo */
@@ -1757,6 +1853,10 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     if( LoadDecoder( p_dec, p_sout != NULL, fmt ) )
         return p_dec;
 
+    if( p_input != NULL )
+        input_SendEventStartup( p_input, INPUT_STARTUP_DECODER,
+                                VLC_TICK_INVALID );
+
     switch( p_dec->fmt_out.i_cat )
     {
         case VIDEO_ES:
@@ -1904,6 +2004,35 @@ static void DecoderUnsupportedCodec( decoder_t *p_dec, const es_format_t *fmt, b
     }
 }
 
+/**
+ * Tells whether a decoder is idle enough to run on the shared threads
+ */
+static bool DecoderIsLowRate( decoder_t *p_dec, const es_format_t *fmt )
+{
+    switch( fmt->i_cat )
+    {
+        case SPU_ES:
+            return true;
+
+        case AUDIO_ES:
+        {
+            /* Compute the rate of linear PCM if it is unknown. The rate of
+             * compressed audio is assumed to be low if it is unknown. */
+            uint64_t i_bitrate = fmt->i_bitrate;
+            if( i_bitrate == 0 )
+                i_bitrate = (uint64_t)aout_BitsPerSample( fmt->i_codec )
+                          * fmt->audio.i_rate * fmt->audio.i_channels;
+
+            return i_bitrate
+                 < 1000 * (uint64_t)var_InheritInteger( p_dec,
+                                                "decoder-pool-audio-bitrate" );
+        }
+
+        default:
+            return false;
+    }
+}
+
 /* TODO: pass p_sout through p_resource? -- Courmisch */
 static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
                                const es_format_t *fmt, input_clock_t *p_clock,
@@ -1935,6 +2064,17 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     p_dec->p_owner->p_clock = p_clock;
     assert( p_dec->fmt_out.i_cat != UNKNOWN_ES );
 
+    if( DecoderIsLowRate( p_dec, fmt ) )
+    {   /* Run the decoder on the shared threads */
+        decoder_pool_t *p_pool = libvlc_priv( p_dec->obj.libvlc )->decoder_pool;
+        if( p_pool != NULL )
+        {
+            p_dec->p_owner->p_pool = p_pool;
+            p_dec->p_owner->b_idle = true;
+            return p_dec;
+        }
+    }
+
     if( p_dec->fmt_out.i_cat == AUDIO_ES )
         i_priority = VLC_THREAD_PRIORITY_AUDIO;
     else
@@ -1988,9 +2128,11 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    vlc_cancel( p_owner->thread );
+    if( p_owner->p_pool == NULL )
+        vlc_cancel( p_owner->thread );
 
     vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->b_dead = true;
     /* Signal DecoderTimedWait */
     p_owner->flushing = true;
     vlc_cond_signal( &p_owner->wait_timed );
@@ -2012,7 +2154,10 @@ void input_DecoderDelete( decoder_t *p_dec )
         vout_Cancel( p_owner->p_vout, true );
     vlc_mutex_unlock( &p_owner->lock );
 
-    vlc_join( p_owner->thread, NULL );
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Cancel( p_owner->p_pool, &p_owner->job );
+    else
+        vlc_join( p_owner->thread, NULL );
 
     /* */
     if( p_dec->p_owner->cc.b_supported )
@@ -2060,6 +2205,8 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     }
 
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    if( p_owner->p_pool != NULL )
+        decoder_pool_Schedule( p_owner->p_pool, &p_owner->job );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2110,7 +2257,7 @@ void input_DecoderDrain( decoder_t *p_dec )
 
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->b_draining = true;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_dec );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2140,7 +2287,7 @@ void input_DecoderFlush( decoder_t *p_dec )
      && p_owner->frames_countdown == 0 )
         p_owner->frames_countdown++;
 
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_dec );
     vlc_cond_signal( &p_owner->wait_timed );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2258,7 +2405,7 @@ void input_DecoderChangePause( decoder_t *p_dec, bool b_paused, vlc_tick_t i_dat
     p_owner->paused = b_paused;
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_dec );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2332,7 +2479,7 @@ void input_DecoderFrameNext( decoder_t *p_dec, vlc_tick_t *pi_duration )
 
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->frames_countdown++;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderSignal( p_dec );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     vlc_mutex_lock( &p_owner->lock );
@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * decoder_pool.c: Shared threads for low rate decoders
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "../libvlc.h"
+#include "decoder_pool.h"
+
+/* Idle threads exit after this delay */
+#define DECODER_POOL_IDLE_TIMEOUT (5 * CLOCK_FREQ)
+
+struct decoder_pool_t
+{
+    vlc_object_t *p_parent;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_job;   /* Signaled when a job is queued */
+    vlc_cond_t  wait_done;  /* Signaled when a job or a thread ends */
+
+    decoder_pool_job_t  *p_first;
+    decoder_pool_job_t **pp_last;
+    unsigned i_queued;
+
+    unsigned i_threads;
+    unsigned i_idle;
+    unsigned i_blocked; /* Threads waiting inside a job */
+    unsigned i_max;     /* Threads not blocked */
+    bool b_closing;
+};
+
+static void Enqueue( decoder_pool_t *p_pool, decoder_pool_job_t *p_job )
+{
+    p_job->p_next = NULL;
+    p_job->b_queued = true;
+    *p_pool->pp_last = p_job;
+    p_pool->pp_last = &p_job->p_next;
+    p_pool->i_queued++;
+}
+
+static decoder_pool_job_t *Dequeue( decoder_pool_t *p_pool )
+{
+    decoder_pool_job_t *p_job = p_pool->p_first;
+
+    if( p_job != NULL )
+    {
+        p_pool->p_first = p_job->p_next;
+        if( p_pool->p_first == NULL )
+            p_pool->pp_last = &p_pool->p_first;
+        p_pool->i_queued--;
+        p_job->b_queued = false;
+    }
+    return p_job;
+}
+
+static void *Thread( void *p_data )
+{
+    decoder_pool_t *p_pool = p_data;
+
+    vlc_mutex_lock( &p_pool->lock );
+    for( ;; )
+    {
+        decoder_pool_job_t *p_job = Dequeue( p_pool );
+        if( p_job == NULL )
+        {
+            if( p_pool->b_closing )
+                break;
+            /* Exit if more threads were spawned while jobs were blocked */
+            if( p_pool->i_threads - p_pool->i_blocked > p_pool->i_max )
+                break;
+
+            p_pool->i_idle++;
+            int ret = vlc_cond_timedwait( &p_pool->wait_job, &p_pool->lock,
+                                          mdate() + DECODER_POOL_IDLE_TIMEOUT );
+            p_pool->i_idle--;
+            if( ret != 0 && p_pool->p_first == NULL )
+                break;
+            continue;
+        }
+
+        p_job->b_running = true;
+        vlc_mutex_unlock( &p_pool->lock );
+
+        p_job->pf_run( p_job->p_data );
+
+        vlc_mutex_lock( &p_pool->lock );
+        p_job->b_running = false;
+        if( p_job->b_again )
+        {   /* Scheduled while running: give the other jobs a chance first */
+            p_job->b_again = false;
+            Enqueue( p_pool, p_job );
+        }
+        vlc_cond_broadcast( &p_pool->wait_done );
+    }
+
+    p_pool->i_threads--;
+    vlc_cond_broadcast( &p_pool->wait_done );
+    vlc_mutex_unlock( &p_pool->lock );
+    return NULL;
+}
+
+/**
+ * Gets a thread for the queued jobs, if possible
+ */
+static void Kick( decoder_pool_t *p_pool )
+{
+    if( p_pool->i_idle >= p_pool->i_queued )
+    {
+        vlc_cond_signal( &p_pool->wait_job );
+        return;
+    }
+    if( p_pool->i_threads - p_pool->i_blocked >= p_pool->i_max )
+        return; /* The job waits for a running thread */
+
+    if( vlc_clone_detach( NULL, Thread, p_pool,
+                          VLC_THREAD_PRIORITY_AUDIO ) == 0 )
+    {
+        p_pool->i_threads++;
+        msg_Dbg( p_pool->p_parent, "decoder pool: %u threads",
+                 p_pool->i_threads );
+    }
+    else if( p_pool->i_threads == 0 )
+        /* The job stays queued until some thread gets spawned */
+        msg_Err( p_pool->p_parent, "cannot spawn decoder pool thread" );
+    else
+        vlc_cond_signal( &p_pool->wait_job );
+}
+
+#undef decoder_pool_New
+decoder_pool_t *decoder_pool_New( vlc_object_t *p_parent )
+{
+    decoder_pool_t *p_pool = malloc( sizeof( *p_pool ) );
+    if( unlikely(p_pool == NULL) )
+        return NULL;
+
+    p_pool->p_parent = p_parent;
+    vlc_mutex_init( &p_pool->lock );
+    vlc_cond_init( &p_pool->wait_job );
+    vlc_cond_init( &p_pool->wait_done );
+    p_pool->p_first = NULL;
+    p_pool->pp_last = &p_pool->p_first;
+    p_pool->i_queued = 0;
+    p_pool->i_threads = 0;
+    p_pool->i_idle = 0;
+    p_pool->i_blocked = 0;
+    p_pool->i_max = __MAX( vlc_GetCPUCount(), 2 );
+    p_pool->b_closing = false;
+    return p_pool;
+}
+
+void decoder_pool_Delete( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    assert( p_pool->p_first == NULL );
+    p_pool->b_closing = true;
+    vlc_cond_broadcast( &p_pool->wait_job );
+    while( p_pool->i_threads > 0 )
+        vlc_cond_wait( &p_pool->wait_done, &p_pool->lock );
+    vlc_mutex_unlock( &p_pool->lock );
+
+    vlc_cond_destroy( &p_pool->wait_done );
+    vlc_cond_destroy( &p_pool->wait_job );
+    vlc_mutex_destroy( &p_pool->lock );
+    free( p_pool );
+}
+
+void decoder_pool_Schedule( decoder_pool_t *p_pool, decoder_pool_job_t *p_job )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    if( p_job->b_running )
+        p_job->b_again = true;
+    else if( !p_job->b_queued )
+    {
+        Enqueue( p_pool, p_job );
+        Kick( p_pool );
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void decoder_pool_EnterWait( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    p_pool->i_blocked++;
+    if( p_pool->i_queued > 0 )
+        Kick( p_pool );
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void decoder_pool_LeaveWait( decoder_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    assert( p_pool->i_blocked > 0 );
+    p_pool->i_blocked--;
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void decoder_pool_Cancel( decoder_pool_t *p_pool, decoder_pool_job_t *p_job )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    if( p_job->b_queued )
+    {
+        decoder_pool_job_t **pp = &p_pool->p_first;
+
+        while( *pp != p_job )
+            pp = &(*pp)->p_next;
+        *pp = p_job->p_next;
+        if( p_pool->pp_last == &p_job->p_next )
+            p_pool->pp_last = pp;
+        p_pool->i_queued--;
+        p_job->b_queued = false;
+    }
+    p_job->b_again = false;
+
+    /* The job cannot be scheduled again while it is being cancelled */
+    while( p_job->b_running )
+        vlc_cond_wait( &p_pool->wait_done, &p_pool->lock );
+    assert( !p_job->b_queued );
+    vlc_mutex_unlock( &p_pool->lock );
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * decoder_pool.h: Shared threads for low rate decoders
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_DECODER_POOL_H
+#define LIBVLC_INPUT_DECODER_POOL_H 1
+
+#include <vlc_common.h>
+
+/**
+ * A pool of threads running the decoders which do not need a thread of their
+ * own, i.e. the ones which are idle most of the time.
+ *
+ * A decoder is run by at most one thread at a time, until it has nothing left
+ * to do. There is about one thread per CPU, not counting the threads blocked
+ * while running a decoder (e.g. while buffering, or until a subtitle is due),
+ * so that the other decoders keep running. The threads exit once they have
+ * been idle for a while.
+ */
+typedef struct decoder_pool_t decoder_pool_t;
+
+typedef struct decoder_pool_job_t decoder_pool_job_t;
+struct decoder_pool_job_t
+{
+    void (*pf_run)( void * );
+    void *p_data;
+
+    /* Private to the pool */
+    decoder_pool_job_t *p_next;
+    bool b_queued;
+    bool b_running;
+    bool b_again;
+};
+
+decoder_pool_t *decoder_pool_New( vlc_object_t * ) VLC_USED;
+#define decoder_pool_New(o) decoder_pool_New(VLC_OBJECT(o))
+
+/**
+ * Deletes the pool. No job may be queued nor running.
+ */
+void decoder_pool_Delete( decoder_pool_t * );
+
+static inline void decoder_pool_InitJob( decoder_pool_job_t *p_job,
+                                         void (*pf_run)( void * ),
+                                         void *p_data )
+{
+    p_job->pf_run = pf_run;
+    p_job->p_data = p_data;
+    p_job->p_next = NULL;
+    p_job->b_queued = false;
+    p_job->b_running = false;
+    p_job->b_again = false;
+}
+
+/**
+ * Schedules a job. If the job is running, it is run again once it returns.
+ */
+void decoder_pool_Schedule( decoder_pool_t *, decoder_pool_job_t * );
+
+/**
+ * Unschedules a job, and waits until it is not running anymore.
+ */
+void decoder_pool_Cancel( decoder_pool_t *, decoder_pool_job_t * );
+
+/**
+ * Tells that the calling job is about to block, and that the pool should
+ * run the other jobs on another thread in the meantime.
+ */
+void decoder_pool_EnterWait( decoder_pool_t * );
+
+/**
+ * Tells that the calling job is not blocked anymore.
+ */
+void decoder_pool_LeaveWait( decoder_pool_t * );
+
+#endif
@@ -35,6 +35,7 @@
 #include <vlc_url.h>
 #include <vlc_modules.h>
 #include <vlc_strings.h>
+#include "modules/modules.h"
 
 typedef const struct
 {
@@ -175,6 +176,9 @@ static void demux_DestroyDemuxFilter(demux_t *demux)
     demux_Delete(demux->p_next);
 }
 
+/* Size of the data matched against the signatures of the demuxers */
+#define DEMUX_SIGNATURE_PEEK 1024
+
 static int demux_Probe(void *func, va_list ap)
 {
     int (*probe)(vlc_object_t *) = func;
@@ -261,8 +265,21 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_parent_input,
         if( psz_module == NULL )
             psz_module = p_demux->psz_demux;
 
-        p_demux->p_module = vlc_module_load(p_demux, "demux", psz_module,
-             !strcmp(psz_module, p_demux->psz_demux), demux_Probe, p_demux);
+        /* Peek once for the signatures of the demuxers. The data is copied
+         * as the probed demuxers invalidate the peek buffer. */
+        uint8_t p_sig[DEMUX_SIGNATURE_PEEK];
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( s, &p_peek, sizeof (p_sig) );
+        if( i_peek > 0 )
+            memcpy( p_sig, p_peek, i_peek );
+
+        mtime_t i_start = mdate();
+        p_demux->p_module = vlc_module_load_data(p_demux, "demux", psz_module,
+             !strcmp(psz_module, p_demux->psz_demux),
+             i_peek >= 0 ? p_sig : NULL, i_peek >= 0 ? i_peek : 0,
+             demux_Probe, p_demux);
+        msg_Dbg( p_demux, "demux probing took %"PRId64" us",
+                 mdate() - i_start );
     }
     else
     {
@@ -37,8 +37,11 @@
 #include <vlc_es_out.h>
 #include <vlc_block.h>
 #include <vlc_aout.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
 #include <vlc_fourcc.h>
 #include <vlc_meta.h>
+#include <vlc_modules.h>
 
 #include "input_internal.h"
 #include "clock.h"
@@ -109,6 +112,22 @@ struct es_out_id_t
 
     /* ID for the meta data */
     int         i_meta_id;
+
+    /* Used while prefetching */
+    decoder_t   *p_prefetch_packetizer; /* to find the key frames */
+    vlc_tick_t  i_prefetch_date;
+};
+
+/* Block or PCR kept while prefetching */
+typedef struct es_out_prefetch_t es_out_prefetch_t;
+struct es_out_prefetch_t
+{
+    es_out_prefetch_t *p_next;
+
+    es_out_id_t *p_es;      /* NULL for a PCR */
+    block_t     *p_block;
+    int         i_group;
+    vlc_tick_t  i_date;     /* block date or PCR value */
 };
 
 typedef struct
@@ -159,6 +178,7 @@ struct es_out_sys_t
     vlc_tick_t  i_pts_delay;
     vlc_tick_t  i_pts_jitter;
     int         i_cr_average;
+    int         i_clock_smoothing;
     int         i_rate;
 
     /* */
@@ -178,14 +198,30 @@ struct es_out_sys_t
     /* Record */
     sout_instance_t *p_sout_record;
 
+    /* Prefetch */
+    struct
+    {
+        bool        b_enabled;
+        es_out_prefetch_t *p_first;
+        es_out_prefetch_t **pp_last;
+        size_t      i_size;     /* size of the kept blocks */
+        size_t      i_max;
+        bool        b_key;      /* a starting point was found */
+        uint64_t    i_bitrate;  /* 0 for no limit */
+        uint64_t    i_received;
+        vlc_tick_t  i_start;
+    } prefetch;
+
     /* Used only to limit debugging output */
     int         i_prev_stream_level;
 };
 
 static es_out_id_t *EsOutAdd    ( es_out_t *, const es_format_t * );
 static int          EsOutSend   ( es_out_t *, es_out_id_t *, block_t * );
+static int          EsOutDecode ( es_out_t *, es_out_id_t *, block_t * );
 static void         EsOutDel    ( es_out_t *, es_out_id_t * );
 static int          EsOutControl( es_out_t *, int i_query, va_list );
+static int          EsOutControlLocked( es_out_t *, int i_query, va_list );
 static void         EsOutDelete ( es_out_t * );
 
 static void         EsOutTerminate( es_out_t * );
@@ -204,6 +240,8 @@ static void EsOutProgramChangePause( es_out_t *out, bool b_paused, vlc_tick_t i_
 static void EsOutProgramsChangeRate( es_out_t *out );
 static void EsOutDecodersStopBuffering( es_out_t *out, bool b_forced );
 static void EsOutGlobalMeta( es_out_t *p_out, const vlc_meta_t *p_meta );
+static void EsOutPrefetchAddEs( es_out_t *out, es_out_id_t *es );
+static void EsOutPrefetchClean( es_out_t *out );
 static void EsOutMeta( es_out_t *p_out, const vlc_meta_t *p_meta, const vlc_meta_t *p_progmeta );
 
 static char *LanguageGetName( const char *psz_code );
@@ -335,11 +373,16 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pause_date = -1;
 
     p_sys->i_rate = i_rate;
+    p_sys->i_clock_smoothing = var_InheritInteger( p_input, "clock-smoothing" );
 
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
 
+    p_sys->prefetch.b_enabled = false;
+    p_sys->prefetch.p_first = NULL;
+    p_sys->prefetch.pp_last = &p_sys->prefetch.p_first;
+
     return out;
 }
 
@@ -367,6 +410,8 @@ static void EsOutTerminate( es_out_t *out )
     if( p_sys->p_sout_record )
         EsOutSetRecord( out, false );
 
+    EsOutPrefetchClean( out );
+
     for( int i = 0; i < p_sys->i_es; i++ )
     {
         if( p_sys->es[i]->p_dec )
@@ -403,6 +448,15 @@ static vlc_tick_t EsOutGetWakeup( es_out_t *out )
     es_out_sys_t   *p_sys = out->p_sys;
     input_thread_t *p_input = p_sys->p_input;
 
+    /* Do not read faster than allowed while prefetching */
+    if( p_sys->prefetch.b_enabled && p_sys->prefetch.i_bitrate > 0 )
+    {
+        const vlc_tick_t i_wakeup = p_sys->prefetch.i_start +
+            p_sys->prefetch.i_received * 8 * CLOCK_FREQ / p_sys->prefetch.i_bitrate;
+        if( i_wakeup > mdate() )
+            return i_wakeup;
+    }
+
     if( !p_sys->p_pgrm )
         return 0;
 
@@ -764,7 +818,7 @@ static void EsOutDecodersChangePause( es_out_t *out, bool b_paused, vlc_tick_t i
     }
 }
 
-static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
+static size_t EsOutGetFifoSize( es_out_t *out )
 {
     es_out_sys_t *p_sys = out->p_sys;
 
@@ -778,6 +832,12 @@ static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
         if( p_es->p_dec_record )
             i_size += input_DecoderGetFifoSize( p_es->p_dec_record );
     }
+    return i_size;
+}
+
+static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
+{
+    const size_t i_size = EsOutGetFifoSize( out );
     //msg_Info( out, "----- EsOutIsExtraBufferingAllowed =% 5d KiB -- ", i_size / 1024 );
 
     /* TODO maybe we want to be able to tune it ? */
@@ -1085,7 +1145,7 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->b_scrambled = false;
     p_pgrm->i_last_pcr = VLC_TICK_INVALID;
     p_pgrm->p_meta = NULL;
-    p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
+    p_pgrm->p_clock = input_clock_New( p_sys->i_rate, p_sys->i_clock_smoothing );
     if( !p_pgrm->p_clock )
     {
         free( p_pgrm );
@@ -1629,9 +1689,14 @@ static es_out_id_t *EsOutAddSlave( es_out_t *out, const es_format_t *fmt, es_out
     es->cc.i_bitmap = 0;
     es->p_master = p_master;
     es->i_pts_level = VLC_TICK_INVALID;
+    es->p_prefetch_packetizer = NULL;
+    es->i_prefetch_date = VLC_TICK_INVALID;
 
     TAB_APPEND( p_sys->i_es, p_sys->es, es );
 
+    if( p_sys->prefetch.b_enabled )
+        EsOutPrefetchAddEs( out, es );
+
     if( es->p_pgrm == p_sys->p_pgrm )
         EsOutESVarUpdate( out, es, false );
 
@@ -2029,6 +2094,296 @@ static void EsOutCreateCCChannels( es_out_t *out, vlc_fourcc_t codec, uint64_t i
     }
 }
 
+/*****************************************************************************
+ * Prefetch
+ *
+ * An input opened ahead of time demuxes without decoders: the blocks and the
+ * PCR are kept from the last video key frame, or for the caching delay when
+ * there is no video, within the "preopen-buffer" size. They are replayed
+ * as freshly received data when the prefetch is stopped.
+ *
+ * An input that can be paced is kept from its first key frame instead, and
+ * is not demuxed any further once the buffer is full, so that it resumes
+ * where the kept data ends.
+ *****************************************************************************/
+static int EsOutControlLockedVa( es_out_t *out, int i_query, ... )
+{
+    va_list args;
+
+    va_start( args, i_query );
+    int i_ret = EsOutControlLocked( out, i_query, args );
+    va_end( args );
+    return i_ret;
+}
+
+static void EsOutPrefetchAddEs( es_out_t *out, es_out_id_t *es )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    /* The demuxers rarely flag the key frames, use a packetizer to find them */
+    if( es->fmt.i_cat != VIDEO_ES || es->fmt.b_packetized || es->p_master )
+        return;
+
+    decoder_t *p_packetizer = vlc_custom_create( p_sys->p_input,
+                                                 sizeof( *p_packetizer ),
+                                                 "prefetch packetizer" );
+    if( !p_packetizer )
+        return;
+
+    p_packetizer->pf_decode = NULL;
+    p_packetizer->pf_packetize = NULL;
+    es_format_Copy( &p_packetizer->fmt_in, &es->fmt );
+    es_format_Init( &p_packetizer->fmt_out, es->fmt.i_cat, 0 );
+
+    p_packetizer->p_module = module_need( p_packetizer, "packetizer", NULL, false );
+    if( !p_packetizer->p_module )
+    {
+        msg_Warn( p_sys->p_input, "cannot find the key frames of ES 0x%x",
+                  es->i_id );
+        es_format_Clean( &p_packetizer->fmt_in );
+        es_format_Clean( &p_packetizer->fmt_out );
+        vlc_object_release( p_packetizer );
+        return;
+    }
+    es->p_prefetch_packetizer = p_packetizer;
+}
+
+static void EsOutPrefetchAppend( es_out_t *out, es_out_id_t *es,
+                                 block_t *p_block, int i_group,
+                                 vlc_tick_t i_date )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    es_out_prefetch_t *p_cmd = malloc( sizeof( *p_cmd ) );
+    if( unlikely(p_cmd == NULL) )
+    {
+        if( p_block )
+            block_Release( p_block );
+        return;
+    }
+    p_cmd->p_next = NULL;
+    p_cmd->p_es = es;
+    p_cmd->p_block = p_block;
+    p_cmd->i_group = i_group;
+    p_cmd->i_date = i_date;
+
+    *p_sys->prefetch.pp_last = p_cmd;
+    p_sys->prefetch.pp_last = &p_cmd->p_next;
+    if( p_block )
+        p_sys->prefetch.i_size += p_block->i_buffer;
+}
+
+static void EsOutPrefetchFree( es_out_t *out, es_out_prefetch_t *p_cmd )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_cmd->p_block )
+    {
+        p_sys->prefetch.i_size -= p_cmd->p_block->i_buffer;
+        block_Release( p_cmd->p_block );
+    }
+    free( p_cmd );
+}
+
+/* Drop the blocks of the given ES, or everything if NULL */
+static void EsOutPrefetchFlush( es_out_t *out, es_out_id_t *es )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_prefetch_t **pp_cmd = &p_sys->prefetch.p_first;
+
+    while( *pp_cmd )
+    {
+        es_out_prefetch_t *p_cmd = *pp_cmd;
+
+        if( es == NULL || p_cmd->p_es == es )
+        {
+            *pp_cmd = p_cmd->p_next;
+            EsOutPrefetchFree( out, p_cmd );
+        }
+        else
+            pp_cmd = &p_cmd->p_next;
+    }
+    p_sys->prefetch.pp_last = pp_cmd;
+}
+
+/* Drop everything older than the given date but the PCR just before it */
+static void EsOutPrefetchTrim( es_out_t *out, vlc_tick_t i_date )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_prefetch_t *p_pcr = NULL;
+
+    for( es_out_prefetch_t *p_cmd = p_sys->prefetch.p_first;
+         p_cmd != NULL; p_cmd = p_cmd->p_next )
+    {
+        if( p_cmd->p_es == NULL && p_cmd->i_date < i_date )
+            p_pcr = p_cmd;
+    }
+
+    es_out_prefetch_t **pp_cmd = &p_sys->prefetch.p_first;
+    while( *pp_cmd )
+    {
+        es_out_prefetch_t *p_cmd = *pp_cmd;
+
+        if( p_cmd != p_pcr && p_cmd->i_date < i_date )
+        {
+            *pp_cmd = p_cmd->p_next;
+            EsOutPrefetchFree( out, p_cmd );
+        }
+        else
+            pp_cmd = &p_cmd->p_next;
+    }
+    p_sys->prefetch.pp_last = pp_cmd;
+}
+
+/* Returns the date of the key frame completed by the block, if any */
+static vlc_tick_t EsOutPrefetchKeyFrame( es_out_id_t *es, block_t *p_block )
+{
+    decoder_t *p_packetizer = es->p_prefetch_packetizer;
+
+    if( p_packetizer == NULL )
+    {
+        if( !(p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+            return VLC_TICK_INVALID;
+        return p_block->i_dts > VLC_TICK_INVALID ? p_block->i_dts
+                                                 : p_block->i_pts;
+    }
+
+    vlc_tick_t i_key = VLC_TICK_INVALID;
+    block_t *p_dup = block_Duplicate( p_block );
+    block_t *p_out;
+
+    while( (p_out = p_packetizer->pf_packetize( p_packetizer, &p_dup )) )
+    {
+        while( p_out )
+        {
+            block_t *p_next = p_out->p_next;
+
+            if( p_out->i_flags & BLOCK_FLAG_TYPE_I )
+                i_key = p_out->i_dts > VLC_TICK_INVALID ? p_out->i_dts
+                                                        : p_out->i_pts;
+            block_Release( p_out );
+            p_out = p_next;
+        }
+    }
+    return i_key;
+}
+
+static void EsOutPrefetchSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    p_sys->prefetch.i_received += p_block->i_buffer;
+
+    /* Non dated blocks take the date of the previous one */
+    vlc_tick_t i_date = p_block->i_dts > VLC_TICK_INVALID ? p_block->i_dts
+                                                          : p_block->i_pts;
+    if( i_date > VLC_TICK_INVALID )
+        es->i_prefetch_date = i_date;
+    else
+        i_date = es->i_prefetch_date;
+
+    vlc_tick_t i_start = VLC_TICK_INVALID;
+    if( es->fmt.i_cat == VIDEO_ES )
+        i_start = EsOutPrefetchKeyFrame( es, p_block );
+    else if( es->fmt.i_cat == AUDIO_ES && p_sys->video.i_count == 0 &&
+             i_date > p_sys->i_pts_delay )
+        i_start = i_date - p_sys->i_pts_delay;
+
+    EsOutPrefetchAppend( out, es, p_block, 0, i_date );
+
+    if( input_priv(p_sys->p_input)->b_can_pace_control )
+    {
+        /* Only what precedes the first key frame is dropped, the input is
+         * then not read beyond the buffer size */
+        if( i_start > VLC_TICK_INVALID && !p_sys->prefetch.b_key )
+        {
+            EsOutPrefetchTrim( out, i_start );
+            p_sys->prefetch.b_key = true;
+        }
+        return;
+    }
+
+    if( i_start > VLC_TICK_INVALID )
+        EsOutPrefetchTrim( out, i_start );
+
+    /* Drop the oldest data above the size limit */
+    while( p_sys->prefetch.i_size > p_sys->prefetch.i_max )
+    {
+        es_out_prefetch_t *p_cmd = p_sys->prefetch.p_first;
+
+        p_sys->prefetch.p_first = p_cmd->p_next;
+        if( p_sys->prefetch.p_first == NULL )
+            p_sys->prefetch.pp_last = &p_sys->prefetch.p_first;
+        EsOutPrefetchFree( out, p_cmd );
+    }
+}
+
+static void EsOutPrefetchStart( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    input_thread_t *p_input = p_sys->p_input;
+
+    p_sys->prefetch.b_enabled = true;
+    p_sys->prefetch.i_size = 0;
+    p_sys->prefetch.i_max = var_InheritInteger( p_input, "preopen-buffer" ) * 1024;
+    p_sys->prefetch.b_key = false;
+    p_sys->prefetch.i_bitrate = var_InheritInteger( p_input, "preopen-bitrate" ) * 1000;
+    p_sys->prefetch.i_received = 0;
+    p_sys->prefetch.i_start = mdate();
+
+    for( int i = 0; i < p_sys->i_es; i++ )
+        EsOutPrefetchAddEs( out, p_sys->es[i] );
+}
+
+static void EsOutPrefetchClean( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    EsOutPrefetchFlush( out, NULL );
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_id_t *es = p_sys->es[i];
+
+        if( es->p_prefetch_packetizer )
+        {
+            demux_PacketizerDestroy( es->p_prefetch_packetizer );
+            es->p_prefetch_packetizer = NULL;
+        }
+    }
+}
+
+static void EsOutPrefetchStop( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    p_sys->prefetch.b_enabled = false;
+
+    es_out_prefetch_t *p_cmd = p_sys->prefetch.p_first;
+    msg_Dbg( p_sys->p_input, "sending %zu prefetched bytes",
+             p_sys->prefetch.i_size );
+
+    p_sys->prefetch.p_first = NULL;
+    p_sys->prefetch.i_size = 0;
+    EsOutPrefetchClean( out );
+
+    /* Restart the clocks and the buffering, the kept data is then received
+     * again as if the input had just been opened */
+    EsOutChangePosition( out );
+
+    while( p_cmd )
+    {
+        es_out_prefetch_t *p_next = p_cmd->p_next;
+
+        if( p_cmd->p_es )
+            EsOutDecode( out, p_cmd->p_es, p_cmd->p_block );
+        else
+            EsOutControlLockedVa( out, ES_OUT_SET_GROUP_PCR, p_cmd->i_group,
+                                  p_cmd->i_date );
+        free( p_cmd );
+        p_cmd = p_next;
+    }
+}
+
 /**
  * Send a block for the given es_out
  *
@@ -2045,26 +2400,45 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 
     if( libvlc_stats( p_input ) )
     {
-        uint64_t i_total;
-
-        vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
         stats_Update( input_priv(p_input)->counters.p_demux_read,
-                      p_block->i_buffer, &i_total );
-        stats_Update( input_priv(p_input)->counters.p_demux_bitrate, i_total, NULL );
+                      p_block->i_buffer );
 
         /* Update number of corrupted data packats */
         if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
         {
-            stats_Update( input_priv(p_input)->counters.p_demux_corrupted, 1, NULL );
+            stats_Update( input_priv(p_input)->counters.p_demux_corrupted, 1 );
         }
         /* Update number of discontinuities */
         if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
         {
-            stats_Update( input_priv(p_input)->counters.p_demux_discontinuity, 1, NULL );
+            stats_Update( input_priv(p_input)->counters.p_demux_discontinuity, 1 );
         }
-        vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
     }
 
+    input_SendEventStartup( p_input, INPUT_STARTUP_FIRST_BLOCK,
+                            VLC_TICK_INVALID );
+
+    vlc_mutex_lock( &p_sys->lock );
+
+    int i_ret = VLC_SUCCESS;
+    if( p_sys->prefetch.b_enabled )
+        EsOutPrefetchSend( out, es, p_block );
+    else
+        i_ret = EsOutDecode( out, es, p_block );
+
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_ret;
+}
+
+/**
+ * Decode a block for the given es_out
+ */
+static int EsOutDecode( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t   *p_sys = out->p_sys;
+    input_thread_t *p_input = p_sys->p_input;
+
     vlc_mutex_lock( &p_sys->lock );
 
     /* Drop all ESes except the video one in case of next-frame */
@@ -2178,6 +2552,10 @@ static void EsOutDel( es_out_t *out, es_out_id_t *es )
 
     es_out_es_props_t *p_esprops = GetPropsByCat( p_sys, es->fmt.i_cat );
 
+    EsOutPrefetchFlush( out, es );
+    if( es->p_prefetch_packetizer )
+        demux_PacketizerDestroy( es->p_prefetch_packetizer );
+
     /* We don't try to reselect */
     if( es->p_dec )
     {   /* FIXME: This might hold the ES output caller (i.e. the demux), and
@@ -2287,7 +2665,8 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         es_out_id_t *es = va_arg( args, es_out_id_t * );
         bool *pb = va_arg( args, bool * );
 
-        *pb = EsIsSelected( es );
+        /* Every ES is kept while prefetching */
+        *pb = p_sys->prefetch.b_enabled || EsIsSelected( es );
         return VLC_SUCCESS;
     }
 
@@ -2512,6 +2891,9 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
         p_pgrm->i_last_pcr = i_pcr;
 
+        if( p_sys->prefetch.b_enabled )
+            EsOutPrefetchAppend( out, NULL, NULL, p_pgrm->i_id, i_pcr );
+
         /* TODO do not use mdate() but proper stream acquisition date */
         bool b_late;
         input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
@@ -2764,6 +3146,29 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_GET_PREFETCH_FULL:
+    {
+        bool *pb_full = va_arg( args, bool * );
+        *pb_full = p_sys->prefetch.b_enabled &&
+                   input_priv(p_sys->p_input)->b_can_pace_control &&
+                   p_sys->prefetch.i_size >= p_sys->prefetch.i_max;
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_SET_PREFETCH:
+    {
+        const bool b_prefetch = (bool)va_arg( args, int );
+
+        if( b_prefetch != p_sys->prefetch.b_enabled )
+        {
+            if( b_prefetch )
+                EsOutPrefetchStart( out );
+            else
+                EsOutPrefetchStop( out );
+        }
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_GET_EMPTY:
     {
         bool *pb = va_arg( args, bool* );
@@ -2771,6 +3176,22 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_GET_FIFO_SIZE:
+    {
+        size_t *pi_size = va_arg( args, size_t * );
+        *pi_size = EsOutGetFifoSize( out );
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_GET_CLOCK_STATS:
+    {
+        input_clock_stats_t *p_stats = va_arg( args, input_clock_stats_t * );
+        if( !p_sys->p_pgrm )
+            return VLC_EGENERIC;
+        input_clock_GetStats( p_sys->p_pgrm->p_clock, p_stats );
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_SET_DELAY:
     {
         const int i_cat = va_arg( args, int );
@@ -88,6 +88,25 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Set prefetch state: while enabled, the blocks are kept from the last
+     * key frame instead of being decoded. They are sent to the decoders once
+     * it is disabled. */
+    ES_OUT_SET_PREFETCH,                            /* arg1=bool                res=cannot fail */
+
+    /* Get whether a prefetching input that can be paced holds enough data,
+     * and should not be demuxed any further */
+    ES_OUT_GET_PREFETCH_FULL,                       /* arg1=bool*               res=cannot fail */
+
+    /* Move the playback within the timeshift storage, relatively to the most
+     * recent data. It fails if the input is not being timeshifted. */
+    ES_OUT_SET_TIMESHIFT_OFFSET,                    /* arg1=vlc_tick_t          res=can fail */
+
+    /* Get the number of bytes waiting in the decoder queues */
+    ES_OUT_GET_FIFO_SIZE,                           /* arg1=size_t *            res=cannot fail */
+
+    /* Get the statistics of the clock of the selected program */
+    ES_OUT_GET_CLOCK_STATS,                         /* arg1=input_clock_stats_t * res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -173,6 +192,22 @@ static inline void es_out_Eos( es_out_t *p_out )
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
     assert( !i_ret );
 }
+static inline void es_out_SetPrefetch( es_out_t *p_out, bool b_prefetch )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_PREFETCH, b_prefetch );
+    assert( !i_ret );
+}
+static inline bool es_out_GetPrefetchFull( es_out_t *p_out )
+{
+    bool b_full;
+    int i_ret = es_out_Control( p_out, ES_OUT_GET_PREFETCH_FULL, &b_full );
+    assert( !i_ret );
+    return b_full;
+}
+static inline int es_out_SetTimeshiftOffset( es_out_t *p_out, vlc_tick_t i_offset )
+{
+    return es_out_Control( p_out, ES_OUT_SET_TIMESHIFT_OFFSET, i_offset );
+}
 
 es_out_t  *input_EsOutNew( input_thread_t *, int i_rate );
 
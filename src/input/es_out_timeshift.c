@@ -37,6 +37,10 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -63,6 +67,7 @@
 
 enum
 {
+    C_NONE, /* already executed, kept in the storage for seeking */
     C_ADD,
     C_SEND,
     C_DEL,
@@ -84,7 +89,7 @@ typedef struct attribute_packed
 {
     es_out_id_t *p_es;
     block_t *p_block;
-    int     i_offset;  /* We do not use file > INT_MAX */
+    uint64_t i_offset; /* Position of the data in the storage */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -161,26 +166,43 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
-typedef struct ts_storage_t ts_storage_t;
-struct ts_storage_t
+/* Header of the blocks in the storage data */
+typedef struct
+{
+    vlc_tick_t i_dts;
+    vlc_tick_t i_pts;
+    vlc_tick_t i_length;
+    uint32_t   i_flags;
+    uint32_t   i_nb_samples;
+    uint64_t   i_buffer;
+} ts_storage_block_t;
+
+/* The storage is a ring of commands, indexing a ring of block data.
+ *
+ * Commands and data are addressed by absolute positions, which only ever
+ * increase, modulo the size of their ring. The commands before i_cmd_r
+ * were executed already: the blocks, clock and time updates among them are
+ * kept, together with their data, so that the reading can go back in
+ * time. When the data ring is full, the oldest executed commands are
+ * dropped, then the oldest unread blocks. */
+typedef struct
 {
-    ts_storage_t *p_next;
+    /* Commands */
+    ts_cmd_t *p_cmd;
+    uint64_t i_cmd_max;     /* Size of the commands ring (power of 2) */
+    uint64_t i_cmd_first;   /* Oldest kept command */
+    uint64_t i_cmd_r;       /* Next command to execute */
+    uint64_t i_cmd_w;       /* Next command to store */
 
-    /* */
-#ifdef _WIN32
-    char    *psz_file;  /* Filename */
-#endif
-    size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
+    /* Data */
+    uint8_t  *p_data;
+    uint64_t i_data_max;    /* Size of the data ring */
+    uint64_t i_data_first;  /* Oldest kept data */
+    uint64_t i_data_w;      /* Next data to store */
 
-    /* */
-    int      i_cmd_r;
-    int      i_cmd_w;
-    int      i_cmd_max;
-    ts_cmd_t *p_cmd;
-};
+    /* Set when unread blocks were dropped or the reading position moved */
+    bool     b_reset;
+} ts_storage_t;
 
 typedef struct
 {
@@ -208,8 +230,7 @@ typedef struct
     vlc_tick_t     i_buffering_delay;
 
     /* */
-    ts_storage_t   *p_storage_r;
-    ts_storage_t   *p_storage_w;
+    ts_storage_t   *p_storage;
 
     vlc_tick_t     i_cmd_delay;
 
@@ -226,14 +247,16 @@ struct es_out_sys_t
     es_out_t       *p_out;
 
     /* Configuration */
-    int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_tmp_size_max;    /* Maximal storage size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    bool           b_always;          /* Keep the storage of live streams */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
 
     /* */
     bool           b_delayed;
+    bool           b_ts_failed;       /* b_always start failed, until next ES */
     ts_thread_t   *p_ts;
 
     /* */
@@ -258,21 +281,21 @@ static void         TsAutoStop( es_out_t * );
 
 static void         TsStop( ts_thread_t * );
 static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
-static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
+static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t * );
 static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, vlc_tick_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, vlc_tick_t i_offset );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNew( vlc_object_t *, const char *psz_path, int64_t i_tmp_size_max );
 static void         TsStorageDelete( ts_storage_t * );
-static void         TsStoragePack( ts_storage_t *p_storage );
-static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
-static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static int          TsStoragePushCmd( ts_storage_t *, ts_cmd_t *p_cmd );
+static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd );
+static int          TsStorageSeek( ts_storage_t *, vlc_tick_t i_offset );
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
@@ -293,8 +316,10 @@ static int  CmdExecuteSend   ( es_out_t *, ts_cmd_t * );
 static void CmdExecuteDel    ( es_out_t *, ts_cmd_t * );
 static int  CmdExecuteControl( es_out_t *, ts_cmd_t * );
 
+#ifdef HAVE_MMAP
 /* File helpers */
 static int GetTmpFile( char **ppsz_file, const char *psz_path );
+#endif
 
 /*****************************************************************************
  * input_EsOutTimeshiftNew:
@@ -331,18 +356,17 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     vlc_mutex_init_recursive( &p_sys->lock );
 
     p_sys->b_delayed = false;
+    p_sys->b_ts_failed = false;
     p_sys->p_ts = NULL;
 
     TAB_INIT( p_sys->i_es, p_sys->pp_es );
 
     /* */
-    const int i_tmp_size_max = var_CreateGetInteger( p_input, "input-timeshift-granularity" );
-    if( i_tmp_size_max < 0 )
-        p_sys->i_tmp_size_max = 50*1024*1024;
-    else
-        p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB",
-             (int)p_sys->i_tmp_size_max/(1024*1024) );
+    const int64_t i_tmp_size_max = var_InheritInteger( p_input, "input-timeshift-size" );
+    p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1 ) * 1024 * 1024;
+    msg_Dbg( p_input, "using timeshift size of %"PRId64" MiB",
+             p_sys->i_tmp_size_max / (1024*1024) );
+    p_sys->b_always = var_InheritBool( p_input, "input-timeshift-always" );
 
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
@@ -445,6 +469,7 @@ static es_out_id_t *Add( es_out_t *p_out, const es_format_t *p_fmt )
     }
 
     TAB_APPEND( p_sys->i_es, p_sys->pp_es, p_es );
+    p_sys->b_ts_failed = false;
 
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
@@ -465,6 +490,12 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
+    /* Record live streams from the start, so that they can be seeked back */
+    if( p_sys->b_always && !p_sys->b_delayed && !p_sys->b_ts_failed &&
+        !input_priv(p_sys->p_input)->b_can_pace_control &&
+        TsStart( p_out ) )
+        p_sys->b_ts_failed = true; /* do not retry on every block */
+
     CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
@@ -665,6 +696,14 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     }
 
     /* Special control when delayed */
+    case ES_OUT_SET_TIMESHIFT_OFFSET:
+    {
+        const vlc_tick_t i_offset = va_arg( args, vlc_tick_t );
+
+        if( !p_sys->b_delayed )
+            return VLC_EGENERIC;
+        return TsSeek( p_sys->p_ts, i_offset );
+    }
     case ES_OUT_GET_ES_STATE:
     {
         es_out_id_t *p_es = (es_out_id_t*)va_arg( args, es_out_id_t * );
@@ -802,8 +841,7 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
-    p_ts->p_storage_r = NULL;
-    p_ts->p_storage_w = NULL;
+    p_ts->p_storage = NULL;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -822,7 +860,7 @@ static void TsAutoStop( es_out_t *p_out )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
-    if( !p_sys->b_delayed || !TsIsUnused( p_sys->p_ts ) )
+    if( !p_sys->b_delayed || p_sys->b_always || !TsIsUnused( p_sys->p_ts ) )
         return;
 
     msg_Warn( p_sys->p_input, "es out timeshift: auto stop" );
@@ -836,18 +874,8 @@ static void TsStop( ts_thread_t *p_ts )
     vlc_join( p_ts->thread, NULL );
 
     vlc_mutex_lock( &p_ts->lock );
-    for( ;; )
-    {
-        ts_cmd_t cmd;
-
-        if( TsPopCmdLocked( p_ts, &cmd, true ) )
-            break;
-
-        CmdClean( &cmd );
-    }
-    assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    if( p_ts->p_storage )
+        TsStorageDelete( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
@@ -856,55 +884,35 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    if( !p_ts->p_storage )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
-
-        if( !p_storage )
+        p_ts->p_storage = TsStorageNew( VLC_OBJECT(p_ts->p_input),
+                                        p_ts->psz_tmp_path,
+                                        p_ts->i_tmp_size_max );
+        if( !p_ts->p_storage )
         {
             CmdClean( p_cmd );
             vlc_mutex_unlock( &p_ts->lock );
             /* TODO warn the user (but only once) */
             return;
         }
-
-        if( !p_ts->p_storage_w )
-        {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
-        }
-        else
-        {
-            TsStoragePack( p_ts->p_storage_w );
-            p_ts->p_storage_w->p_next = p_storage;
-            p_ts->p_storage_w = p_storage;
-        }
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_ts->p_storage, p_cmd );
 
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
 }
-static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_assert_locked( &p_ts->lock );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
+    if( TsStorageIsEmpty( p_ts->p_storage ) )
         return VLC_EGENERIC;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
-
-    while( TsStorageIsEmpty( p_ts->p_storage_r ) )
-    {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
-
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
-    }
+    TsStoragePopCmd( p_ts->p_storage, p_cmd );
 
     return VLC_SUCCESS;
 }
@@ -913,7 +921,7 @@ static bool TsHasCmd( ts_thread_t *p_ts )
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd = !TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd = !TsStorageIsEmpty( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -925,7 +933,7 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     b_unused = !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
-               TsStorageIsEmpty( p_ts->p_storage_r );
+               TsStorageIsEmpty( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_unused;
@@ -979,6 +987,23 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsSeek( ts_thread_t *p_ts, vlc_tick_t i_offset )
+{
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_ts->lock );
+    if( p_ts->p_storage )
+        i_ret = TsStorageSeek( p_ts->p_storage, i_offset );
+    if( !i_ret )
+    {
+        msg_Dbg( p_ts->p_input, "es out timeshift: seek to %"PRId64" ms from live",
+                 i_offset / 1000 );
+        vlc_cond_signal( &p_ts->wait );
+    }
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return i_ret;
+}
 
 static void *TsRun( void *p_data )
 {
@@ -990,6 +1015,7 @@ static void *TsRun( void *p_data )
         ts_cmd_t cmd;
         vlc_tick_t  i_deadline;
         bool b_buffering;
+        bool b_reset;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -1000,7 +1026,7 @@ static void *TsRun( void *p_data )
             const int canc = vlc_savecancel();
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
-            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
+            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd ) )
             {
                 vlc_restorecancel( canc );
                 break;
@@ -1010,6 +1036,19 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
+        /* Restart from the command if the reading position moved */
+        b_reset = p_ts->p_storage->b_reset;
+        if( b_reset )
+        {
+            p_ts->p_storage->b_reset = false;
+
+            p_ts->i_rate_date = -1;
+            p_ts->i_rate_delay = 0;
+            p_ts->i_buffering_delay = 0;
+            p_ts->i_cmd_delay = mdate() - cmd.i_date;
+            i_buffering_date = -1;
+        }
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.i_date;
@@ -1072,6 +1111,8 @@ static void *TsRun( void *p_data )
 
         /* Execute the command  */
         const int canc = vlc_savecancel();
+        if( b_reset )
+            es_out_Control( p_ts->p_out, ES_OUT_RESET_PCR );
         switch( cmd.i_type )
         {
         case C_ADD:
@@ -1102,181 +1143,365 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
+#define TS_STORAGE_CMD_MIN  (1024)
+#define TS_STORAGE_DATA_MIN (4*1024*1024)
+#define TS_STORAGE_ALIGN    (8)
+
+static inline ts_cmd_t *TsStorageCmd( ts_storage_t *p_storage, uint64_t i )
+{
+    return &p_storage->p_cmd[i & (p_storage->i_cmd_max - 1)];
+}
+
+/* Blocks, clock and time updates can be executed again after a seek, or
+ * dropped */
+static bool TsCmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    return p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_SET_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_GROUP_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_TIMES );
+}
+
+/* The playback cannot go back before these commands */
+static bool TsCmdIsBarrier( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_ADD || p_cmd->i_type == C_DEL )
+        return true;
+    return p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_RESET_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_ES_FMT ||
+             p_cmd->u.control.i_query == ES_OUT_DEL_GROUP );
+}
+
+static ts_storage_t *TsStorageNew( vlc_object_t *p_obj, const char *psz_tmp_path, int64_t i_tmp_size_max )
 {
     ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
     if( unlikely(p_storage == NULL) )
         return NULL;
 
+    /* The data size is halved until it can be allocated, as the address
+     * space and the temporary directory may be too small */
+    uint64_t i_size = i_tmp_size_max;
+    uint8_t *p_data = NULL;
+#ifdef HAVE_MMAP
     char *psz_file;
     int fd = GetTmpFile( &psz_file, psz_tmp_path );
     if( fd == -1 )
     {
+        msg_Err( p_obj, "cannot create the timeshift file: %s",
+                 vlc_strerror_c(errno) );
         free( p_storage );
         return NULL;
     }
+    vlc_unlink( psz_file );
+    free( psz_file );
 
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
-    {
-        vlc_close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
+    for( ;; )
     {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
+#if defined(_POSIX_ADVISORY_INFO) && (_POSIX_ADVISORY_INFO >= 0)
+        /* Reserve the space, writing to the mapping must not fail later */
+        if( !posix_fallocate( fd, 0, i_size ) )
+#else
+        if( !ftruncate( fd, i_size ) )
+#endif
+        {
+            p_data = mmap( NULL, i_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 );
+            if( p_data != MAP_FAILED )
+                break;
+            p_data = NULL;
+        }
+        if( i_size / 2 < TS_STORAGE_DATA_MIN )
+            break;
+        i_size /= 2;
     }
-
-#ifndef _WIN32
-    vlc_unlink( psz_file );
-    free( psz_file );
+    vlc_close( fd );
 #else
-    p_storage->psz_file = psz_file;
+    VLC_UNUSED(psz_tmp_path);
+    while( (p_data = malloc( i_size )) == NULL && i_size / 2 >= TS_STORAGE_DATA_MIN )
+        i_size /= 2;
 #endif
-    p_storage->p_next = NULL;
+    if( p_data == NULL )
+    {
+        msg_Err( p_obj, "cannot allocate the timeshift storage" );
+        free( p_storage );
+        return NULL;
+    }
+    msg_Dbg( p_obj, "using timeshift storage of %"PRIu64" MiB",
+             i_size / (1024*1024) );
 
-    /* */
-    p_storage->i_file_max = i_tmp_size_max;
-    p_storage->i_file_size = 0;
+    p_storage->p_data = p_data;
+    p_storage->i_data_max = i_size;
+    p_storage->i_data_first = 0;
+    p_storage->i_data_w = 0;
+    p_storage->b_reset = false;
 
-    /* */
-    p_storage->i_cmd_w = 0;
+    p_storage->i_cmd_max = TS_STORAGE_CMD_MIN;
+    p_storage->i_cmd_first = 0;
     p_storage->i_cmd_r = 0;
-    p_storage->i_cmd_max = 30000;
+    p_storage->i_cmd_w = 0;
     p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
-    //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
-
     if( !p_storage->p_cmd )
     {
         TsStorageDelete( p_storage );
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
-    while( p_storage->i_cmd_r < p_storage->i_cmd_w )
+    if( p_storage->p_cmd )
     {
-        ts_cmd_t cmd;
-
-        TsStoragePopCmd( p_storage, &cmd, true );
-
-        CmdClean( &cmd );
+        for( uint64_t i = p_storage->i_cmd_r; i < p_storage->i_cmd_w; i++ )
+            CmdClean( TsStorageCmd( p_storage, i ) );
+        free( p_storage->p_cmd );
     }
-    free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
-#ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
+#ifdef HAVE_MMAP
+    munmap( p_storage->p_data, p_storage->i_data_max );
+#else
+    free( p_storage->p_data );
 #endif
     free( p_storage );
 }
 
-static void TsStoragePack( ts_storage_t *p_storage )
+static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
-    /* Try to release a bit of memory */
-    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
-        return;
+    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
+}
 
-    p_storage->i_cmd_max = __MAX( p_storage->i_cmd_w, 1 );
+/* Must be called when the oldest commands or their data changed */
+static void TsStorageUpdateFirst( ts_storage_t *p_storage )
+{
+    while( p_storage->i_cmd_first < p_storage->i_cmd_r &&
+           TsStorageCmd( p_storage, p_storage->i_cmd_first )->i_type == C_NONE )
+        p_storage->i_cmd_first++;
 
-    ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
-    if( p_new )
-        p_storage->p_cmd = p_new;
+    p_storage->i_data_first = p_storage->i_data_w;
+    for( uint64_t i = p_storage->i_cmd_first; i < p_storage->i_cmd_w; i++ )
+    {
+        const ts_cmd_t *p_cmd = TsStorageCmd( p_storage, i );
+        if( p_cmd->i_type == C_SEND )
+        {
+            p_storage->i_data_first = p_cmd->u.send.i_offset;
+            break;
+        }
+    }
 }
-static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
+
+/* Sets the next command to execute, skipping the executed ones */
+static void TsStorageSetRead( ts_storage_t *p_storage, uint64_t i_cmd )
 {
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
+    while( i_cmd < p_storage->i_cmd_w &&
+           TsStorageCmd( p_storage, i_cmd )->i_type == C_NONE )
+        i_cmd++;
+    p_storage->i_cmd_r = i_cmd;
+}
+
+/* Drops the unread blocks and clock updates up to i_end. The other
+ * commands are kept in order, right before i_end. */
+static void TsStorageSkip( ts_storage_t *p_storage, uint64_t i_end )
+{
+    uint64_t i_keep = i_end;
+
+    for( uint64_t i = i_end; i > p_storage->i_cmd_r; i-- )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        const ts_cmd_t *p_cmd = TsStorageCmd( p_storage, i - 1 );
 
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
-            return true;
+        if( p_cmd->i_type != C_NONE && !TsCmdIsReplayable( p_cmd ) )
+            *TsStorageCmd( p_storage, --i_keep ) = *p_cmd;
     }
-    return p_storage->i_cmd_w >= p_storage->i_cmd_max;
+    for( uint64_t i = p_storage->i_cmd_r; i < i_keep; i++ )
+        TsStorageCmd( p_storage, i )->i_type = C_NONE;
+
+    TsStorageSetRead( p_storage, i_keep );
+    TsStorageUpdateFirst( p_storage );
+    p_storage->b_reset = true;
 }
-static bool TsStorageIsEmpty( ts_storage_t *p_storage )
+
+/* Frees the oldest data: the executed blocks first, then unread ones */
+static void TsStorageDrop( ts_storage_t *p_storage )
 {
-    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
+    while( p_storage->i_cmd_first < p_storage->i_cmd_r )
+    {
+        const ts_cmd_t *p_cmd = TsStorageCmd( p_storage, p_storage->i_cmd_first++ );
+        if( p_cmd->i_type == C_SEND )
+        {
+            TsStorageUpdateFirst( p_storage );
+            return;
+        }
+    }
+
+    /* Drop a sixteenth of the storage at once, as the commands in between
+     * are moved */
+    const uint64_t i_data = p_storage->i_data_first + p_storage->i_data_max / 16;
+    uint64_t i_end = p_storage->i_cmd_r;
+
+    while( i_end < p_storage->i_cmd_w )
+    {
+        const ts_cmd_t *p_cmd = TsStorageCmd( p_storage, i_end++ );
+        if( p_cmd->i_type == C_SEND && p_cmd->u.send.i_offset >= i_data )
+            break;
+    }
+    TsStorageSkip( p_storage, i_end );
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+
+static int TsStorageGrow( ts_storage_t *p_storage )
 {
-    ts_cmd_t cmd = *p_cmd;
+    const uint64_t i_max = 2 * p_storage->i_cmd_max;
+    ts_cmd_t *p_cmd = vlc_alloc( i_max, sizeof(*p_cmd) );
+    if( unlikely(p_cmd == NULL) )
+        return VLC_ENOMEM;
 
-    assert( !TsStorageIsFull( p_storage, p_cmd ) );
+    for( uint64_t i = p_storage->i_cmd_first; i < p_storage->i_cmd_w; i++ )
+        p_cmd[i & (i_max - 1)] = *TsStorageCmd( p_storage, i );
 
-    if( cmd.i_type == C_SEND )
+    free( p_storage->p_cmd );
+    p_storage->p_cmd = p_cmd;
+    p_storage->i_cmd_max = i_max;
+    return VLC_SUCCESS;
+}
+
+static int TsStoragePushCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd )
+{
+    if( p_storage->i_cmd_w - p_storage->i_cmd_first >= p_storage->i_cmd_max &&
+        TsStorageGrow( p_storage ) )
     {
-        block_t *p_block = cmd.u.send.p_block;
+        CmdClean( p_cmd );
+        return VLC_ENOMEM;
+    }
 
-        cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
+    if( p_cmd->i_type == C_SEND )
+    {
+        block_t *p_block = p_cmd->u.send.p_block;
+        const uint64_t i_size = (sizeof(ts_storage_block_t) + p_block->i_buffer +
+                                 TS_STORAGE_ALIGN - 1) & ~(uint64_t)(TS_STORAGE_ALIGN - 1);
 
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        if( i_size > p_storage->i_data_max )
         {
             block_Release( p_block );
-            return;
+            return VLC_EGENERIC;
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
+
+        /* The data of a block is never split at the end of the ring */
+        uint64_t i_offset = p_storage->i_data_w;
+        const uint64_t i_pos = i_offset % p_storage->i_data_max;
+        if( i_pos + i_size > p_storage->i_data_max )
+            i_offset += p_storage->i_data_max - i_pos;
+
+        while( i_offset + i_size - p_storage->i_data_first > p_storage->i_data_max )
         {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
+            if( p_storage->i_data_first == p_storage->i_data_w )
+                p_storage->i_data_first = i_offset; /* no data is kept */
+            else
+                TsStorageDrop( p_storage );
         }
-        p_storage->i_file_size += p_block->i_buffer;
+
+        uint8_t *p_data = &p_storage->p_data[i_offset % p_storage->i_data_max];
+        const ts_storage_block_t header = {
+            .i_dts = p_block->i_dts,
+            .i_pts = p_block->i_pts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_buffer = p_block->i_buffer,
+        };
+        memcpy( p_data, &header, sizeof(header) );
+        if( p_block->i_buffer > 0 )
+            memcpy( &p_data[sizeof(header)], p_block->p_buffer, p_block->i_buffer );
         block_Release( p_block );
 
-        if( b_flush )
-            fflush( p_storage->p_filew );
+        p_storage->i_data_w = i_offset + i_size;
+        p_cmd->u.send.p_block = NULL;
+        p_cmd->u.send.i_offset = i_offset;
     }
-    p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
+
+    *TsStorageCmd( p_storage, p_storage->i_cmd_w++ ) = *p_cmd;
+    return VLC_SUCCESS;
 }
-static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
+
+static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd )
 {
     assert( !TsStorageIsEmpty( p_storage ) );
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
+    ts_cmd_t *p_stored = TsStorageCmd( p_storage, p_storage->i_cmd_r );
+
+    *p_cmd = *p_stored;
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        const uint8_t *p_data = &p_storage->p_data[p_cmd->u.send.i_offset % p_storage->i_data_max];
+        ts_storage_block_t header;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+        memcpy( &header, p_data, sizeof(header) );
+
+        block_t *p_block = block_Alloc( header.i_buffer );
+        if( p_block )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
+            p_block->i_dts      = header.i_dts;
+            p_block->i_pts      = header.i_pts;
+            p_block->i_flags    = header.i_flags;
+            p_block->i_length   = header.i_length;
+            p_block->i_nb_samples = header.i_nb_samples;
+            if( header.i_buffer > 0 )
+                memcpy( p_block->p_buffer, &p_data[sizeof(header)], header.i_buffer );
         }
+        p_cmd->u.send.p_block = p_block;
+    }
+
+    /* The executed command stays in the storage if it can be executed
+     * again; the pop gives away the ownership of the others */
+    if( TsCmdIsBarrier( p_stored ) )
+        p_storage->i_cmd_first = p_storage->i_cmd_r + 1;
+    else if( !TsCmdIsReplayable( p_stored ) )
+        p_stored->i_type = C_NONE;
+
+    TsStorageSetRead( p_storage, p_storage->i_cmd_r + 1 );
+    TsStorageUpdateFirst( p_storage );
+}
+
+static int TsStorageSeek( ts_storage_t *p_storage, vlc_tick_t i_offset )
+{
+    if( p_storage->i_cmd_first >= p_storage->i_cmd_w )
+        return VLC_EGENERIC;
+
+    /* Find the first command at or after the date */
+    const vlc_tick_t i_date =
+        TsStorageCmd( p_storage, p_storage->i_cmd_w - 1 )->i_date + i_offset;
+    uint64_t i_low = p_storage->i_cmd_first;
+    uint64_t i_high = p_storage->i_cmd_w;
+
+    while( i_low < i_high )
+    {
+        const uint64_t i_mid = i_low + (i_high - i_low) / 2;
+        if( TsStorageCmd( p_storage, i_mid )->i_date < i_date )
+            i_low = i_mid + 1;
         else
-        {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
-        }
+            i_high = i_mid;
+    }
+
+    /* Start on a clock update, so that the playback resumes quickly */
+    while( i_low < p_storage->i_cmd_w )
+    {
+        const ts_cmd_t *p_cmd = TsStorageCmd( p_storage, i_low );
+        if( p_cmd->i_type == C_CONTROL &&
+            ( p_cmd->u.control.i_query == ES_OUT_SET_PCR ||
+              p_cmd->u.control.i_query == ES_OUT_SET_GROUP_PCR ) )
+            break;
+        i_low++;
+    }
+
+    if( i_low < p_storage->i_cmd_r )
+    {
+        p_storage->i_cmd_r = i_low;
+        p_storage->b_reset = true;
     }
+    else
+    {
+        TsStorageSkip( p_storage, i_low );
+    }
+    return VLC_SUCCESS;
 }
 
 /*****************************************************************************
@@ -1296,6 +1521,7 @@ static void CmdClean( ts_cmd_t *p_cmd )
         CmdCleanControl( p_cmd );
         break;
     case C_DEL:
+    case C_NONE:
         break;
     default:
         vlc_assert_unreachable();
@@ -1641,6 +1867,7 @@ static void CmdCleanControl( ts_cmd_t *p_cmd )
     }
 }
 
+#ifdef HAVE_MMAP
 static int GetTmpFile( char **filename, const char *dirname )
 {
     if( dirname != NULL
@@ -1667,3 +1894,4 @@ static int GetTmpFile( char **filename, const char *dirname )
     free( *filename );
     return -1;
 }
+#endif
@@ -189,6 +189,57 @@ void input_SendEventCache( input_thread_t *p_input, double f_level )
     Trigger( p_input, INPUT_EVENT_CACHE );
 }
 
+/**
+ * Records that a startup stage was reached, and notifies it. Only the first
+ * time is recorded.
+ *
+ * \param i_date date the stage was reached, or VLC_TICK_INVALID for now
+ */
+void input_SendEventStartup( input_thread_t *p_input, int i_stage,
+                             vlc_tick_t i_date )
+{
+    static const char names[INPUT_STARTUP_COUNT][14] = {
+        "access", "stream filter", "demux", "first block", "decoder",
+        "first frame", "first picture", "first audio",
+    };
+    input_thread_private_t *priv = input_priv(p_input);
+    const unsigned mask = 1u << i_stage;
+
+    assert( i_stage >= 0 && i_stage < INPUT_STARTUP_COUNT );
+
+    /* Cheap check first, as this is called for every block and frame */
+    if( priv->b_preparsing
+     || (atomic_load_explicit( &priv->startup.reached,
+                               memory_order_relaxed ) & mask) )
+        return;
+
+    vlc_mutex_lock( &priv->counters.counters_lock );
+    if( atomic_load( &priv->startup.reached ) & mask )
+    {
+        vlc_mutex_unlock( &priv->counters.counters_lock );
+        return;
+    }
+
+    if( i_date == VLC_TICK_INVALID )
+        i_date = mdate();
+    else if( i_date < priv->startup.i_start )
+    {
+        /* e.g. a picture of the previous input of a recycled vout */
+        vlc_mutex_unlock( &priv->counters.counters_lock );
+        return;
+    }
+
+    const vlc_tick_t i_delay = i_date - priv->startup.i_start;
+
+    priv->startup.pi_delay[i_stage] = i_delay;
+    atomic_fetch_or( &priv->startup.reached, mask );
+    vlc_mutex_unlock( &priv->counters.counters_lock );
+
+    msg_Dbg( p_input, "startup: %s after %"PRId64" us", names[i_stage],
+             i_delay );
+    Trigger( p_input, INPUT_EVENT_STARTUP );
+}
+
 void input_SendEventMeta( input_thread_t *p_input )
 {
     Trigger( p_input, INPUT_EVENT_ITEM_META );
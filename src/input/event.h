@@ -43,6 +43,12 @@ void input_SendEventSignal( input_thread_t *p_input, double f_quality, double f_
 void input_SendEventState( input_thread_t *p_input, int i_state );
 void input_SendEventCache( input_thread_t *p_input, double f_level );
 
+/*****************************************************************************
+ * Event for access.c/input.c/es_out.c/decoder.c
+ *****************************************************************************/
+void input_SendEventStartup( input_thread_t *p_input, int i_stage,
+                             vlc_tick_t i_date );
+
 /* TODO rename Item* */
 void input_SendEventMeta( input_thread_t *p_input );
 void input_SendEventMetaInfo( input_thread_t *p_input );
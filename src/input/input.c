@@ -63,7 +63,7 @@ static  void *Run( void * );
 static  void *Preparse( void * );
 
 static input_thread_t * Create  ( vlc_object_t *, input_item_t *,
-                                  const char *, bool, input_resource_t *,
+                                  const char *, bool, bool, input_resource_t *,
                                   vlc_renderer_item_t * );
 static  int             Init    ( input_thread_t *p_input );
 static void             End     ( input_thread_t *p_input );
@@ -130,7 +130,8 @@ input_thread_t *input_Create( vlc_object_t *p_parent,
                               const char *psz_log, input_resource_t *p_resource,
                               vlc_renderer_item_t *p_renderer )
 {
-    return Create( p_parent, p_item, psz_log, false, p_resource, p_renderer );
+    return Create( p_parent, p_item, psz_log, false, false, p_resource,
+                   p_renderer );
 }
 
 #undef input_Read
@@ -143,7 +144,8 @@ input_thread_t *input_Create( vlc_object_t *p_parent,
  */
 int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
 {
-    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL, NULL );
+    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, false,
+                                      NULL, NULL );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -160,7 +162,19 @@ int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
 input_thread_t *input_CreatePreparser( vlc_object_t *parent,
                                        input_item_t *item )
 {
-    return Create( parent, item, NULL, true, NULL, NULL );
+    return Create( parent, item, NULL, true, false, NULL, NULL );
+}
+
+input_thread_t *input_CreatePreopened( vlc_object_t *parent,
+                                       input_item_t *item,
+                                       input_resource_t *resource )
+{
+    return Create( parent, item, NULL, false, true, resource, NULL );
+}
+
+void input_Activate( input_thread_t *p_input )
+{
+    input_ControlPush( p_input, INPUT_CONTROL_ACTIVATE, NULL );
 }
 
 /**
@@ -179,6 +193,7 @@ int input_Start( input_thread_t *p_input )
         func = Preparse;
 
     assert( !priv->is_running );
+    priv->startup.i_start = mdate();
     /* Create thread and wait for its readiness. */
     priv->is_running = !vlc_clone( &priv->thread, func, priv,
                                    VLC_THREAD_PRIORITY_INPUT );
@@ -188,6 +203,16 @@ int input_Start( input_thread_t *p_input )
         msg_Err( p_input, "cannot create input thread" );
         return VLC_EGENERIC;
     }
+
+    /* Started inputs are always closed with input_Close() */
+    if( !priv->b_preparsing )
+    {
+        libvlc_priv_t *libpriv = libvlc_priv( p_input->obj.libvlc );
+
+        vlc_mutex_lock( &libpriv->inputs_lock );
+        TAB_APPEND( libpriv->i_inputs, libpriv->pp_inputs, p_input );
+        vlc_mutex_unlock( &libpriv->inputs_lock );
+    }
     return VLC_SUCCESS;
 }
 
@@ -221,6 +246,15 @@ void input_Stop( input_thread_t *p_input )
  */
 void input_Close( input_thread_t *p_input )
 {
+    if( input_priv(p_input)->is_running && !input_priv(p_input)->b_preparsing )
+    {
+        libvlc_priv_t *priv = libvlc_priv( p_input->obj.libvlc );
+
+        vlc_mutex_lock( &priv->inputs_lock );
+        TAB_REMOVE( priv->i_inputs, priv->pp_inputs, p_input );
+        vlc_mutex_unlock( &priv->inputs_lock );
+    }
+
     if( input_priv(p_input)->is_running )
         vlc_join( input_priv(p_input)->thread, NULL );
     vlc_interrupt_deinit( &input_priv(p_input)->interrupt );
@@ -276,6 +310,30 @@ input_item_t *input_GetItem( input_thread_t *p_input )
     return input_priv(p_input)->p_item;
 }
 
+#undef input_GetAll
+input_thread_t **input_GetAll( vlc_object_t *obj, size_t *pi_count )
+{
+    libvlc_priv_t *priv = libvlc_priv( obj->obj.libvlc );
+    input_thread_t **pp_inputs = NULL;
+
+    vlc_mutex_lock( &priv->inputs_lock );
+    *pi_count = priv->i_inputs;
+    if( priv->i_inputs > 0 )
+    {
+        pp_inputs = vlc_alloc( priv->i_inputs, sizeof( *pp_inputs ) );
+        if( likely(pp_inputs != NULL) )
+        {
+            for( int i = 0; i < priv->i_inputs; i++ )
+                pp_inputs[i] = vlc_object_hold( priv->pp_inputs[i] );
+        }
+        else
+            *pi_count = 0;
+    }
+    vlc_mutex_unlock( &priv->inputs_lock );
+
+    return pp_inputs;
+}
+
 /*****************************************************************************
  * This function creates a new input, and returns a pointer
  * to its description. On error, it returns NULL.
@@ -284,7 +342,7 @@ input_item_t *input_GetItem( input_thread_t *p_input )
  *****************************************************************************/
 static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
                                const char *psz_header, bool b_preparsing,
-                               input_resource_t *p_resource,
+                               bool b_prefetch, input_resource_t *p_resource,
                                vlc_renderer_item_t *p_renderer )
 {
     /* Allocate descriptor */
@@ -308,6 +366,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
 
     /* Init Common fields */
     priv->b_preparsing = b_preparsing;
+    priv->b_prefetch = b_prefetch;
     priv->b_can_pace_control = true;
     priv->i_start = 0;
     priv->i_time  = 0;
@@ -397,7 +456,8 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         priv->p_resource_private = input_resource_New( VLC_OBJECT( p_input ) );
         priv->p_resource = input_resource_Hold( priv->p_resource_private );
     }
-    input_resource_SetInput( priv->p_resource, p_input );
+    if( !b_prefetch )
+        input_resource_SetInput( priv->p_resource, p_input );
 
     /* Init control buffer */
     vlc_mutex_init( &priv->lock_control );
@@ -473,6 +533,9 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     memset( &priv->counters, 0, sizeof( priv->counters ) );
     vlc_mutex_init( &priv->counters.counters_lock );
 
+    priv->startup.i_start = mdate();
+    atomic_init( &priv->startup.reached, 0 );
+
     priv->p_es_out_display = input_EsOutNew( p_input, priv->i_rate );
     priv->p_es_out = NULL;
 
@@ -681,6 +744,26 @@ static void MainLoopStatistics( input_thread_t *p_input )
     input_priv(p_input)->bookmark.i_time_offset = i_time;
     vlc_mutex_unlock( &input_priv(p_input)->p_item->lock );
 
+    if( libvlc_stats( p_input ) )
+    {
+        size_t i_buffered;
+
+        if( es_out_Control( input_priv(p_input)->p_es_out_display,
+                            ES_OUT_GET_FIFO_SIZE, &i_buffered ) == VLC_SUCCESS )
+            stats_Set( input_priv(p_input)->counters.p_decoder_buffered,
+                       i_buffered );
+
+        input_clock_stats_t clock;
+
+        if( es_out_Control( input_priv(p_input)->p_es_out_display,
+                            ES_OUT_GET_CLOCK_STATS, &clock ) == VLC_SUCCESS )
+        {
+            vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
+            input_priv(p_input)->counters.clock = clock;
+            vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
+        }
+    }
+
     stats_ComputeInputStats( p_input, input_priv(p_input)->p_item->p_stats );
     input_SendEventStatistics( p_input );
 }
@@ -717,7 +800,11 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
 
         if( !b_paused )
         {
-            if( !input_priv(p_input)->master->b_eof )
+            /* A pre-opened input that can be paced waits once it holds
+             * enough data */
+            if( !input_priv(p_input)->master->b_eof &&
+                !( input_priv(p_input)->b_prefetch &&
+                   es_out_GetPrefetchFull( input_priv(p_input)->p_es_out_display ) ) )
             {
                 bool b_force_update = false;
 
@@ -730,6 +817,10 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
 
                 b_paused_at_eof = false;
             }
+            else if( input_priv(p_input)->b_prefetch )
+            {
+                /* Keep the prefetched data until the input is activated */
+            }
             else if( !es_out_GetEmpty( input_priv(p_input)->p_es_out ) )
             {
                 msg_Dbg( p_input, "waiting decoder fifos to empty" );
@@ -820,26 +911,24 @@ static void InitStatistics( input_thread_t *p_input )
     if( priv->b_preparsing ) return;
 
     /* Prepare statistics */
-#define INIT_COUNTER( c, compute ) free( priv->counters.p_##c ); \
-    priv->counters.p_##c = \
- stats_CounterCreate( STATS_##compute);
+#define INIT_COUNTER( c ) free( priv->counters.p_##c ); \
+    priv->counters.p_##c = stats_CounterCreate();
     if( libvlc_stats( p_input ) )
     {
-        INIT_COUNTER( read_bytes, COUNTER );
-        INIT_COUNTER( read_packets, COUNTER );
-        INIT_COUNTER( demux_read, COUNTER );
-        INIT_COUNTER( input_bitrate, DERIVATIVE );
-        INIT_COUNTER( demux_bitrate, DERIVATIVE );
-        INIT_COUNTER( demux_corrupted, COUNTER );
-        INIT_COUNTER( demux_discontinuity, COUNTER );
-        INIT_COUNTER( played_abuffers, COUNTER );
-        INIT_COUNTER( lost_abuffers, COUNTER );
-        INIT_COUNTER( displayed_pictures, COUNTER );
-        INIT_COUNTER( lost_pictures, COUNTER );
-        INIT_COUNTER( decoded_audio, COUNTER );
-        INIT_COUNTER( decoded_video, COUNTER );
-        INIT_COUNTER( decoded_sub, COUNTER );
-        priv->counters.p_sout_send_bitrate = NULL;
+        INIT_COUNTER( read_bytes );
+        INIT_COUNTER( read_packets );
+        INIT_COUNTER( demux_read );
+        INIT_COUNTER( demux_corrupted );
+        INIT_COUNTER( demux_discontinuity );
+        INIT_COUNTER( played_abuffers );
+        INIT_COUNTER( lost_abuffers );
+        INIT_COUNTER( displayed_pictures );
+        INIT_COUNTER( lost_pictures );
+        INIT_COUNTER( decoded_audio );
+        INIT_COUNTER( decoded_video );
+        INIT_COUNTER( decoded_sub );
+        INIT_COUNTER( decoder_buffered );
+        INIT_COUNTER( audio_drift );
         priv->counters.p_sout_sent_packets = NULL;
         priv->counters.p_sout_sent_bytes = NULL;
     }
@@ -881,9 +970,8 @@ static int InitSout( input_thread_t * p_input )
         }
         if( libvlc_stats( p_input ) )
         {
-            INIT_COUNTER( sout_sent_packets, COUNTER );
-            INIT_COUNTER( sout_sent_bytes, COUNTER );
-            INIT_COUNTER( sout_send_bitrate, DERIVATIVE );
+            INIT_COUNTER( sout_sent_packets );
+            INIT_COUNTER( sout_sent_bytes );
         }
     }
     else
@@ -1322,7 +1410,9 @@ static void InitPrograms( input_thread_t * p_input )
             i_es_out_mode = ES_OUT_MODE_ALL;
         }
     }
-    es_out_SetMode( input_priv(p_input)->p_es_out, i_es_out_mode );
+    /* A pre-opened input selects its ES once activated */
+    if( !input_priv(p_input)->b_prefetch )
+        es_out_SetMode( input_priv(p_input)->p_es_out, i_es_out_mode );
 
     /* Inform the demuxer about waited group (needed only for DVB) */
     if( i_es_out_mode == ES_OUT_MODE_ALL )
@@ -1369,6 +1459,8 @@ static int Init( input_thread_t * p_input )
                                               priv->i_rate );
     if( priv->p_es_out == NULL )
         goto error;
+    if( priv->b_prefetch )
+        es_out_SetPrefetch( priv->p_es_out_display, true );
 
     /* */
     input_ChangeState( p_input, OPENING_S );
@@ -1452,7 +1544,8 @@ error:
         if( input_priv(p_input)->p_sout )
             input_resource_RequestSout( input_priv(p_input)->p_resource,
                                          input_priv(p_input)->p_sout, NULL );
-        input_resource_SetInput( input_priv(p_input)->p_resource, NULL );
+        if( !input_priv(p_input)->b_prefetch )
+            input_resource_SetInput( input_priv(p_input)->p_resource, NULL );
         if( input_priv(p_input)->p_resource_private )
             input_resource_Terminate( input_priv(p_input)->p_resource_private );
     }
@@ -1465,8 +1558,6 @@ error:
         EXIT_COUNTER( read_bytes );
         EXIT_COUNTER( read_packets );
         EXIT_COUNTER( demux_read );
-        EXIT_COUNTER( input_bitrate );
-        EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
         EXIT_COUNTER( played_abuffers );
@@ -1476,12 +1567,13 @@ error:
         EXIT_COUNTER( decoded_audio );
         EXIT_COUNTER( decoded_video );
         EXIT_COUNTER( decoded_sub );
+        EXIT_COUNTER( decoder_buffered );
+        EXIT_COUNTER( audio_drift );
 
         if( input_priv(p_input)->p_sout )
         {
             EXIT_COUNTER( sout_sent_packets );
             EXIT_COUNTER( sout_sent_bytes );
-            EXIT_COUNTER( sout_send_bitrate );
         }
 #undef EXIT_COUNTER
     }
@@ -1541,8 +1633,6 @@ do { \
             CL_CO( read_bytes );
             CL_CO( read_packets );
             CL_CO( demux_read );
-            CL_CO( input_bitrate );
-            CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
             CL_CO( played_abuffers );
@@ -1552,6 +1642,8 @@ do { \
             CL_CO( decoded_audio) ;
             CL_CO( decoded_video );
             CL_CO( decoded_sub) ;
+            CL_CO( decoder_buffered );
+            CL_CO( audio_drift );
         }
 
         /* Close optional stream output instance */
@@ -1559,7 +1651,6 @@ do { \
         {
             CL_CO( sout_sent_packets );
             CL_CO( sout_sent_bytes );
-            CL_CO( sout_send_bitrate );
         }
 #undef CL_CO
     }
@@ -1584,7 +1675,8 @@ do { \
     /* */
     input_resource_RequestSout( input_priv(p_input)->p_resource,
                                  input_priv(p_input)->p_sout, NULL );
-    input_resource_SetInput( input_priv(p_input)->p_resource, NULL );
+    if( !input_priv(p_input)->b_prefetch )
+        input_resource_SetInput( input_priv(p_input)->p_resource, NULL );
     if( input_priv(p_input)->p_resource_private )
         input_resource_Terminate( input_priv(p_input)->p_resource_private );
 }
@@ -2062,6 +2154,19 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* Seek within the timeshift storage of live streams, the time of
+             * the demuxer being the one of the most recent data */
+            int64_t i_live;
+            if( !input_priv(p_input)->b_can_pace_control &&
+                !demux_Control( input_priv(p_input)->master->p_demux,
+                                DEMUX_GET_TIME, &i_live ) &&
+                !es_out_SetTimeshiftOffset( input_priv(p_input)->p_es_out,
+                                            __MIN( i_time - i_live, 0 ) ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( input_priv(p_input)->p_es_out, -1 );
 
@@ -2463,6 +2568,28 @@ static bool Control( input_thread_t *p_input,
             ControlNav( p_input, i_type );
             break;
 
+        case INPUT_CONTROL_ACTIVATE:
+        {
+            input_thread_private_t *priv = input_priv(p_input);
+
+            if( !priv->b_prefetch )
+                break;
+
+            msg_Dbg( p_input, "activating the pre-opened input" );
+            priv->b_prefetch = false;
+
+            /* Trace the startup of the decoders from now on */
+            vlc_mutex_lock( &priv->counters.counters_lock );
+            priv->startup.i_start = mdate();
+            vlc_mutex_unlock( &priv->counters.counters_lock );
+
+            input_resource_SetInput( priv->p_resource, p_input );
+            es_out_SetMode( priv->p_es_out, ES_OUT_MODE_AUTO );
+            es_out_SetPrefetch( priv->p_es_out_display, false );
+            b_force_update = true;
+            break;
+        }
+
         default:
             msg_Err( p_input, "not yet implemented" );
             break;
@@ -2604,6 +2731,8 @@ static demux_t *InputDemuxNew( input_thread_t *p_input, input_source_t *p_source
                                  NULL, priv->p_es_out, priv->b_preparsing );
     if( p_demux )
     {
+        input_SendEventStartup( p_input, INPUT_STARTUP_DEMUX,
+                                VLC_TICK_INVALID );
         MRLSections( psz_anchor,
             &p_source->i_title_start, &p_source->i_title_end,
             &p_source->i_seekpoint_start, &p_source->i_seekpoint_end );
@@ -2640,13 +2769,20 @@ static demux_t *InputDemuxNew( input_thread_t *p_input, input_source_t *p_source
     if( var_InheritBool( p_source, "input-record-native" ) )
         p_stream = stream_FilterChainNew( p_stream, "record" );
 
+    input_SendEventStartup( p_input, INPUT_STARTUP_STREAM_FILTER,
+                            VLC_TICK_INVALID );
+
     /* create a regular demux with the access stream created */
     p_demux = demux_NewAdvanced( VLC_OBJECT( p_source ), p_input,
                                  psz_access, psz_demux, psz_path,
                                  p_stream, priv->p_es_out,
                                  priv->b_preparsing );
     if( p_demux )
+    {
+        input_SendEventStartup( p_input, INPUT_STARTUP_DEMUX,
+                                VLC_TICK_INVALID );
         return p_demux;
+    }
 
 error:
     free( psz_base_mrl );
@@ -3523,10 +3659,9 @@ void input_UpdateStatistic( input_thread_t *p_input,
 {
     assert( input_priv(p_input)->i_state != INIT_S );
 
-    vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock);
     switch( i_type )
     {
-#define I(c) stats_Update( input_priv(p_input)->counters.c, i_delta, NULL )
+#define I(c) stats_Update( input_priv(p_input)->counters.c, i_delta )
     case INPUT_STATISTIC_DECODED_VIDEO:
         I(p_decoded_video);
         break;
@@ -3539,20 +3674,14 @@ void input_UpdateStatistic( input_thread_t *p_input,
     case INPUT_STATISTIC_SENT_PACKET:
         I(p_sout_sent_packets);
         break;
-#undef I
     case INPUT_STATISTIC_SENT_BYTE:
-    {
-        uint64_t bytes;
-
-        stats_Update( input_priv(p_input)->counters.p_sout_sent_bytes, i_delta, &bytes );
-        stats_Update( input_priv(p_input)->counters.p_sout_send_bitrate, bytes, NULL );
+        I(p_sout_sent_bytes);
         break;
-    }
+#undef I
     default:
         msg_Err( p_input, "Invalid statistic type %d (internal error)", i_type );
         break;
     }
-    vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock);
 }
 
 /**/
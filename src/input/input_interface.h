@@ -53,6 +53,28 @@ void input_item_SetEpgOffline( input_item_t * );
 input_thread_t *input_CreatePreparser(vlc_object_t *obj, input_item_t *item)
 VLC_USED;
 
+/**
+ * Creates a pre-opened input.
+ *
+ * The input opens and demuxes the item without decoding it: the elementary
+ * streams are kept from their last key frame, until input_Activate() is
+ * called. It does not use the resource until then. The input needs to be
+ * started with input_Start() afterwards.
+ *
+ * @param obj parent object
+ * @param item input item to open
+ * @param resource input resource to use once activated
+ * @return an input thread or NULL on error
+ */
+input_thread_t *input_CreatePreopened(vlc_object_t *obj, input_item_t *item,
+                                      input_resource_t *resource)
+VLC_USED;
+
+/**
+ * Starts decoding a pre-opened input from the data it kept.
+ */
+void input_Activate(input_thread_t *);
+
 /* misc/stats.c
  * FIXME it should NOT be defined here or not coded in misc/stats.c */
 input_stats_t *stats_NewInputStats( input_thread_t *p_input );
@@ -27,11 +27,13 @@
 #include <stddef.h>
 
 #include <vlc_access.h>
+#include <vlc_atomic.h>
 #include <vlc_demux.h>
 #include <vlc_input.h>
 #include <vlc_viewpoint.h>
 #include <libvlc.h>
 #include "input_interface.h"
+#include "clock.h"
 #include "misc/interrupt.h"
 
 /*****************************************************************************
@@ -88,6 +90,7 @@ typedef struct input_thread_private_t
 
     /* Global properties */
     bool        b_preparsing;
+    bool        b_prefetch; /* pre-opened, not decoding yet */
     bool        b_can_pause;
     bool        b_can_rate_control;
     bool        b_can_pace_control;
@@ -151,24 +154,31 @@ typedef struct input_thread_private_t
     struct {
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
-        counter_t *p_input_bitrate;
         counter_t *p_demux_read;
-        counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
         counter_t *p_demux_discontinuity;
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
+        counter_t *p_decoder_buffered;
         counter_t *p_sout_sent_packets;
         counter_t *p_sout_sent_bytes;
-        counter_t *p_sout_send_bitrate;
         counter_t *p_played_abuffers;
         counter_t *p_lost_abuffers;
+        counter_t *p_audio_drift;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
-        vlc_mutex_t counters_lock;
+        input_clock_stats_t clock; /* protected by counters_lock */
+        vlc_mutex_t counters_lock; /* the counters themselves are atomic */
     } counters;
 
+    /* Startup trace (delays protected by counters_lock) */
+    struct {
+        vlc_tick_t  i_start;
+        vlc_tick_t  pi_delay[INPUT_STARTUP_COUNT];
+        atomic_uint reached; /* mask of the stages reached */
+    } startup;
+
     /* Buffer of pending actions */
     vlc_mutex_t lock_control;
     vlc_cond_t  wait_control;
@@ -234,6 +244,8 @@ enum input_control_e
     INPUT_CONTROL_SET_FRAME_NEXT,
 
     INPUT_CONTROL_SET_RENDERER,
+
+    INPUT_CONTROL_ACTIVATE,         // start decoding a pre-opened input
 };
 
 /* Internal helpers */
@@ -282,4 +294,7 @@ void vlc_audio_replay_gain_MergeFromMeta( audio_replay_gain_t *p_dst,
 /* item.c */
 void input_item_node_PostAndDelete( input_item_node_t *p_node );
 
+/* stats.c */
+void input_GetStartup( input_thread_t *, int64_t pi_delay[INPUT_STARTUP_COUNT] );
+
 #endif
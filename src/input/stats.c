@@ -30,39 +30,49 @@
 
 /**
  * Create a statistics counter
- * \param i_compute_type the aggregation type. One of STATS_LAST (always
- * keep the last value), STATS_COUNTER (increment by the passed value),
- * STATS_MAX (keep the maximum passed value), STATS_MIN, or STATS_DERIVATIVE
- * (keep a time derivative of the value)
  */
-counter_t * stats_CounterCreate( int i_compute_type )
+counter_t * stats_CounterCreate( void )
 {
     counter_t *p_counter = (counter_t*) malloc( sizeof( counter_t ) ) ;
 
     if( !p_counter ) return NULL;
-    p_counter->i_compute_type = i_compute_type;
-    p_counter->i_samples = 0;
-    p_counter->pp_samples = NULL;
-
-    p_counter->last_update = 0;
+    atomic_init( &p_counter->value, 0 );
+    memset( p_counter->samples, 0, sizeof( p_counter->samples ) );
 
     return p_counter;
 }
 
 static inline int64_t stats_GetTotal(const counter_t *counter)
 {
-    if (counter == NULL || counter->i_samples == 0)
+    if (counter == NULL)
         return 0;
-    return counter->pp_samples[0]->value;
+    return atomic_load_explicit(&counter->value, memory_order_relaxed);
 }
 
-static inline float stats_GetRate(const counter_t *counter)
+/**
+ * Gets the rate of a counter, in units per microsecond. The counter is
+ * sampled at most once per second, and only by the thread computing the
+ * statistics.
+ */
+static float stats_GetRate(counter_t *counter, vlc_tick_t now)
 {
-    if (counter == NULL || counter->i_samples < 2)
+    if (counter == NULL)
         return 0.;
 
-    return (counter->pp_samples[0]->value - counter->pp_samples[1]->value)
-        / (float)(counter->pp_samples[0]->date - counter->pp_samples[1]->date);
+    counter_sample_t *last = &counter->samples[0];
+
+    if (last->date == 0 || now - last->date >= CLOCK_FREQ)
+    {
+        counter->samples[1] = *last;
+        last->value = stats_GetTotal(counter);
+        last->date = now;
+    }
+
+    const counter_sample_t *prev = &counter->samples[1];
+    if (prev->date == 0)
+        return 0.;
+
+    return (last->value - prev->value) / (float)(last->date - prev->date);
 }
 
 input_stats_t *stats_NewInputStats( input_thread_t *p_input )
@@ -78,6 +88,27 @@ input_stats_t *stats_NewInputStats( input_thread_t *p_input )
     return p_stats;
 }
 
+static void GetStartup(input_thread_private_t *priv, int64_t *delay)
+{
+    const unsigned reached = atomic_load(&priv->startup.reached);
+
+    for (unsigned i = 0; i < INPUT_STARTUP_COUNT; i++)
+        delay[i] = (reached & (1u << i)) ? priv->startup.pi_delay[i] : -1;
+}
+
+/**
+ * Gets the delays of the startup stages since the input start, or -1 for
+ * the stages not reached yet.
+ */
+void input_GetStartup(input_thread_t *input, int64_t delay[INPUT_STARTUP_COUNT])
+{
+    input_thread_private_t *priv = input_priv(input);
+
+    vlc_mutex_lock(&priv->counters.counters_lock);
+    GetStartup(priv, delay);
+    vlc_mutex_unlock(&priv->counters.counters_lock);
+}
+
 void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
 {
     input_thread_private_t *priv = input_priv(input);
@@ -85,40 +116,56 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     if (!libvlc_stats(input))
         return;
 
-    vlc_mutex_lock(&priv->counters.counters_lock);
+    const vlc_tick_t now = mdate();
+
     vlc_mutex_lock(&st->lock);
 
     /* Input */
     st->i_read_packets = stats_GetTotal(priv->counters.p_read_packets);
     st->i_read_bytes = stats_GetTotal(priv->counters.p_read_bytes);
-    st->f_input_bitrate = stats_GetRate(priv->counters.p_input_bitrate);
+    st->f_input_bitrate = stats_GetRate(priv->counters.p_read_bytes, now);
     st->i_demux_read_bytes = stats_GetTotal(priv->counters.p_demux_read);
-    st->f_demux_bitrate = stats_GetRate(priv->counters.p_demux_bitrate);
+    st->f_demux_bitrate = stats_GetRate(priv->counters.p_demux_read, now);
     st->i_demux_corrupted = stats_GetTotal(priv->counters.p_demux_corrupted);
     st->i_demux_discontinuity = stats_GetTotal(priv->counters.p_demux_discontinuity);
 
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(priv->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(priv->counters.p_decoded_audio);
+    st->i_decoder_buffered = stats_GetTotal(priv->counters.p_decoder_buffered);
 
     /* Sout */
-    if (priv->counters.p_sout_send_bitrate)
+    if (priv->counters.p_sout_sent_bytes)
     {
         st->i_sent_packets = stats_GetTotal(priv->counters.p_sout_sent_packets);
         st->i_sent_bytes = stats_GetTotal(priv->counters.p_sout_sent_bytes);
-        st->f_send_bitrate = stats_GetRate(priv->counters.p_sout_send_bitrate);
+        st->f_send_bitrate = stats_GetRate(priv->counters.p_sout_sent_bytes,
+                                           now);
     }
 
     /* Aout */
     st->i_played_abuffers = stats_GetTotal(priv->counters.p_played_abuffers);
     st->i_lost_abuffers = stats_GetTotal(priv->counters.p_lost_abuffers);
+    st->i_audio_drift = (int64_t)stats_GetTotal(priv->counters.p_audio_drift);
 
     /* Vouts */
     st->i_displayed_pictures = stats_GetTotal(priv->counters.p_displayed_pictures);
     st->i_lost_pictures = stats_GetTotal(priv->counters.p_lost_pictures);
 
-    vlc_mutex_unlock(&st->lock);
+    vlc_mutex_lock(&priv->counters.counters_lock);
+
+    /* Clock */
+    st->i_clock_drift = priv->counters.clock.i_drift;
+    st->i_clock_resets = priv->counters.clock.i_resets;
+    for (unsigned i = 0; i < INPUT_CLOCK_JITTER_BUCKETS; i++)
+        st->i_clock_jitter[i] = priv->counters.clock.pi_jitter[i];
+    st->i_clock_jitter_sum = priv->counters.clock.i_jitter_sum;
+
+    /* Startup */
+    GetStartup(priv, st->i_startup);
     vlc_mutex_unlock(&priv->counters.counters_lock);
+
+    vlc_mutex_unlock(&st->lock);
 }
 
 void stats_ReinitInputStats( input_stats_t *p_stats )
@@ -132,78 +179,18 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
-    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
-     = 0;
+    p_stats->i_decoder_buffered = p_stats->i_audio_drift =
+    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate =
+    p_stats->i_clock_drift = p_stats->i_clock_resets =
+    p_stats->i_clock_jitter_sum = 0;
+    for( unsigned i = 0; i < INPUT_CLOCK_JITTER_BUCKETS; i++ )
+        p_stats->i_clock_jitter[i] = 0;
+    for( unsigned i = 0; i < INPUT_STARTUP_COUNT; i++ )
+        p_stats->i_startup[i] = -1;
     vlc_mutex_unlock( &p_stats->lock );
 }
 
 void stats_CounterClean( counter_t *p_c )
 {
-    if( p_c )
-    {
-        for( int i = 0; i < p_c->i_samples; i++ )
-            free( p_c->pp_samples[i] );
-        TAB_CLEAN(p_c->i_samples, p_c->pp_samples);
-        free( p_c );
-    }
-}
-
-
-/** Update a counter element with new values
- * \param p_counter the counter to update
- * \param val the vlc_value union containing the new value to aggregate. For
- * more information on how data is aggregated, \see stats_Create
- * \param val_new a pointer that will be filled with new data
- */
-void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
-{
-    if( !p_counter )
-        return;
-
-    switch( p_counter->i_compute_type )
-    {
-    case STATS_DERIVATIVE:
-    {
-        counter_sample_t *p_new, *p_old;
-        vlc_tick_t now = mdate();
-        if( now - p_counter->last_update < CLOCK_FREQ )
-            return;
-        p_counter->last_update = now;
-        /* Insert the new one at the beginning */
-        p_new = (counter_sample_t*)malloc( sizeof( counter_sample_t ) );
-        if (unlikely(p_new == NULL))
-            return; /* NOTE: Losing sample here */
-
-        p_new->value = val;
-        p_new->date = p_counter->last_update;
-        TAB_INSERT(p_counter->i_samples, p_counter->pp_samples, p_new, 0);
-
-        if( p_counter->i_samples == 3 )
-        {
-            p_old = p_counter->pp_samples[2];
-            TAB_ERASE(p_counter->i_samples, p_counter->pp_samples, 2);
-            free( p_old );
-        }
-        break;
-    }
-    case STATS_COUNTER:
-        if( p_counter->i_samples == 0 )
-        {
-            counter_sample_t *p_new = (counter_sample_t*)malloc(
-                                               sizeof( counter_sample_t ) );
-            if (unlikely(p_new == NULL))
-                return; /* NOTE: Losing sample here */
-
-            p_new->value = 0;
-
-            TAB_APPEND(p_counter->i_samples, p_counter->pp_samples, p_new);
-        }
-        if( p_counter->i_samples == 1 )
-        {
-            p_counter->pp_samples[0]->value += val;
-            if( new_val )
-                *new_val = p_counter->pp_samples[0]->value;
-        }
-        break;
-    }
+    free( p_c );
 }
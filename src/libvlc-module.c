@@ -87,6 +87,12 @@ static const char *const ppsz_snap_formats[] =
     "This is the verbosity level (0=only errors and " \
     "standard messages, 1=warnings, 2=debug).")
 
+#define LOG_ASYNC_TEXT N_("Asynchronous logging")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "The messages are passed to the log by a dedicated thread, so that " \
+    "logging does not slow the other threads down. Disable this to get " \
+    "the messages right away, e.g. when debugging a crash.")
+
 #define OPEN_TEXT N_("Default stream")
 #define OPEN_LONGTEXT N_( \
     "This stream will always be opened at VLC startup." )
@@ -232,6 +238,14 @@ static const char *const ppsz_stereo_mode_texts[] = { N_("Unset"),
     "This allows playing audio at lower or higher speed without " \
     "affecting the audio pitch" )
 
+#define AUDIO_LOW_LATENCY_TEXT N_( \
+    "Low latency audio" )
+#define AUDIO_LOW_LATENCY_LONGTEXT N_( \
+    "Play audio ahead of its timestamps, keeping only as much buffered " \
+    "as the measured jitter of the input requires. The playback speed is " \
+    "adjusted continuously to track the buffer target. This breaks the " \
+    "synchronization with video, and is meant for live audio streams." )
+
 
 static const char *const ppsz_replay_gain_mode[] = {
     "none", "track", "album" };
@@ -475,6 +489,11 @@ static const char *const ppsz_pos_descriptions[] =
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define FRAME_STATS_TEXT N_("Report frame timing statistics")
+#define FRAME_STATS_LONGTEXT N_( \
+    "This logs the latency, pacing and rendering time histograms of the " \
+    "displayed pictures when the video output is closed." )
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -530,6 +549,13 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define CLOCK_SMOOTHING_TEXT N_("Clock smoothing")
+#define CLOCK_SMOOTHING_LONGTEXT N_( \
+    "This selects how the drift between the stream clock and the system " \
+    "clock of real-time sources is estimated. The linear regression over " \
+    "the clock references of the averaging period follows a difference of " \
+    "frequency between the clocks without lagging behind.")
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -539,6 +565,10 @@ static const int pi_clock_values[] = { -1, 0, 1 };
 static const char *const ppsz_clock_descriptions[] =
 { N_("Default"), N_("Disable"), N_("Enable") };
 
+static const int pi_clock_smoothing_values[] = { 0, 1 };
+static const char *const ppsz_clock_smoothing_descriptions[] =
+{ N_("Average"), N_("Linear regression") };
+
 #define MTU_TEXT N_("MTU of the network interface")
 #define MTU_LONGTEXT N_( \
     "This is the maximum application-layer packet size that can be " \
@@ -681,10 +711,16 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_TIMESHIFT_PATH_LONGTEXT N_( \
     "Directory used to store the timeshift temporary files." )
 
-#define INPUT_TIMESHIFT_GRANULARITY_TEXT N_("Timeshift granularity")
-#define INPUT_TIMESHIFT_GRANULARITY_LONGTEXT N_( \
-    "This is the maximum size in bytes of the temporary files " \
-    "that will be used to store the timeshifted streams." )
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size (MiB)")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum size of the temporary file that will be used to " \
+    "store the timeshifted streams. The oldest data are dropped when it " \
+    "is full." )
+
+#define INPUT_TIMESHIFT_ALWAYS_TEXT N_("Always timeshift live streams")
+#define INPUT_TIMESHIFT_ALWAYS_LONGTEXT N_( \
+    "Store live streams from the start, and not only when they are " \
+    "paused, so that the playback can go back in time." )
 
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
@@ -917,6 +953,18 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define DECODER_POOL_TEXT N_("Share threads between low rate decoders")
+#define DECODER_POOL_LONGTEXT N_( \
+    "Subtitles decoders and low bitrate audio decoders run on a pool of " \
+    "shared threads, instead of a thread each. This saves many mostly " \
+    "idle threads when all the streams of a multiplex are decoded.")
+
+#define DECODER_POOL_AUDIO_BITRATE_TEXT N_("Shared audio decoders bitrate")
+#define DECODER_POOL_AUDIO_BITRATE_LONGTEXT N_( \
+    "Audio streams below this bitrate (in kb/s) are decoded on the shared " \
+    "threads. The bitrate of compressed audio is assumed to be low if " \
+    "it is unknown.")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1123,6 +1171,11 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time allowed to preparse an item, in milliseconds" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed at the same time " \
+    "(0 = twice the number of CPUs)." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1200,6 +1253,23 @@ static const char *const psz_recursive_list_text[] = {
     "The playlist can use a tree to categorize some items, like the " \
     "contents of a directory." )
 
+#define PREOPEN_TEXT N_("Pre-opened items")
+#define PREOPEN_LONGTEXT N_( \
+    "Number of playlist items around the current one to open in advance. " \
+    "They are demuxed without being decoded, from their last key frame for " \
+    "live streams or from their start otherwise, so that switching to them " \
+    "is almost instantaneous (0 to disable)." )
+
+#define PREOPEN_BUFFER_TEXT N_("Pre-opened item buffer (kB)")
+#define PREOPEN_BUFFER_LONGTEXT N_( \
+    "Maximum amount of data kept by each pre-opened item. Above it, the " \
+    "oldest data of live streams is dropped, and other items are not read " \
+    "any further until they are played." )
+
+#define PREOPEN_BITRATE_TEXT N_("Pre-opened item bitrate (kb/s)")
+#define PREOPEN_BITRATE_LONGTEXT N_( \
+    "Maximum bitrate read by each pre-opened item (0 for no limit)." )
+
 
 /*****************************************************************************
  * Hotkeys
@@ -1525,6 +1595,8 @@ vlc_module_begin ()
 
     add_bool( "audio-time-stretch", true,
               AUDIO_TIME_STRETCH_TEXT, AUDIO_TIME_STRETCH_LONGTEXT, false )
+    add_bool( "audio-low-latency", false,
+              AUDIO_LOW_LATENCY_TEXT, AUDIO_LOW_LATENCY_LONGTEXT, true )
 
     set_subcategory( SUBCAT_AUDIO_AOUT )
     add_module( "aout", "audio output", NULL, AOUT_TEXT, AOUT_LONGTEXT,
@@ -1568,6 +1640,8 @@ vlc_module_begin ()
               SKIP_FRAMES_LONGTEXT, true )
     add_bool( "quiet-synchro", 0, QUIET_SYNCHRO_TEXT,
               QUIET_SYNCHRO_LONGTEXT, true )
+    add_bool( "vout-frame-stats", false, FRAME_STATS_TEXT,
+              FRAME_STATS_LONGTEXT, true )
     add_bool( "keyboard-events", true, KEYBOARD_EVENTS_TEXT,
               KEYBOARD_EVENTS_LONGTEXT, true )
     add_bool( "mouse-events", true, MOUSE_EVENTS_TEXT,
@@ -1914,6 +1988,11 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_integer( "clock-smoothing", 0, CLOCK_SMOOTHING_TEXT,
+                 CLOCK_SMOOTHING_LONGTEXT, true )
+        change_integer_list( pi_clock_smoothing_values,
+                             ppsz_clock_smoothing_descriptions )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1925,8 +2004,11 @@ vlc_module_begin ()
 
     add_directory( "input-timeshift-path", NULL, INPUT_TIMESHIFT_PATH_TEXT,
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
-    add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
-                 INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_obsolete_integer( "input-timeshift-granularity" ) /* since 3.0.22 */
+    add_integer( "input-timeshift-size", 256, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+    add_bool( "input-timeshift-always", false, INPUT_TIMESHIFT_ALWAYS_TEXT,
+              INPUT_TIMESHIFT_ALWAYS_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1939,6 +2021,12 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_bool( "decoder-pool", false, DECODER_POOL_TEXT,
+              DECODER_POOL_LONGTEXT, true )
+    add_integer( "decoder-pool-audio-bitrate", 256,
+                 DECODER_POOL_AUDIO_BITRATE_TEXT,
+                 DECODER_POOL_AUDIO_BITRATE_LONGTEXT, true )
+        change_integer_range( 0, 100000 )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -2104,6 +2192,14 @@ vlc_module_begin ()
     add_bool( "media-library", 0, ML_TEXT, ML_LONGTEXT, false )
     add_bool( "playlist-tree", 0, PLTREE_TEXT, PLTREE_LONGTEXT, false )
 
+    add_integer_with_range( "preopen", 0, 0, 8, PREOPEN_TEXT,
+                            PREOPEN_LONGTEXT, true )
+    add_integer_with_range( "preopen-buffer", 16384, 256, 262144,
+                            PREOPEN_BUFFER_TEXT, PREOPEN_BUFFER_LONGTEXT, true )
+    add_integer( "preopen-bitrate", 0, PREOPEN_BITRATE_TEXT,
+                 PREOPEN_BITRATE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+
     add_string( "open", "", OPEN_TEXT, OPEN_LONGTEXT, false )
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
@@ -2111,6 +2207,9 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer_with_range( "preparse-threads", 0, 0, 64,
+                            PREPARSE_THREADS_TEXT, PREPARSE_THREADS_LONGTEXT,
+                            true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
@@ -2140,6 +2239,7 @@ vlc_module_begin ()
                  false )
         change_short('v')
         change_volatile ()
+    add_bool( "log-async", true, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
     add_obsolete_string( "verbose-objects" ) /* since 2.1.0 */
 #if !defined(_WIN32) && !defined(__OS2__)
     add_bool( "daemon", 0, DAEMON_TEXT, DAEMON_LONGTEXT, true )
@@ -43,6 +43,7 @@
 #include "modules/modules.h"
 #include "config/configuration.h"
 #include "playlist/preparser.h"
+#include "input/decoder_pool.h"
 
 #include <stdio.h>                                              /* sprintf() */
 #include <string.h>
@@ -94,6 +95,9 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->playlist = NULL;
     priv->p_vlm = NULL;
 
+    vlc_mutex_init( &priv->inputs_lock );
+    TAB_INIT( priv->i_inputs, priv->pp_inputs );
+
     vlc_ExitInit( &priv->exit );
 
     return p_libvlc;
@@ -244,6 +248,12 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     if( !priv->parser )
         goto error;
 
+    /*
+     * Shared decoder threads
+     */
+    if( var_InheritBool( p_libvlc, "decoder-pool" ) )
+        priv->decoder_pool = decoder_pool_New( p_libvlc );
+
     /* Create a variable for showing the fullscreen interface */
     var_Create( p_libvlc, "intf-toggle-fscontrol", VLC_VAR_BOOL );
     var_SetBool( p_libvlc, "intf-toggle-fscontrol", true );
@@ -416,6 +426,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if (priv->decoder_pool != NULL)
+        decoder_pool_Delete(priv->decoder_pool);
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
@@ -443,6 +456,10 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
 
     vlc_ExitDestroy( &priv->exit );
 
+    assert( priv->i_inputs == 0 );
+    TAB_CLEAN( priv->i_inputs, priv->pp_inputs );
+    vlc_mutex_destroy( &priv->inputs_lock );
+
     assert( atomic_load(&(vlc_internals(p_libvlc)->refs)) == 1 );
     vlc_object_release( p_libvlc );
 }
@@ -546,6 +563,22 @@ int libvlc_ArtRequest(libvlc_int_t *libvlc, input_item_t *item,
     return VLC_SUCCESS;
 }
 
+/**
+ * Changes the priority of a pending meta data extraction request, e.g. when
+ * the item becomes visible. Only the META_REQUEST_OPTION_PRIORITY_* options
+ * are used.
+ */
+void libvlc_MetadataPrioritize(libvlc_int_t *libvlc, void *id,
+                               input_item_meta_request_option_t i_options)
+{
+    libvlc_priv_t *priv = libvlc_priv(libvlc);
+
+    if (unlikely(priv->parser == NULL))
+        return;
+
+    playlist_preparser_Prioritize(priv->parser, id, i_options);
+}
+
 /**
  * Cancels extraction of the meta data for an input item.
  *
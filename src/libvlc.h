@@ -26,6 +26,7 @@
 # define LIBVLC_LIBVLC_H 1
 
 #include <vlc_input_item.h>
+#include <vlc_atomic.h>
 
 extern const char psz_vlc_changeset[];
 
@@ -191,6 +192,12 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     vlc_actions_t *actions; ///< Hotkeys handler
+    struct decoder_pool_t *decoder_pool; ///< Shared decoder threads (or NULL)
+
+    /* Running inputs (for statistics) */
+    vlc_mutex_t        inputs_lock;
+    int                i_inputs;
+    input_thread_t   **pp_inputs;
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -219,12 +226,6 @@ void var_OptionParse (vlc_object_t *, const char *, bool trusted);
 /*
  * Stats stuff
  */
-enum
-{
-    STATS_COUNTER,
-    STATS_DERIVATIVE,
-};
-
 typedef struct counter_sample_t
 {
     uint64_t value;
@@ -233,40 +234,34 @@ typedef struct counter_sample_t
 
 typedef struct counter_t
 {
-    int                 i_compute_type;
-    int                 i_samples;
-    counter_sample_t ** pp_samples;
-
-    vlc_tick_t          last_update;
+    atomic_uint_fast64_t value;
+    /* Last two samples for the rate, only used by the reading thread */
+    counter_sample_t     samples[2];
 } counter_t;
 
-enum
-{
-    STATS_INPUT_BITRATE,
-    STATS_READ_BYTES,
-    STATS_READ_PACKETS,
-    STATS_DEMUX_READ,
-    STATS_DEMUX_BITRATE,
-    STATS_DEMUX_CORRUPTED,
-    STATS_DEMUX_DISCONTINUITY,
-    STATS_PLAYED_ABUFFERS,
-    STATS_LOST_ABUFFERS,
-    STATS_DECODED_AUDIO,
-    STATS_DECODED_VIDEO,
-    STATS_DECODED_SUB,
-    STATS_CLIENT_CONNECTIONS,
-    STATS_ACTIVE_CONNECTIONS,
-    STATS_SOUT_SENT_PACKETS,
-    STATS_SOUT_SENT_BYTES,
-    STATS_SOUT_SEND_BITRATE,
-    STATS_DISPLAYED_PICTURES,
-    STATS_LOST_PICTURES,
-};
-
-counter_t * stats_CounterCreate (int);
-void stats_Update (counter_t *, uint64_t, uint64_t *);
+counter_t * stats_CounterCreate (void);
 void stats_CounterClean (counter_t * );
 
+/**
+ * Adds a value to a counter. This does not take any lock, and can be called
+ * from any thread.
+ */
+static inline void stats_Update (counter_t *counter, uint64_t val)
+{
+    if (counter != NULL)
+        atomic_fetch_add_explicit (&counter->value, val,
+                                   memory_order_relaxed);
+}
+
+/**
+ * Sets the value of a gauge counter.
+ */
+static inline void stats_Set (counter_t *counter, uint64_t val)
+{
+    if (counter != NULL)
+        atomic_store_explicit (&counter->value, val, memory_order_relaxed);
+}
+
 void stats_ComputeInputStats(input_thread_t*, input_stats_t*);
 void stats_ReinitInputStats(input_stats_t *);
 
@@ -32,6 +32,8 @@ struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
     int timeout; /**< timeout duration in microseconds */
+    vlc_tick_t deadline; /**< deadline of the task, once running */
+    struct bg_queued_item* next; /**< next item in the same list */
 };
 
 struct background_worker {
@@ -40,142 +42,215 @@ struct background_worker {
 
     vlc_mutex_t lock; /**< acquire to inspect members that follow */
     struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_cond_t wait; /**< wait for update in terms of head */
+        vlc_cond_t wait; /**< wait for an update in terms of running tasks */
         vlc_cond_t worker_wait; /**< wait for probe request or cancelation */
-        vlc_tick_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
+        unsigned probe_request; /**< incremented on each probe request */
+        struct bg_queued_item* tasks; /**< running tasks */
     } head;
 
     struct {
         vlc_cond_t wait; /**< wait for update in terms of tail */
-        vlc_array_t data; /**< queue of pending entities to process */
+        struct {
+            struct bg_queued_item* first;
+            struct bg_queued_item** lastp;
+        } queue[BACKGROUND_WORKER_PRIORITY_COUNT]; /**< pending entities */
+        size_t count; /**< number of pending entities */
     } tail;
+
+    struct {
+        unsigned count; /**< number of threads */
+        unsigned idle; /**< number of threads waiting for an entity */
+        bool closing; /**< true if the threads shall terminate */
+    } threads;
 };
 
-static void* Thread( void* data )
+static void QueueAppend( struct background_worker* worker,
+                         struct bg_queued_item* item, int priority )
 {
-    struct background_worker* worker = data;
+    item->next = NULL;
+    *worker->tail.queue[priority].lastp = item;
+    worker->tail.queue[priority].lastp = &item->next;
+}
 
-    for( ;; )
+/**
+ * Removes the entities matching an id (or all, if NULL) from a queue, and
+ * returns them as a list
+ */
+static struct bg_queued_item* QueueExtract( struct background_worker* worker,
+                                            int priority, void* id )
+{
+    struct bg_queued_item* list = NULL;
+    struct bg_queued_item** listp = &list;
+    struct bg_queued_item** pp = &worker->tail.queue[priority].first;
+
+    while( *pp != NULL )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_queued_item* item = *pp;
+
+        if( id == NULL || item->id == id )
+        {
+            *pp = item->next;
+            *listp = item;
+            listp = &item->next;
+            continue;
+        }
+        pp = &item->next;
+    }
+    *listp = NULL;
+    worker->tail.queue[priority].lastp = pp;
+    return list;
+}
+
+/* Gets the oldest entity of the highest priority */
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
+{
+    for( int i = BACKGROUND_WORKER_PRIORITY_COUNT - 1; i >= 0; i-- )
+    {
+        struct bg_queued_item* item = worker->tail.queue[i].first;
+
+        if( item == NULL )
+            continue;
+
+        worker->tail.queue[i].first = item->next;
+        if( item->next == NULL )
+            worker->tail.queue[i].lastp = &worker->tail.queue[i].first;
+        worker->tail.count--;
+        return item;
+    }
+    return NULL;
+}
+
+static void TaskRemove( struct background_worker* worker,
+                        struct bg_queued_item* task )
+{
+    struct bg_queued_item** pp = &worker->head.tasks;
+
+    while( *pp != task )
+        pp = &(*pp)->next;
+    *pp = task->next;
+}
 
+static bool TaskIsRunning( struct background_worker* worker, void* id )
+{
+    for( struct bg_queued_item* task = worker->head.tasks; task != NULL;
+         task = task->next )
+        if( id == NULL || task->id == id )
+            return true;
+    return false;
+}
+
+static void RunTask( struct background_worker* worker,
+                     struct bg_queued_item* item )
+{
+    void* handle;
+
+    if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
+        return;
+
+    for( ;; )
+    {
         vlc_mutex_lock( &worker->lock );
-        for( ;; )
+
+        bool const b_timeout = item->deadline <= mdate();
+        unsigned const probe_request = worker->head.probe_request;
+
+        vlc_mutex_unlock( &worker->lock );
+
+        if( b_timeout ||
+            worker->conf.pf_probe( worker->owner, handle ) )
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
-
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
-
-            if( worker->head.deadline == VLC_TICK_0 && item == NULL )
-                worker->head.active = false;
-            worker->head.id = item ? item->id : NULL;
-            vlc_cond_broadcast( &worker->head.wait );
-
-            if( item )
-            {
-                if( item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-                else
-                    worker->head.deadline = INT64_MAX;
-            }
-            else if( worker->head.deadline != VLC_TICK_0 )
-            {
-                /* Wait 1 seconds for new inputs before terminating */
-                vlc_tick_t deadline = mdate() + INT64_C(1000000);
-                int ret = vlc_cond_timedwait( &worker->tail.wait,
-                                              &worker->lock, deadline );
-                if( ret != 0 )
-                {
-                    /* Timeout: if there is still no items, the thread will be
-                     * terminated at next loop iteration (active = false). */
-                    worker->head.deadline = VLC_TICK_0;
-                }
-                continue;
-            }
+            worker->conf.pf_stop( worker->owner, handle );
             break;
         }
 
-        if( !worker->head.active )
+        vlc_mutex_lock( &worker->lock );
+        if( worker->head.probe_request == probe_request &&
+            item->deadline > mdate() )
         {
-            vlc_mutex_unlock( &worker->lock );
-            break;
+            vlc_cond_timedwait( &worker->head.worker_wait, &worker->lock,
+                                 item->deadline );
         }
         vlc_mutex_unlock( &worker->lock );
+    }
+}
 
-        assert( item != NULL );
+static void* Thread( void* data )
+{
+    struct background_worker* worker = data;
 
-        if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
-        {
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
-        }
+    vlc_mutex_lock( &worker->lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
 
-        for( ;; )
+        if( item == NULL )
         {
-            vlc_mutex_lock( &worker->lock );
+            if( worker->threads.closing )
+                break;
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            /* Wait 1 seconds for new inputs before terminating */
+            vlc_tick_t deadline = mdate() + INT64_C(1000000);
 
-            vlc_mutex_unlock( &worker->lock );
+            worker->threads.idle++;
+            int ret = vlc_cond_timedwait( &worker->tail.wait,
+                                          &worker->lock, deadline );
+            worker->threads.idle--;
 
-            if( b_timeout ||
-                worker->conf.pf_probe( worker->owner, handle ) )
-            {
-                worker->conf.pf_stop( worker->owner, handle );
-                worker->conf.pf_release( item->entity );
-                free( item );
+            if( ret != 0 && worker->tail.count == 0 )
                 break;
-            }
-
-            vlc_mutex_lock( &worker->lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
-            {
-                vlc_cond_timedwait( &worker->head.worker_wait, &worker->lock,
-                                     worker->head.deadline );
-            }
-            vlc_mutex_unlock( &worker->lock );
+            continue;
         }
+
+        if( item->timeout > 0 )
+            item->deadline = mdate() + item->timeout * 1000;
+        else
+            item->deadline = INT64_MAX;
+
+        item->next = worker->head.tasks;
+        worker->head.tasks = item;
+        vlc_mutex_unlock( &worker->lock );
+
+        RunTask( worker, item );
+        worker->conf.pf_release( item->entity );
+
+        vlc_mutex_lock( &worker->lock );
+        TaskRemove( worker, item );
+        free( item );
+        vlc_cond_broadcast( &worker->head.wait );
     }
 
+    worker->threads.count--;
+    vlc_cond_broadcast( &worker->head.wait );
+    vlc_mutex_unlock( &worker->lock );
     return NULL;
 }
 
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
     vlc_mutex_lock( &worker->lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        struct bg_queued_item* item = QueueExtract( worker, i, id );
 
-        if( id == NULL || item->id == id )
+        while( item != NULL )
         {
-            vlc_array_remove( &worker->tail.data, i );
+            struct bg_queued_item* next = item->next;
+
+            worker->tail.count--;
             worker->conf.pf_release( item->entity );
             free( item );
-            continue;
+            item = next;
         }
-
-        ++i;
     }
 
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    while( TaskIsRunning( worker, id ) )
     {
-        worker->head.deadline = VLC_TICK_0;
-        vlc_cond_signal( &worker->head.worker_wait );
-        vlc_cond_signal( &worker->tail.wait );
+        for( struct bg_queued_item* task = worker->head.tasks; task != NULL;
+             task = task->next )
+            if( id == NULL || task->id == id )
+                task->deadline = VLC_TICK_0;
+
+        vlc_cond_broadcast( &worker->head.worker_wait );
         vlc_cond_wait( &worker->head.wait, &worker->lock );
     }
     vlc_mutex_unlock( &worker->lock );
@@ -190,56 +265,94 @@ struct background_worker* background_worker_New( void* owner,
         return NULL;
 
     worker->conf = *conf;
+    if( worker->conf.max_threads < 1 )
+        worker->conf.max_threads = 1;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TICK_INVALID;
+    worker->head.probe_request = 0;
+    worker->head.tasks = NULL;
 
     vlc_mutex_init( &worker->lock );
     vlc_cond_init( &worker->head.wait );
     vlc_cond_init( &worker->head.worker_wait );
 
-    vlc_array_init( &worker->tail.data );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
+    {
+        worker->tail.queue[i].first = NULL;
+        worker->tail.queue[i].lastp = &worker->tail.queue[i].first;
+    }
+    worker->tail.count = 0;
     vlc_cond_init( &worker->tail.wait );
 
+    worker->threads.count = 0;
+    worker->threads.idle = 0;
+    worker->threads.closing = false;
+
     return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, int priority )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
     if( unlikely( !item ) )
         return VLC_EGENERIC;
 
+    assert( priority >= 0 && priority < BACKGROUND_WORKER_PRIORITY_COUNT );
+
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
 
     vlc_mutex_lock( &worker->lock );
-    int i_ret = vlc_array_append( &worker->tail.data, item );
-    vlc_cond_signal( &worker->tail.wait );
-    if( i_ret != 0 )
+
+    /* Start another thread if the idle ones cannot take all the entities */
+    if( worker->tail.count >= worker->threads.idle
+     && worker->threads.count < (unsigned)worker->conf.max_threads )
+    {
+        if( !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW ) )
+            worker->threads.count++;
+    }
+
+    if( worker->threads.count == 0 )
     {
+        vlc_mutex_unlock( &worker->lock );
         free( item );
         return VLC_EGENERIC;
     }
 
-    if( worker->head.active == false )
+    QueueAppend( worker, item, priority );
+    worker->tail.count++;
+    vlc_cond_signal( &worker->tail.wait );
+    worker->conf.pf_hold( item->entity );
+    vlc_mutex_unlock( &worker->lock );
+
+    return VLC_SUCCESS;
+}
+
+void background_worker_Reprioritize( struct background_worker* worker,
+                                     void* id, int priority )
+{
+    assert( id != NULL );
+    assert( priority >= 0 && priority < BACKGROUND_WORKER_PRIORITY_COUNT );
+
+    vlc_mutex_lock( &worker->lock );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; i++ )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
-    }
+        if( i == priority )
+            continue;
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
+        struct bg_queued_item* item = QueueExtract( worker, i, id );
 
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
-    vlc_mutex_unlock( &worker->lock );
+        while( item != NULL )
+        {
+            struct bg_queued_item* next = item->next;
 
-    return ret;
+            QueueAppend( worker, item, priority );
+            item = next;
+        }
+    }
+    vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -250,15 +363,22 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock( &worker->lock );
-    worker->head.probe_request = true;
-    vlc_cond_signal( &worker->head.worker_wait );
+    worker->head.probe_request++;
+    vlc_cond_broadcast( &worker->head.worker_wait );
     vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+
+    vlc_mutex_lock( &worker->lock );
+    worker->threads.closing = true;
+    vlc_cond_broadcast( &worker->tail.wait );
+    while( worker->threads.count > 0 )
+        vlc_cond_wait( &worker->head.wait, &worker->lock );
+    vlc_mutex_unlock( &worker->lock );
+
     vlc_mutex_destroy( &worker->lock );
     vlc_cond_destroy( &worker->head.wait );
     vlc_cond_destroy( &worker->head.worker_wait );
@@ -19,6 +19,19 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+/**
+ * Priorities of the entities
+ *
+ * The pending entities of the highest priority are processed first, in the
+ * order in which they were pushed.
+ **/
+enum background_worker_priority {
+    BACKGROUND_WORKER_PRIORITY_LOW, /**< bulk requests */
+    BACKGROUND_WORKER_PRIORITY_NORMAL,
+    BACKGROUND_WORKER_PRIORITY_HIGH, /**< someone is waiting for the result */
+};
+#define BACKGROUND_WORKER_PRIORITY_COUNT 3
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -29,6 +42,15 @@ struct background_worker_config {
      **/
     vlc_tick_t default_timeout;
 
+    /**
+     * Maximum number of tasks running at the same time
+     *
+     * Each running task uses a thread of the background-worker. The threads
+     * are started on demand, and terminated when they have been idle for a
+     * while. A value less than 1 is treated as 1.
+     **/
+    int max_threads;
+
     /**
      * Release an entity
      *
@@ -119,10 +141,10 @@ struct background_worker* background_worker_New( void* owner,
     struct background_worker_config* config );
 
 /**
- * Request the background-worker to probe the current task
+ * Request the background-worker to probe the current tasks
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the running tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +158,9 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities of a given priority will be started in the order in which they are
+ * received (in terms of the order of invocations in a single-threaded
+ * environment), after the entities of higher priorities.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +168,27 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the priority of the entity (see \ref
+ *                 background_worker_priority)
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, int priority );
+
+/**
+ * Change the priority of queued entities
+ *
+ * This function moves the pending entities associated with the given id to
+ * the end of the queue of the given priority. It has no effects on the
+ * entities which are already being processed.
+ *
+ * \param worker the background-worker
+ * \param id the id of the entities, not `NULL`
+ * \param priority the new priority (see \ref background_worker_priority)
+ **/
+void background_worker_Reprioritize( struct background_worker* worker,
+    void* id, int priority );
 
 /**
  * Remove entities from the background-worker
@@ -171,11 +210,11 @@ void background_worker_Cancel( struct background_worker* worker, void* id );
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are running tasks, the function will block until they
+ *          have been stopped, and until the threads have terminated.
  *
  * \param worker the background-worker
  **/
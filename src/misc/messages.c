@@ -41,8 +41,45 @@
 #include <vlc_interface.h>
 #include <vlc_charset.h>
 #include <vlc_modules.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
+/*
+ * Once the logger is initialized, the messages are formatted by the calling
+ * thread into a ring of records of its own, and passed to the logger callback
+ * by a dedicated thread. The rings have a single writer and a single reader,
+ * and do not need any lock. A message is dropped if the ring of its thread is
+ * full, and the number of dropped messages is logged later on.
+ */
+#define VLC_LOG_RING_SIZE   (64 * 1024) /* must be a power of 2 */
+#define VLC_LOG_RECORD_MAX  (16 * 1024)
+#define VLC_LOG_RECORD_ALIGN 8
+
+typedef struct
+{
+    uint32_t size; /**< Size of the record, or 0 to skip to the ring start */
+    int type;
+    mtime_t date;
+    vlc_log_t meta;
+    /* followed by the module name, the header if any, and the message */
+} vlc_log_record_t;
+
+typedef struct vlc_log_ring
+{
+    struct vlc_log_ring *next;
+    atomic_size_t head; /**< Written by the thread of the ring */
+    atomic_size_t tail; /**< Written by the logger thread */
+    atomic_uint dropped;
+    atomic_bool orphan; /**< The thread of the ring exited */
+    unsigned reported; /**< Dropped messages already reported */
+    uint64_t data[VLC_LOG_RING_SIZE / VLC_LOG_RECORD_ALIGN];
+} vlc_log_ring_t;
+
+static inline char *vlc_LogRingAt(vlc_log_ring_t *ring, size_t pos)
+{
+    return (char *)ring->data + (pos & (VLC_LOG_RING_SIZE - 1));
+}
+
 struct vlc_logger_t
 {
     VLC_COMMON_MEMBERS
@@ -50,23 +87,274 @@ struct vlc_logger_t
     vlc_log_cb log;
     void *sys;
     module_t *module;
+
+    /* Highest type of the messages to log, or -1 */
+    atomic_int threshold;
+
+    /* Asynchronous logging */
+    atomic_bool async;
+    atomic_bool sleeping;
+    atomic_bool stopping;
+    vlc_thread_t thread;
+    vlc_sem_t wait;
+    vlc_threadvar_t ring;
+    vlc_mutex_t rings_lock; /**< Protects the list of rings */
+    vlc_log_ring_t *rings;
 };
 
-static void vlc_vaLogCallback(libvlc_int_t *vlc, int type,
+static void vlc_vaLogDispatch(vlc_logger_t *logger, int type,
                               const vlc_log_t *item, const char *format,
                               va_list ap)
 {
-    vlc_logger_t *logger = libvlc_priv(vlc)->logger;
-    int canc;
-
-    assert(logger != NULL);
-    canc = vlc_savecancel();
+    int canc = vlc_savecancel();
     vlc_rwlock_rdlock(&logger->lock);
     logger->log(logger->sys, type, item, format, ap);
     vlc_rwlock_unlock(&logger->lock);
     vlc_restorecancel(canc);
 }
 
+static void vlc_LogDispatch(vlc_logger_t *logger, int type,
+                            const vlc_log_t *item, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vlc_vaLogDispatch(logger, type, item, format, ap);
+    va_end(ap);
+}
+
+static void vlc_LogRingOrphan(void *data)
+{
+    vlc_log_ring_t *ring = data;
+
+    atomic_store_explicit(&ring->orphan, true, memory_order_release);
+}
+
+static vlc_log_ring_t *vlc_LogRingGet(vlc_logger_t *logger)
+{
+    vlc_log_ring_t *ring = vlc_threadvar_get(logger->ring);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->orphan, false);
+    ring->reported = 0;
+
+    if (vlc_threadvar_set(logger->ring, ring))
+    {
+        free(ring);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&logger->rings_lock);
+    ring->next = logger->rings;
+    logger->rings = ring;
+    vlc_mutex_unlock(&logger->rings_lock);
+    return ring;
+}
+
+/**
+ * Formats a message into the ring of the calling thread.
+ */
+static void vlc_vaLogPush(vlc_logger_t *logger, int type,
+                          const vlc_log_t *item, const char *format,
+                          va_list ap)
+{
+    vlc_log_ring_t *ring = vlc_LogRingGet(logger);
+    if (unlikely(ring == NULL))
+        return;
+
+    const size_t modlen = strlen(item->psz_module) + 1;
+    const size_t hdrlen = (item->psz_header != NULL)
+                        ? strlen(item->psz_header) + 1 : 0;
+    const size_t fixed = sizeof (vlc_log_record_t) + modlen + hdrlen;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t avail = VLC_LOG_RING_SIZE - (head - tail);
+    size_t contig = VLC_LOG_RING_SIZE - (head & (VLC_LOG_RING_SIZE - 1));
+    size_t start = head;
+
+    for (;;)
+    {
+        const size_t space = __MIN(__MIN(avail, contig), VLC_LOG_RECORD_MAX);
+
+        if (fixed < space)
+        {
+            char *data = vlc_LogRingAt(ring, head);
+            va_list aq;
+
+            va_copy(aq, ap);
+            int len = vsnprintf(data + fixed, space - fixed, format, aq);
+            va_end(aq);
+            if (len < 0)
+                return;
+
+            /* Messages longer than a record are truncated */
+            if ((size_t)len < space - fixed || space == VLC_LOG_RECORD_MAX)
+            {
+                size_t size = fixed + __MIN((size_t)len + 1, space - fixed);
+                size = (size + VLC_LOG_RECORD_ALIGN - 1)
+                     & ~(size_t)(VLC_LOG_RECORD_ALIGN - 1);
+
+                vlc_log_record_t *rec = (vlc_log_record_t *)data;
+                rec->size = size;
+                rec->type = type;
+                rec->date = mdate();
+                rec->meta = *item;
+                memcpy(rec + 1, item->psz_module, modlen);
+                if (hdrlen > 0)
+                    memcpy((char *)(rec + 1) + modlen, item->psz_header,
+                           hdrlen);
+                data[size - 1] = '\0';
+
+                if (start != head) /* skip the end of the ring */
+                    ((vlc_log_record_t *)vlc_LogRingAt(ring, start))->size = 0;
+
+                atomic_store_explicit(&ring->head, head + size,
+                                      memory_order_release);
+                if (atomic_exchange(&logger->sleeping, false))
+                    vlc_sem_post(&logger->wait);
+                return;
+            }
+        }
+
+        /* Retry from the start of the ring, if there is more room there */
+        if (head != start || contig >= avail)
+            break;
+        head += contig;
+        avail -= contig;
+        contig = VLC_LOG_RING_SIZE;
+    }
+
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+}
+
+/**
+ * Returns the oldest record of a ring, or NULL if the ring is empty.
+ */
+static vlc_log_record_t *vlc_LogRingPeek(vlc_log_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (tail == head)
+        return NULL;
+
+    vlc_log_record_t *rec = (vlc_log_record_t *)vlc_LogRingAt(ring, tail);
+    if (rec->size == 0)
+    {
+        tail += VLC_LOG_RING_SIZE - (tail & (VLC_LOG_RING_SIZE - 1));
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        assert(tail != head);
+        rec = (vlc_log_record_t *)vlc_LogRingAt(ring, tail);
+    }
+    return rec;
+}
+
+/**
+ * Passes the oldest message of all the rings to the logger callback.
+ * \return false if all the rings were empty
+ */
+static bool vlc_LogDrainOne(vlc_logger_t *logger)
+{
+    vlc_log_ring_t *oldest = NULL, **pp = &logger->rings;
+    vlc_log_record_t *rec = NULL;
+
+    vlc_mutex_lock(&logger->rings_lock);
+    while (*pp != NULL)
+    {
+        vlc_log_ring_t *ring = *pp;
+        vlc_log_record_t *r = vlc_LogRingPeek(ring);
+
+        if (r == NULL && atomic_load_explicit(&ring->orphan,
+                                              memory_order_acquire)
+         && vlc_LogRingPeek(ring) == NULL)
+        {
+            *pp = ring->next;
+            free(ring);
+            continue;
+        }
+        if (r != NULL && (rec == NULL || r->date < rec->date))
+        {
+            oldest = ring;
+            rec = r;
+        }
+        pp = &ring->next;
+    }
+    vlc_mutex_unlock(&logger->rings_lock);
+
+    if (rec == NULL)
+        return false;
+
+    /* The record stays valid until the tail moves */
+    char *str = (char *)(rec + 1);
+    rec->meta.psz_module = str;
+    str += strlen(str) + 1;
+    if (rec->meta.psz_header != NULL)
+    {
+        rec->meta.psz_header = str;
+        str += strlen(str) + 1;
+    }
+    vlc_LogDispatch(logger, rec->type, &rec->meta, "%s", str);
+
+    size_t tail = atomic_load_explicit(&oldest->tail, memory_order_relaxed);
+    atomic_store_explicit(&oldest->tail, tail + rec->size,
+                          memory_order_release);
+
+    unsigned dropped = atomic_load_explicit(&oldest->dropped,
+                                            memory_order_relaxed);
+    if (dropped != oldest->reported)
+    {
+        msg_Warn(logger, "%u messages dropped", dropped - oldest->reported);
+        oldest->reported = dropped;
+    }
+    return true;
+}
+
+static void *vlc_LogThread(void *data)
+{
+    vlc_logger_t *logger = data;
+
+    for (;;)
+    {
+        while (vlc_LogDrainOne(logger));
+
+        if (atomic_load(&logger->stopping))
+            break;
+
+        /* Check again once the writers know they must wake this up */
+        atomic_store(&logger->sleeping, true);
+        if (vlc_LogDrainOne(logger))
+        {
+            if (!atomic_exchange(&logger->sleeping, false))
+                vlc_sem_wait(&logger->wait); /* consume the wake up */
+            continue;
+        }
+        vlc_sem_wait(&logger->wait);
+    }
+    return NULL;
+}
+
+static void vlc_vaLogCallback(libvlc_int_t *vlc, int type,
+                              const vlc_log_t *item, const char *format,
+                              va_list ap)
+{
+    vlc_logger_t *logger = libvlc_priv(vlc)->logger;
+
+    assert(logger != NULL);
+    if (atomic_load_explicit(&logger->async, memory_order_acquire))
+        vlc_vaLogPush(logger, type, item, format, ap);
+    else
+        vlc_vaLogDispatch(logger, type, item, format, ap);
+}
+
 static void vlc_LogCallback(libvlc_int_t *vlc, int type, const vlc_log_t *item,
                             const char *format, ...)
 {
@@ -93,6 +381,16 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
     if (obj != NULL && obj->obj.flags & OBJECT_FLAGS_QUIET)
         return;
 
+    /* Skip the message before formatting it if no one wants it */
+    vlc_logger_t *logger = (obj != NULL)
+                         ? libvlc_priv(obj->obj.libvlc)->logger : NULL;
+    const bool wanted = logger != NULL && type <= atomic_load_explicit(
+                                &logger->threshold, memory_order_relaxed);
+#ifndef _WIN32
+    if (!wanted)
+        return;
+#endif
+
     /* Get basename from the module filename */
     char *p = strrchr(module, '/');
     if (p != NULL)
@@ -136,7 +434,7 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
 #endif
 
     /* Pass message to the callback */
-    if (obj != NULL)
+    if (wanted)
         vlc_vaLogCallback(obj->obj.libvlc, type, &msg, format, args);
 }
 
@@ -330,6 +628,23 @@ int vlc_LogPreinit(libvlc_int_t *vlc)
         return -1;
 
     vlc_rwlock_init(&logger->lock);
+    atomic_init(&logger->threshold, VLC_MSG_DBG);
+    atomic_init(&logger->async, false);
+    atomic_init(&logger->sleeping, false);
+    atomic_init(&logger->stopping, false);
+    vlc_sem_init(&logger->wait, 0);
+    vlc_mutex_init(&logger->rings_lock);
+    logger->rings = NULL;
+
+    if (vlc_threadvar_create(&logger->ring, vlc_LogRingOrphan))
+    {
+        vlc_mutex_destroy(&logger->rings_lock);
+        vlc_sem_destroy(&logger->wait);
+        vlc_rwlock_destroy(&logger->lock);
+        vlc_object_release(logger);
+        libvlc_priv(vlc)->logger = NULL;
+        return -1;
+    }
 
     if (vlc_LogEarlyOpen(logger))
     {
@@ -359,13 +674,25 @@ int vlc_LogInit(libvlc_int_t *vlc)
 
     vlc_log_cb cb;
     void *sys, *early_sys = NULL;
+    int threshold = -1;
+
+    /* The logger module sets its verbosity, if it filters messages */
+    var_Create(logger, "verbosity", VLC_VAR_INTEGER);
+    var_SetInteger(logger, "verbosity", VLC_MSG_DBG);
 
     /* TODO: module configuration item */
     module_t *module = vlc_module_load(logger, "logger", NULL, false,
                                        vlc_logger_load, logger, &cb, &sys);
-    if (module == NULL)
+    if (module != NULL)
+        threshold = var_GetInteger(logger, "verbosity");
+    else
         cb = vlc_vaLogDiscard;
 
+    if (var_InheritBool(vlc, "log-async")
+     && vlc_clone(&logger->thread, vlc_LogThread, logger,
+                  VLC_THREAD_PRIORITY_LOW) == 0)
+        atomic_store_explicit(&logger->async, true, memory_order_release);
+
     vlc_rwlock_wrlock(&logger->lock);
     if (logger->log == vlc_vaLogEarly)
         early_sys = logger->sys;
@@ -379,6 +706,8 @@ int vlc_LogInit(libvlc_int_t *vlc)
     if (early_sys != NULL)
         vlc_LogEarlyClose(logger, early_sys);
 
+    atomic_store_explicit(&logger->threshold, threshold,
+                          memory_order_relaxed);
     return 0;
 }
 
@@ -397,6 +726,9 @@ void vlc_LogSet(libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     module_t *module;
     void *sys;
 
+    atomic_store_explicit(&logger->threshold,
+                          (cb != NULL) ? VLC_MSG_DBG : -1,
+                          memory_order_relaxed);
     if (cb == NULL)
         cb = vlc_vaLogDiscard;
 
@@ -426,6 +758,14 @@ void vlc_LogDeinit(libvlc_int_t *vlc)
     if (unlikely(logger == NULL))
         return;
 
+    /* Pass the pending messages to the log, and go back to synchronous */
+    if (atomic_exchange(&logger->async, false))
+    {
+        atomic_store(&logger->stopping, true);
+        vlc_sem_post(&logger->wait);
+        vlc_join(logger->thread, NULL);
+    }
+
     if (logger->module != NULL)
         vlc_module_unload(vlc, logger->module, vlc_logger_unload, logger->sys);
     else
@@ -436,6 +776,15 @@ void vlc_LogDeinit(libvlc_int_t *vlc)
         vlc_LogEarlyClose(logger, logger->sys);
     }
 
+    for (vlc_log_ring_t *ring = logger->rings, *next; ring != NULL;
+         ring = next)
+    {
+        next = ring->next;
+        free(ring);
+    }
+    vlc_threadvar_delete(&logger->ring);
+    vlc_mutex_destroy(&logger->rings_lock);
+    vlc_sem_destroy(&logger->wait);
     vlc_rwlock_destroy(&logger->lock);
     vlc_object_release(logger);
     libvlc_priv(vlc)->logger = NULL;
@@ -242,6 +242,7 @@ picture_t *picture_NewFromResource( const video_format_t *p_fmt, const picture_r
 
     atomic_init( &priv->gc.refs, 1 );
     priv->gc.opaque = NULL;
+    priv->queued = VLC_TICK_INVALID;
 
     if( p_resource )
     {
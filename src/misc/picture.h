@@ -30,4 +30,5 @@ typedef struct
         void (*destroy)(picture_t *);
         void *opaque;
     } gc;
+    vlc_tick_t queued; /**< vout_PutPicture() date, for frame statistics */
 } picture_priv_t;
@@ -36,6 +36,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <assert.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -57,13 +60,89 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 34
+#define CACHE_SUBVERSION_NUM 36
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * The cache file is mapped in memory and used in place, without parsing.
+ * After the header and the index come the data area and the strings pool.
+ *
+ * The data area starts with the plug-in records, the module records and the
+ * configuration items, followed by the arrays they refer to. The items are
+ * stored as module_config_t, with references in place of pointers, and are
+ * relocated in place. References to the data area are offsets from its
+ * start. References to strings are offsets within the pool, zero for NULL.
+ */
+#define CACHE_ALIGN 8
+
+typedef struct
+{
+    uint32_t plugins; /**< Number of plug-ins */
+    uint32_t modules; /**< Number of modules */
+    uint32_t items; /**< Number of configuration items */
+    uint32_t item_size; /**< Size of a configuration item */
+    uint32_t data_size; /**< Size of the data area */
+    uint32_t strings_size; /**< Size of the strings pool */
+} vlc_cache_index_t;
+
+typedef struct
+{
+    uint32_t modules; /**< Index of the first module */
+    uint32_t modules_count;
+    uint32_t items; /**< Index of the first configuration item */
+    uint32_t items_count;
+    uint32_t textdomain;
+    uint32_t path;
+    uint32_t unloadable;
+    uint32_t reserved;
+    int64_t mtime;
+    uint64_t size;
+} vlc_cache_plugin_t;
+
+typedef struct
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t capability;
+    int32_t score;
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t shortcuts; /**< Array of strings */
+    uint32_t shortcuts_count;
+    uint32_t signatures; /**< Array of offset and magic string pairs */
+    uint32_t signatures_count;
+    uint32_t reserved;
+} vlc_cache_module_t;
+
+static size_t vlc_cache_records_size(const vlc_cache_index_t *index)
+{
+    uint64_t size = (uint64_t)index->plugins * sizeof (vlc_cache_plugin_t)
+                  + (uint64_t)index->modules * sizeof (vlc_cache_module_t)
+                  + (uint64_t)index->items * sizeof (module_config_t);
+
+    size = (size + CACHE_ALIGN - 1) & ~(uint64_t)(CACHE_ALIGN - 1);
+    return (size <= SIZE_MAX) ? size : SIZE_MAX;
+}
+
+/** Mapped cache file */
+typedef struct
+{
+    uint8_t *data;
+    size_t data_size;
+    const char *strings;
+    size_t strings_size;
+
+    const vlc_cache_plugin_t *plugins;
+    const vlc_cache_module_t *modules;
+    size_t modules_count;
+    module_config_t *items;
+    size_t items_count;
+} vlc_cache_t;
 
 static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
 {
@@ -76,203 +155,127 @@ static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
     return 0;
 }
 
-static int vlc_cache_load_bool(bool *out, block_t *in)
+static int vlc_cache_load_align(size_t align, block_t *file)
 {
-    unsigned char b;
-
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
-        return -1;
-
-    *out = b;
-    return 0;
-}
+    assert(align > 0);
 
-static int vlc_cache_load_array(const void **p, size_t size, size_t n,
-                                block_t *file)
-{
-    if (n == 0)
-    {
-        *p = NULL;
+    size_t skip = (-(uintptr_t)file->p_buffer) % align;
+    if (skip == 0)
         return 0;
-    }
 
-    if (unlikely(size * n < size))
-        return -1;
-
-    size *= n;
+    assert(skip < align);
 
-    if (file->i_buffer < size)
+    if (file->i_buffer < skip)
         return -1;
 
-    *p = file->p_buffer;
-    file->p_buffer += size;
-    file->i_buffer -= size;
+    file->p_buffer += skip;
+    file->i_buffer -= skip;
+    assert((((uintptr_t)file->p_buffer) % align) == 0);
     return 0;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
+/* The pool ends with a nul byte, so any offset within it is a string. */
+static int vlc_cache_load_string(const char **restrict p, uintptr_t ref,
+                                 const vlc_cache_t *cache)
 {
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
+    if (ref >= cache->strings_size)
         return -1;
 
-    if (size == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    const char *str = (char *)file->p_buffer;
-
-    if (file->i_buffer < size || str[size - 1] != '\0')
-        return -1;
-
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
+    *p = (ref != 0) ? cache->strings + ref : NULL;
     return 0;
 }
 
-static int vlc_cache_load_align(size_t align, block_t *file)
+static int vlc_cache_load_array(void **restrict p, uintptr_t ref, size_t size,
+                                size_t n, const vlc_cache_t *cache)
 {
-    assert(align > 0);
-
-    size_t skip = (-(uintptr_t)file->p_buffer) % align;
-    if (skip == 0)
+    if (n == 0)
+    {
+        *p = NULL;
         return 0;
+    }
 
-    assert(skip < align);
-
-    if (file->i_buffer < skip)
+    if ((ref % CACHE_ALIGN) != 0 || ref > cache->data_size
+     || (cache->data_size - ref) / size < n)
         return -1;
 
-    file->p_buffer += skip;
-    file->i_buffer -= skip;
-    assert((((uintptr_t)file->p_buffer) % align) == 0);
+    *p = cache->data + ref;
     return 0;
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
+#define LOAD_STRING(a, ref) \
+    if (vlc_cache_load_string(&(a), (uintptr_t)(ref), cache)) \
         goto error
-#define LOAD_FLAG(a) \
+#define LOAD_ARRAY(a, ref, n) \
     do \
     { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-#define LOAD_ARRAY(a,n) \
-    do \
-    { \
-        const void *base; \
-        if (vlc_cache_load_array(&base, sizeof (*(a)), (n), file)) \
+        void *base; \
+        if (vlc_cache_load_array(&base, (uintptr_t)(ref), sizeof (*(a)), \
+                                 (n), cache)) \
             goto error; \
         (a) = base; \
     } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
-#define LOAD_ALIGNOF(t) \
-    if (vlc_cache_load_align(alignof(t), file)) \
-        goto error
 
-static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
+static int vlc_cache_load_config(module_config_t *cfg,
+                                 const vlc_cache_t *cache)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_advanced);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    LOAD_STRING (cfg->psz_type, cfg->psz_type);
+    LOAD_STRING (cfg->psz_name, cfg->psz_name);
+    LOAD_STRING (cfg->psz_text, cfg->psz_text);
+    LOAD_STRING (cfg->psz_longtext, cfg->psz_longtext);
+    LOAD_STRING (cfg->list_cb_name, cfg->list_cb_name);
 
     if (IsConfigStringType (cfg->i_type))
     {
         const char *psz;
-        LOAD_STRING(psz);
+        LOAD_STRING(psz, cfg->orig.psz);
         cfg->orig.psz = (char *)psz;
-        cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
+        cfg->value.psz = NULL;
 
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else
-            LOAD_STRING(cfg->list_cb_name);
+        LOAD_ARRAY(cfg->list.psz, cfg->list.psz, cfg->list_count);
         for (unsigned i = 0; i < cfg->list_count; i++)
-        {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
-        }
+            LOAD_STRING (cfg->list.psz[i], cfg->list.psz[i]);
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
         cfg->value = cfg->orig;
-
-        if (cfg->list_count)
-        {
-            LOAD_ALIGNOF(*cfg->list.i);
-        }
-        else
-            LOAD_STRING(cfg->list_cb_name);
-
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
+        LOAD_ARRAY(cfg->list.i, cfg->list.i, cfg->list_count);
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
+    LOAD_ARRAY(cfg->list_text, cfg->list_text, cfg->list_count);
     for (unsigned i = 0; i < cfg->list_count; i++)
-    {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
-    }
+        LOAD_STRING (cfg->list_text[i], cfg->list_text[i]);
 
+    /* Only the current value is allocated */
+    if (IsConfigStringType (cfg->i_type) && cfg->orig.psz != NULL)
+        cfg->value.psz = strdup (cfg->orig.psz);
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin,
+                                        const vlc_cache_plugin_t *rec,
+                                        const vlc_cache_t *cache)
 {
-    uint16_t lines;
-
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
-
-    /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.items = calloc(sizeof (module_config_t), lines);
-        if (unlikely(plugin->conf.items == NULL))
-        {
-            plugin->conf.size = 0;
-            return -1;
-        }
-    }
-    else
-        plugin->conf.items = NULL;
+    if (rec->items > cache->items_count
+     || rec->items_count > cache->items_count - rec->items)
+        return -1;
 
-    plugin->conf.size = lines;
+    /* The items are used in place */
+    plugin->conf.items = (rec->items_count > 0) ? cache->items + rec->items
+                                                : NULL;
+    plugin->conf.size = rec->items_count;
+    plugin->conf.mapped = true;
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
+    for (size_t i = 0; i < plugin->conf.size; i++)
     {
         module_config_t *item = plugin->conf.items + i;
 
-        if (vlc_cache_load_config(item, file))
+        if (vlc_cache_load_config(item, cache))
+        {   /* Do not free the values of the items not relocated */
+            plugin->conf.size = i;
             return -1;
+        }
 
         if (CONFIG_ITEM(item->i_type))
         {
@@ -284,60 +287,80 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
     }
 
     return 0;
-error:
-    return -1; /* FIXME: leaks */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static int vlc_cache_load_module(vlc_plugin_t *plugin,
+                                 const vlc_cache_module_t *rec,
+                                 const vlc_cache_t *cache)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
+    const uint32_t *refs;
+
+    if (rec->shortcuts_count > MODULE_SHORTCUT_MAX)
         goto error;
-    else
+    LOAD_ARRAY(refs, rec->shortcuts, rec->shortcuts_count);
+
+    module->pp_shortcuts =
+        xmalloc (sizeof (*module->pp_shortcuts) * rec->shortcuts_count);
+    for (unsigned j = 0; j < rec->shortcuts_count; j++)
+        LOAD_STRING(module->pp_shortcuts[j], refs[j]);
+    module->i_shortcuts = rec->shortcuts_count;
+
+    LOAD_STRING(module->activate_name, rec->activate);
+    LOAD_STRING(module->deactivate_name, rec->deactivate);
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
+
+    if (rec->signatures_count > MODULE_SIGNATURE_MAX)
+        goto error;
+    LOAD_ARRAY(refs, rec->signatures, 2 * rec->signatures_count);
+
+    if (rec->signatures_count > 0)
+        module->p_signatures =
+            xmalloc (sizeof (*module->p_signatures) * rec->signatures_count);
+    for (unsigned j = 0; j < rec->signatures_count; j++)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
+        module->p_signatures[j].offset = refs[2 * j];
+        LOAD_STRING(module->p_signatures[j].magic, refs[2 * j + 1]);
+        if (module->p_signatures[j].magic == NULL)
+            goto error;
+        module->i_signatures = j + 1;
     }
-
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
     return 0;
 error:
     return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+static vlc_plugin_t *vlc_cache_load_plugin(const vlc_cache_plugin_t *rec,
+                                           const vlc_cache_t *cache)
 {
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
+    if (rec->modules > cache->modules_count
+     || rec->modules_count > cache->modules_count - rec->modules)
+        goto error;
 
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    for (size_t i = 0; i < rec->modules_count; i++)
+        if (vlc_cache_load_module(plugin, cache->modules + rec->modules + i,
+                                  cache))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
+    if (vlc_cache_load_plugin_config(plugin, rec, cache))
         goto error;
 
-    LOAD_STRING(plugin->textdomain);
+    LOAD_STRING(plugin->textdomain, rec->textdomain);
 
     const char *path;
-    LOAD_STRING(path);
+    LOAD_STRING(path, rec->path);
     if (path == NULL)
         goto error;
 
@@ -345,9 +368,9 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (unlikely(plugin->path == NULL))
         goto error;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    plugin->unloadable = rec->unloadable != 0;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
@@ -379,7 +402,8 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    block_t *file = block_FilePath(psz_filename, false);
+    /* The mapping is private and writable, for in place relocations */
+    block_t *file = block_FilePath(psz_filename, true);
     if (file == NULL)
         msg_Warn(p_this, "cannot read %s: %s", psz_filename,
                  vlc_strerror_c(errno));
@@ -438,11 +462,51 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return 0;
     }
 
+    /* Check the index */
+    vlc_cache_index_t index;
+
+    if (vlc_cache_load_align(CACHE_ALIGN, file)
+     || vlc_cache_load_immediate(&index, file, sizeof (index))
+     || vlc_cache_load_align(CACHE_ALIGN, file)
+     || index.item_size != sizeof (module_config_t)
+     || vlc_cache_records_size(&index) > index.data_size
+     || file->i_buffer != (uint64_t)index.data_size + index.strings_size
+     || index.strings_size == 0
+     || file->p_buffer[file->i_buffer - 1] != '\0')
+    {
+        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
+                  "(corrupted index)" );
+        block_Release(file);
+        return 0;
+    }
+
+    vlc_cache_t map = {
+        .data = file->p_buffer,
+        .data_size = index.data_size,
+        .strings = (const char *)file->p_buffer + index.data_size,
+        .strings_size = index.strings_size,
+        .modules_count = index.modules,
+        .items_count = index.items,
+    };
+    map.plugins = (const vlc_cache_plugin_t *)map.data;
+    map.modules = (const vlc_cache_module_t *)(map.plugins + index.plugins);
+    map.items = (module_config_t *)(map.modules + index.modules);
+
+#ifdef MADV_POPULATE_WRITE
+    /* The items and arrays are relocated in place: break the copy-on-write
+     * of their pages at once rather than one page fault at a time. */
+    uintptr_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t start = (uintptr_t)map.items & ~page_mask;
+
+    madvise((void *)start, (uintptr_t)(map.data + map.data_size) - start,
+            MADV_POPULATE_WRITE);
+#endif
+
     vlc_plugin_t *cache = NULL;
 
-    while (file->i_buffer > 0)
+    for (size_t i = 0; i < index.plugins; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(map.plugins + i, &map);
         if (plugin == NULL)
             goto error;
 
@@ -465,37 +529,17 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
-    block_Release(file);
-    return NULL;
-}
-
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
-
-static int CacheSaveString (FILE *file, const char *str)
-{
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
-
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
+    while (cache != NULL)
     {
-error:
-        return -1;
+        vlc_plugin_t *plugin = cache;
+
+        cache = plugin->next;
+        vlc_plugin_destroy(plugin);
     }
-    return 0;
+    block_Release(file);
+    return NULL;
 }
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
-
 static int CacheSaveAlign(FILE *file, size_t align)
 {
     assert(align > 0);
@@ -508,96 +552,204 @@ static int CacheSaveAlign(FILE *file, size_t align)
     return fseek(file, skip, SEEK_CUR);
 }
 
-#define SAVE_ALIGNOF(t) \
-    if (CacheSaveAlign(file, alignof (t))) \
-        goto error
-
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
+/** Cache file being built */
+typedef struct
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_advanced);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    vlc_cache_plugin_t *plugins;
+    vlc_cache_module_t *modules;
+    module_config_t *items;
+    size_t records_size;
 
-    if (IsConfigStringType (cfg->i_type))
+    struct
     {
-        SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_STRING(cfg->list_cb_name);
+        uint8_t *base;
+        size_t size;
+    } arrays, strings;
+    bool error;
+} vlc_cache_writer_t;
+
+static size_t CacheAppend(vlc_cache_writer_t *w, uint8_t **base, size_t *size,
+                          const void *data, size_t len)
+{
+    size_t offset = *size;
+    uint8_t *buf = realloc(*base, offset + len);
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
-    }
-    else
+    if (unlikely(buf == NULL))
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
+        w->error = true;
+        return 0;
+    }
+    memcpy(buf + offset, data, len);
+    *base = buf;
+    *size = offset + len;
+    return offset;
+}
 
-        if (cfg->list_count > 0)
-        {
-            SAVE_ALIGNOF(*cfg->list.i);
-        }
-        else
-            SAVE_STRING(cfg->list_cb_name);
+static uint32_t CacheSaveString(vlc_cache_writer_t *w, const char *str)
+{
+    if (str == NULL)
+        return 0;
+    return CacheAppend(w, &w->strings.base, &w->strings.size,
+                       str, strlen(str) + 1);
+}
 
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
-    }
-    for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+static uint32_t CacheSaveArray(vlc_cache_writer_t *w, const void *data,
+                               size_t len)
+{
+    static const uint8_t padding[CACHE_ALIGN];
 
-    return 0;
-error:
-    return -1;
+    if (len == 0)
+        return 0;
+
+    CacheAppend(w, &w->arrays.base, &w->arrays.size, padding,
+                (-w->arrays.size) % CACHE_ALIGN);
+    return w->records_size
+         + CacheAppend(w, &w->arrays.base, &w->arrays.size, data, len);
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+/* NULL entries of the lists are stored as empty strings */
+static uint32_t CacheSaveStrings(vlc_cache_writer_t *w,
+                                 const char *const *tab, size_t n)
 {
-    uint16_t lines = plugin->conf.size;
+    uintptr_t refs[n ? n : 1];
 
-    SAVE_IMMEDIATE (lines);
+    for (size_t i = 0; i < n; i++)
+        refs[i] = CacheSaveString(w, (tab[i] != NULL) ? tab[i] : "");
+    return CacheSaveArray(w, refs, n * sizeof (refs[0]));
+}
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.items + i))
-           goto error;
+#define SAVE_STRING(a) \
+    ((const char *)(uintptr_t)CacheSaveString(w, (a)))
 
-    return 0;
-error:
-    return -1;
+static void CacheSaveConfig(vlc_cache_writer_t *w, module_config_t *out,
+                            const module_config_t *cfg)
+{
+    out->i_type = cfg->i_type;
+    out->i_short = cfg->i_short;
+    out->b_advanced = cfg->b_advanced;
+    out->b_internal = cfg->b_internal;
+    out->b_unsaveable = cfg->b_unsaveable;
+    out->b_safe = cfg->b_safe;
+    out->b_removed = cfg->b_removed;
+    out->psz_type = SAVE_STRING(cfg->psz_type);
+    out->psz_name = SAVE_STRING(cfg->psz_name);
+    out->psz_text = SAVE_STRING(cfg->psz_text);
+    out->psz_longtext = SAVE_STRING(cfg->psz_longtext);
+    out->list_count = cfg->list_count;
+
+    if (IsConfigStringType (cfg->i_type))
+    {
+        out->orig.psz = (char *)SAVE_STRING(cfg->orig.psz);
+        if (cfg->list_count > 0)
+            out->list.psz = (const char **)(uintptr_t)
+                CacheSaveStrings(w, cfg->list.psz, cfg->list_count);
+    }
+    else
+    {
+        out->orig = cfg->orig;
+        out->min = cfg->min;
+        out->max = cfg->max;
+        if (cfg->list_count > 0)
+            out->list.i = (const int *)(uintptr_t)
+                CacheSaveArray(w, cfg->list.i,
+                               cfg->list_count * sizeof (*cfg->list.i));
+    }
+
+    if (cfg->list_count > 0)
+        out->list_text = (const char **)(uintptr_t)
+            CacheSaveStrings(w, cfg->list_text, cfg->list_count);
+    out->list_cb_name = SAVE_STRING(cfg->list_cb_name);
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+static void CacheSaveModule(vlc_cache_writer_t *w, vlc_cache_module_t *out,
+                            const module_t *module)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    uint32_t refs[2 * (MODULE_SHORTCUT_MAX + MODULE_SIGNATURE_MAX)];
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    out->shortname = CacheSaveString(w, module->psz_shortname);
+    out->longname = CacheSaveString(w, module->psz_longname);
+    out->help = CacheSaveString(w, module->psz_help);
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
+    assert(module->i_shortcuts <= MODULE_SHORTCUT_MAX);
+    for (size_t j = 0; j < module->i_shortcuts; j++)
+         refs[j] = CacheSaveString(w, module->pp_shortcuts[j]);
+    out->shortcuts = CacheSaveArray(w, refs,
+                                    module->i_shortcuts * sizeof (refs[0]));
+    out->shortcuts_count = module->i_shortcuts;
+
+    out->activate = CacheSaveString(w, module->activate_name);
+    out->deactivate = CacheSaveString(w, module->deactivate_name);
+    out->capability = CacheSaveString(w, module->psz_capability);
+    out->score = module->i_score;
+
+    assert(module->i_signatures <= MODULE_SIGNATURE_MAX);
+    for (size_t j = 0; j < module->i_signatures; j++)
+    {
+        refs[2 * j] = module->p_signatures[j].offset;
+        refs[2 * j + 1] = CacheSaveString(w, module->p_signatures[j].magic);
+    }
+    out->signatures = CacheSaveArray(w, refs,
+                                     2 * module->i_signatures * sizeof (refs[0]));
+    out->signatures_count = module->i_signatures;
 }
 
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    vlc_cache_writer_t w = { .error = false };
+    vlc_cache_index_t index = {
+        .plugins = n,
+        .item_size = sizeof (module_config_t),
+    };
     uint32_t i_file_size = 0;
 
+    for (size_t i = 0; i < n; i++)
+    {
+        index.modules += cache[i]->modules_count;
+        index.items += cache[i]->conf.size;
+    }
+
+    w.records_size = vlc_cache_records_size(&index);
+    w.plugins = calloc(1, w.records_size);
+    if (unlikely(w.plugins == NULL))
+        goto error;
+    w.modules = (vlc_cache_module_t *)(w.plugins + index.plugins);
+    w.items = (module_config_t *)(w.modules + index.modules);
+
+    /* The zero reference is NULL */
+    CacheAppend(&w, &w.strings.base, &w.strings.size, "", 1);
+
+    for (size_t i = 0, m = 0, c = 0; i < n; i++)
+    {
+        const vlc_plugin_t *plugin = cache[i];
+        vlc_cache_plugin_t *rec = w.plugins + i;
+
+        rec->modules = m;
+        rec->modules_count = plugin->modules_count;
+        for (module_t *module = plugin->module;
+             module != NULL;
+             module = module->next)
+            CacheSaveModule(&w, w.modules + m++, module);
+
+        /* Config stuff */
+        rec->items = c;
+        rec->items_count = plugin->conf.size;
+        for (size_t j = 0; j < plugin->conf.size; j++)
+            CacheSaveConfig(&w, w.items + c++, plugin->conf.items + j);
+
+        /* Save common info */
+        rec->textdomain = CacheSaveString(&w, plugin->textdomain);
+        rec->path = CacheSaveString(&w, plugin->path);
+        rec->unloadable = plugin->unloadable;
+        rec->mtime = plugin->mtime;
+        rec->size = plugin->size;
+    }
+
+    if (w.error || w.records_size + w.arrays.size > UINT32_MAX
+     || w.strings.size > UINT32_MAX)
+        goto error;
+    index.data_size = w.records_size + w.arrays.size;
+    index.strings_size = w.strings.size;
+
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
         goto error;
@@ -617,36 +769,26 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
-
-        SAVE_IMMEDIATE(count);
-
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
-            goto error;
-
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
+    if (CacheSaveAlign(file, CACHE_ALIGN)
+     || fwrite(&index, sizeof (index), 1, file) != 1
+     || CacheSaveAlign(file, CACHE_ALIGN)
+     || fwrite(w.plugins, 1, w.records_size, file) != w.records_size
+     || fwrite(w.arrays.base, 1, w.arrays.size, file) != w.arrays.size
+     || fwrite(w.strings.base, 1, w.strings.size, file) != w.strings.size)
+        goto error;
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
+
+    free(w.strings.base);
+    free(w.arrays.base);
+    free(w.plugins);
     return 0; /* success! */
 
 error:
+    free(w.strings.base);
+    free(w.arrays.base);
+    free(w.plugins);
     return -1;
 }
 
@@ -70,6 +70,8 @@ module_t *vlc_module_create(vlc_plugin_t *plugin)
     module->i_shortcuts = 0;
     module->psz_capability = NULL;
     module->i_score = (parent != NULL) ? parent->i_score : 1;
+    module->i_signatures = 0;
+    module->p_signatures = NULL;
     module->activate_name = NULL;
     module->deactivate_name = NULL;
     module->pf_activate = NULL;
@@ -87,6 +89,7 @@ void vlc_module_destroy (module_t *module)
         module_t *next = module->next;
 
         free(module->pp_shortcuts);
+        free(module->p_signatures);
         free(module);
         module = next;
     }
@@ -104,6 +107,7 @@ vlc_plugin_t *vlc_plugin_create(void)
     plugin->conf.size = 0;
     plugin->conf.count = 0;
     plugin->conf.booleans = 0;
+    plugin->conf.mapped = false;
 #ifdef HAVE_DYNAMIC_PLUGINS
     plugin->abspath = NULL;
     atomic_init(&plugin->loaded, false);
@@ -132,7 +136,7 @@ void vlc_plugin_destroy(vlc_plugin_t *plugin)
     if (plugin->module != NULL)
         vlc_module_destroy(plugin->module);
 
-    config_Free(plugin->conf.items, plugin->conf.size);
+    config_Free(plugin->conf.items, plugin->conf.size, plugin->conf.mapped);
 #ifdef HAVE_DYNAMIC_PLUGINS
     free(plugin->abspath);
     free(plugin->path);
@@ -316,6 +320,29 @@ static int vlc_plugin_desc_cb(void *ctx, void *tgt, int propid, ...)
             plugin->textdomain = va_arg(ap, const char *);
             break;
 
+        case VLC_MODULE_SIGNATURE:
+        {
+            unsigned offset = va_arg (ap, unsigned);
+            const char *magic = va_arg (ap, const char *);
+            unsigned index = module->i_signatures;
+            /* The cache loader accept only a small number of signatures */
+            assert(index < MODULE_SIGNATURE_MAX);
+            assert(magic[0] != '\0');
+
+            void *tab = realloc (module->p_signatures,
+                                 sizeof (*module->p_signatures) * (index + 1));
+            if (unlikely(tab == NULL))
+            {
+                ret = -1;
+                break;
+            }
+            module->p_signatures = tab;
+            module->p_signatures[index].offset = offset;
+            module->p_signatures[index].magic = magic;
+            module->i_signatures = index + 1;
+            break;
+        }
+
         case VLC_CONFIG_NAME:
         {
             const char *name = va_arg (ap, const char *);
@@ -190,30 +190,48 @@ static int module_load (vlc_object_t *obj, module_t *m,
     return ret;
 }
 
-#undef vlc_module_load
 /**
- * Finds and instantiates the best module of a certain type.
- * All candidates modules having the specified capability and name will be
- * sorted in decreasing order of priority. Then the probe callback will be
- * invoked for each module, until it succeeds (returns 0), or all candidate
- * module failed to initialize.
+ * Checks whether some data may be handled by a module.
  *
- * The probe callback first parameter is the address of the module entry point.
- * Further parameters are passed as an argument list; it corresponds to the
- * variable arguments passed to this function. This scheme is meant to
- * support arbitrary prototypes for the module entry point.
- *
- * \param obj VLC object
- * \param capability capability, i.e. class of module
- * \param name name of the module asked, if any
- * \param strict if true, do not fallback to plugin with a different name
- *                 but the same capability
- * \param probe module probe callback
- * \return the module or NULL in case of a failure
+ * \return false if the module declares signatures and none of them matches
  */
-module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
-                          const char *name, bool strict,
-                          vlc_activate_t probe, ...)
+static bool module_match_data (const module_t *m, const uint8_t *data,
+                               size_t size)
+{
+    if (m->i_signatures == 0)
+        return true;
+
+    for (unsigned i = 0; i < m->i_signatures; i++)
+    {
+        size_t offset = m->p_signatures[i].offset;
+        const char *magic = m->p_signatures[i].magic;
+        size_t len = strlen (magic);
+
+        if (offset <= size && len <= size - offset
+         && !memcmp (data + offset, magic, len))
+            return true;
+    }
+    return false;
+}
+
+static int module_probe (vlc_object_t *obj, module_t *m, bool trace,
+                         vlc_activate_t probe, va_list args)
+{
+    if (!trace)
+        return module_load (obj, m, probe, args);
+
+    mtime_t start = mdate ();
+    int ret = module_load (obj, m, probe, args);
+
+    msg_Dbg (obj, "probed \"%s\" in %"PRId64" us", module_get_object (m),
+             mdate () - start);
+    return ret;
+}
+
+static module_t *vlc_module_load_va(vlc_object_t *obj, const char *capability,
+                                    const char *name, bool strict,
+                                    const uint8_t *data, size_t size,
+                                    vlc_activate_t probe, va_list args)
 {
     char *var = NULL;
 
@@ -243,9 +261,17 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
 
     module_t *module = NULL;
     const bool b_force_backup = obj->obj.force; /* FIXME: remove this */
-    va_list args;
+    /* Modules whose signatures do not match are deferred to the end */
+    bool *deferred = NULL;
+    size_t deferred_count = 0;
+
+    if (data != NULL)
+    {
+        deferred = calloc (total, sizeof (*deferred));
+        if (unlikely(deferred == NULL))
+            data = NULL;
+    }
 
-    va_start(args, probe);
     while (*name)
     {
         char buf[32];
@@ -275,9 +301,17 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
                 continue; // module failed in previous iteration
             if (!module_match_name (cand, shortcut))
                 continue;
+            if (data != NULL && !obj->obj.force
+             && !module_match_data (cand, data, size))
+            {
+                if (!deferred[i])
+                    deferred_count++;
+                deferred[i] = true;
+                continue;
+            }
             mods[i] = NULL; // only try each module once at most...
 
-            int ret = module_load (obj, cand, probe, args);
+            int ret = module_probe (obj, cand, data != NULL, probe, args);
             switch (ret)
             {
                 case VLC_SUCCESS:
@@ -298,8 +332,39 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
             module_t *cand = mods[i];
             if (cand == NULL || module_get_score (cand) <= 0)
                 continue;
+            if (data != NULL && !module_match_data (cand, data, size))
+            {
+                if (!deferred[i])
+                    deferred_count++;
+                deferred[i] = true;
+                continue;
+            }
 
-            int ret = module_load (obj, cand, probe, args);
+            int ret = module_probe (obj, cand, data != NULL, probe, args);
+            switch (ret)
+            {
+                case VLC_SUCCESS:
+                    module = cand;
+                    /* fall through */
+                case VLC_ETIMEOUT:
+                    goto done;
+            }
+        }
+    }
+
+    /* The signatures may be incomplete: try the deferred modules anyway */
+    if (deferred_count > 0)
+    {
+        msg_Dbg (obj, "no %s module matched among the signatures, "
+                 "probing %zu more candidates", capability, deferred_count);
+        obj->obj.force = false;
+        for (ssize_t i = 0; i < total; i++)
+        {
+            module_t *cand = mods[i];
+            if (cand == NULL || !deferred[i])
+                continue;
+
+            int ret = module_probe (obj, cand, true, probe, args);
             switch (ret)
             {
                 case VLC_SUCCESS:
@@ -311,9 +376,9 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
         }
     }
 done:
-    va_end (args);
     obj->obj.force = b_force_backup;
     module_list_free (mods);
+    free (deferred);
     free (var);
 
     if (module != NULL)
@@ -327,6 +392,55 @@ done:
     return module;
 }
 
+#undef vlc_module_load
+/**
+ * Finds and instantiates the best module of a certain type.
+ * All candidates modules having the specified capability and name will be
+ * sorted in decreasing order of priority. Then the probe callback will be
+ * invoked for each module, until it succeeds (returns 0), or all candidate
+ * module failed to initialize.
+ *
+ * The probe callback first parameter is the address of the module entry point.
+ * Further parameters are passed as an argument list; it corresponds to the
+ * variable arguments passed to this function. This scheme is meant to
+ * support arbitrary prototypes for the module entry point.
+ *
+ * \param obj VLC object
+ * \param capability capability, i.e. class of module
+ * \param name name of the module asked, if any
+ * \param strict if true, do not fallback to plugin with a different name
+ *                 but the same capability
+ * \param probe module probe callback
+ * \return the module or NULL in case of a failure
+ */
+module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
+                          const char *name, bool strict,
+                          vlc_activate_t probe, ...)
+{
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = vlc_module_load_va(obj, capability, name, strict,
+                                          NULL, 0, probe, args);
+    va_end(args);
+    return module;
+}
+
+#undef vlc_module_load_data
+module_t *vlc_module_load_data(vlc_object_t *obj, const char *capability,
+                               const char *name, bool strict,
+                               const void *data, size_t size,
+                               vlc_activate_t probe, ...)
+{
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = vlc_module_load_va(obj, capability, name, strict,
+                                          data, size, probe, args);
+    va_end(args);
+    return module;
+}
+
 #undef vlc_module_unload
 /**
  * Deinstantiates a module.
@@ -25,6 +25,7 @@
 # define LIBVLC_MODULES_H 1
 
 # include <vlc_atomic.h>
+# include <vlc_modules.h>
 
 /** The plugin handle type */
 typedef void *module_handle_t;
@@ -47,6 +48,7 @@ typedef struct vlc_plugin_t
         size_t size; /**< Size of items table */
         size_t count; /**< Number of configuration items */
         size_t booleans; /**< Number of booleal config items */
+        bool mapped; /**< Whether the table is in the mapped cache */
     } conf;
 
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -67,6 +69,7 @@ typedef struct vlc_plugin_t
 extern struct vlc_plugin_t *vlc_plugins;
 
 #define MODULE_SHORTCUT_MAX 20
+#define MODULE_SIGNATURE_MAX 8
 
 /** Plugin entry point prototype */
 typedef int (*vlc_plugin_cb) (int (*)(void *, void *, int, ...), void *);
@@ -96,6 +99,14 @@ struct module_t
     const char *psz_capability;                              /**< Capability */
     int      i_score;                          /**< Score for the capability */
 
+    /** Magic bytes of the handled data */
+    unsigned    i_signatures;
+    struct
+    {
+        unsigned offset;
+        const char *magic;
+    } *p_signatures;
+
     /* Callbacks */
     const char *activate_name;
     const char *deactivate_name;
@@ -119,6 +130,21 @@ int module_Map(vlc_object_t *, vlc_plugin_t *);
 
 ssize_t module_list_cap (module_t ***, const char *);
 
+/**
+ * Finds and instantiates the best module for some data, like
+ * vlc_module_load(). Unless forced, the modules declaring signatures that
+ * do not match the data are only probed after all the other ones failed.
+ *
+ * \param data first bytes of the data to handle
+ * \param size number of bytes available in data
+ */
+module_t *vlc_module_load_data(vlc_object_t *obj, const char *capability,
+                               const char *name, bool strict,
+                               const void *data, size_t size,
+                               vlc_activate_t probe, ...) VLC_USED;
+#define vlc_module_load_data(o,c,n,s,d,l,...) \
+        vlc_module_load_data(VLC_OBJECT(o),c,n,s,d,l,__VA_ARGS__)
+
 int vlc_bindtextdomain (const char *);
 
 /* Low-level OS-dependent handler */
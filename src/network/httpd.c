@@ -435,8 +435,11 @@ httpd_HandlerCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
 
         /* Looks for end of header (i.e. one empty line) */
         while ((p = strchr(p, '\r')))
+        {
             if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
                 break;
+            p++;
+        }
 
         if (p) {
             p[4] = '\0';
@@ -264,6 +264,8 @@ playlist_t *playlist_Create( vlc_object_t *p_parent )
     pl_priv(p_playlist)->last_eos = 0;
     pl_priv(p_playlist)->eos_burst_count = 0;
     p->request.input_dead = false;
+    for( int i = 0; i < PLAYLIST_PREOPEN_MAX; i++ )
+        p->preopened[i].p_input = NULL;
 
     if (ml != NULL)
         playlist_MLLoad( p_playlist );
@@ -207,7 +207,8 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0,
+                                     playlist_RequestPriority( req->options ) ) )
             return VLC_SUCCESS;
     }
 
@@ -297,7 +298,8 @@ static void SearchLocal( playlist_fetcher_t* fetcher, struct fetcher_request* re
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( background_worker_Push( fetcher->network, req, NULL, 0,
+                                    playlist_RequestPriority( req->options ) ) )
             SetPreparsed( req );
     }
     else
@@ -400,10 +402,12 @@ DEF_STARTER(SearchNetwork, fetcher->network )
 DEF_STARTER(   Downloader, fetcher->downloader )
 
 static void WorkerInit( playlist_fetcher_t* fetcher,
-    struct background_worker** worker, int( *starter )( void*, void*, void** ) )
+    struct background_worker** worker, int( *starter )( void*, void*, void** ),
+    int max_threads )
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
+        .max_threads = max_threads,
         .pf_start = starter,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
@@ -413,7 +417,7 @@ static void WorkerInit( playlist_fetcher_t* fetcher,
     *worker = background_worker_New( fetcher, &conf );
 }
 
-playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner )
+playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner, int max_threads )
 {
     playlist_fetcher_t* fetcher = malloc( sizeof( *fetcher ) );
 
@@ -422,9 +426,10 @@ playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner )
 
     fetcher->owner = owner;
 
-    WorkerInit( fetcher, &fetcher->local, StartSearchLocal );
-    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork );
-    WorkerInit( fetcher, &fetcher->downloader, StartDownloader );
+    /* Do not hammer the remote services nor the art cache */
+    WorkerInit( fetcher, &fetcher->local, StartSearchLocal, max_threads );
+    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork, 1 );
+    WorkerInit( fetcher, &fetcher->downloader, StartDownloader, 1 );
 
     if( unlikely( !fetcher->local || !fetcher->network || !fetcher->downloader ) )
     {
@@ -462,7 +467,8 @@ int playlist_fetcher_Push( playlist_fetcher_t* fetcher, input_item_t* item,
     atomic_init( &req->refs, 1 );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( background_worker_Push( fetcher->local, req, NULL, 0,
+                                playlist_RequestPriority( options ) ) )
         SetPreparsed( req );
 
     RequestRelease( req );
@@ -27,6 +27,8 @@
 
 #include <vlc_input_item.h>
 
+#include "misc/background_worker.h"
+
 /**
  * Fetcher opaque structure.
  *
@@ -36,9 +38,11 @@
 typedef struct playlist_fetcher_t playlist_fetcher_t;
 
 /**
- * This function creates the fetcher object and thread.
+ * This function creates the fetcher object.
+ *
+ * \param max_threads the number of items searched locally at the same time
  */
-playlist_fetcher_t *playlist_fetcher_New( vlc_object_t * );
+playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *, int max_threads );
 
 /**
  * This function enqueues the provided item to be art fetched.
@@ -49,6 +53,19 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t * );
 int playlist_fetcher_Push( playlist_fetcher_t *, input_item_t *,
                            input_item_meta_request_option_t, int );
 
+/**
+ * Gets the background worker priority matching the options of a request.
+ */
+static inline int playlist_RequestPriority(
+    input_item_meta_request_option_t options )
+{
+    if( options & META_REQUEST_OPTION_PRIORITY_HIGH )
+        return BACKGROUND_WORKER_PRIORITY_HIGH;
+    if( options & META_REQUEST_OPTION_PRIORITY_LOW )
+        return BACKGROUND_WORKER_PRIORITY_LOW;
+    return BACKGROUND_WORKER_PRIORITY_NORMAL;
+}
+
 /**
  * This function destroys the fetcher object and thread.
  *
@@ -42,6 +42,8 @@
 
 typedef struct vlc_sd_internal_t vlc_sd_internal_t;
 
+#define PLAYLIST_PREOPEN_MAX 8
+
 void playlist_ServicesDiscoveryKillAll( playlist_t *p_playlist );
 
 typedef struct playlist_private_t
@@ -79,6 +81,11 @@ typedef struct playlist_private_t
         bool input_dead; /**< Set when input has finished. */
     } request;
 
+    struct {
+        input_thread_t *p_input; /**< Input opened ahead of time */
+        bool b_dead; /**< Set when that input has finished */
+    } preopened[PLAYLIST_PREOPEN_MAX];
+
     vlc_thread_t thread; /**< engine thread */
     vlc_mutex_t lock; /**< dah big playlist global lock */
     vlc_cond_t signal; /**< wakes up the playlist engine thread */
@@ -39,6 +39,14 @@ struct playlist_preparser_t
     atomic_bool deactivated;
 };
 
+struct preparser_request
+{
+    input_item_t* item;
+    input_thread_t* input;
+    input_item_meta_request_option_t options;
+    atomic_uint refs;
+};
+
 static int InputEvent( vlc_object_t* obj, const char* varname,
     vlc_value_t old, vlc_value_t cur, void* worker )
 {
@@ -50,14 +58,16 @@ static int InputEvent( vlc_object_t* obj, const char* varname,
     return VLC_SUCCESS;
 }
 
-static int PreparserOpenInput( void* preparser_, void* item_, void** out )
+static int PreparserOpenInput( void* preparser_, void* req_, void** out )
 {
     playlist_preparser_t* preparser = preparser_;
+    struct preparser_request* req = req_;
 
-    input_thread_t* input = input_CreatePreparser( preparser->owner, item_ );
+    input_thread_t* input = input_CreatePreparser( preparser->owner,
+                                                   req->item );
     if( !input )
     {
-        input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
+        input_item_SignalPreparseEnded( req->item, ITEM_PREPARSE_FAILED );
         return VLC_EGENERIC;
     }
 
@@ -66,26 +76,29 @@ static int PreparserOpenInput( void* preparser_, void* item_, void** out )
     {
         var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
         input_Close( input );
-        input_item_SignalPreparseEnded( item_, ITEM_PREPARSE_FAILED );
+        input_item_SignalPreparseEnded( req->item, ITEM_PREPARSE_FAILED );
         return VLC_EGENERIC;
     }
 
-    *out = input;
+    req->input = input;
+    *out = req;
     return VLC_SUCCESS;
 }
 
-static int PreparserProbeInput( void* preparser_, void* input_ )
+static int PreparserProbeInput( void* preparser_, void* req_ )
 {
-    int state = input_GetState( input_ );
+    struct preparser_request* req = req_;
+    int state = input_GetState( req->input );
     return state == END_S || state == ERROR_S;
     VLC_UNUSED( preparser_ );
 }
 
-static void PreparserCloseInput( void* preparser_, void* input_ )
+static void PreparserCloseInput( void* preparser_, void* req_ )
 {
     playlist_preparser_t* preparser = preparser_;
-    input_thread_t* input = input_;
-    input_item_t* item = input_priv(input)->p_item;
+    struct preparser_request* req = req_;
+    input_thread_t* input = req->input;
+    input_item_t* item = req->item;
 
     var_DelCallback( input, "intf-event", InputEvent, preparser->worker );
 
@@ -104,10 +117,17 @@ static void PreparserCloseInput( void* preparser_, void* input_ )
 
     input_Stop( input );
     input_Close( input );
+    req->input = NULL;
 
     if( preparser->fetcher )
     {
-        if( !playlist_fetcher_Push( preparser->fetcher, item, 0, status ) )
+        /* The request is not over until the art is fetched */
+        input_item_meta_request_option_t options =
+            req->options & ( META_REQUEST_OPTION_PRIORITY_LOW
+                           | META_REQUEST_OPTION_PRIORITY_HIGH );
+
+        if( !playlist_fetcher_Push( preparser->fetcher, item, options,
+                                    status ) )
             return;
     }
 
@@ -115,20 +135,40 @@ static void PreparserCloseInput( void* preparser_, void* input_ )
     input_item_SignalPreparseEnded( item, status );
 }
 
-static void InputItemRelease( void* item ) { input_item_Release( item ); }
-static void InputItemHold( void* item ) { input_item_Hold( item ); }
+static void RequestRelease( void* req_ )
+{
+    struct preparser_request* req = req_;
+
+    if( atomic_fetch_sub( &req->refs, 1 ) != 1 )
+        return;
+
+    input_item_Release( req->item );
+    free( req );
+}
+
+static void RequestHold( void* req_ )
+{
+    struct preparser_request* req = req_;
+    atomic_fetch_add_explicit( &req->refs, 1, memory_order_relaxed );
+}
 
 playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 {
     playlist_preparser_t* preparser = malloc( sizeof *preparser );
 
+    /* Preparsing mostly waits for I/O */
+    int max_threads = var_InheritInteger( parent, "preparse-threads" );
+    if( max_threads <= 0 )
+        max_threads = 2 * vlc_GetCPUCount();
+
     struct background_worker_config conf = {
         .default_timeout = var_InheritInteger( parent, "preparse-timeout" ),
+        .max_threads = max_threads,
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
-        .pf_release = InputItemRelease,
-        .pf_hold = InputItemHold };
+        .pf_release = RequestRelease,
+        .pf_hold = RequestHold };
 
 
     if( likely( preparser ) )
@@ -141,7 +181,7 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
     }
 
     preparser->owner = parent;
-    preparser->fetcher = playlist_fetcher_New( parent );
+    preparser->fetcher = playlist_fetcher_New( parent, max_threads );
     atomic_init( &preparser->deactivated, false );
 
     if( unlikely( !preparser->fetcher ) )
@@ -175,8 +215,31 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    struct preparser_request* req = malloc( sizeof *req );
+    if( unlikely( !req ) )
+    {
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
+        return;
+    }
+
+    req->item = item;
+    req->input = NULL;
+    req->options = i_options;
+    atomic_init( &req->refs, 1 );
+    input_item_Hold( item );
+
+    if( background_worker_Push( preparser->worker, req, id, timeout,
+                                playlist_RequestPriority( i_options ) ) )
+        input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
+
+    RequestRelease( req );
+}
+
+void playlist_preparser_Prioritize( playlist_preparser_t *preparser,
+    void *id, input_item_meta_request_option_t i_options )
+{
+    background_worker_Reprioritize( preparser->worker, id,
+                                    playlist_RequestPriority( i_options ) );
 }
 
 void playlist_preparser_fetcher_Push( playlist_preparser_t *preparser,
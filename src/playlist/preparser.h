@@ -61,6 +61,17 @@ void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
 void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
                                       input_item_meta_request_option_t );
 
+/**
+ * This function changes the priority of the pending requests for a given id
+ *
+ * Only the META_REQUEST_OPTION_PRIORITY_* options are used. The requests
+ * which are already being processed are not affected.
+ *
+ * @param id unique id given to playlist_preparser_Push()
+ */
+void playlist_preparser_Prioritize( playlist_preparser_t *, void *id,
+                                    input_item_meta_request_option_t );
+
 /**
  * This function cancel all preparsing requests for a given id
  *
@@ -90,11 +90,25 @@ void playlist_Deactivate( playlist_t *p_playlist )
 
 /* */
 
+static int FindPreopened( playlist_private_t *p_sys, input_thread_t *p_input,
+                          input_item_t *p_item )
+{
+    for( int i = 0; i < PLAYLIST_PREOPEN_MAX; i++ )
+    {
+        input_thread_t *p_preopened = p_sys->preopened[i].p_input;
+
+        if( p_preopened != NULL &&
+            ( p_preopened == p_input || input_GetItem( p_preopened ) == p_item ) )
+            return i;
+    }
+    return -1;
+}
+
 /* Input Callback */
 static int InputEvent( vlc_object_t *p_this, char const *psz_cmd,
                        vlc_value_t oldval, vlc_value_t newval, void *p_data )
 {
-    VLC_UNUSED(p_this); VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
+    VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
     playlist_t *p_playlist = p_data;
 
     if( newval.i_int == INPUT_EVENT_DEAD )
@@ -102,8 +116,14 @@ static int InputEvent( vlc_object_t *p_this, char const *psz_cmd,
         playlist_private_t *sys = pl_priv(p_playlist);
 
         PL_LOCK;
-        sys->request.input_dead = true;
-        vlc_cond_signal( &sys->signal );
+        int i = FindPreopened( sys, (input_thread_t *)p_this, NULL );
+        if( i >= 0 )
+            sys->preopened[i].b_dead = true;
+        else
+        {
+            sys->request.input_dead = true;
+            vlc_cond_signal( &sys->signal );
+        }
         PL_UNLOCK;
     }
     return VLC_SUCCESS;
@@ -210,16 +230,33 @@ static bool PlayItem( playlist_t *p_playlist, playlist_item_t *p_item )
     if( p_renderer )
         vlc_renderer_item_hold( p_renderer );
     assert( p_sys->p_input == NULL );
+
+    /* Take the input from the pre-opened ones if possible */
+    input_thread_t *p_input_thread = NULL;
+    int i_preopened = p_renderer == NULL ? FindPreopened( p_sys, NULL, p_input )
+                                         : -1;
+    if( i_preopened >= 0 )
+    {
+        p_input_thread = p_sys->preopened[i_preopened].p_input;
+        p_sys->preopened[i_preopened].p_input = NULL;
+        /* Its end event was already received */
+        p_sys->request.input_dead = p_sys->preopened[i_preopened].b_dead;
+    }
     PL_UNLOCK;
 
     libvlc_MetadataCancel( p_playlist->obj.libvlc, p_item );
 
-    input_thread_t *p_input_thread = input_Create( p_playlist, p_input, NULL,
-                                                   p_sys->p_input_resource,
-                                                   p_renderer );
+    if( p_input_thread != NULL )
+    {
+        msg_Dbg( p_playlist, "using pre-opened input thread" );
+        input_Activate( p_input_thread );
+    }
+    else
+        p_input_thread = input_Create( p_playlist, p_input, NULL,
+                                       p_sys->p_input_resource, p_renderer );
     if( p_renderer )
         vlc_renderer_item_release( p_renderer );
-    if( likely(p_input_thread != NULL) )
+    if( likely(p_input_thread != NULL) && i_preopened < 0 )
     {
         var_AddCallback( p_input_thread, "intf-event",
                          InputEvent, p_playlist );
@@ -463,6 +500,128 @@ static bool LoopInput( playlist_t *p_playlist )
     return ok;
 }
 
+static void ClosePreopened( playlist_t *p_playlist, input_thread_t *p_input )
+{
+    var_DelCallback( p_input, "intf-event", InputEvent, p_playlist );
+    input_Stop( p_input );
+    input_Close( p_input );
+}
+
+static bool CanPreopen( input_item_t *p_input )
+{
+    bool b_ok;
+
+    vlc_mutex_lock( &p_input->lock );
+    b_ok = p_input->i_type == ITEM_TYPE_FILE ||
+           p_input->i_type == ITEM_TYPE_STREAM;
+    /* The stream output cannot be shared with the current input */
+    for( int i = 0; b_ok && i < p_input->i_options; i++ )
+    {
+        const char *psz_option = p_input->ppsz_options[i];
+
+        psz_option += strspn( psz_option, ":-" );
+        if( !strncmp( psz_option, "sout", 4 ) )
+            b_ok = false;
+    }
+    vlc_mutex_unlock( &p_input->lock );
+
+    return b_ok;
+}
+
+/**
+ * Keep the items around the current one pre-opened
+ *
+ * The next and previous items are opened alternately, up to the "preopen"
+ * count. The pre-opened inputs of other items are closed.
+ */
+static void UpdatePreopened( playlist_t *p_playlist, int i_count )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    input_item_t *pp_wanted[PLAYLIST_PREOPEN_MAX];
+    int pi_unused[PLAYLIST_PREOPEN_MAX];
+    int i_wanted = 0, i_unused = 0;
+
+    PL_ASSERT_LOCKED;
+
+    const int i_size = p_playlist->current.i_size;
+    const int i_current = p_playlist->i_current_index;
+
+    for( int k = 1; i_current >= 0 && k < i_size && i_wanted < i_count; k++ )
+    {
+        const int i_offset = k & 1 ? (k + 1) / 2 : -k / 2;
+        const int i_index = ( i_current + i_offset % i_size + i_size ) % i_size;
+        input_item_t *p_input = ARRAY_VAL( p_playlist->current, i_index )->p_input;
+
+        bool b_found = false;
+        for( int i = 0; i < i_wanted; i++ )
+            b_found = b_found || pp_wanted[i] == p_input;
+        if( !b_found && CanPreopen( p_input ) )
+            pp_wanted[i_wanted++] = input_item_Hold( p_input );
+    }
+
+    /* Keep the live inputs still wanted */
+    for( int i = 0; i < PLAYLIST_PREOPEN_MAX; i++ )
+    {
+        input_thread_t *p_input = p_sys->preopened[i].p_input;
+        if( p_input == NULL )
+            continue;
+
+        int j = 0;
+        while( j < i_wanted && pp_wanted[j] != input_GetItem( p_input ) )
+            j++;
+        if( j < i_wanted && !p_sys->preopened[i].b_dead )
+        {
+            input_item_Release( pp_wanted[j] );
+            pp_wanted[j] = pp_wanted[--i_wanted];
+            continue;
+        }
+        /* The slot is kept until the callback is removed, so that the end
+         * of the closing input is not taken for the current one's */
+        pi_unused[i_unused++] = i;
+    }
+    PL_UNLOCK;
+
+    /* Mind: NO LOCKS while manipulating the inputs */
+    for( int i = 0; i < i_unused; i++ )
+        ClosePreopened( p_playlist, p_sys->preopened[pi_unused[i]].p_input );
+
+    PL_LOCK;
+    for( int i = 0; i < i_unused; i++ )
+        p_sys->preopened[pi_unused[i]].p_input = NULL;
+    PL_UNLOCK;
+
+    for( int i = 0; i < i_wanted; i++ )
+    {
+        input_thread_t *p_input = input_CreatePreopened( VLC_OBJECT(p_playlist),
+                                                         pp_wanted[i],
+                                                         p_sys->p_input_resource );
+        input_item_Release( pp_wanted[i] );
+        if( p_input == NULL )
+            continue;
+
+        /* Register it before it can end */
+        PL_LOCK;
+        int j = 0;
+        while( p_sys->preopened[j].p_input != NULL )
+            j++;
+        assert( j < PLAYLIST_PREOPEN_MAX );
+        p_sys->preopened[j].p_input = p_input;
+        p_sys->preopened[j].b_dead = false;
+        PL_UNLOCK;
+
+        var_AddCallback( p_input, "intf-event", InputEvent, p_playlist );
+        if( input_Start( p_input ) )
+        {
+            PL_LOCK;
+            p_sys->preopened[j].p_input = NULL;
+            PL_UNLOCK;
+            var_DelCallback( p_input, "intf-event", InputEvent, p_playlist );
+            vlc_object_release( p_input );
+        }
+    }
+    PL_LOCK;
+}
+
 static bool Next( playlist_t *p_playlist )
 {
     playlist_item_t *p_item = NextItem( p_playlist );
@@ -471,7 +630,16 @@ static bool Next( playlist_t *p_playlist )
 
     msg_Dbg( p_playlist, "starting playback of new item" );
     ResyncCurrentIndex( p_playlist, p_item );
-    return PlayItem( p_playlist, p_item );
+    if( !PlayItem( p_playlist, p_item ) )
+        return false;
+
+    int i_count = var_InheritInteger( p_playlist, "preopen" );
+    char *psz_sout = var_InheritString( p_playlist, "sout" );
+    if( psz_sout != NULL || pl_priv(p_playlist)->p_renderer != NULL )
+        i_count = 0;
+    free( psz_sout );
+    UpdatePreopened( p_playlist, __MIN( i_count, PLAYLIST_PREOPEN_MAX ) );
+    return true;
 }
 
 /**
@@ -528,6 +696,7 @@ static void *Thread ( void *data )
 
         /* Playlist stopping */
         msg_Dbg( p_playlist, "nothing to play" );
+        UpdatePreopened( p_playlist, 0 );
         if( played && var_InheritBool( p_playlist, "play-and-exit" ) )
         {
             msg_Info( p_playlist, "end of playlist, exiting" );
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ * statistic.c : vout frame timing statistic
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "statistic.h"
+
+static const char *const timing_names[VOUT_TIMING_COUNT] = {
+    [VOUT_TIMING_LATENCY] = "latency",
+    [VOUT_TIMING_PACING]  = "pacing",
+    [VOUT_TIMING_FILTER]  = "filter",
+    [VOUT_TIMING_SPU]     = "spu",
+    [VOUT_TIMING_PREPARE] = "prepare",
+};
+
+/* Upper bound of the bucket holding the q-th quantile, clipped to the
+ * maximum value seen. */
+static double Percentile(const unsigned *buckets, unsigned count,
+                         uint64_t max, double q)
+{
+    const unsigned rank = __MAX(1, (unsigned)(q * count + .5));
+    unsigned acc = 0;
+
+    for (unsigned i = 0; i < VOUT_HISTOGRAM_SIZE; i++) {
+        acc += buckets[i];
+        if (acc >= rank) {
+            uint64_t value = i + 1 < VOUT_HISTOGRAM_SIZE
+                           ? vout_histogram_Value(i + 1) - 1 : max;
+            return __MIN(value, max) / 1000.;
+        }
+    }
+    return max / 1000.;
+}
+
+static void ReportHistogram(vlc_object_t *obj, const char *name,
+                            vout_histogram_t *h)
+{
+    unsigned count = atomic_load_explicit(&h->count, memory_order_acquire);
+    if (count == 0)
+        return;
+
+    unsigned buckets[VOUT_HISTOGRAM_SIZE];
+    unsigned total = 0;
+    for (unsigned i = 0; i < VOUT_HISTOGRAM_SIZE; i++) {
+        buckets[i] = atomic_load_explicit(&h->bucket[i], memory_order_relaxed);
+        total += buckets[i];
+    }
+    /* The vout thread may have added samples since count was read */
+    count = __MIN(count, total);
+
+    const uint64_t sum = atomic_load_explicit(&h->sum, memory_order_relaxed);
+    const uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+
+    msg_Info(obj, "%s: %u frames, mean %.3f ms, p50 %.3f ms, p90 %.3f ms, "
+             "p99 %.3f ms, p99.9 %.3f ms, max %.3f ms", name, count,
+             sum / 1000. / count,
+             Percentile(buckets, count, max, .50),
+             Percentile(buckets, count, max, .90),
+             Percentile(buckets, count, max, .99),
+             Percentile(buckets, count, max, .999),
+             max / 1000.);
+
+    for (unsigned i = 0; i < VOUT_HISTOGRAM_SIZE; i++) {
+        if (buckets[i] == 0)
+            continue;
+
+        uint64_t low = vout_histogram_Value(i);
+        if (i + 1 < VOUT_HISTOGRAM_SIZE)
+            msg_Dbg(obj, "%s: [%.3f, %.3f) ms: %u (%.2f%%)", name,
+                    low / 1000., vout_histogram_Value(i + 1) / 1000.,
+                    buckets[i], 100. * buckets[i] / total);
+        else
+            msg_Dbg(obj, "%s: [%.3f, inf) ms: %u (%.2f%%)", name,
+                    low / 1000., buckets[i], 100. * buckets[i] / total);
+    }
+}
+
+void vout_statistic_Report(vout_statistic_t *stat, vlc_object_t *obj)
+{
+    if (atomic_load(&stat->timing[VOUT_TIMING_FILTER].count) == 0) {
+        msg_Info(obj, "no frame timing statistics");
+        return;
+    }
+
+    msg_Info(obj, "frame timing statistics");
+    for (unsigned i = 0; i < VOUT_TIMING_COUNT; i++)
+        ReportHistogram(obj, timing_names[i], &stat->timing[i]);
+}
@@ -25,18 +25,100 @@
 # define LIBVLC_VOUT_STATISTIC_H
 # include <vlc_atomic.h>
 
+/* Log-linear histogram of durations in microseconds: values below
+ * 2 * VOUT_HISTOGRAM_SUB are counted exactly, each further power of two is
+ * split into VOUT_HISTOGRAM_SUB buckets (12.5% precision). Values from
+ * 2^26 us (about 67 s) are counted in the last bucket.
+ *
+ * Histograms are only written by the vout thread, and can be read from any
+ * thread. */
+#define VOUT_HISTOGRAM_SUB  8
+#define VOUT_HISTOGRAM_SIZE (24 * VOUT_HISTOGRAM_SUB)
+
+typedef struct {
+    atomic_uint           bucket[VOUT_HISTOGRAM_SIZE];
+    atomic_uint           count;
+    atomic_uint_least64_t sum;
+    atomic_uint_least64_t max;
+} vout_histogram_t;
+
+enum {
+    VOUT_TIMING_LATENCY, /* decoder output to display */
+    VOUT_TIMING_PACING,  /* display delay past the picture date */
+    VOUT_TIMING_FILTER,  /* interactive filters */
+    VOUT_TIMING_SPU,     /* subpicture rendering and early blending */
+    VOUT_TIMING_PREPARE, /* copy, conversion and display prepare */
+    VOUT_TIMING_COUNT
+};
+
 /* NOTE: Both statistics are atomic on their own, so one might be older than
  * the other one. Currently, only one of them is updated at a time, so this
  * is a non-issue. */
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+    /* Date of the first picture displayed since the last reset */
+    atomic_uint_least64_t first_displayed;
+
+    /* Frame timings, unlike the counters above, are never reset */
+    vout_histogram_t timing[VOUT_TIMING_COUNT];
 } vout_statistic_t;
 
+static inline void vout_histogram_Init(vout_histogram_t *h)
+{
+    for (unsigned i = 0; i < VOUT_HISTOGRAM_SIZE; i++)
+        atomic_init(&h->bucket[i], 0);
+    atomic_init(&h->count, 0);
+    atomic_init(&h->sum, 0);
+    atomic_init(&h->max, 0);
+}
+
+static inline unsigned vout_histogram_Index(uint64_t value)
+{
+    if (value < 2 * VOUT_HISTOGRAM_SUB)
+        return value;
+
+    if (value > UINT32_MAX)
+        return VOUT_HISTOGRAM_SIZE - 1;
+
+    unsigned msb = 31 - clz32(value);
+    unsigned index = (msb - 2) * VOUT_HISTOGRAM_SUB
+                   + ((value >> (msb - 3)) & (VOUT_HISTOGRAM_SUB - 1));
+    return __MIN(index, VOUT_HISTOGRAM_SIZE - 1);
+}
+
+/* Lower bound of the values counted in a bucket */
+static inline uint64_t vout_histogram_Value(unsigned index)
+{
+    if (index < 2 * VOUT_HISTOGRAM_SUB)
+        return index;
+
+    unsigned msb = index / VOUT_HISTOGRAM_SUB + 2;
+    uint64_t sub = VOUT_HISTOGRAM_SUB + index % VOUT_HISTOGRAM_SUB;
+    return sub << (msb - 3);
+}
+
+static inline void vout_histogram_Add(vout_histogram_t *h, vlc_tick_t value)
+{
+    const uint64_t v = value > 0 ? value : 0;
+
+    atomic_fetch_add_explicit(&h->bucket[vout_histogram_Index(v)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, v, memory_order_relaxed);
+    if (v > atomic_load_explicit(&h->max, memory_order_relaxed))
+        atomic_store_explicit(&h->max, v, memory_order_relaxed);
+    /* Published last, so that readers never see more samples than counts */
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_release);
+}
+
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    atomic_init(&stat->first_displayed, 0);
+
+    for (unsigned i = 0; i < VOUT_TIMING_COUNT; i++)
+        vout_histogram_Init(&stat->timing[i]);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -46,15 +128,22 @@ static inline void vout_statistic_Clean(vout_statistic_t *stat)
 
 static inline void vout_statistic_GetReset(vout_statistic_t *stat,
                                            unsigned *restrict displayed,
-                                           unsigned *restrict lost)
+                                           unsigned *restrict lost,
+                                           vlc_tick_t *restrict first)
 {
     *displayed = atomic_exchange(&stat->displayed, 0);
     *lost      = atomic_exchange(&stat->lost, 0);
+    *first     = atomic_load(&stat->first_displayed);
 }
 
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
-                                               int displayed)
+                                               int displayed, vlc_tick_t date)
 {
+    /* Stored before the count is published: a reader seeing the count
+     * also sees the date */
+    if (atomic_load_explicit(&stat->displayed, memory_order_relaxed) == 0)
+        atomic_store_explicit(&stat->first_displayed, date,
+                              memory_order_relaxed);
     atomic_fetch_add(&stat->displayed, displayed);
 }
 
@@ -63,4 +152,15 @@ static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
     atomic_fetch_add(&stat->lost, lost);
 }
 
+static inline void vout_statistic_AddTiming(vout_statistic_t *stat,
+                                            unsigned type, vlc_tick_t value)
+{
+    vout_histogram_Add(&stat->timing[type], value);
+}
+
+/**
+ * Logs the frame timing histograms and percentiles.
+ */
+void vout_statistic_Report(vout_statistic_t *stat, vlc_object_t *obj);
+
 #endif
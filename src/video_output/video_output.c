@@ -54,6 +54,7 @@
 #include "display.h"
 #include "window.h"
 #include "../misc/variables.h"
+#include "../misc/picture.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -271,6 +272,9 @@ void vout_Close(vout_thread_t *vout)
     vout_control_PushVoid(&vout->p->control, VOUT_CONTROL_CLEAN);
     vlc_join(vout->p->thread, NULL);
 
+    if (var_GetBool(vout, "vout-frame-stats"))
+        vout_statistic_Report(&vout->p->statistic, VLC_OBJECT(vout));
+
     if (vout->p->window != NULL)
         vout_display_window_Delete(vout->p->window);
 
@@ -323,9 +327,11 @@ void vout_ChangePause(vout_thread_t *vout, bool is_paused, vlc_tick_t date)
 }
 
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost)
+                            unsigned *restrict lost,
+                            vlc_tick_t *restrict first_displayed)
 {
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost,
+                             first_displayed );
 }
 
 void vout_Flush(vout_thread_t *vout, vlc_tick_t date)
@@ -427,6 +433,7 @@ void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
     picture->p_next = NULL;
     if (picture_pool_OwnsPic(vout->p->decoder_pool, picture))
     {
+        ((picture_priv_t *)picture)->queued = mdate();
         picture_fifo_Push(vout->p->decoder_fifo, picture);
 
         vout_control_Wake(&vout->p->control);
@@ -897,6 +904,16 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
     }
 
+    /* Forward the decoder output date once: the pictures produced again from
+     * the same decoded picture (redisplay, extra deinterlaced fields) must
+     * not be accounted for twice */
+    if (picture && picture != vout->p->displayed.decoded) {
+        picture_priv_t *decoded = (picture_priv_t *)vout->p->displayed.decoded;
+
+        ((picture_priv_t *)picture)->queued = decoded->queued;
+        decoded->queued = VLC_TICK_INVALID;
+    }
+
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (!picture)
@@ -971,11 +988,18 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     picture_t *torender = picture_Hold(vout->p->displayed.current);
 
+    /* Only the first display of a picture accounts for its latency */
+    picture_priv_t *current = (picture_priv_t *)vout->p->displayed.current;
+    const vlc_tick_t queued = current->queued;
+    current->queued = VLC_TICK_INVALID;
+
+    const vlc_tick_t render_start = mdate();
     vout_chrono_Start(&vout->p->render);
 
     vlc_mutex_lock(&vout->p->filter.lock);
     picture_t *filtered = filter_chain_VideoFilter(vout->p->filter.chain_interactive, torender);
     vlc_mutex_unlock(&vout->p->filter.lock);
+    const vlc_tick_t filter_end = mdate();
 
     if (!filtered)
         return VLC_EGENERIC;
@@ -1096,6 +1120,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         subpicture_Delete(subpic);
         subpic = NULL;
     }
+    const vlc_tick_t spu_end = mdate();
 
     assert(vout_IsDisplayFiltered(vd) == !sys->display.use_dr);
     if (sys->display.use_dr && !is_direct) {
@@ -1155,6 +1180,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     }
 
     vout_chrono_Stop(&vout->p->render);
+    const vlc_tick_t prepare_end = mdate();
 #if 0
         {
         static int i = 0;
@@ -1170,14 +1196,26 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (delay < 1000)
         msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
 #endif
+    const vlc_tick_t display_date = todisplay->date;
     if (!is_forced)
-        mwait(todisplay->date);
+        mwait(display_date);
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout->p->displayed.date = mdate();
     vout_display_Display(vd, todisplay, subpic);
 
-    vout_statistic_AddDisplayed(&vout->p->statistic, 1);
+    vout_statistic_AddDisplayed(&vout->p->statistic, 1,
+                                vout->p->displayed.date);
+
+    vout_statistic_t *stat = &vout->p->statistic;
+    const vlc_tick_t displayed = vout->p->displayed.date;
+    if (queued != VLC_TICK_INVALID)
+        vout_statistic_AddTiming(stat, VOUT_TIMING_LATENCY, displayed - queued);
+    if (!is_forced)
+        vout_statistic_AddTiming(stat, VOUT_TIMING_PACING, displayed - display_date);
+    vout_statistic_AddTiming(stat, VOUT_TIMING_FILTER, filter_end - render_start);
+    vout_statistic_AddTiming(stat, VOUT_TIMING_SPU, spu_end - filter_end);
+    vout_statistic_AddTiming(stat, VOUT_TIMING_PREPARE, prepare_end - spu_end);
 
     return VLC_SUCCESS;
 }
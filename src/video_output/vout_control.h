@@ -40,9 +40,12 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, vlc_tick_t i_duration );
 
 /**
  * This function will return and reset internal statistics.
+ *
+ * The date of the first picture displayed since the previous call is only
+ * meaningful if *pi_displayed is not zero.
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost );
+                             unsigned *pi_lost, vlc_tick_t *pi_first_displayed );
 
 /**
  * This function will ensure that all ready/displayed pictures have at most
@@ -65,6 +65,8 @@ static int FullscreenCallback( vlc_object_t *, char const *,
                                vlc_value_t, vlc_value_t, void * );
 static int SnapshotCallback( vlc_object_t *, char const *,
                              vlc_value_t, vlc_value_t, void * );
+static int FrameStatsCallback( vlc_object_t *, char const *,
+                               vlc_value_t, vlc_value_t, void * );
 static int VideoFilterCallback( vlc_object_t *, char const *,
                                 vlc_value_t, vlc_value_t, void * );
 static int SubSourceCallback( vlc_object_t *, char const *,
@@ -275,6 +277,11 @@ void vout_IntfInit( vout_thread_t *p_vout )
     var_Change( p_vout, "video-snapshot", VLC_VAR_SETTEXT, &text, NULL );
     var_AddCallback( p_vout, "video-snapshot", SnapshotCallback, NULL );
 
+    /* Frame timing statistics, logged on request and when closing */
+    var_Create( p_vout, "frame-stats", VLC_VAR_VOID );
+    var_AddCallback( p_vout, "frame-stats", FrameStatsCallback, NULL );
+    var_Create( p_vout, "vout-frame-stats", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
+
     /* Add a video-filter variable */
     var_Create( p_vout, "video-filter",
                 VLC_VAR_STRING | VLC_VAR_DOINHERIT | VLC_VAR_ISCOMMAND );
@@ -566,6 +573,17 @@ static int SnapshotCallback( vlc_object_t *p_this, char const *psz_cmd,
     return VLC_SUCCESS;
 }
 
+static int FrameStatsCallback( vlc_object_t *p_this, char const *psz_cmd,
+                       vlc_value_t oldval, vlc_value_t newval, void *p_data )
+{
+    vout_thread_t *p_vout = (vout_thread_t *)p_this;
+    VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
+    VLC_UNUSED(newval); VLC_UNUSED(p_data);
+
+    vout_statistic_Report( &p_vout->p->statistic, p_this );
+    return VLC_SUCCESS;
+}
+
 static int VideoFilterCallback( vlc_object_t *p_this, char const *psz_cmd,
                                 vlc_value_t oldval, vlc_value_t newval, void *p_data)
 {
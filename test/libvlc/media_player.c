@@ -190,6 +190,70 @@ static void test_media_player_pause_stop(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+struct startup_trace
+{
+    unsigned stages;
+    int64_t delay[libvlc_startup_first_audio + 1];
+};
+
+static void on_startup_stage(const libvlc_event_t *event, void *data)
+{
+    struct startup_trace *trace = data;
+    int stage = event->u.media_player_startup_stage.stage;
+
+    assert(event->type == libvlc_MediaPlayerStartupStage);
+    assert(stage >= 0 && stage <= libvlc_startup_first_audio);
+    assert(!(trace->stages & (1u << stage))); /* reported only once */
+    assert(event->u.media_player_startup_stage.delay >= 0);
+
+    trace->stages |= 1u << stage;
+    trace->delay[stage] = event->u.media_player_startup_stage.delay;
+}
+
+static void test_media_player_startup(const char** argv, int argc)
+{
+    libvlc_instance_t *vlc;
+    libvlc_media_t *md;
+    libvlc_media_player_t *mi;
+    const char * file = test_default_sample;
+    struct startup_trace trace = { 0 };
+
+    log ("Testing startup stages of %s\n", file);
+
+    vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    md = libvlc_media_new_path (vlc, file);
+    assert (md != NULL);
+
+    mi = libvlc_media_player_new_from_media (md);
+    assert (mi != NULL);
+
+    libvlc_media_release (md);
+
+    int ret = libvlc_event_attach (libvlc_media_player_event_manager (mi),
+                                   libvlc_MediaPlayerStartupStage,
+                                   on_startup_stage, &trace);
+    assert (ret == 0);
+
+    libvlc_media_player_play (mi);
+    wait_playing (mi);
+    /* The input thread is joined: all the events were sent */
+    libvlc_media_player_stop (mi);
+
+    const unsigned opened = (1u << libvlc_startup_access)
+                          | (1u << libvlc_startup_stream_filter)
+                          | (1u << libvlc_startup_demux);
+    assert ((trace.stages & opened) == opened);
+    assert (trace.delay[libvlc_startup_access]
+            <= trace.delay[libvlc_startup_stream_filter]);
+    assert (trace.delay[libvlc_startup_stream_filter]
+            <= trace.delay[libvlc_startup_demux]);
+
+    libvlc_media_player_release (mi);
+    libvlc_release (vlc);
+}
+
 
 int main (void)
 {
@@ -198,6 +262,7 @@ int main (void)
     test_media_player_set_media (test_defaults_args, test_defaults_nargs);
     test_media_player_play_stop (test_defaults_args, test_defaults_nargs);
     test_media_player_pause_stop (test_defaults_args, test_defaults_nargs);
+    test_media_player_startup (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
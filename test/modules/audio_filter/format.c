@@ -0,0 +1,238 @@
+/*****************************************************************************
+ * format.c: PCM format converters and volume benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Build and run the benchmark:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_audio_filter_format
+ * $ ./test_modules_audio_filter_format
+ *
+ * For every pair of PCM formats, and every number of channels from 1 to 8,
+ * it prints the time taken by the audio converter per frame, as the blocks
+ * go through the audio output. The same is done for the software volume of
+ * each format. The SIMD versions are used where the CPU supports them; the
+ * C versions can be compared with the audio_filter_pcm_test module test.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+static const vlc_fourcc_t formats[] = {
+    VLC_CODEC_U8, VLC_CODEC_S16N, VLC_CODEC_S32N, VLC_CODEC_FL32,
+    VLC_CODEC_FL64,
+};
+
+static const uint16_t layouts[] = {
+    AOUT_CHAN_CENTER,
+    AOUT_CHANS_STEREO,
+    AOUT_CHANS_2_1,
+    AOUT_CHANS_4_0,
+    AOUT_CHANS_5_0,
+    AOUT_CHANS_5_1,
+    AOUT_CHANS_6_1_MIDDLE,
+    AOUT_CHANS_7_1,
+};
+
+#define RATE 48000
+#define FRAMES 1024
+#define RUNS 2000
+
+static void FillBlock(block_t *block, vlc_fourcc_t format, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        const double v = sin(i * .01) * .9;
+
+        switch (format)
+        {
+            case VLC_CODEC_U8:
+                block->p_buffer[i] = 128 + lround(v * 127.);
+                break;
+            case VLC_CODEC_S16N:
+                ((int16_t *)block->p_buffer)[i] = lround(v * 32767.);
+                break;
+            case VLC_CODEC_S32N:
+                ((int32_t *)block->p_buffer)[i] = lround(v * 2147483647.);
+                break;
+            case VLC_CODEC_FL32:
+                ((float *)block->p_buffer)[i] = v;
+                break;
+            case VLC_CODEC_FL64:
+                ((double *)block->p_buffer)[i] = v;
+                break;
+        }
+    }
+}
+
+/* Returns the time per frame in nanoseconds, or a negative value if the
+ * conversion is not available */
+static double BenchConverter(vlc_object_t *parent, vlc_fourcc_t src,
+                             vlc_fourcc_t dst, uint16_t layout)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    audio_format_t fmt = {
+        .i_format = src,
+        .i_rate = RATE,
+        .i_physical_channels = layout,
+    };
+    aout_FormatPrepare(&fmt);
+    es_format_Init(&filter->fmt_in, AUDIO_ES, src);
+    filter->fmt_in.audio = fmt;
+
+    fmt.i_format = dst;
+    aout_FormatPrepare(&fmt);
+    es_format_Init(&filter->fmt_out, AUDIO_ES, dst);
+    filter->fmt_out.audio = fmt;
+
+    filter->p_module = module_need(filter, "audio converter", NULL, false);
+    if (filter->p_module == NULL)
+    {
+        vlc_object_release(filter);
+        return -1.;
+    }
+
+    const unsigned channels = aout_FormatNbChannels(&fmt);
+    const size_t samples = FRAMES * channels;
+    vlc_tick_t duration = 0;
+
+    for (unsigned r = 0; r < RUNS; r++)
+    {
+        /* Room for 8 bytes samples, so that they can grow in place */
+        block_t *block = block_Alloc(samples * 8);
+        assert(block != NULL);
+
+        block->i_buffer = samples * filter->fmt_in.audio.i_bitspersample / 8;
+        block->i_nb_samples = FRAMES;
+        FillBlock(block, src, samples);
+
+        vlc_tick_t start = mdate();
+        block = filter->pf_audio_filter(filter, block);
+        duration += mdate() - start;
+
+        assert(block != NULL);
+        block_Release(block);
+    }
+
+    module_unneed(filter, filter->p_module);
+    vlc_object_release(filter);
+    return duration * 1000. / ((double)RUNS * FRAMES);
+}
+
+static double BenchVolume(vlc_object_t *parent, vlc_fourcc_t format,
+                          unsigned channels)
+{
+    audio_volume_t *volume = vlc_object_create(parent, sizeof (*volume));
+    assert(volume != NULL);
+
+    volume->format = format;
+    module_t *module = module_need(volume, "audio volume", NULL, false);
+    if (module == NULL)
+    {
+        vlc_object_release(volume);
+        return -1.;
+    }
+
+    const size_t samples = FRAMES * channels;
+    const unsigned bytes = aout_BitsPerSample(format) / 8;
+    block_t *block = block_Alloc(samples * bytes);
+    assert(block != NULL);
+    FillBlock(block, format, samples);
+
+    vlc_tick_t start = mdate();
+    for (unsigned r = 0; r < RUNS; r++)
+        volume->amplify(volume, block, r & 1 ? .5f : 2.f);
+    vlc_tick_t duration = mdate() - start;
+
+    block_Release(block);
+    module_unneed(volume, module);
+    vlc_object_release(volume);
+    return duration * 1000. / ((double)RUNS * FRAMES);
+}
+
+static void PrintHeader(const char *title)
+{
+    printf("%-11s", title);
+    for (unsigned c = 1; c <= ARRAY_SIZE(layouts); c++)
+        printf(" %5u ch", c);
+    printf("   (ns/frame)\n");
+}
+
+static void PrintTime(double ns)
+{
+    if (ns < 0.)
+        printf("      n/a");
+    else
+        printf(" %8.2f", ns);
+}
+
+int main(void)
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    vlc_object_t *parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    PrintHeader("converter");
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(formats); j++)
+        {
+            if (i == j)
+                continue;
+
+            printf("%4.4s>%4.4s ", (const char *)&formats[i],
+                   (const char *)&formats[j]);
+            for (size_t l = 0; l < ARRAY_SIZE(layouts); l++)
+                PrintTime(BenchConverter(parent, formats[i], formats[j],
+                                         layouts[l]));
+            printf("\n");
+        }
+
+    PrintHeader("volume");
+    for (size_t i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        printf("%4.4s       ", (const char *)&formats[i]);
+        for (unsigned c = 1; c <= ARRAY_SIZE(layouts); c++)
+            PrintTime(BenchVolume(parent, formats[i], c));
+        printf("\n");
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
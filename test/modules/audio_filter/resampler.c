@@ -0,0 +1,239 @@
+/*****************************************************************************
+ * resampler.c: audio resamplers quality and speed benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Build and run the benchmark:
+ * $ cd vlc/build-<name>/modules
+ * $ make libbandlimited_resampler_plugin.la
+ * $ cd ../test
+ * $ make test_modules_audio_filter_resampler
+ * $ ./test_modules_audio_filter_resampler [modules...]
+ *
+ * For each conversion, it prints the speed of the resampler, and the level
+ * of the noise and distortion (THD+N) on a pure tone, relative to the tone.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+static const char *const default_modules[] = {
+    "bandlimited", "speex", "soxr", "samplerate", "ugly",
+};
+
+struct conversion
+{
+    unsigned in_rate;
+    unsigned out_rate;
+    unsigned channels;
+};
+
+static const struct conversion conversions[] = {
+    { 44100, 48000, 2 },
+    { 48000, 44100, 2 },
+    { 48000, 96000, 2 },
+    { 96000, 48000, 2 },
+    { 48000, 48000 + 2 * AOUT_MAX_RESAMPLING, 2 }, /* clock drift */
+    { 44100, 48000, 6 },
+};
+
+#define SECONDS 10
+#define BLOCK_FRAMES 1024
+#define SKIP_SECONDS 1
+
+static const double tones[] = { 1000., 10000. };
+
+static filter_t *CreateResampler(vlc_object_t *parent, const char *name,
+                                 const struct conversion *conv)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    audio_format_t fmt = {
+        .i_format = VLC_CODEC_FL32,
+        .i_rate = conv->in_rate,
+        .i_physical_channels = conv->channels == 6 ? AOUT_CHANS_5_1
+                                                   : AOUT_CHANS_STEREO,
+        .i_chan_mode = 0,
+    };
+    aout_FormatPrepare(&fmt);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio = fmt;
+    es_format_Init(&filter->fmt_out, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_out.audio = fmt;
+    filter->fmt_out.audio.i_rate = conv->out_rate;
+
+    filter->p_module = module_need(filter, "audio resampler", name, true);
+    if (filter->p_module == NULL)
+    {
+        vlc_object_release(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteResampler(filter_t *filter)
+{
+    module_unneed(filter, filter->p_module);
+    vlc_object_release(filter);
+}
+
+/* Returns the level of everything but the tone, relative to the tone, by
+ * least squares fitting of the tone on the first channel. */
+static double THDN(const float *samples, size_t frames, unsigned channels,
+                   double freq, unsigned rate)
+{
+    double ss = 0., sc = 0., cc = 0., ys = 0., yc = 0.;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const double s = sin(2. * M_PI * freq * i / rate);
+        const double c = cos(2. * M_PI * freq * i / rate);
+        const double y = samples[i * channels];
+
+        ss += s * s; sc += s * c; cc += c * c;
+        ys += y * s; yc += y * c;
+    }
+
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det;
+    const double b = (yc * ss - ys * sc) / det;
+    double signal = 0., noise = 0.;
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const double fit = a * sin(2. * M_PI * freq * i / rate)
+                         + b * cos(2. * M_PI * freq * i / rate);
+        const double e = samples[i * channels] - fit;
+
+        signal += fit * fit;
+        noise += e * e;
+    }
+    return 10. * log10(noise / signal);
+}
+
+static void Bench(vlc_object_t *parent, const char *name,
+                  const struct conversion *conv, double freq)
+{
+    filter_t *filter = CreateResampler(parent, name, conv);
+    if (filter == NULL)
+        return;
+
+    const unsigned channels = conv->channels;
+    const size_t max_frames = (size_t)SECONDS * conv->out_rate * 11 / 10;
+    float *out = malloc(max_frames * channels * sizeof (float));
+    size_t out_frames = 0;
+    vlc_tick_t duration = 0;
+    assert(out != NULL);
+
+    for (size_t pos = 0; pos < (size_t)SECONDS * conv->in_rate;
+         pos += BLOCK_FRAMES)
+    {
+        block_t *block = block_Alloc(BLOCK_FRAMES * channels * sizeof (float));
+        assert(block != NULL);
+
+        float *in = (float *)block->p_buffer;
+        for (unsigned i = 0; i < BLOCK_FRAMES; i++)
+        {
+            const float v = .5 * sin(2. * M_PI * freq * (pos + i)
+                                     / conv->in_rate);
+            for (unsigned c = 0; c < channels; c++)
+                *(in++) = v;
+        }
+        block->i_nb_samples = BLOCK_FRAMES;
+        block->i_pts = block->i_dts = VLC_TICK_0
+                     + CLOCK_FREQ * pos / conv->in_rate;
+        block->i_length = CLOCK_FREQ * BLOCK_FRAMES / conv->in_rate;
+
+        vlc_tick_t start = mdate();
+        block = filter->pf_audio_filter(filter, block);
+        duration += mdate() - start;
+
+        if (block == NULL)
+            continue;
+
+        size_t frames = __MIN(block->i_nb_samples, max_frames - out_frames);
+        memcpy(out + out_frames * channels, block->p_buffer,
+               frames * channels * sizeof (float));
+        out_frames += frames;
+        block_Release(block);
+    }
+
+    const size_t skip = SKIP_SECONDS * conv->out_rate;
+    printf("%-22s %6u -> %6u Hz %u ch %5.0f Hz: %7.1f x realtime, "
+           "THD+N %6.1f dB\n", name, conv->in_rate, conv->out_rate,
+           channels, freq,
+           (double)SECONDS * CLOCK_FREQ / __MAX(duration, 1),
+           out_frames > skip ? THDN(out + skip * channels, out_frames - skip,
+                                    channels, freq, conv->out_rate) : 0.);
+
+    free(out);
+    DeleteResampler(filter);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *const *modules = default_modules;
+    size_t count = ARRAY_SIZE(default_modules);
+
+    if (argc > 1)
+    {
+        modules = (const char *const *)(argv + 1);
+        count = argc - 1;
+    }
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    vlc_object_t *parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!module_exists(modules[i]))
+        {
+            printf("%-22s not available\n", modules[i]);
+            continue;
+        }
+
+        for (size_t j = 0; j < ARRAY_SIZE(conversions); j++)
+            for (size_t k = 0; k < ARRAY_SIZE(tones); k++)
+                Bench(parent, modules[i], &conversions[j], tones[k]);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * scaletempo.c: scaletempo speed and quality benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Build and run the benchmark:
+ * $ cd vlc/build-<name>/test
+ * $ make test_modules_audio_filter_scaletempo
+ * $ ./test_modules_audio_filter_scaletempo [rates...]
+ *
+ * For each playback rate, number of channels and search mode, it prints the
+ * speed of the filter, and the level of the splicing noise on a pure tone,
+ * relative to the tone. Since scaletempo shifts the phase of the tone at
+ * every stride, the tone is fitted separately on short windows.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+static const double default_rates[] = { 0.75, 1.25, 1.5, 2., 3. };
+
+static const struct
+{
+    unsigned channels;
+    uint16_t layout;
+} layouts[] = {
+    { 2, AOUT_CHANS_STEREO },
+    { 6, AOUT_CHANS_5_1 },
+    { 8, AOUT_CHANS_7_1 },
+};
+
+#define RATE 48000
+#define SECONDS 10
+#define BLOCK_FRAMES 1024
+#define SKIP_SECONDS 1
+#define WINDOW_FRAMES (RATE / 100)
+
+static const double tones[] = { 440., 3000. };
+
+static filter_t *CreateFilter(vlc_object_t *parent, const char *module,
+                              uint16_t layout, bool fast)
+{
+    filter_t *filter = vlc_object_create(parent, sizeof (*filter));
+    assert(filter != NULL);
+
+    var_Create(filter, "scaletempo-fast-search", VLC_VAR_BOOL);
+    var_SetBool(filter, "scaletempo-fast-search", fast);
+
+    audio_format_t fmt = {
+        .i_format = VLC_CODEC_FL32,
+        .i_rate = RATE,
+        .i_physical_channels = layout,
+        .i_chan_mode = 0,
+    };
+    aout_FormatPrepare(&fmt);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio = fmt;
+    es_format_Init(&filter->fmt_out, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_out.audio = fmt;
+
+    filter->p_module = module_need(filter, "audio filter", module, true);
+    if (filter->p_module == NULL)
+    {
+        vlc_object_release(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    module_unneed(filter, filter->p_module);
+    vlc_object_release(filter);
+}
+
+/* Returns the level of everything but the tone, relative to the tone, by
+ * least squares fitting of the tone on short windows of the first channel */
+static double SpliceNoise(const float *samples, size_t frames,
+                          unsigned channels, double freq)
+{
+    double signal = 0., noise = 0.;
+
+    for (size_t start = 0; start + WINDOW_FRAMES <= frames;
+         start += WINDOW_FRAMES)
+    {
+        const float *window = samples + start * channels;
+        double ss = 0., sc = 0., cc = 0., ys = 0., yc = 0.;
+
+        for (size_t i = 0; i < WINDOW_FRAMES; i++)
+        {
+            const double s = sin(2. * M_PI * freq * i / RATE);
+            const double c = cos(2. * M_PI * freq * i / RATE);
+            const double y = window[i * channels];
+
+            ss += s * s; sc += s * c; cc += c * c;
+            ys += y * s; yc += y * c;
+        }
+
+        const double det = ss * cc - sc * sc;
+        const double a = (ys * cc - yc * sc) / det;
+        const double b = (yc * ss - ys * sc) / det;
+
+        for (size_t i = 0; i < WINDOW_FRAMES; i++)
+        {
+            const double fit = a * sin(2. * M_PI * freq * i / RATE)
+                             + b * cos(2. * M_PI * freq * i / RATE);
+            const double e = window[i * channels] - fit;
+
+            signal += fit * fit;
+            noise += e * e;
+        }
+    }
+    return 10. * log10(noise / signal);
+}
+
+static void Bench(vlc_object_t *parent, double rate, unsigned layout,
+                  double freq, bool fast)
+{
+    const unsigned channels = layouts[layout].channels;
+    filter_t *filter = CreateFilter(parent, "scaletempo",
+                                    layouts[layout].layout, fast);
+    if (filter == NULL)
+    {
+        printf("scaletempo not available\n");
+        return;
+    }
+
+    /* The audio output signals the playback rate through the input rate */
+    filter->fmt_in.audio.i_rate = lround(RATE * rate);
+
+    const size_t max_frames = (size_t)(SECONDS / rate * RATE * 11 / 10);
+    float *out = malloc(max_frames * channels * sizeof (float));
+    size_t out_frames = 0;
+    vlc_tick_t duration = 0;
+    assert(out != NULL);
+
+    for (size_t pos = 0; pos < (size_t)SECONDS * RATE; pos += BLOCK_FRAMES)
+    {
+        block_t *block = block_Alloc(BLOCK_FRAMES * channels * sizeof (float));
+        assert(block != NULL);
+
+        float *in = (float *)block->p_buffer;
+        for (unsigned i = 0; i < BLOCK_FRAMES; i++)
+        {
+            const float v = .5 * sin(2. * M_PI * freq * (pos + i) / RATE);
+            for (unsigned c = 0; c < channels; c++)
+                *(in++) = v;
+        }
+        block->i_nb_samples = BLOCK_FRAMES;
+        block->i_pts = block->i_dts = VLC_TICK_0 + CLOCK_FREQ * pos / RATE;
+        block->i_length = CLOCK_FREQ * BLOCK_FRAMES / RATE;
+
+        vlc_tick_t start = mdate();
+        block = filter->pf_audio_filter(filter, block);
+        duration += mdate() - start;
+
+        if (block == NULL)
+            continue;
+
+        size_t frames = __MIN(block->i_nb_samples, max_frames - out_frames);
+        memcpy(out + out_frames * channels, block->p_buffer,
+               frames * channels * sizeof (float));
+        out_frames += frames;
+        block_Release(block);
+    }
+
+    const size_t skip = SKIP_SECONDS * RATE;
+    printf("%4.2fx %u ch %5.0f Hz %-4s search: %7.1f x realtime, "
+           "splice noise %6.1f dB\n", rate, channels, freq,
+           fast ? "fast" : "full",
+           (double)SECONDS * CLOCK_FREQ / __MAX(duration, 1),
+           out_frames > skip ? SpliceNoise(out + skip * channels,
+                                           out_frames - skip, channels, freq)
+                             : 0.);
+
+    free(out);
+    DeleteFilter(filter);
+}
+
+int main(int argc, char *argv[])
+{
+    double rates[ARRAY_SIZE(default_rates)];
+    size_t count = ARRAY_SIZE(default_rates);
+
+    memcpy(rates, default_rates, sizeof (rates));
+    if (argc > 1)
+    {
+        count = __MIN((size_t)argc - 1, ARRAY_SIZE(rates));
+        for (size_t i = 0; i < count; i++)
+            rates[i] = atof(argv[i + 1]);
+    }
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    vlc_object_t *parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = 0; j < ARRAY_SIZE(layouts); j++)
+            for (size_t k = 0; k < ARRAY_SIZE(tones); k++)
+            {
+                Bench(parent, rates[i], j, tones[k], false);
+                Bench(parent, rates[i], j, tones[k], true);
+            }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * clock.c: test for the input clock smoothing
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * A real-time source sends a clock reference every 40ms, with a clock
+ * running 100ppm faster than the system clock. The references are received
+ * with a random network delay of up to 30ms. The test checks how much the
+ * converted timestamps wobble around the ideal mapping with both smoothing
+ * modes, and the clock statistics.
+ */
+
+/* The clock functions are not exported by libvlccore */
+#include "../../../src/input/clock.c"
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+
+#include <vlc/vlc.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+const char vlc_module_name[] = "test_src_input_clock";
+
+#define PCR_PERIOD  (CLOCK_FREQ / 25)
+#define PCR_COUNT   (25 * 120)
+#define SKEW        (100) /* ppm */
+#define JITTER_MAX  (CLOCK_FREQ * 30 / 1000)
+#define WARMUP      (25 * 10)
+
+static vlc_object_t *parent;
+
+static vlc_tick_t Jitter(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return (*seed >> 8) % JITTER_MAX;
+}
+
+/* Returns the peak to peak distance between the converted timestamps and
+ * the ideal mapping, once the estimation has settled */
+static vlc_tick_t Run(int smoothing, input_clock_stats_t *stats)
+{
+    const vlc_tick_t stream0 = CLOCK_FREQ;
+    const vlc_tick_t system0 = 1000 * CLOCK_FREQ;
+    vlc_tick_t min = INT64_MAX, max = INT64_MIN;
+    vlc_tick_t ideal, first_jitter = 0;
+    uint32_t seed = 0x12345678;
+
+    input_clock_t *cl = input_clock_New(INPUT_RATE_DEFAULT, smoothing);
+    assert(cl != NULL);
+    input_clock_SetJitter(cl, 0, 100);
+
+    for (unsigned i = 0; i < PCR_COUNT; i++)
+    {
+        const vlc_tick_t stream = stream0 + i * PCR_PERIOD;
+        const vlc_tick_t jitter = Jitter(&seed);
+        bool late;
+
+        ideal = system0 + i * PCR_PERIOD - i * PCR_PERIOD * SKEW / 1000000;
+        if (i == 0)
+            first_jitter = jitter;
+
+        input_clock_Update(cl, parent, &late, false, false,
+                           stream, ideal + jitter);
+
+        vlc_tick_t ts = stream;
+        int val = input_clock_ConvertTS(parent, cl, NULL, &ts, NULL,
+                                        INT64_MAX);
+        assert(val == VLC_SUCCESS);
+
+        if (i >= WARMUP)
+        {
+            min = __MIN(min, ts - ideal);
+            max = __MAX(max, ts - ideal);
+        }
+    }
+
+    input_clock_GetStats(cl, stats);
+    assert(stats->i_resets == 1);
+
+    /* The regression follows the skew, on top of the mean network delay
+     * relative to the first reference */
+    if (smoothing == INPUT_CLOCK_SMOOTHING_REGRESSION)
+    {
+        const vlc_tick_t drift = (ideal - system0) - (PCR_COUNT - 1) * PCR_PERIOD
+                               + JITTER_MAX / 2 - first_jitter;
+        assert(llabs(stats->i_drift - drift) < 1000);
+    }
+
+    /* Reference points set on request and on discontinuities */
+    bool late;
+    input_clock_Reset(cl);
+    input_clock_Update(cl, parent, &late, false, false,
+                       stream0, system0);
+    input_clock_Update(cl, parent, &late, false, false,
+                       stream0 + 2 * CR_MAX_GAP, system0 + PCR_PERIOD);
+
+    input_clock_stats_t after;
+    input_clock_GetStats(cl, &after);
+    assert(after.i_resets == 3);
+    input_clock_Delete(cl);
+
+    return max - min;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    input_clock_stats_t avg, reg;
+    const vlc_tick_t avg_wobble = Run(INPUT_CLOCK_SMOOTHING_AVERAGE, &avg);
+    const vlc_tick_t reg_wobble = Run(INPUT_CLOCK_SMOOTHING_REGRESSION, &reg);
+
+    printf("wobble: average %"PRId64" us, regression %"PRId64" us\n",
+           avg_wobble, reg_wobble);
+    printf("drift: average %"PRId64" us, regression %"PRId64" us\n",
+           avg.i_drift, reg.i_drift);
+
+    /* Every reference but the first one is in the histogram */
+    uint64_t total = 0;
+    for (unsigned i = 0; i < INPUT_CLOCK_JITTER_BUCKETS; i++)
+    {
+        printf("jitter < %4u ms: %5"PRIu64" %5"PRIu64"\n", 1u << i,
+               avg.pi_jitter[i], reg.pi_jitter[i]);
+        total += reg.pi_jitter[i];
+    }
+    assert(total == PCR_COUNT - 1);
+    assert(reg.i_jitter_sum > 0);
+
+    /* The network delay stays within 30ms of the regression line */
+    for (unsigned i = 6; i < INPUT_CLOCK_JITTER_BUCKETS; i++)
+        assert(reg.pi_jitter[i] == 0);
+
+
+    /* The regression follows the skew and filters the jitter out */
+    assert(reg_wobble < 5000);
+    assert(reg_wobble < avg_wobble);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*****************************************************************************
+ * probe.c: demux probing benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Build and run the benchmark:
+ * $ cd vlc/build-<name>/test
+ * $ make test_src_input_probe
+ * $ ./test_src_input_probe [-v]
+ *
+ * A small corpus of synthetic files is generated in memory, one per
+ * container, without file name extensions. For each file, it prints the
+ * demuxer which accepted it and the time taken to find it. With -v, the
+ * debug messages show the time taken by each probed demuxer.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_modules.h>
+#include <vlc_stream.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#define SIZE (64 * 1024)
+#define RUNS 20
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    (void) fmt;
+    return (es_out_id_t *)out;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    (void) out; (void) id;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete(es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out; (void) query; (void) args;
+    return VLC_EGENERIC;
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static void SetLE(uint8_t *p, uint32_t v, unsigned bytes)
+{
+    for (unsigned i = 0; i < bytes; i++)
+        p[i] = v >> (8 * i);
+}
+
+static void SetBE(uint8_t *p, uint32_t v, unsigned bytes)
+{
+    for (unsigned i = 0; i < bytes; i++)
+        p[i] = v >> (8 * (bytes - 1 - i));
+}
+
+static void MakeWav(uint8_t *p)
+{
+    memcpy(p, "RIFF", 4);
+    SetLE(p + 4, SIZE - 8, 4);
+    memcpy(p + 8, "WAVEfmt ", 8);
+    SetLE(p + 16, 16, 4);
+    SetLE(p + 20, 1, 2);          /* PCM */
+    SetLE(p + 22, 2, 2);          /* channels */
+    SetLE(p + 24, 44100, 4);
+    SetLE(p + 28, 44100 * 4, 4);
+    SetLE(p + 32, 4, 2);
+    SetLE(p + 34, 16, 2);
+    memcpy(p + 36, "data", 4);
+    SetLE(p + 40, SIZE - 44, 4);
+}
+
+static void MakeAu(uint8_t *p)
+{
+    memcpy(p, ".snd", 4);
+    SetBE(p + 4, 24, 4);
+    SetBE(p + 8, SIZE - 24, 4);
+    SetBE(p + 12, 3, 4);          /* 16-bits linear */
+    SetBE(p + 16, 8000, 4);
+    SetBE(p + 20, 1, 4);
+}
+
+static void MakeVoc(uint8_t *p)
+{
+    memcpy(p, "Creative Voice File\x1a", 20);
+    SetLE(p + 20, 26, 2);
+    SetLE(p + 22, 0x10a, 2);
+    SetLE(p + 24, ~0x10a + 0x1234, 2);
+    p[26] = 1;                    /* sound data */
+    SetLE(p + 27, SIZE - 32, 3);
+    p[30] = 0x9c;                 /* 10 kHz */
+    p[31] = 0;                    /* 8-bits */
+}
+
+static void MakeAiff(uint8_t *p)
+{
+    static const uint8_t rate[10] = {
+        0x40, 0x0e, 0xac, 0x44, 0, 0, 0, 0, 0, 0 }; /* 44100 */
+
+    memcpy(p, "FORM", 4);
+    SetBE(p + 4, SIZE - 8, 4);
+    memcpy(p + 8, "AIFFCOMM", 8);
+    SetBE(p + 16, 18, 4);
+    SetBE(p + 20, 2, 2);
+    SetBE(p + 22, (SIZE - 54) / 4, 4);
+    SetBE(p + 26, 16, 2);
+    memcpy(p + 28, rate, 10);
+    memcpy(p + 38, "SSND", 4);
+    SetBE(p + 42, SIZE - 46, 4);
+}
+
+static void MakeMkv(uint8_t *p)
+{
+    static const uint8_t ebml[] = {
+        0x1a, 0x45, 0xdf, 0xa3, 0x93,
+        0x42, 0x82, 0x88, 'm', 'a', 't', 'r', 'o', 's', 'k', 'a',
+        0x42, 0x87, 0x81, 0x02, 0x42, 0x85, 0x81, 0x02,
+    };
+    memcpy(p, ebml, sizeof (ebml));
+}
+
+static void MakeMpga(uint8_t *p)
+{
+    /* MPEG-1 layer III, 128 kb/s, 44.1 kHz: 417 bytes per frame */
+    for (size_t i = 0; i + 4 <= SIZE; i += 417)
+        SetBE(p + i, 0xfffb9000, 4);
+}
+
+static void MakeTs(uint8_t *p)
+{
+    for (size_t i = 0; i + 4 <= SIZE; i += 188)
+        SetBE(p + i, 0x471fff10, 4); /* null packets */
+}
+
+static void MakeNoise(uint8_t *p)
+{
+    uint32_t seed = 0x12345678;
+
+    for (size_t i = 0; i < SIZE; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        p[i] = seed >> 24;
+    }
+}
+
+static const struct
+{
+    const char *name;
+    void (*make)(uint8_t *);
+} corpus[] = {
+    { "wav",   MakeWav },
+    { "au",    MakeAu },
+    { "voc",   MakeVoc },
+    { "aiff",  MakeAiff },
+    { "mkv",   MakeMkv },
+    { "mpga",  MakeMpga },
+    { "ts",    MakeTs },
+    { "noise", MakeNoise },
+};
+
+static void Bench(vlc_object_t *parent, const char *name,
+                  void (*make)(uint8_t *))
+{
+    uint8_t *buf = calloc(1, SIZE);
+    assert(buf != NULL);
+    make(buf);
+
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDelete,
+        .pf_control = EsOutControl,
+        .pf_destroy = EsOutDestroy,
+    };
+    char module[32] = "none";
+    mtime_t duration = 0;
+
+    for (unsigned r = 0; r < RUNS; r++)
+    {
+        stream_t *s = vlc_stream_MemoryNew(parent, buf, SIZE, true);
+        assert(s != NULL);
+
+        mtime_t start = mdate();
+        demux_t *demux = demux_New(parent, "any", "probe", s, &out);
+        duration += mdate() - start;
+
+        if (demux != NULL)
+        {
+            snprintf(module, sizeof (module), "%s",
+                     module_get_object(demux->p_module));
+            demux_Delete(demux); /* deletes the stream too */
+        }
+        else
+            vlc_stream_Delete(s);
+    }
+    free(buf);
+
+    printf("%-6s %-10s %10.1f\n", name, module, (double)duration / RUNS);
+}
+
+int main(int argc, char *argv[])
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    bool verbose = argc > 1 && !strcmp(argv[1], "-v");
+    const char *args[] = { verbose ? "-vv" : "-q" };
+
+    libvlc_instance_t *vlc = libvlc_new(1, args);
+    assert(vlc != NULL);
+
+    vlc_object_t *parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    printf("%-6s %-10s %10s\n", "file", "demux", "us/probe");
+    for (size_t i = 0; i < ARRAY_SIZE(corpus); i++)
+        Bench(parent, corpus[i].name, corpus[i].make);
+
+    libvlc_release(vlc);
+    return 0;
+}